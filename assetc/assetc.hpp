@@ -0,0 +1,41 @@
+#pragma once
+
+#ifndef ASSETC_HPP
+#define ASSETC_HPP
+
+#include "asset_manifest.hpp"
+
+#include <string>
+#include <vector>
+
+/** Conversion d'un fichier source de data/ */
+struct asset_job
+{
+  /** chemin relatif au repertoire source */
+  std::string relative;
+  /** chemins complets du source et du prefixe de sortie (destination/relative) */
+  std::string source;
+  std::string destination;
+  /** hachage du contenu du source et de la version du convertisseur */
+  unsigned long long hash;
+  /** fichiers produits (chemins relatifs a la destination) */
+  std::vector<std::string> outputs;
+  /** compte-rendu de la conversion (vide si erreur) */
+  std::string report;
+  /** message d'erreur (vide si succes) */
+  std::string error;
+};
+
+/** Maillage obj/off: normales, ordre des triangles pour le cache de sommets, indices 16 bits, boite et BVH */
+void compile_mesh(asset_job* job);
+/** Image tga/jpg: chaine de mipmaps complete compressee en BC1 (opaque) ou BC3 au format KTX */
+void compile_texture(asset_job* job);
+
+/** Liste recursive des fichiers du repertoire (chemins relatifs, separateur '/') */
+std::vector<std::string> list_files(const std::string& directory);
+/** Cree le repertoire et ses parents si besoin */
+bool make_directories(const std::string& path);
+/** Indique si le fichier existe */
+bool file_exists(const std::string& filename);
+
+#endif
@@ -0,0 +1,40 @@
+
+#include "assetc.hpp"
+
+#include "bvh.hpp"
+#include "mesh.hpp"
+#include "mesh_asset.hpp"
+#include "mesh_cache.hpp"
+#include "mesh_optimize.hpp"
+
+#include <cstdio>
+
+void compile_mesh(asset_job* job)
+{
+  const std::string& source=job->source;
+  mesh m=mesh_loader_for(source)(source);
+  if(m.connectivity.empty())
+    throw std::string("Empty mesh in file "+source);
+
+  if(!has_normals(&m))
+    update_normals(&m);
+
+  const float acmr_before=average_cache_miss_ratio(&m,32);
+  optimize_vertex_cache(&m);
+  optimize_vertex_fetch(&m);
+  const float acmr_after=average_cache_miss_ratio(&m,32);
+
+  const mesh_asset asset=build_mesh_asset(m);
+  save_mesh_asset(job->destination+".msh",asset);
+  job->outputs.push_back(job->relative+".msh");
+
+  const bvh b=build_bvh(&m);
+  save_bvh(job->destination+".bvh",b);
+  job->outputs.push_back(job->relative+".bvh");
+
+  char report[256];
+  std::snprintf(report,sizeof(report),"%u sommets, %u triangles, indices %u bits, ACMR %.2f -> %.2f, BVH %u noeuds",
+      static_cast<unsigned int>(m.vertex.size()),static_cast<unsigned int>(m.connectivity.size()),8*asset.index_size,
+      acmr_before,acmr_after,static_cast<unsigned int>(b.nodes.size()));
+  job->report=report;
+}
@@ -0,0 +1,36 @@
+
+#include "assetc.hpp"
+
+#include "image.hpp"
+#include "ktx.hpp"
+#include "texture_compress.hpp"
+
+#include <cstdio>
+#include <memory>
+
+void compile_texture(asset_job* job)
+{
+  //decodeur natif pour les tga, stb pour les autres formats
+  std::unique_ptr<Image> image(image_load_tga(job->source));
+  if(!image)
+    throw std::string("Cannot read image "+job->source);
+
+  const int width=image->width,height=image->height;
+  const texture_data source=texture_from_image(*image,true);
+  image.reset();
+
+  //hors ligne: la qualite la plus elevee, BC1 pour les images opaques et BC3 sinon
+  const block_format format=choose_block_format(&source.levels[0].data[0],static_cast<size_t>(width)*height);
+  const texture_data texture=compress_texture(source,format,compress_high);
+  const double psnr=texture_psnr(source,texture);
+
+  save_ktx(job->destination+".ktx",texture);
+  job->outputs.push_back(job->relative+".ktx");
+
+  const size_t size=texture_memory(texture);
+  char report[256];
+  std::snprintf(report,sizeof(report),"%dx%d %s, %u niveaux, %.1f Ko (RGBA8 %.1f Ko), PSNR %.1f dB",width,height,
+      format==block_bc1 ? "BC1" : "BC3",static_cast<unsigned int>(texture.levels.size()),size/1024.0,
+      texture_memory(source)/1024.0,psnr);
+  job->report=report;
+}
@@ -0,0 +1,89 @@
+
+#include "assetc.hpp"
+
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <direct.h>
+#else
+#include <dirent.h>
+#endif
+
+namespace
+{
+  void list_files_recursive(const std::string& root,const std::string& relative,std::vector<std::string>& files)
+  {
+    const std::string directory=relative.empty() ? root : root+"/"+relative;
+#ifdef _WIN32
+    WIN32_FIND_DATAA entry;
+    HANDLE handle=FindFirstFileA((directory+"/*").c_str(),&entry);
+    if(handle==INVALID_HANDLE_VALUE)
+      return;
+    do
+    {
+      const std::string name=entry.cFileName;
+      if(name=="." || name=="..")
+        continue;
+      const std::string path=relative.empty() ? name : relative+"/"+name;
+      if(entry.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+        list_files_recursive(root,path,files);
+      else
+        files.push_back(path);
+    } while(FindNextFileA(handle,&entry));
+    FindClose(handle);
+#else
+    DIR* dir=opendir(directory.c_str());
+    if(dir==nullptr)
+      return;
+    while(dirent* entry=readdir(dir))
+    {
+      const std::string name=entry->d_name;
+      if(name=="." || name=="..")
+        continue;
+      const std::string path=relative.empty() ? name : relative+"/"+name;
+      struct stat info;
+      if(stat((root+"/"+path).c_str(),&info)!=0)
+        continue;
+      if(S_ISDIR(info.st_mode))
+        list_files_recursive(root,path,files);
+      else
+        files.push_back(path);
+    }
+    closedir(dir);
+#endif
+  }
+}
+
+std::vector<std::string> list_files(const std::string& directory)
+{
+  std::vector<std::string> files;
+  list_files_recursive(directory,"",files);
+  return files;
+}
+
+bool make_directories(const std::string& path)
+{
+  for(size_t k=1;k<=path.size();++k)
+  {
+    if(k<path.size() && path[k]!='/')
+      continue;
+    const std::string parent=path.substr(0,k);
+#ifdef _WIN32
+    _mkdir(parent.c_str());
+#else
+    mkdir(parent.c_str(),0755);
+#endif
+  }
+  struct stat info;
+  return stat(path.c_str(),&info)==0;
+}
+
+bool file_exists(const std::string& filename)
+{
+  struct stat info;
+  return stat(filename.c_str(),&info)==0;
+}
@@ -0,0 +1,207 @@
+/*****************************************************************************\
+ * Compilateur d'assets
+ * --------------
+ *
+ * ./build/assetc [source] [destination] [-f]
+ * ./build/assetc -pack [-c] fichier.pak repertoire_1 repertoire_2 ...
+ *
+ * Convertit les fichiers de source (data par defaut) en formats prets pour
+ * l'execution dans destination (assets par defaut):
+ *  - maillages obj/off/ply/gltf -> .msh (sommets + indices optimises) et .bvh
+ *  - images tga/jpg -> .ktx (mipmaps compressees en BC1 ou BC3)
+ * Seuls les fichiers dont le contenu a change depuis la derniere execution
+ * sont reconvertis (manifest.txt), -f force la reconstruction complete.
+ *
+ * -pack regroupe tous les fichiers des repertoires dans un seul pack, chacun
+ * sous son chemin relatif (shaders/shader.vert, data/nathan.tga, ...).
+ * Avec -c les maillages et textures sont compresses en blocs LZ4 quand le gain en vaut la peine.
+ \*****************************************************************************/
+
+#include "assetc.hpp"
+
+#include "pack_file.hpp"
+#include "thread_pool.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <iostream>
+
+namespace
+{
+  enum asset_kind {asset_none,asset_mesh,asset_texture};
+
+  asset_kind kind_of(const std::string& filename)
+  {
+    const size_t dot=filename.find_last_of('.');
+    if(dot==std::string::npos)
+      return asset_none;
+    std::string ext=filename.substr(dot+1);
+    std::transform(ext.begin(),ext.end(),ext.begin(),::tolower);
+    if(ext=="obj" || ext=="off" || ext=="ply" || ext=="gltf" || ext=="glb")
+      return asset_mesh;
+    if(ext=="tga" || ext=="jpg" || ext=="jpeg" || ext=="png")
+      return asset_texture;
+    return asset_none;
+  }
+
+  bool up_to_date(const asset_manifest& entries,const asset_job& job,const std::string& destination)
+  {
+    asset_manifest::const_iterator it=entries.find(job.relative);
+    if(it==entries.end() || it->second.first!=job.hash)
+      return false;
+    for(unsigned int k=0;k<it->second.second.size();++k)
+      if(!file_exists(destination+"/"+it->second.second[k]))
+        return false;
+    return true;
+  }
+
+  int build_pack(const std::string& filename,const std::vector<std::string>& directories,bool compress)
+  {
+    pack_writer writer;
+    int nb_file=0;
+    for(unsigned int d=0;d<directories.size();++d)
+    {
+      const std::vector<std::string> files=list_files(directories[d]);
+      for(unsigned int k=0;k<files.size();++k)
+      {
+        const std::string name=directories[d]+"/"+files[k];
+        if(!writer.add_file(name,name,compress && kind_of(name)!=asset_none))
+        {
+          std::cerr<<"Lecture impossible: "<<name<<std::endl;
+          return 1;
+        }
+        ++nb_file;
+      }
+    }
+    if(!writer.write(filename))
+    {
+      std::cerr<<"Ecriture impossible: "<<filename<<std::endl;
+      return 1;
+    }
+    std::cout<<filename<<": "<<nb_file<<" fichier(s)";
+    pack_file pack;
+    if(pack.open(filename))
+    {
+      unsigned long long raw_size=0,size=0;
+      for(unsigned int k=0;k<pack.entries().size();++k)
+      {
+        raw_size+=pack.entries()[k].raw_size;
+        size+=pack.entries()[k].size;
+      }
+      std::cout<<", "<<raw_size/1024<<" Ko -> "<<size/1024<<" Ko";
+    }
+    std::cout<<std::endl;
+    return 0;
+  }
+}
+
+int main(int argc,char** argv)
+{
+  if(argc>2 && std::string(argv[1])=="-pack")
+  {
+    const bool compress=std::string(argv[2])=="-c";
+    const int first=compress ? 3 : 2;
+    if(argc<=first)
+      return 1;
+    return build_pack(argv[first],std::vector<std::string>(argv+first+1,argv+argc),compress);
+  }
+
+  std::string source=asset_source_directory;
+  std::string destination=asset_directory;
+  bool force=false;
+  int nb_path=0;
+  for(int k=1;k<argc;++k)
+  {
+    const std::string arg=argv[k];
+    if(arg=="-f")         force=true;
+    else if(nb_path==0)   { source=arg; ++nb_path; }
+    else                  { destination=arg; ++nb_path; }
+  }
+
+  if(!make_directories(destination))
+  {
+    std::cerr<<"Impossible de creer le repertoire "<<destination<<std::endl;
+    return 1;
+  }
+
+  const std::string manifest_filename=destination+"/manifest.txt";
+  asset_manifest entries=force ? asset_manifest() : read_asset_manifest(manifest_filename);
+
+  //les travaux a refaire, selon le hachage du contenu
+  std::vector<asset_job> jobs;
+  std::vector<asset_kind> kinds;
+  const std::vector<std::string> files=list_files(source);
+  int nb_up_to_date=0;
+  for(unsigned int k=0;k<files.size();++k)
+  {
+    const asset_kind kind=kind_of(files[k]);
+    if(kind==asset_none)
+      continue;
+
+    asset_job job;
+    job.relative=files[k];
+    job.source=source+"/"+files[k];
+    job.destination=destination+"/"+files[k];
+    if(!hash_asset_source(job.source,&job.hash))
+    {
+      std::cerr<<"Lecture impossible: "<<job.source<<std::endl;
+      continue;
+    }
+    if(up_to_date(entries,job,destination))
+    {
+      ++nb_up_to_date;
+      continue;
+    }
+
+    const size_t slash=job.destination.find_last_of('/');
+    make_directories(job.destination.substr(0,slash));
+    jobs.push_back(job);
+    kinds.push_back(kind);
+  }
+
+  //les sources supprimes sortent du manifest
+  for(asset_manifest::iterator it=entries.begin();it!=entries.end();)
+  {
+    if(std::find(files.begin(),files.end(),it->first)==files.end()) entries.erase(it++);
+    else                                                            ++it;
+  }
+
+  //conversions en parallele, chaque travail ecrit ses propres fichiers
+  task_group group(default_thread_pool());
+  for(unsigned int k=0;k<jobs.size();++k)
+  {
+    asset_job* job=&jobs[k];
+    const asset_kind kind=kinds[k];
+    group.run([job,kind]() {
+      try
+      {
+        if(kind==asset_mesh) compile_mesh(job);
+        else                 compile_texture(job);
+      }
+      catch(const std::string& e)
+      {
+        job->error=e;
+      }
+    });
+  }
+  group.wait();
+
+  int nb_error=0;
+  for(unsigned int k=0;k<jobs.size();++k)
+  {
+    const asset_job& job=jobs[k];
+    if(!job.error.empty())
+    {
+      std::cerr<<"[erreur] "<<job.relative<<": "<<job.error<<std::endl;
+      entries.erase(job.relative);
+      ++nb_error;
+      continue;
+    }
+    std::cout<<"[ok] "<<job.relative<<": "<<job.report<<std::endl;
+    entries[job.relative]=std::make_pair(job.hash,job.outputs);
+  }
+  write_asset_manifest(manifest_filename,entries);
+
+  std::cout<<jobs.size()-nb_error<<" converti(s), "<<nb_up_to_date<<" a jour, "<<nb_error<<" erreur(s)"<<std::endl;
+  return nb_error>0 ? 1 : 0;
+}
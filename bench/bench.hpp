@@ -0,0 +1,47 @@
+#pragma once
+
+#ifndef BENCH_HPP
+#define BENCH_HPP
+
+#include <chrono>
+
+/** Mesures de performance des modules de tools/ (hors OpenGL) */
+
+/** broadphase: grille hachee et balayage trie pour 10 a 100000 objets en mouvement */
+void bench_broadphase();
+/** demi-aretes: construction comparee a une table d'aretes std::map, normales par etoile, anneaux, bords et bascules verifies contre une reference */
+void bench_half_edge();
+/** chargement obj: ancien parseur a base de stringstream contre le parseur projete en memoire */
+void bench_obj();
+/** obj en flux par fenetres de taille fixe: memoire bornee contre chargement complet */
+void bench_obj_stream();
+/** chargement off: ancien parseur contre le parseur decoupe en blocs de lignes traites en parallele */
+void bench_off();
+/** chargement ply ascii et binaire (petit et gros-boutiste) compare au off */
+void bench_ply();
+/** chargement gltf binaire (glb): ouverture projetee et conversion en mesh, compare a l'obj */
+void bench_gltf();
+/** compression lz4 par blocs: taux et debits de compression et de decompression parallele */
+void bench_lz4();
+/** compression de textures BC1/BC3/BC4/BC5: debit et PSNR selon la qualite, chargement sans cache, avec cache et depuis un ktx */
+void bench_texture_compress();
+/** decodage tga: decodeur natif (RLE, conversion BGR(A) en SSE2) contre stb, et vue sans copie des tga brutes */
+void bench_tga();
+/** decodage d'images: tga et jpg seules puis plusieurs en parallele sur le pool, et variante sans perte retenue selon les options (png genere a partir de route1) */
+void bench_image_decode();
+/** atlas de textures: placement skyline de rectangles aleatoires et regroupement des petites textures du jeu, sans et avec cache */
+void bench_atlas();
+
+/** Chronometre simple en millisecondes */
+struct chrono_ms
+{
+  std::chrono::high_resolution_clock::time_point start;
+
+  chrono_ms():start(std::chrono::high_resolution_clock::now()) {}
+  double elapsed() const
+  {
+    return std::chrono::duration<double,std::milli>(std::chrono::high_resolution_clock::now()-start).count();
+  }
+};
+
+#endif
@@ -0,0 +1,72 @@
+
+#include "bench.hpp"
+
+#include "atlas_packer.hpp"
+#include "texture_atlas.hpp"
+#include "texture_cache.hpp"
+
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+void bench_atlas()
+{
+  //rectangles aleatoires de 8 a 256 texels: nombre de pages et remplissage
+  std::printf("%-12s %12s %10s %14s\n","rectangles","temps (ms)","pages","remplissage");
+  const int counts[]={100,1000,10000};
+  for(unsigned int c=0;c<sizeof(counts)/sizeof(counts[0]);++c)
+  {
+    std::mt19937 random(1);
+    std::uniform_int_distribution<int> side(8,256);
+    std::vector<std::pair<int,int> > sizes(counts[c]);
+    long long area=0;
+    for(unsigned int k=0;k<sizes.size();++k)
+    {
+      sizes[k]=std::make_pair(side(random),side(random));
+      area+=static_cast<long long>(sizes[k].first)*sizes[k].second;
+    }
+    int nb_page=0;
+    chrono_ms chrono;
+    pack_rectangles(sizes,2048,2048,&nb_page);
+    const double t=chrono.elapsed();
+    std::printf("%-12d %12.3f %10d %13.1f%%\n",counts[c],t,nb_page,100.0*area/(nb_page*2048.0*2048.0));
+  }
+
+  //textures du jeu regroupees comme dans main.cpp, avec et sans compression des couches, sans puis avec cache
+  const std::vector<std::string> files={"data/stegosaurus.tga","data/white.tga","data/fontB.tga","data/nathan.tga"};
+  const bool compression=texture_compression_enabled();
+  for(int config=0;config<2;++config)
+  {
+    set_texture_compression_enabled(config==1);
+    const std::string cache=texture_atlas_cache_filename(files,1024,8);
+    std::remove((cache+".txt").c_str());
+    chrono_ms chrono;
+    const texture_atlas atlas=load_texture_atlas(files,1024,8);
+    const double t=chrono.elapsed();
+    chrono_ms chrono_cache;
+    const texture_atlas cached=load_texture_atlas(files,1024,8);
+    const double t_cache=chrono_cache.elapsed();
+
+    bool same=cached.layers.size()==atlas.layers.size() && cached.entries.size()==atlas.entries.size() && cached.nb_level==atlas.nb_level;
+    for(unsigned int l=0;same && l<atlas.layers.size();++l)
+      for(int k=0;k<atlas.nb_level;++k)
+        same=same && cached.layers[l].levels[k].data==atlas.layers[l].levels[k].data;
+    for(unsigned int k=0;same && k<atlas.entries.size();++k)
+      same=cached.entries[k].layer==atlas.entries[k].layer && cached.entries[k].x==atlas.entries[k].x && cached.entries[k].y==atlas.entries[k].y;
+    std::printf("\natlas %dx%d, %u couche(s), %d niveaux, %s: %.1f ms, cache %.2f ms (%s), %.1f Ko\n",atlas.width,atlas.height,
+        static_cast<unsigned int>(atlas.layers.size()),atlas.nb_level,config==1 ? "compresse" : "RGBA8",t,t_cache,
+        same ? "identique" : "DIFFERENT",texture_memory(atlas)/1024.0);
+    std::remove((cache+".txt").c_str());
+    for(unsigned int l=0;l<atlas.layers.size();++l)
+      std::remove((cache+"."+std::to_string(l)+".ktx").c_str());
+    if(config==1)
+      continue;
+    for(unsigned int k=0;k<atlas.entries.size();++k)
+    {
+      const atlas_entry& e=atlas.entries[k];
+      std::printf("  %-24s couche %d  %4d,%-4d %4dx%-4d\n",files[k].c_str(),e.layer,e.x,e.y,e.width,e.height);
+    }
+  }
+  set_texture_compression_enabled(compression);
+}
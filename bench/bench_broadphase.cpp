@@ -0,0 +1,146 @@
+
+#include "bench.hpp"
+
+#include "broadphase.hpp"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+namespace
+{
+  /** objets de la taille d'un dinosaure circulant sur des voies paralleles a x */
+  struct lane_scene
+  {
+    std::vector<vec3> position;
+    std::vector<float> speed;
+    vec3 half_size;
+    float length;
+
+    lane_scene(int N)
+      :half_size(2.5f,1.0f,1.0f)
+    {
+      //densite constante: une voie de largeur 3 tous les 3 metres, 1 objet pour 25 m2
+      const float side=std::sqrt(25.0f*N);
+      length=side;
+      srand(42);
+      for(int k=0;k<N;++k)
+      {
+        const float lane=std::floor(side/3.0f*(rand()/(RAND_MAX+1.0f)));
+        position.push_back(vec3(side*(rand()/(RAND_MAX+1.0f)),0.0f,3.0f*lane));
+        const float v=0.25f+rand()/(RAND_MAX+1.0f);
+        speed.push_back(static_cast<int>(lane)%2==0 ? v : -v);
+      }
+    }
+
+    void step()
+    {
+      for(unsigned int k=0;k<position.size();++k)
+      {
+        float& x=position[k].x;
+        x+=speed[k];
+        if(x>length) x-=length;
+        if(x<0.0f)   x+=length;
+      }
+    }
+
+    void boxes(std::vector<aabb>* b) const
+    {
+      b->resize(position.size());
+      for(unsigned int k=0;k<position.size();++k)
+        (*b)[k]=aabb(position[k]-half_size,position[k]+half_size);
+    }
+  };
+
+  unsigned int brute_force_pairs(const std::vector<aabb>& b)
+  {
+    unsigned int n=0;
+    for(unsigned int i=0;i<b.size();++i)
+      for(unsigned int j=i+1;j<b.size();++j)
+        n+=overlap(b[i],b[j]);
+    return n;
+  }
+}
+
+void bench_broadphase()
+{
+  const int sizes[]={10,100,1000,10000,100000};
+  std::printf("%8s %12s %12s %12s %12s %10s %12s %5s %10s %10s\n","objets","brute (ms)","rebuild (ms)","update (ms)","sap x (ms)","echanges",
+              "sap (ms)","axe","echanges","paires");
+
+  for(unsigned int s=0;s<sizeof(sizes)/sizeof(sizes[0]);++s)
+  {
+    const int N=sizes[s];
+    const int nb_tick=N>=100000 ? 10 : 50;
+
+    lane_scene scene_rebuild(N),scene_update(N),scene_sap_x(N),scene_sap(N);
+    spatial_hash h_rebuild(8.0f),h_update(8.0f);
+    //axe x impose (le long des voies) contre axe choisi automatiquement
+    sweep_and_prune sap_x(0),sap;
+    std::vector<aabb> boxes;
+    std::vector<broadphase_pair> pairs;
+    double t_rebuild=0.0,t_update=0.0,t_sap_x=0.0,t_sap=0.0,t_brute=-1.0;
+    unsigned int nb_pair=0,nb_pair_brute=0,nb_swap_x=0,nb_swap=0;
+
+    for(int tick=0;tick<nb_tick;++tick)
+    {
+      scene_rebuild.step();
+      scene_rebuild.boxes(&boxes);
+      spatial_hash_rebuild(&h_rebuild,boxes);
+      spatial_hash_pairs(&h_rebuild,&pairs);
+      t_rebuild+=h_rebuild.stats.update_ms;
+
+      scene_update.step();
+      scene_update.boxes(&boxes);
+      spatial_hash_update(&h_update,boxes);
+      spatial_hash_pairs(&h_update,&pairs);
+      t_update+=h_update.stats.update_ms;
+      nb_pair=h_update.stats.nb_pair;
+
+      scene_sap_x.step();
+      scene_sap_x.boxes(&boxes);
+      sweep_and_prune_update(&sap_x,boxes);
+      sweep_and_prune_pairs(&sap_x,&pairs);
+      if(tick>0)
+      {
+        t_sap_x+=sap_x.stats.update_ms;
+        nb_swap_x+=sap_x.nb_swap;
+      }
+      if(sap_x.stats.nb_pair!=nb_pair)
+        std::printf("  erreur: %u paires par balayage sur x, %u par grille\n",sap_x.stats.nb_pair,nb_pair);
+
+      scene_sap.step();
+      scene_sap.boxes(&boxes);
+      sweep_and_prune_update(&sap,boxes);
+      sweep_and_prune_pairs(&sap,&pairs);
+      if(tick>0)
+      {
+        t_sap+=sap.stats.update_ms;
+        nb_swap+=sap.nb_swap;
+      }
+      if(sap.stats.nb_pair!=nb_pair)
+        std::printf("  erreur: %u paires par balayage, %u par grille\n",sap.stats.nb_pair,nb_pair);
+    }
+
+    if(N<=10000)
+    {
+      chrono_ms chrono;
+      nb_pair_brute=brute_force_pairs(boxes);
+      t_brute=chrono.elapsed();
+      if(nb_pair_brute!=nb_pair)
+        std::printf("  erreur: %u paires attendues, %u trouvees\n",nb_pair_brute,nb_pair);
+    }
+
+    //le premier pas du balayage (tri complet) n'est pas compte
+    const double t_sap_x_tick=t_sap_x/(nb_tick-1),t_sap_tick=t_sap/(nb_tick-1);
+    const unsigned int nb_swap_x_tick=nb_swap_x/(nb_tick-1),nb_swap_tick=nb_swap/(nb_tick-1);
+    const char axes[]="xyz";
+    if(t_brute>=0.0)
+      std::printf("%8d %12.3f %12.3f %12.3f %12.3f %10u %12.3f %5c %10u %10u\n",N,t_brute,t_rebuild/nb_tick,t_update/nb_tick,
+                  t_sap_x_tick,nb_swap_x_tick,t_sap_tick,axes[sap.axis],nb_swap_tick,nb_pair);
+    else
+      std::printf("%8d %12s %12.3f %12.3f %12.3f %10u %12.3f %5c %10u %10u\n",N,"-",t_rebuild/nb_tick,t_update/nb_tick,
+                  t_sap_x_tick,nb_swap_x_tick,t_sap_tick,axes[sap.axis],nb_swap_tick,nb_pair);
+  }
+}
@@ -0,0 +1,97 @@
+#include "bench.hpp"
+
+#include "format/mesh_io_gltf.hpp"
+#include "format/mesh_io_obj.hpp"
+#include "mesh.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+namespace
+{
+  /** ecrit m en glb: positions, normales et coordonnees de texture entrelacees
+   *  dans une bufferView a pas fixe (la disposition de vertex_opengl), indices 32 bits */
+  void write_glb(const std::string& filename,const mesh& m)
+  {
+    const size_t vertex_size=m.vertex.size()*sizeof(vertex_opengl);
+    const size_t index_size=m.connectivity.size()*sizeof(triangle_index);
+    std::ostringstream json;
+    json<<"{\"asset\":{\"version\":\"2.0\"},\"buffers\":[{\"byteLength\":"<<vertex_size+index_size<<"}],"
+        <<"\"bufferViews\":[{\"buffer\":0,\"byteLength\":"<<vertex_size<<",\"byteStride\":"<<sizeof(vertex_opengl)<<"},"
+        <<"{\"buffer\":0,\"byteOffset\":"<<vertex_size<<",\"byteLength\":"<<index_size<<"}],"
+        <<"\"accessors\":[{\"bufferView\":0,\"componentType\":5126,\"count\":"<<m.vertex.size()<<",\"type\":\"VEC3\"},"
+        <<"{\"bufferView\":0,\"byteOffset\":12,\"componentType\":5126,\"count\":"<<m.vertex.size()<<",\"type\":\"VEC3\"},"
+        <<"{\"bufferView\":0,\"byteOffset\":36,\"componentType\":5126,\"count\":"<<m.vertex.size()<<",\"type\":\"VEC2\"},"
+        <<"{\"bufferView\":1,\"componentType\":5125,\"count\":"<<3*m.connectivity.size()<<",\"type\":\"SCALAR\"}],"
+        <<"\"meshes\":[{\"primitives\":[{\"attributes\":{\"POSITION\":0,\"NORMAL\":1,\"TEXCOORD_0\":2},\"indices\":3}]}]}";
+    std::string text=json.str();
+    while(text.size()%4!=0)
+      text+=' ';
+
+    const unsigned int bin_size=static_cast<unsigned int>(vertex_size+index_size);
+    const unsigned int header[5]={0x46546C67,2,static_cast<unsigned int>(12+8+text.size()+8+bin_size),
+                                  static_cast<unsigned int>(text.size()),0x4E4F534A};
+    const unsigned int bin_header[2]={bin_size,0x004E4942};
+    std::ofstream fid(filename.c_str(),std::ios::binary);
+    fid.write(reinterpret_cast<const char*>(header),sizeof(header));
+    fid.write(text.c_str(),text.size());
+    fid.write(reinterpret_cast<const char*>(bin_header),sizeof(bin_header));
+    fid.write(reinterpret_cast<const char*>(&m.vertex[0]),vertex_size);
+    fid.write(reinterpret_cast<const char*>(&m.connectivity[0]),index_size);
+  }
+
+  float max_difference(const mesh& m0,const mesh& m1)
+  {
+    if(m0.vertex.size()!=m1.vertex.size() || m0.connectivity.size()!=m1.connectivity.size())
+      return -1.0f;
+    for(unsigned int k=0;k<m0.connectivity.size();++k)
+    {
+      const triangle_index& t0=m0.connectivity[k];
+      const triangle_index& t1=m1.connectivity[k];
+      if(t0.u0!=t1.u0 || t0.u1!=t1.u1 || t0.u2!=t1.u2)
+        return -1.0f;
+    }
+    float d=0.0f;
+    for(unsigned int k=0;k<m0.vertex.size();++k)
+    {
+      d=std::max(d,norm(m0.vertex[k].position-m1.vertex[k].position));
+      d=std::max(d,norm(m0.vertex[k].texture-m1.vertex[k].texture));
+    }
+    return d;
+  }
+}
+
+void bench_gltf()
+{
+  const std::string source="data/stegosaurus.obj";
+  const std::string filename="/tmp/bench_stegosaurus.glb";
+  const int nb_iteration=20;
+  const mesh reference=cpe::load_mesh_file_obj(source);
+  write_glb(filename,reference);
+
+  chrono_ms chrono_obj;
+  for(int k=0;k<nb_iteration;++k)
+    cpe::load_mesh_file_obj(source);
+  const double t_obj=chrono_obj.elapsed()/nb_iteration;
+
+  //ouverture seule: projection du fichier, lecture du JSON, accesseurs prets pour glBufferData
+  chrono_ms chrono_open;
+  for(int k=0;k<nb_iteration;++k)
+    cpe::gltf_file gltf(filename);
+  const double t_open=chrono_open.elapsed()/nb_iteration;
+
+  mesh current;
+  chrono_ms chrono_mesh;
+  for(int k=0;k<nb_iteration;++k)
+    current=cpe::load_mesh_file_gltf(filename);
+  const double t_mesh=chrono_mesh.elapsed()/nb_iteration;
+
+  std::printf("%-32s %12s %10s %12s\n","","temps (ms)","/ obj","ecart max");
+  std::printf("%-32s %12.3f %10.2f %12g\n",source.c_str(),t_obj,1.0,0.0);
+  std::printf("%-32s %12.3f %10.3f %12s\n","glb (ouverture)",t_open,t_open/t_obj,"");
+  std::printf("%-32s %12.3f %10.3f %12g\n","glb (vers mesh)",t_mesh,t_mesh/t_obj,max_difference(reference,current));
+  std::remove(filename.c_str());
+}
@@ -0,0 +1,171 @@
+
+#include "bench.hpp"
+
+#include "half_edge.hpp"
+#include "mesh.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace
+{
+  typedef std::map<std::pair<unsigned int,unsigned int>,int> edge_map;
+
+  /** reference: nombre d'occurrences de chaque arete orientee, dans une std::map */
+  edge_map build_edge_map(const mesh& m)
+  {
+    edge_map edges;
+    for(unsigned int k=0;k<m.connectivity.size();++k)
+    {
+      const unsigned int* u=&m.connectivity[k].u0;
+      for(int i=0;i<3;++i)
+        edges[std::make_pair(u[i],u[(i+1)%3])]++;
+    }
+    return edges;
+  }
+
+  /** reference: voisins de chaque sommet d'apres les triangles */
+  std::vector<std::set<int> > brute_force_rings(const mesh& m)
+  {
+    std::vector<std::set<int> > rings(m.vertex.size());
+    for(unsigned int k=0;k<m.connectivity.size();++k)
+    {
+      const unsigned int* u=&m.connectivity[k].u0;
+      for(int i=0;i<3;++i)
+      {
+        rings[u[i]].insert(u[(i+1)%3]);
+        rings[u[i]].insert(u[(i+2)%3]);
+      }
+    }
+    return rings;
+  }
+
+  /** nombre de sommets dont l'anneau ne correspond pas a la reference */
+  int ring_errors(const half_edge_structure& he,const mesh& m)
+  {
+    const std::vector<std::set<int> > rings=brute_force_rings(m);
+    int nb_error=0;
+    std::vector<int> ring;
+    for(unsigned int v=0;v<m.vertex.size();++v)
+    {
+      vertex_one_ring(he,v,&ring);
+      if(std::set<int>(ring.begin(),ring.end())!=rings[v])
+        ++nb_error;
+    }
+    return nb_error;
+  }
+
+  /** nombre de demi-aretes et de sommets dont l'etat de bord ne correspond pas a la reference */
+  int boundary_errors(const half_edge_structure& he,const mesh& m,const edge_map& edges)
+  {
+    int nb_error=0;
+    std::vector<bool> boundary_vertex(m.vertex.size(),false);
+    for(unsigned int h=0;h<he.origin.size();++h)
+    {
+      const unsigned int a=he.origin[h];
+      const unsigned int b=he_target(he,h);
+      const bool boundary=edges.count(std::make_pair(b,a))==0;
+      if(boundary!=is_boundary_edge(he,h))
+        ++nb_error;
+      if(he.opposite[h]!=-1 && (he.origin[he.opposite[h]]!=b || he_target(he,he.opposite[h])!=a))
+        ++nb_error;
+      if(boundary)
+        boundary_vertex[a]=boundary_vertex[b]=true;
+    }
+    for(unsigned int v=0;v<m.vertex.size();++v)
+      if(he.vertex_half_edge[v]!=-1 && boundary_vertex[v]!=is_boundary_vertex(he,v))
+        ++nb_error;
+    return nb_error;
+  }
+
+  /** bascule des aretes interieures au hasard, puis compare la structure mise a jour a une reconstruction */
+  int flip_errors(half_edge_structure he,mesh m,int nb_flip,int* nb_done)
+  {
+    srand(7);
+    *nb_done=0;
+    const int N=he.origin.size();
+    for(int k=0;k<nb_flip && N>0;++k)
+      if(flip_edge(&he,&m,rand()%N))
+        ++*nb_done;
+
+    const half_edge_structure rebuilt=build_half_edge_structure(&m);
+    int nb_error=0;
+    for(int h=0;h<N;++h)
+    {
+      if(he.origin[h]!=rebuilt.origin[h] || (he.opposite[h]==-1)!=(rebuilt.opposite[h]==-1))
+        ++nb_error;
+      else if(he.opposite[h]!=-1 && he.origin[he.opposite[h]]!=rebuilt.origin[rebuilt.opposite[h]])
+        ++nb_error;
+    }
+    for(unsigned int v=0;v<he.vertex_half_edge.size();++v)
+    {
+      const int h=he.vertex_half_edge[v];
+      if((h==-1)!=(rebuilt.vertex_half_edge[v]==-1) || (h!=-1 && he.origin[h]!=v))
+        ++nb_error;
+    }
+    return nb_error+ring_errors(he,m)+boundary_errors(he,m,build_edge_map(m));
+  }
+
+  /** nombre de sommets dont la normale (etoiles des demi-aretes) s'ecarte de la somme directe des normales des triangles */
+  int normal_errors(const mesh& m)
+  {
+    std::vector<vec3> reference(m.vertex.size());
+    for(unsigned int k=0;k<m.connectivity.size();++k)
+    {
+      const triangle_index& t=m.connectivity[k];
+      const vec3& p0=m.vertex[t.u0].position;
+      const vec3 n=normalize(cross(normalize(m.vertex[t.u1].position-p0),normalize(m.vertex[t.u2].position-p0)));
+      reference[t.u0]+=n;
+      reference[t.u1]+=n;
+      reference[t.u2]+=n;
+    }
+    int nb_error=0;
+    for(unsigned int v=0;v<m.vertex.size();++v)
+      if(norm(m.vertex[v].normal-normalize(reference[v]))>1e-4f)
+        ++nb_error;
+    return nb_error;
+  }
+}
+
+void bench_half_edge()
+{
+  const char* files[]={"data/cube.obj","data/stegosaurus.obj","data/armadillo_light.off"};
+  std::printf("%-26s %9s %9s %12s %12s %12s %8s %8s %8s %8s %14s\n","fichier","sommets","triangles","demi-ar (ms)","map (ms)",
+              "normales (ms)","bord","anneau","err bord","err norm","bascules/err");
+
+  for(unsigned int f=0;f<sizeof(files)/sizeof(files[0]);++f)
+  {
+    const std::string filename=files[f];
+    const size_t dot=filename.find_last_of('.');
+    mesh m=filename.substr(dot)==".off" ? load_off_file(filename) : load_obj_file(filename);
+    const int nb_iteration=m.connectivity.size()>10000 ? 10 : 1000;
+
+    half_edge_structure he;
+    chrono_ms chrono_he;
+    for(int k=0;k<nb_iteration;++k)
+      he=build_half_edge_structure(&m);
+    const double t_he=chrono_he.elapsed()/nb_iteration;
+
+    edge_map edges;
+    chrono_ms chrono_map;
+    for(int k=0;k<nb_iteration;++k)
+      edges=build_edge_map(m);
+    const double t_map=chrono_map.elapsed()/nb_iteration;
+
+    chrono_ms chrono_normals;
+    for(int k=0;k<nb_iteration;++k)
+      update_normals(&m,he);
+    const double t_normals=chrono_normals.elapsed()/nb_iteration;
+
+    int nb_flip=0;
+    const int errors_flip=flip_errors(he,m,1000,&nb_flip);
+    std::printf("%-26s %9zu %9zu %12.3f %12.3f %12.3f %8zu %8d %8d %8d %8d/%d\n",filename.c_str(),m.vertex.size(),m.connectivity.size(),
+                t_he,t_map,t_normals,boundary_half_edges(he).size(),ring_errors(he,m),boundary_errors(he,m,edges),normal_errors(m),nb_flip,errors_flip);
+  }
+}
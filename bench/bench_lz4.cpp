@@ -0,0 +1,44 @@
+
+#include "bench.hpp"
+
+#include "lz4.hpp"
+#include "mapped_file.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+void bench_lz4()
+{
+  const char* files[]={"data/stegosaurus.obj","data/armadillo_light.off","data/route.tga","data/route1.tga","data/unicorn.tga","data/parc.jpg"};
+  std::printf("%-26s %10s %10s %8s %14s %14s %6s\n","fichier","taille","compresse","ratio","compression","decompression","ok");
+
+  for(unsigned int f=0;f<sizeof(files)/sizeof(files[0]);++f)
+  {
+    mapped_file file(files[f]);
+    if(!file.is_open())
+      continue;
+    const unsigned char* data=reinterpret_cast<const unsigned char*>(file.data());
+    const size_t size=file.size();
+    const int nb_iteration=10;
+
+    std::vector<unsigned char> stream;
+    chrono_ms chrono_compress;
+    for(int k=0;k<nb_iteration;++k)
+      stream=lz4_compress_blocks(data,size);
+    const double t_compress=chrono_compress.elapsed()/nb_iteration;
+
+    std::vector<unsigned char> output(size);
+    bool ok=true;
+    chrono_ms chrono_decompress;
+    for(int k=0;k<nb_iteration;++k)
+      ok=lz4_decompress_blocks(&stream[0],stream.size(),&output[0],size) && ok;
+    const double t_decompress=chrono_decompress.elapsed()/nb_iteration;
+    ok=ok && std::memcmp(&output[0],data,size)==0;
+
+    const double mb=size/(1024.0*1024.0);
+    std::printf("%-26s %10u %10u %7.1f%% %9.0f MB/s %9.0f MB/s %6s\n",files[f],static_cast<unsigned int>(size),
+        static_cast<unsigned int>(stream.size()),100.0*stream.size()/size,mb/t_compress*1000.0,mb/t_decompress*1000.0,ok ? "oui" : "NON");
+  }
+}
@@ -0,0 +1,107 @@
+
+#include "bench.hpp"
+
+#include "format/mesh_io_obj.hpp"
+#include "mesh.hpp"
+#include "mesh_cache.hpp"
+
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+namespace
+{
+  /** ancien chargeur (getline + stringstream par ligne et par indice), garde comme reference */
+  cpe::obj_structure load_obj_structure_stringstream(const std::string& filename)
+  {
+    std::ifstream fid(filename.c_str());
+    cpe::obj_structure obj;
+    std::string buffer;
+    while(fid.good())
+    {
+      std::getline(fid,buffer);
+      std::stringstream tokens(buffer);
+      std::string first_word;
+      tokens>>first_word;
+      if(first_word=="v")  { vec3 v; tokens>>v.x>>v.y>>v.z; obj.data_vertex.push_back(v); }
+      if(first_word=="vt") { vec2 t; tokens>>t.x>>t.y; obj.data_texture.push_back(t); }
+      if(first_word=="vn") { vec3 n; tokens>>n.x>>n.y>>n.z; obj.data_normal.push_back(n); }
+      if(first_word=="f")
+      {
+        std::vector<int> face_vertex,face_texture;
+        while(tokens.good())
+        {
+          std::string index_str;
+          tokens>>index_str;
+          const std::vector<int> data=cpe::split_face_data(index_str);
+          if(data.size()>0) face_vertex.push_back(data[0]-1);
+          if(data.size()>1) face_texture.push_back(data[1]-1);
+        }
+        if(face_vertex.size()>0)  obj.data_face_vertex.push_back(face_vertex);
+        if(face_texture.size()>0) obj.data_face_texture.push_back(face_texture);
+      }
+    }
+    return obj;
+  }
+
+  float max_difference(const cpe::obj_structure& o0,const cpe::obj_structure& o1)
+  {
+    if(o0.data_vertex.size()!=o1.data_vertex.size() || o0.data_texture.size()!=o1.data_texture.size() ||
+       o0.data_face_vertex!=o1.data_face_vertex || o0.data_face_texture!=o1.data_face_texture)
+      return -1.0f;
+    float d=0.0f;
+    for(unsigned int k=0;k<o0.data_vertex.size();++k)
+      d=std::max(d,norm(o0.data_vertex[k]-o1.data_vertex[k]));
+    for(unsigned int k=0;k<o0.data_texture.size();++k)
+      d=std::max(d,norm(o0.data_texture[k]-o1.data_texture[k]));
+    return d;
+  }
+
+  double file_size_mb(const std::string& filename)
+  {
+    std::ifstream fid(filename.c_str(),std::ios::binary|std::ios::ate);
+    return static_cast<double>(fid.tellg())/(1024.0*1024.0);
+  }
+}
+
+void bench_obj()
+{
+  const char* files[]={"data/stegosaurus.obj","data/cube.obj"};
+  std::printf("%-24s %14s %14s %14s %14s %10s %12s\n","fichier","ancien (ms)","structure (ms)","mesh (ms)","cache (ms)","gain","ecart max");
+
+  for(unsigned int f=0;f<sizeof(files)/sizeof(files[0]);++f)
+  {
+    const std::string filename=files[f];
+    const double size=file_size_mb(filename);
+    const int nb_iteration=size>0.1 ? 20 : 2000;
+
+    cpe::obj_structure reference,current;
+    chrono_ms chrono_legacy;
+    for(int k=0;k<nb_iteration;++k)
+      reference=load_obj_structure_stringstream(filename);
+    const double t_legacy=chrono_legacy.elapsed()/nb_iteration;
+
+    chrono_ms chrono_structure;
+    for(int k=0;k<nb_iteration;++k)
+      current=cpe::load_file_obj_structure(filename);
+    const double t_structure=chrono_structure.elapsed()/nb_iteration;
+
+    chrono_ms chrono_mesh;
+    for(int k=0;k<nb_iteration;++k)
+      cpe::load_mesh_file_obj(filename);
+    const double t_mesh=chrono_mesh.elapsed()/nb_iteration;
+
+    //le premier appel ecrit le cache binaire, les suivants le relisent
+    load_obj_file(filename);
+    chrono_ms chrono_cache;
+    for(int k=0;k<nb_iteration;++k)
+      load_obj_file(filename);
+    const double t_cache=chrono_cache.elapsed()/nb_iteration;
+
+    std::printf("%-24s %14.3f %14.3f %14.3f %14.3f %9.1fx %12g\n",filename.c_str(),t_legacy,t_structure,t_mesh,t_cache,
+        t_legacy/t_structure,max_difference(reference,current));
+    std::printf("%-24s %14.1f %14.1f %14.1f %14.1f   MB/s\n","",size/t_legacy*1000.0,size/t_structure*1000.0,size/t_mesh*1000.0,size/t_cache*1000.0);
+  }
+}
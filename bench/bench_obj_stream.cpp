@@ -0,0 +1,164 @@
+#include "bench.hpp"
+
+#include "format/mesh_io_obj.hpp"
+#include "mesh.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <thread>
+
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+
+namespace
+{
+  /** ecrit nb_copy copies decalees de l'obj (v, vt, faces v/vt) pour obtenir un gros fichier */
+  void write_tiled_obj(const std::string& filename,const cpe::obj_structure& obj,int nb_copy)
+  {
+    std::ofstream fid(filename.c_str());
+    for(int c=0;c<nb_copy;++c)
+    {
+      const int offset_v=c*obj.data_vertex.size();
+      const int offset_t=c*obj.data_texture.size();
+      for(unsigned int k=0;k<obj.data_vertex.size();++k)
+        fid<<"v "<<obj.data_vertex[k].x+c<<" "<<obj.data_vertex[k].y<<" "<<obj.data_vertex[k].z<<"\n";
+      for(unsigned int k=0;k<obj.data_texture.size();++k)
+        fid<<"vt "<<obj.data_texture[k].x<<" "<<obj.data_texture[k].y<<"\n";
+      for(unsigned int k=0;k<obj.data_face_vertex.size();++k)
+      {
+        fid<<"f";
+        for(unsigned int i=0;i<obj.data_face_vertex[k].size();++i)
+          fid<<" "<<obj.data_face_vertex[k][i]+1+offset_v<<"/"<<obj.data_face_texture[k][i]+1+offset_t;
+        fid<<"\n";
+      }
+    }
+  }
+
+  /** memoire residente actuelle du processus en Mo (0 si indisponible) */
+  double current_rss_mb()
+  {
+#ifndef _WIN32
+    std::ifstream fid("/proc/self/statm");
+    long size=0,resident=0;
+    if(!(fid>>size>>resident))
+      return 0.0;
+    return resident*static_cast<double>(sysconf(_SC_PAGESIZE))/(1024.0*1024.0);
+#else
+    return 0.0;
+#endif
+  }
+
+  /** Pic de memoire residente pendant une mesure, au-dessus du niveau de depart.
+   *  ru_maxrss est le pic de toute la vie du processus: apres les autres benchs il ne bouge plus,
+   *  on echantillonne donc la memoire residente actuelle depuis un thread. */
+  class rss_sampler
+  {
+  public:
+    rss_sampler()
+      :running(true),peak(0.0)
+    {
+#ifdef __GLIBC__
+      //rend au systeme la memoire liberee par les benchs precedents, sinon elle est reutilisee sans etre comptee
+      malloc_trim(0);
+#endif
+      start=current_rss_mb();
+      peak=start;
+      sampler=std::thread([this]() {
+        while(running.load())
+        {
+          peak=std::max(peak,current_rss_mb());
+          std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+      });
+    }
+
+    /** Arrete l'echantillonnage et renvoie le pic en Mo */
+    double stop()
+    {
+      if(sampler.joinable())
+      {
+        running=false;
+        sampler.join();
+        peak=std::max(peak,current_rss_mb());
+      }
+      return peak-start;
+    }
+
+    ~rss_sampler()
+    {
+      stop();
+    }
+
+  private:
+    std::atomic<bool> running;
+    double start;
+    double peak;
+    std::thread sampler;
+  };
+
+  /** plus grand ecart entre les sommets des coins de chaque triangle */
+  float max_difference(const mesh& m0,const mesh& m1)
+  {
+    if(m0.connectivity.size()!=m1.connectivity.size())
+      return -1.0f;
+    float d=0.0f;
+    for(unsigned int k=0;k<m0.connectivity.size();++k)
+    {
+      const unsigned int* u0=&m0.connectivity[k].u0;
+      const unsigned int* u1=&m1.connectivity[k].u0;
+      for(int i=0;i<3;++i)
+      {
+        d=std::max(d,norm(m0.vertex[u0[i]].position-m1.vertex[u1[i]].position));
+        d=std::max(d,norm(m0.vertex[u0[i]].texture-m1.vertex[u1[i]].texture));
+      }
+    }
+    return d;
+  }
+}
+
+void bench_obj_stream()
+{
+  const std::string filename="/tmp/bench_stegosaurus_tiled.obj";
+  write_tiled_obj(filename,cpe::load_file_obj_structure("data/stegosaurus.obj"),60);
+  double size_mb=0.0;
+  {
+    std::ifstream fid(filename.c_str(),std::ios::binary|std::ios::ate);
+    size_mb=static_cast<double>(fid.tellg())/(1024.0*1024.0);
+  }
+  std::printf("%s: %.1f Mo\n",filename.c_str(),size_mb);
+  std::printf("%-28s %12s %16s %16s %12s\n","","temps (ms)","etat (Mo)","pic RSS (Mo)","ecart max");
+
+  //flux seul: les lots sont comptes puis oublies, la memoire reste bornee
+  size_t nb_triangle=0;
+  rss_sampler rss_stream;
+  chrono_ms chrono_stream;
+  const cpe::obj_stream_stats stats=cpe::stream_mesh_file_obj(filename,[&nb_triangle](const vertex_opengl*,size_t,const triangle_index*,size_t N_triangle) {
+    nb_triangle+=N_triangle;
+  });
+  const double t_stream=chrono_stream.elapsed();
+  std::printf("%-28s %12.1f %16.1f %16.1f %12s\n","flux (fenetre 1 Mo)",t_stream,stats.peak_memory/(1024.0*1024.0),rss_stream.stop(),"");
+
+  //chargement complet de reference, puis flux accumule dans un mesh pour comparer
+  rss_sampler rss_full;
+  chrono_ms chrono_full;
+  const mesh reference=cpe::load_mesh_file_obj(filename);
+  const double t_full=chrono_full.elapsed();
+  std::printf("%-28s %12.1f %16s %16.1f %12s\n","chargement complet",t_full,"",rss_full.stop(),"");
+
+  mesh current;
+  cpe::stream_mesh_file_obj(filename,[&current](const vertex_opengl* vertex,size_t N_vertex,const triangle_index* triangle,size_t N_triangle) {
+    current.vertex.insert(current.vertex.end(),vertex,vertex+N_vertex);
+    current.connectivity.insert(current.connectivity.end(),triangle,triangle+N_triangle);
+  });
+  std::printf("%-28s %12s %16s %16s %12g\n","flux -> mesh","","","",max_difference(reference,current));
+  std::printf("%zu sommets, %zu triangles\n",stats.nb_vertex,nb_triangle);
+  std::remove(filename.c_str());
+}
@@ -0,0 +1,85 @@
+
+#include "bench.hpp"
+
+#include "format/mesh_io_off.hpp"
+#include "mesh.hpp"
+#include "thread_pool.hpp"
+
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+namespace
+{
+  /** ancien chargeur (getline + stringstream par ligne), garde comme reference */
+  mesh load_off_stringstream(const std::string& filename)
+  {
+    mesh m;
+    std::ifstream fid(filename.c_str());
+    std::string buffer;
+    while(fid.good() && buffer.find("OFF")==std::string::npos)
+      std::getline(fid,buffer);
+
+    int N_vertex=0,N_triangle=0;
+    std::getline(fid,buffer);
+    std::stringstream tokens(buffer);
+    tokens>>N_vertex>>N_triangle;
+    for(int k=0;k<N_vertex;++k)
+    {
+      std::getline(fid,buffer);
+      vec3 p;
+      std::stringstream tokens_vertices(buffer);
+      tokens_vertices>>p.x>>p.y>>p.z;
+      m.vertex.push_back(vertex_opengl(p,vec3(),vec3(),vec2()));
+    }
+    for(int k=0;k<N_triangle;++k)
+    {
+      std::getline(fid,buffer);
+      int N_size,u0,u1,u2;
+      std::stringstream tokens_connectivity(buffer);
+      tokens_connectivity>>N_size>>u0>>u1>>u2;
+      m.connectivity.push_back(triangle_index(u0,u1,u2));
+    }
+    return m;
+  }
+
+  float max_difference(const mesh& m0,const mesh& m1)
+  {
+    if(m0.vertex.size()!=m1.vertex.size() || m0.connectivity.size()!=m1.connectivity.size())
+      return -1.0f;
+    for(unsigned int k=0;k<m0.connectivity.size();++k)
+    {
+      const triangle_index& t0=m0.connectivity[k];
+      const triangle_index& t1=m1.connectivity[k];
+      if(t0.u0!=t1.u0 || t0.u1!=t1.u1 || t0.u2!=t1.u2)
+        return -1.0f;
+    }
+    float d=0.0f;
+    for(unsigned int k=0;k<m0.vertex.size();++k)
+      d=std::max(d,norm(m0.vertex[k].position-m1.vertex[k].position));
+    return d;
+  }
+}
+
+void bench_off()
+{
+  const std::string filename="data/armadillo_light.off";
+  const int nb_iteration=20;
+  std::printf("%u thread(s)\n",default_thread_pool().size()+1);
+  std::printf("%-24s %14s %14s %10s %12s\n","fichier","ancien (ms)","decoupe (ms)","gain","ecart max");
+
+  mesh reference,current;
+  chrono_ms chrono_legacy;
+  for(int k=0;k<nb_iteration;++k)
+    reference=load_off_stringstream(filename);
+  const double t_legacy=chrono_legacy.elapsed()/nb_iteration;
+
+  chrono_ms chrono_chunk;
+  for(int k=0;k<nb_iteration;++k)
+    current=cpe::load_mesh_file_off(filename);
+  const double t_chunk=chrono_chunk.elapsed()/nb_iteration;
+
+  std::printf("%-24s %14.3f %14.3f %9.1fx %12g\n",filename.c_str(),t_legacy,t_chunk,t_legacy/t_chunk,max_difference(reference,current));
+}
@@ -0,0 +1,113 @@
+#include "bench.hpp"
+
+#include "format/mesh_io_off.hpp"
+#include "format/mesh_io_ply.hpp"
+#include "mesh.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+
+namespace
+{
+  /** ecrit une valeur binaire, octets inverses pour le gros-boutiste */
+  template <typename T> void write_binary(std::ofstream& fid,T value,bool big_endian)
+  {
+    char b[sizeof(T)];
+    std::memcpy(b,&value,sizeof(T));
+    if(big_endian)
+      std::reverse(b,b+sizeof(T));
+    fid.write(b,sizeof(T));
+  }
+
+  /** ecrit m en ply: ascii, binaire petit-boutiste (float) ou gros-boutiste (double),
+   *  avec une propriete supplementaire a ignorer */
+  void write_ply(const std::string& filename,const mesh& m,const std::string& format)
+  {
+    std::ofstream fid(filename.c_str(),std::ios::binary);
+    const bool ascii=format=="ascii";
+    const bool big_endian=format=="binary_big_endian";
+    const char* real=big_endian ? "double" : "float";
+    fid<<"ply\nformat "<<format<<" 1.0\ncomment bench\n";
+    fid<<"element vertex "<<m.vertex.size()<<"\n";
+    fid<<"property "<<real<<" x\nproperty "<<real<<" y\nproperty "<<real<<" z\nproperty float quality\n";
+    fid<<"element face "<<m.connectivity.size()<<"\nproperty list uchar int vertex_indices\nend_header\n";
+
+    for(unsigned int k=0;k<m.vertex.size();++k)
+    {
+      const vec3& p=m.vertex[k].position;
+      if(ascii)
+        fid<<p.x<<" "<<p.y<<" "<<p.z<<" 1\n";
+      else if(big_endian)
+      {
+        write_binary<double>(fid,p.x,true); write_binary<double>(fid,p.y,true); write_binary<double>(fid,p.z,true);
+        write_binary<float>(fid,1.0f,true);
+      }
+      else
+      {
+        write_binary(fid,p.x,false); write_binary(fid,p.y,false); write_binary(fid,p.z,false);
+        write_binary(fid,1.0f,false);
+      }
+    }
+    for(unsigned int k=0;k<m.connectivity.size();++k)
+    {
+      const triangle_index& t=m.connectivity[k];
+      if(ascii)
+        fid<<"3 "<<t.u0<<" "<<t.u1<<" "<<t.u2<<"\n";
+      else
+      {
+        write_binary<unsigned char>(fid,3,big_endian);
+        write_binary<int>(fid,t.u0,big_endian); write_binary<int>(fid,t.u1,big_endian); write_binary<int>(fid,t.u2,big_endian);
+      }
+    }
+  }
+
+  float max_difference(const mesh& m0,const mesh& m1)
+  {
+    if(m0.vertex.size()!=m1.vertex.size() || m0.connectivity.size()!=m1.connectivity.size())
+      return -1.0f;
+    for(unsigned int k=0;k<m0.connectivity.size();++k)
+    {
+      const triangle_index& t0=m0.connectivity[k];
+      const triangle_index& t1=m1.connectivity[k];
+      if(t0.u0!=t1.u0 || t0.u1!=t1.u1 || t0.u2!=t1.u2)
+        return -1.0f;
+    }
+    float d=0.0f;
+    for(unsigned int k=0;k<m0.vertex.size();++k)
+      d=std::max(d,norm(m0.vertex[k].position-m1.vertex[k].position));
+    return d;
+  }
+}
+
+void bench_ply()
+{
+  const std::string source="data/armadillo_light.off";
+  const int nb_iteration=20;
+  const mesh reference=cpe::load_mesh_file_off(source);
+
+  chrono_ms chrono_off;
+  for(int k=0;k<nb_iteration;++k)
+    cpe::load_mesh_file_off(source);
+  const double t_off=chrono_off.elapsed()/nb_iteration;
+
+  std::printf("%-36s %12s %10s %12s\n","fichier","temps (ms)","/ off","ecart max");
+  std::printf("%-36s %12.3f %10.2f %12g\n",source.c_str(),t_off,1.0,0.0);
+
+  const char* formats[]={"ascii","binary_little_endian","binary_big_endian"};
+  for(unsigned int f=0;f<3;++f)
+  {
+    const std::string filename=std::string("/tmp/bench_")+formats[f]+".ply";
+    write_ply(filename,reference,formats[f]);
+
+    mesh current;
+    chrono_ms chrono;
+    for(int k=0;k<nb_iteration;++k)
+      current=cpe::load_mesh_file_ply(filename);
+    const double t=chrono.elapsed()/nb_iteration;
+    std::printf("%-36s %12.3f %10.2f %12g\n",filename.c_str(),t,t/t_off,max_difference(reference,current));
+    std::remove(filename.c_str());
+  }
+}
@@ -0,0 +1,65 @@
+#include "bench.hpp"
+
+#include "image.hpp"
+#include "ktx.hpp"
+#include "texture_cache.hpp"
+#include "texture_compress.hpp"
+
+#include <cstdio>
+#include <memory>
+#include <string>
+
+void bench_texture_compress()
+{
+  const char* files[]={"data/route1.tga","data/stegosaurus.tga","data/nathan.tga"};
+  const char* format_names[]={"BC1","BC3","BC4","BC5"};
+  const char* quality_names[]={"rapide","normal","haute"};
+  std::printf("%-24s %-6s %-8s %12s %12s %10s %10s\n","fichier","format","qualite","temps (ms)","Mpixels/s","Ko","PSNR (dB)");
+
+  for(unsigned int f=0;f<sizeof(files)/sizeof(files[0]);++f)
+  {
+    std::unique_ptr<Image> image(image_load_tga(files[f]));
+    if(!image)
+      continue;
+    const texture_data source=texture_from_image(*image,false);
+    const texture_level& base=source.levels[0];
+    const double mpixel=static_cast<double>(base.width)*base.height/1e6;
+
+    for(int format=block_bc1;format<=block_bc5;++format)
+      for(int quality=compress_fast;quality<=compress_high;++quality)
+      {
+        const int nb_iteration=3;
+        texture_data compressed;
+        chrono_ms chrono;
+        for(int k=0;k<nb_iteration;++k)
+          compressed=compress_texture(source,static_cast<block_format>(format),static_cast<compress_quality>(quality));
+        const double t=chrono.elapsed()/nb_iteration;
+        std::printf("%-24s %-6s %-8s %12.2f %12.1f %10.1f %10.2f\n",files[f],format_names[format],quality_names[quality],
+            t,mpixel/t*1000.0,texture_memory(compressed)/1024.0,texture_psnr(source,compressed));
+      }
+    std::printf("%-24s RGBA8 %54.1f\n","",texture_memory(source)/1024.0);
+  }
+
+  //chargement complet (decodage, mipmaps, compression), relecture du cache KTX sur place,
+  //puis conteneur KTX produit par la chaine d'assets lu sur place
+  std::printf("\n%-24s %14s %14s %14s\n","fichier","premier (ms)","cache (ms)","ktx (ms)");
+  for(unsigned int f=0;f<sizeof(files)/sizeof(files[0]);++f)
+  {
+    chrono_ms chrono_first;
+    const std::shared_ptr<texture_source> first=open_texture_file(files[f]);
+    const double t_first=chrono_first.elapsed();
+    chrono_ms chrono_cache;
+    open_texture_file(files[f]);
+    const double t_cache=chrono_cache.elapsed();
+
+    const std::string baked="bench_texture.ktx";
+    save_ktx(baked,first->data);
+    chrono_ms chrono_baked;
+    const std::shared_ptr<texture_source> container=open_texture_file(baked);
+    const double t_baked=chrono_baked.elapsed();
+
+    std::printf("%-24s %14.2f %14.2f %14.2f\n",files[f],t_first,t_cache,t_baked);
+    std::remove(baked.c_str());
+    std::remove(texture_cache_filename(files[f],first->content_hash).c_str());
+  }
+}
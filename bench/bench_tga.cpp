@@ -0,0 +1,237 @@
+
+#include "bench.hpp"
+
+#include "image.hpp"
+#include "mapped_file.hpp"
+#include "stb_image.h"
+#include "texture_cache.hpp"
+#include "thread_pool.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace
+{
+  /** nombre d'octets differents entre le decodeur natif et stb (-1 si les dimensions different) */
+  long difference(const Image& image,const unsigned char* reference,int width,int height,int channels)
+  {
+    if(image.width!=width || image.height!=height || image_channels(image.type)!=channels)
+      return -1;
+    long d=0;
+    const size_t size=static_cast<size_t>(width)*height*channels;
+    for(size_t k=0;k<size;++k)
+      d+=image.data[k]!=reference[k];
+    return d;
+  }
+
+  void put_u32_be(std::vector<unsigned char>* out,unsigned int value)
+  {
+    for(int shift=24;shift>=0;shift-=8)
+      out->push_back(static_cast<unsigned char>(value>>shift));
+  }
+
+  void put_png_chunk(std::vector<unsigned char>* out,const char* type,const std::vector<unsigned char>& data)
+  {
+    static unsigned int table[256];
+    if(table[1]==0)
+      for(unsigned int n=0;n<256;++n)
+      {
+        unsigned int c=n;
+        for(int k=0;k<8;++k)
+          c=c&1 ? 0xedb88320u^(c>>1) : c>>1;
+        table[n]=c;
+      }
+    put_u32_be(out,static_cast<unsigned int>(data.size()));
+    const size_t start=out->size();
+    out->insert(out->end(),type,type+4);
+    out->insert(out->end(),data.begin(),data.end());
+    unsigned int crc=0xffffffffu;
+    for(size_t k=start;k<out->size();++k)
+      crc=table[(crc^(*out)[k])&0xff]^(crc>>8);
+    put_u32_be(out,crc^0xffffffffu);
+  }
+
+  /** png sans compression (blocs deflate stockes) des texels de image: meme image sans perte, sous un autre format */
+  bool save_png_stored(const std::string& filename,const Image& image)
+  {
+    const unsigned char color_types[]={0,4,2,6};
+    const int channels=image_channels(image.type);
+    const size_t row=static_cast<size_t>(image.width)*channels;
+    std::vector<unsigned char> raw;
+    for(int y=0;y<image.height;++y)
+    {
+      raw.push_back(0);
+      raw.insert(raw.end(),image.data+y*row,image.data+(y+1)*row);
+    }
+
+    std::vector<unsigned char> header;
+    put_u32_be(&header,image.width);
+    put_u32_be(&header,image.height);
+    const unsigned char tail[]={8,color_types[image.type],0,0,0};
+    header.insert(header.end(),tail,tail+5);
+
+    std::vector<unsigned char> zlib={0x78,0x01};
+    unsigned int a=1,b=0;
+    for(size_t k=0;k<raw.size();++k)
+    {
+      a=(a+raw[k])%65521;
+      b=(b+a)%65521;
+    }
+    for(size_t k=0;k==0 || k<raw.size();k+=65535)
+    {
+      const size_t n=std::min<size_t>(65535,raw.size()-k);
+      zlib.push_back(k+n==raw.size() ? 1 : 0);
+      const unsigned char len[]={static_cast<unsigned char>(n),static_cast<unsigned char>(n>>8),
+                                 static_cast<unsigned char>(~n),static_cast<unsigned char>(~n>>8)};
+      zlib.insert(zlib.end(),len,len+4);
+      zlib.insert(zlib.end(),raw.begin()+k,raw.begin()+k+n);
+    }
+    put_u32_be(&zlib,(b<<16)|a);
+
+    std::vector<unsigned char> png={0x89,'P','N','G','\r','\n',0x1a,'\n'};
+    put_png_chunk(&png,"IHDR",header);
+    put_png_chunk(&png,"IDAT",zlib);
+    put_png_chunk(&png,"IEND",std::vector<unsigned char>());
+    std::FILE* fid=std::fopen(filename.c_str(),"wb");
+    if(!fid)
+      return false;
+    const bool ok=std::fwrite(&png[0],1,png.size(),fid)==png.size();
+    return std::fclose(fid)==0 && ok;
+  }
+
+  bool copy_file(const std::string& from,const std::string& to)
+  {
+    mapped_file file(from);
+    std::FILE* fid=file.is_open() ? std::fopen(to.c_str(),"wb") : nullptr;
+    if(!fid)
+      return false;
+    const bool ok=std::fwrite(file.data(),1,file.size(),fid)==file.size();
+    return std::fclose(fid)==0 && ok;
+  }
+}
+
+void bench_tga()
+{
+  const char* files[]={"data/route1.tga","data/route.tga","data/stegosaurus.tga","data/grass.tga","data/fontB.tga","data/nathan.tga"};
+  std::printf("%-24s %-5s %12s %12s %12s %10s %10s\n","fichier","type","stb (ms)","natif (ms)","vue (ms)","gain","ecart");
+
+  for(unsigned int f=0;f<sizeof(files)/sizeof(files[0]);++f)
+  {
+    //fichier projete une fois: seul le decodage est mesure
+    mapped_file file(files[f]);
+    if(!file.is_open())
+      continue;
+    const unsigned char* data=reinterpret_cast<const unsigned char*>(file.data());
+    const size_t size=file.size();
+    const int nb_iteration=50;
+
+    int width=0,height=0,channels=0;
+    unsigned char* reference=nullptr;
+    chrono_ms chrono_stb;
+    for(int k=0;k<nb_iteration;++k)
+    {
+      stbi_image_free(reference);
+      reference=stbi_load_from_memory(data,static_cast<int>(size),&width,&height,&channels,0);
+    }
+    const double t_stb=chrono_stb.elapsed()/nb_iteration;
+
+    std::unique_ptr<Image> image;
+    chrono_ms chrono_native;
+    for(int k=0;k<nb_iteration;++k)
+      image.reset(image_decode_tga(data,size));
+    const double t_native=chrono_native.elapsed()/nb_iteration;
+
+    //tga brute en haut a gauche: aucune copie, seule la vue est construite
+    texture_view view;
+    bool viewable=false;
+    chrono_ms chrono_view;
+    for(int k=0;k<nb_iteration;++k)
+      viewable=image_view_tga(data,size,&view);
+    const double t_view=chrono_view.elapsed()/nb_iteration;
+
+    const char* type=data[2]>=9 ? "RLE" : "brut";
+    const long d=image ? difference(*image,reference,width,height,channels) : -1;
+    if(viewable)
+      std::printf("%-24s %-5s %12.3f %12.3f %12.4f %9.1fx %10ld\n",files[f],type,t_stb,t_native,t_view,t_stb/t_native,d);
+    else
+      std::printf("%-24s %-5s %12.3f %12.3f %12s %9.1fx %10ld\n",files[f],type,t_stb,t_native,"-",t_stb/t_native,d);
+    stbi_image_free(reference);
+  }
+}
+
+void bench_image_decode()
+{
+  const char* files[]={"data/route1.tga","data/route1.jpg","data/stegosaurus.tga","data/stegosaurus.jpg","data/parc.jpg"};
+  const unsigned int nb_file=sizeof(files)/sizeof(files[0]);
+  const int nb_iteration=10;
+
+  //chaque image seule, projetee une fois
+  std::vector<std::shared_ptr<mapped_file> > mapped;
+  std::printf("%-24s %10s %12s %12s\n","fichier","Ko","decodage (ms)","Mpixels/s");
+  for(unsigned int f=0;f<nb_file;++f)
+  {
+    mapped.push_back(std::make_shared<mapped_file>(files[f]));
+    const unsigned char* data=reinterpret_cast<const unsigned char*>(mapped[f]->data());
+    std::unique_ptr<Image> image;
+    chrono_ms chrono;
+    for(int k=0;k<nb_iteration;++k)
+      image.reset(image_load_memory(data,mapped[f]->size()));
+    const double t=chrono.elapsed()/nb_iteration;
+    if(image)
+      std::printf("%-24s %10.1f %12.3f %12.1f\n",files[f],mapped[f]->size()/1024.0,t,static_cast<double>(image->width)*image->height/1e3/t);
+  }
+
+  //toutes les images l'une apres l'autre, puis en meme temps sur le pool
+  chrono_ms chrono_sequential;
+  for(int k=0;k<nb_iteration;++k)
+    for(unsigned int f=0;f<nb_file;++f)
+      delete image_load_memory(reinterpret_cast<const unsigned char*>(mapped[f]->data()),mapped[f]->size());
+  const double t_sequential=chrono_sequential.elapsed()/nb_iteration;
+  chrono_ms chrono_parallel;
+  for(int k=0;k<nb_iteration;++k)
+  {
+    task_group group(default_thread_pool());
+    for(unsigned int f=0;f<nb_file;++f)
+      group.run([&mapped,f]() { delete image_load_memory(reinterpret_cast<const unsigned char*>(mapped[f]->data()),mapped[f]->size()); });
+    group.wait();
+  }
+  const double t_parallel=chrono_parallel.elapsed()/nb_iteration;
+  std::printf("\n%u images: %.2f ms l'une apres l'autre, %.2f ms en parallele (%u threads + appelant), %.1fx\n",nb_file,
+      t_sequential,t_parallel,default_thread_pool().size(),t_sequential/t_parallel);
+
+  //choix du format source selon les options de chargement; bench_route1 existe aussi en png sans perte
+  const std::string twin="data/bench_route1";
+  std::unique_ptr<Image> route(image_load_tga("data/route1.tga"));
+  if(!route || !copy_file("data/route1.tga",twin+".tga") || !copy_file("data/route1.jpg",twin+".jpg") || !save_png_stored(twin+".png",*route))
+    std::printf("\nimpossible d'ecrire les variantes de %s\n",twin.c_str());
+  const std::vector<std::string> requested={"data/route1.tga","data/stegosaurus.tga",twin+".tga"};
+  const bool compression=texture_compression_enabled();
+  for(int config=0;config<2;++config)
+  {
+    set_texture_compression_enabled(config==1);
+    std::printf("\ncompression %s, cache %s\n",config==1 ? "active" : "inactive",texture_cache_enabled() ? "actif" : "inactif");
+    chrono_ms chrono_measure;
+    const std::vector<texture_source_cost> costs=calibrate_texture_sources(requested);
+    const double t_measure=chrono_measure.elapsed();
+    for(unsigned int k=0;k<costs.size();++k)
+      if(costs[k].milliseconds>=0.0)
+        std::printf("%-24s %10.2f ms%s\n",costs[k].filename.c_str(),costs[k].milliseconds,costs[k].chosen ? "  <-" : "");
+      else
+        std::printf("%-24s %13s%s\n",costs[k].filename.c_str(),costs[k].identical ? "-" : "texels differents",costs[k].chosen ? "  <-" : "");
+
+    //second lancement: le choix enregistre est relu sans nouvelle mesure
+    chrono_ms chrono_reload;
+    calibrate_texture_sources(requested);
+    std::printf("calibration %.2f ms, relecture du choix %.2f ms\n",t_measure,chrono_reload.elapsed());
+    for(unsigned int k=0;k<requested.size();++k)
+      std::remove(texture_source_choice_filename(requested[k]).c_str());
+  }
+  set_texture_compression_enabled(compression);
+  const char* extensions[]={".tga",".jpg",".png"};
+  for(unsigned int e=0;e<3;++e)
+    std::remove((twin+extensions[e]).c_str());
+}
@@ -0,0 +1,53 @@
+/*****************************************************************************\
+ * Programme de mesure de performance
+ * --------------
+ *
+ * ./build/bench [nom]   lance toutes les mesures ou seulement celle nommee
+ \*****************************************************************************/
+
+#include "bench.hpp"
+
+#include <iostream>
+#include <string>
+
+struct bench_entry
+{
+  const char* name;
+  void (*run)();
+};
+
+static const bench_entry benchs[] = {
+  {"broadphase", bench_broadphase},
+  {"half_edge", bench_half_edge},
+  {"obj", bench_obj},
+  {"obj_stream", bench_obj_stream},
+  {"off", bench_off},
+  {"ply", bench_ply},
+  {"gltf", bench_gltf},
+  {"lz4", bench_lz4},
+  {"bc", bench_texture_compress},
+  {"tga", bench_tga},
+  {"decode", bench_image_decode},
+  {"atlas", bench_atlas},
+};
+
+int main(int argc, char** argv)
+{
+  const std::string selected = argc>1 ? argv[1] : "";
+  bool found = false;
+  for(unsigned int k=0; k<sizeof(benchs)/sizeof(benchs[0]); ++k)
+  {
+    if(!selected.empty() && selected!=benchs[k].name)
+      continue;
+    std::cout << "== " << benchs[k].name << " ==" << std::endl;
+    benchs[k].run();
+    found = true;
+  }
+
+  if(!found)
+  {
+    std::cerr << "Mesure inconnue : " << selected << std::endl;
+    return 1;
+  }
+  return 0;
+}
@@ -24,12 +24,47 @@ int temps = 0;
 int score = 0;
 
 bool perdu = false;
+//texture du sol affichee en cas de collision, chargee une seule fois a l'initialisation (0 si absente)
+GLuint texture_perdu = 0;
+
+//petites textures (dinosaure, joueur, police) regroupees dans une texture tableau liee sur l'unite 1:
+//les objets qui les utilisent s'affichent les uns apres les autres sans changer de texture
+GLuint atlas_textures = 0;
+std::vector<atlas_entry> atlas_entrees;
+//texture 2D liee sur l'unite 0, pour ne pas la relier entre deux objets qui la partagent
+GLuint texture_liee = 0;
+
+static void place_dans_atlas(objet* o, int entree);
+static void lie_texture(const objet* o);
+
+//BVH en espace objet des maillages testes en collision
+bvh bvh_dinosaure;
+bvh bvh_joueur;
+
+//recherche des paires d'objets proches : balayage trie sur l'axe le moins cher (choisi a chaque pas) ou grille hachee
+bool collision_balayage = true;
+sweep_and_prune balayage_collision;
+spatial_hash grille_collision(8.0f);
+
+//duree d'un pas de simulation (ms), les vitesses sont donnees pour un pas de 25 ms
+const int periode_timer = 25;
+const float pas_temps = periode_timer/25.0f;
+
+//transformations au pas precedent, pour la detection de collision continue
+transformation tr_precedent[nb_obj];
+bool tr_precedent_valide = false;
+//au-dela, un deplacement est une teleportation (retour en debut de voie) et n'est pas balaye
+const float deplacement_max = 20.0f;
+//au-dela, le test exact par sous-pas est remplace par un test balaye sur les boites des triangles
+const int nb_sous_pas_max = 16;
+
 /*****************************************************************************\
 * initialisation                                                              *
 \*****************************************************************************/
 static void init()
 {
-  shader_program_id = glhelper::create_program_from_file("shaders/shader.vert", "shaders/shader.frag"); CHECK_GL_ERROR();
+  shader_program_id = assets().acquire_program("shaders/shader.vert", "shaders/shader_atlas.frag"); CHECK_GL_ERROR();
+  gui_program_id = assets().acquire_program("shaders/gui.vert", "shaders/gui_atlas.frag"); CHECK_GL_ERROR();
 
   cam.projection = matrice_projection(60.0f*M_PI/180.0f,1.0f,0.01f,100.0f);
   cam.tr.translation = vec3(0.0f, 2.0f, 0.0f);
@@ -37,11 +72,37 @@ static void init()
   cam.tr.rotation_center = vec3(0.0f, 40.0f, 0.0f);
   cam.tr.rotation_euler = vec3(M_PI/2., 0.0f, 0.0f);
 
+  // variante sans perte (memes texels) la moins chere a charger sur cette machine, mesuree au premier lancement
+  calibrate_texture_sources({"data/route1.tga", "data/stegosaurus.tga"});
+  print_texture_sources();
+
+  // atlas relu depuis son cache ktx, sinon decode en parallele sur le pool; la route, repetee et trop large, garde sa texture
+  try
+  {
+    const texture_atlas atlas = load_texture_atlas({"data/stegosaurus.tga", "data/white.tga", "data/fontB.tga"}, 1024, 8);
+    atlas_entrees = atlas.entries;
+    atlas_textures = glhelper::create_texture_array(atlas.layers, "atlas");
+  }
+  catch(const std::string& e)
+  {
+    std::cerr << e << ", etes-vous dans le bon repertoire?" << std::endl;
+    abort();
+  }
+  glActiveTexture(GL_TEXTURE1);                                             CHECK_GL_ERROR();
+  glBindTexture(GL_TEXTURE_2D_ARRAY, atlas_textures);                       CHECK_GL_ERROR();
+  glActiveTexture(GL_TEXTURE0);                                             CHECK_GL_ERROR();
+  const GLuint programmes[] = {shader_program_id, gui_program_id};
+  for(GLuint p : programmes)
+  {
+    glUseProgram(p);                                                        CHECK_GL_ERROR();
+    glUniform1i(glGetUniformLocation(p, "atlas"), 1);                       CHECK_GL_ERROR();
+  }
+
   init_model_1();
   init_model_2();
   init_model_3();
-
-  gui_program_id = glhelper::create_program_from_file("shaders/gui.vert", "shaders/gui.frag"); CHECK_GL_ERROR();
+  texture_perdu = assets().acquire_texture("data/natani.tga");
+  glhelper::print_texture_memory();
 
   text_to_draw[0].value = "Timer";
   text_to_draw[0].bottomLeft = vec2(0.2, 0.92);
@@ -63,6 +124,7 @@ static void init()
 {
   glClearColor(0.5f, 0.6f, 0.9f, 1.0f); CHECK_GL_ERROR();
   glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT); CHECK_GL_ERROR();
+  texture_liee = 0;
 
   for(int i = 0; i < nb_obj; ++i)
     draw_obj3d(obj + i, cam);
@@ -108,6 +170,16 @@ static void keyboard_callback(unsigned char key, int, int)
       cam.tr.translation.x += d_angle;
       break;
 
+    case 'b':
+    {
+      //affiche le cout de la broadphase courante puis change de methode
+      const broadphase_stats& stats = collision_balayage ? balayage_collision.stats : grille_collision.stats;
+      std::cout << (collision_balayage ? "balayage" : "grille") << " : " << stats.nb_object << " objets, "
+                << stats.nb_pair << " paires, " << stats.update_ms << " ms" << std::endl;
+      collision_balayage = !collision_balayage;
+      break;
+    }
+
   }
 }
 
@@ -151,29 +223,29 @@ float d =(double) rand()/RAND_MAX;
 \*****************************************************************************/
 static void timer_callback(int)
 {
-  obj[0].tr.translation.x += (a+0.25);
+  obj[0].tr.translation.x += (a+0.25)*pas_temps;
   if (obj[0].tr.translation.x >30.0f){
     obj[0].tr.translation.x -= 55.0f;
   }
 
-  obj[3].tr.translation.x -= (b+0.25);
+  obj[3].tr.translation.x -= (b+0.25)*pas_temps;
   if (obj[3].tr.translation.x <-30.0f){
     obj[3].tr.translation.x += 50.0f;
   }
 
-  obj[5].tr.translation.x += (c+0.25);
+  obj[5].tr.translation.x += (c+0.25)*pas_temps;
   if (obj[5].tr.translation.x >30.0f){
     obj[5].tr.translation.x -= 55.0f;
   }
 
-  obj[4].tr.translation.x -= (d+0.25);
+  obj[4].tr.translation.x -= (d+0.25)*pas_temps;
   if (obj[4].tr.translation.x <-30.0f){
     obj[4].tr.translation.x += 50.0f;
   }
 
   collision();
   win();
-  glutTimerFunc(25, timer_callback, 0);
+  glutTimerFunc(periode_timer, timer_callback, 0);
   glutPostRedisplay();
   
 }
@@ -197,11 +269,89 @@ static void compteur(int)
 }
 }
 
+static mat4 deplace_modele(mat4 m, const vec3& d){
+  m(0,3) += d.x;
+  m(1,3) += d.y;
+  m(2,3) += d.z;
+  return m;
+}
+
 void collision(){
-int NumeroDinosaure[4]={0,3,4,5};
-for (int i=0; i<4; i++){
- if (abs(obj[2].tr.translation.x -obj[NumeroDinosaure[i]].tr.translation.x)<5 && (abs(obj[2].tr.translation.z -obj[NumeroDinosaure[i]].tr.translation.z)<2) ){
-  obj[1].texture_id = glhelper::load_texture("data/natani.tga");
+//boites englobantes en espace monde des objets visibles ayant une forme de collision,
+//balayees entre le pas precedent et le pas courant pour ne pas manquer les objets rapides
+std::vector<aabb> boites(nb_obj);
+aabb boites_debut[nb_obj];
+vec3 deplacements[nb_obj];
+mat4 modeles[nb_obj];
+for (int i=0; i<nb_obj; i++){
+ modeles[i] = matrice_modele(obj[i].tr);
+ if (tr_precedent_valide){
+  deplacements[i] = obj[i].tr.translation - tr_precedent[i].translation;
+  if (norm(deplacements[i]) > deplacement_max)
+   deplacements[i] = vec3();
+ }
+ tr_precedent[i] = obj[i].tr;
+ if (obj[i].visible && obj[i].forme != nullptr){
+  const aabb fin = transform(modeles[i], bvh_bounds(*obj[i].forme));
+  boites_debut[i] = aabb(fin.p_min-deplacements[i], fin.p_max-deplacements[i]);
+  boites[i] = swept_aabb(boites_debut[i], deplacements[i]);
+ }
+}
+tr_precedent_valide = true;
+
+std::vector<broadphase_pair> paires;
+if (collision_balayage){
+ sweep_and_prune_update(&balayage_collision, boites);
+ sweep_and_prune_pairs(&balayage_collision, &paires);
+}
+else{
+ spatial_hash_update(&grille_collision, boites);
+ spatial_hash_pairs(&grille_collision, &paires);
+}
+
+const int joueur = 2;
+for (unsigned int k=0; k<paires.size(); k++){
+ if (paires[k].first != joueur && paires[k].second != joueur)
+  continue;
+ const int i = paires[k].first == joueur ? paires[k].second : paires[k].first;
+
+ //premier instant de contact des boites pendant le pas
+ float toi;
+ if (!swept_aabb_toi(boites_debut[i], deplacements[i], boites_debut[joueur], deplacements[joueur], &toi))
+  continue;
+ //spheres englobantes, invariantes par rotation: plus serrees que les boites en monde des objets tournes
+ float toi_sphere;
+ const vec3 centre_obstacle = modeles[i]*obj[i].centre_forme - deplacements[i];
+ const vec3 centre_joueur = modeles[joueur]*obj[joueur].centre_forme - deplacements[joueur];
+ if (!swept_sphere_toi(centre_obstacle, obj[i].rayon_forme, deplacements[i], centre_joueur, obj[joueur].rayon_forme, deplacements[joueur], &toi_sphere))
+  continue;
+ toi = std::max(toi, toi_sphere);
+
+ //test exact sur les triangles, de l'instant de contact a la fin du pas, par sous-pas plus petits que le joueur
+ const vec3 taille = boites_debut[joueur].p_max-boites_debut[joueur].p_min;
+ const float epaisseur = std::max(0.05f, 0.5f*std::min(taille.x, std::min(taille.y, taille.z)));
+ const vec3 relatif = deplacements[joueur]-deplacements[i];
+ const int nb_sous_pas = 1+static_cast<int>(norm(relatif)*(1.0f-toi)/epaisseur);
+ bool touche = false;
+ if (nb_sous_pas <= nb_sous_pas_max){
+  for (int n=0; n<=nb_sous_pas && !touche; n++){
+   const float t = toi+(1.0f-toi)*n/nb_sous_pas;
+   const mat4 modele_obstacle = deplace_modele(modeles[i], (t-1.0f)*deplacements[i]);
+   const mat4 modele_joueur = deplace_modele(modeles[joueur], (t-1.0f)*deplacements[joueur]);
+   touche = bvh_overlap(*obj[i].forme, *obj[joueur].forme, inverse(modele_obstacle)*modele_joueur);
+  }
+ }
+ else{
+  //trop de sous-pas: boite du joueur balayee contre les boites des triangles de l'obstacle, dans l'espace de l'obstacle
+  const mat4 obstacle_inverse = inverse(deplace_modele(modeles[i], -1.0f*deplacements[i]));
+  const vec3 relatif_objet = obstacle_inverse*relatif - obstacle_inverse*vec3();
+  float t;
+  touche = bvh_swept_aabb_toi(*obj[i].forme, transform(obstacle_inverse, boites_debut[joueur]), relatif_objet, &t);
+ }
+
+ if (touche){
+  if (texture_perdu != 0)
+   obj[1].texture_id = texture_perdu;
   obj[0].visible=false;
   obj[3].visible=false;
   obj[2].visible=false;
@@ -212,6 +362,7 @@ for (int i=0; i<4; i++){
   text_to_draw[3].bottomLeft = vec2(-0.9, -0.9);
   text_to_draw[3].topRight = vec2(0.9, 0.9);
   perdu = true;
+  break;
 }
 
 }
@@ -224,6 +375,27 @@ void win (){
 }
 
 }
+
+/*****************************************************************************\
+* matrice_modele                                                              *
+\*****************************************************************************/
+mat4 matrice_modele(const transformation& tr)
+{
+  //meme transformation que le vertex shader : R*(p-c)+c+t
+  mat4 rotation_x = matrice_rotation(tr.rotation_euler.x, 1.0f, 0.0f, 0.0f);
+  mat4 rotation_y = matrice_rotation(tr.rotation_euler.y, 0.0f, 1.0f, 0.0f);
+  mat4 rotation_z = matrice_rotation(tr.rotation_euler.z, 0.0f, 0.0f, 1.0f);
+  mat4 m = rotation_x*rotation_y*rotation_z;
+
+  const vec3 c = tr.rotation_center;
+  const vec3 t = tr.translation;
+  const vec3 rc = m*c;
+  m(0,3) = c.x+t.x-rc.x;
+  m(1,3) = c.y+t.y-rc.y;
+  m(2,3) = c.z+t.z-rc.z;
+  return m;
+}
+
 /*****************************************************************************\
 * main                                                                         *
 \*****************************************************************************/
@@ -237,7 +409,7 @@ int main(int argc, char** argv)
   glutDisplayFunc(display_callback);
   glutKeyboardFunc(keyboard_callback);
   glutSpecialFunc(special_callback);
-  glutTimerFunc(25, timer_callback, 0);
+  glutTimerFunc(periode_timer, timer_callback, 0);
   glutTimerFunc(1000, compteur, 0);
 
   glewExperimental = true;
@@ -245,12 +417,48 @@ int main(int argc, char** argv)
 
   std::cout << "OpenGL: " << (GLchar *)(glGetString(GL_VERSION)) << std::endl;
 
+  // Les shaders, textures et maillages sont lus depuis data.pak s'il existe (assetc -pack data.pak shaders data)
+  if(asset_pack().open("data.pak"))
+    std::cout << "Pack data.pak: " << asset_pack().entries().size() << " fichiers" << std::endl;
+
   init();
   glutMainLoop();
 
   return 0;
 }
 
+/*****************************************************************************\
+* textures des objets                                                         *
+\*****************************************************************************/
+static void place_dans_atlas(objet* o, int entree)
+{
+  const atlas_entry& e = atlas_entrees[entree];
+  o->texture_id = atlas_textures;
+  o->atlas = true;
+  o->atlas_layer = e.layer;
+  o->atlas_offset = vec2(e.offset[0], e.offset[1]);
+  o->atlas_scale = vec2(e.scale[0], e.scale[1]);
+}
+
+static void lie_texture(const objet* o)
+{
+  GLint loc_use_atlas = glGetUniformLocation(o->prog, "use_atlas"); CHECK_GL_ERROR();
+  if (loc_use_atlas == -1) std::cerr << "Pas de variable uniforme : use_atlas" << std::endl;
+  glUniform1i(loc_use_atlas, o->atlas);                                   CHECK_GL_ERROR();
+  if(o->atlas)
+  {
+    GLint loc_layer = glGetUniformLocation(o->prog, "atlas_layer");      CHECK_GL_ERROR();
+    glUniform1i(loc_layer, o->atlas_layer);                               CHECK_GL_ERROR();
+    GLint loc_rect = glGetUniformLocation(o->prog, "atlas_rect");        CHECK_GL_ERROR();
+    glUniform4f(loc_rect, o->atlas_offset.x, o->atlas_offset.y, o->atlas_scale.x, o->atlas_scale.y); CHECK_GL_ERROR();
+  }
+  else if(o->texture_id != texture_liee)
+  {
+    glBindTexture(GL_TEXTURE_2D, o->texture_id);                          CHECK_GL_ERROR();
+    texture_liee = o->texture_id;
+  }
+}
+
 /*****************************************************************************\
 * draw_text                                                                   *
 \*****************************************************************************/
@@ -268,6 +476,7 @@ void draw_text(const text * const t)
   glUniform2f(loc_size,size.x, size.y);     CHECK_GL_ERROR();
 
   glBindVertexArray(t->vao);                CHECK_GL_ERROR();
+  lie_texture(t);
   
   for(unsigned i = 0; i < t->value.size(); ++i)
   {
@@ -278,7 +487,6 @@ void draw_text(const text * const t)
     GLint loc_char = glGetUniformLocation(gui_program_id, "c"); CHECK_GL_ERROR();
     if (loc_char == -1) std::cerr << "Pas de variable uniforme : c" << std::endl;
     glUniform1i(loc_char, (int)t->value[i]);    CHECK_GL_ERROR();
-    glBindTexture(GL_TEXTURE_2D, t->texture_id);                            CHECK_GL_ERROR();
     glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);                    CHECK_GL_ERROR();
   }
 }
@@ -335,8 +543,8 @@ void draw_obj3d(const objet3d* const obj, camera cam)
   }
   glBindVertexArray(obj->vao);                                              CHECK_GL_ERROR();
 
-  glBindTexture(GL_TEXTURE_2D, obj->texture_id);                            CHECK_GL_ERROR();
-  glDrawElements(GL_TRIANGLES, 3*obj->nb_triangle, GL_UNSIGNED_INT, 0);     CHECK_GL_ERROR();
+  lie_texture(obj);
+  glDrawElements(GL_TRIANGLES, 3*obj->nb_triangle, obj->type_index, 0);     CHECK_GL_ERROR();
 }
 
 void init_text(text *t){
@@ -364,7 +572,7 @@ void init_text(text *t){
   glBindBuffer(GL_ELEMENT_ARRAY_BUFFER,vboi);                                 CHECK_GL_ERROR();
   glBufferData(GL_ELEMENT_ARRAY_BUFFER,sizeof(index),index,GL_STATIC_DRAW);   CHECK_GL_ERROR();
 
-  t->texture_id = glhelper::load_texture("data/fontB.tga");
+  place_dans_atlas(t, 2);
 
   t->visible = true;
   t->prog = gui_program_id;
@@ -401,30 +609,34 @@ GLuint upload_mesh_to_gpu(const mesh& m)
 
 void init_model_1()
 {
-  // Chargement d'un maillage a partir d'un fichier
-  mesh m = load_obj_file("data/stegosaurus.obj");
-
-  // Affecte une transformation sur les sommets du maillage
+  // Transformation des sommets, normales et couleur appliquees au chargement
   float s = 1.2f;
-  mat4 transform = mat4(   s, 0.0f, 0.0f, 0.0f,
+  mesh_processing traitement;
+  traitement.deformation = mat4(   s, 0.0f, 0.0f, 0.0f,
       0.0f,    s, 0.0f, 0.0f,
       0.0f, 0.0f,   s , 0.0f,
       0.0f, 0.0f, 0.0f, 1.0f);
-  apply_deformation(&m,transform);
+  traitement.compute_normals = true;
+  traitement.use_color = true;
+  traitement.color = vec3(1.0f,1.0f,1.0f);
+
+  // Chargement d'un maillage a partir d'un fichier (assets/ d'assetc s'il est a jour, sinon cache binaire apres le premier lancement)
+  const gpu_mesh* m = assets().acquire_mesh("data/stegosaurus.obj",traitement);
+  bvh_dinosaure = load_bvh_processed("data/stegosaurus.obj",traitement,m->cpu);
 
   // Centre la rotation du modele 1 autour de son centre de gravite approximatif
   obj[0].tr.rotation_center = vec3(0.0f,0.0f,0.0f);
   obj[0].tr.rotation_euler = vec3(0.0f,1.6f,0.0f);
 
-  update_normals(&m);
-  fill_color(&m,vec3(1.0f,1.0f,1.0f));
+  obj[0].vao = m->vao;
 
-  obj[0].vao = upload_mesh_to_gpu(m);
-
-  obj[0].nb_triangle = m.connectivity.size();
-  obj[0].texture_id = glhelper::load_texture("data/stegosaurus.tga");
+  obj[0].nb_triangle = m->nb_triangle;
+  obj[0].type_index = m->index_type;
+  place_dans_atlas(&obj[0], 0);
   obj[0].visible = true;
   obj[0].prog = shader_program_id;
+  obj[0].forme = &bvh_dinosaure;
+  bvh_bounding_sphere(bvh_dinosaure, &obj[0].centre_forme, &obj[0].rayon_forme);
 
   obj[0].tr.translation = vec3(-15.0, 0.0, 10.0);
 
@@ -483,9 +695,10 @@ void init_model_2()
   m.connectivity = {tri0, tri1};
 
   obj[1].nb_triangle = 2;
+  obj[1].type_index = GL_UNSIGNED_INT;
   obj[1].vao = upload_mesh_to_gpu(m);
 
-  obj[1].texture_id = glhelper::load_texture("data/route1.tga");
+  obj[1].texture_id = assets().acquire_texture("data/route1.tga");
 
   obj[1].visible = true;
   obj[1].prog = shader_program_id;
@@ -494,29 +707,31 @@ void init_model_2()
 
 void init_model_3()
 {
-  // Chargement d'un maillage a partir d'un fichier
-  mesh m = load_obj_file("data/stickman.OBJ");
-
-  //Affecte une transformation sur les sommets du maillage
+  //Transformation des sommets, normales et couleur appliquees au chargement
   float s = 0.1f;
-  mat4 transform = mat4(   s, 0.0f, 0.0f, 0.0f,
+  mesh_processing traitement;
+  traitement.deformation = mat4(   s, 0.0f, 0.0f, 0.0f,
       0.0f,    s, 0.0f, 0.50f,
       0.0f, 0.0f,   s , 0.0f,
       0.0f, 0.0f, 0.0f, 1.0f);
-  //apply_deformation(&m,matrice_rotation(M_PI/2.0f,1.0f,0.0f,0.0f));
-  //apply_deformation(&m,matrice_rotation(M_PI,0.0f,1.0f,0.0f));
-  apply_deformation(&m,transform);
+  traitement.compute_normals = true;
+  traitement.use_color = true;
+  traitement.color = vec3(1.0f,1.0f,1.0f);
 
-  update_normals(&m);
-  fill_color(&m,vec3(1.0f,1.0f,1.0f));
+  // Chargement d'un maillage a partir d'un fichier (assets/ d'assetc s'il est a jour, sinon cache binaire apres le premier lancement)
+  const gpu_mesh* m = assets().acquire_mesh("data/stickman.OBJ",traitement);
+  bvh_joueur = load_bvh_processed("data/stickman.OBJ",traitement,m->cpu);
 
-  obj[2].vao = upload_mesh_to_gpu(m);
+  obj[2].vao = m->vao;
 
-  obj[2].nb_triangle = m.connectivity.size();
-  obj[2].texture_id = glhelper::load_texture("data/white.tga");
+  obj[2].nb_triangle = m->nb_triangle;
+  obj[2].type_index = m->index_type;
+  place_dans_atlas(&obj[2], 1);
 
   obj[2].visible = true;
   obj[2].prog = shader_program_id;
+  obj[2].forme = &bvh_joueur;
+  bvh_bounding_sphere(bvh_joueur, &obj[2].centre_forme, &obj[2].rayon_forme);
 
   obj[2].tr.translation = vec3(0.0, 0.0, -15.0);
 }
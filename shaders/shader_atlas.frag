@@ -0,0 +1,48 @@
+#version 330 core
+
+// Variable de sortie (sera utilisé comme couleur)
+out vec4 color;
+
+in vec3 coordonnee_3d;
+in vec3 coordonnee_3d_locale;
+in vec3 vnormale;
+in vec4 vcolor;
+in vec2 vtex;
+
+// texture propre a l'objet (unite 0)
+uniform sampler2D texture_objet;
+// textures regroupees (unite 1): couche et rectangle (coin, taille) de l'objet dans l'atlas
+uniform sampler2DArray atlas;
+uniform bool use_atlas;
+uniform int atlas_layer;
+uniform vec4 atlas_rect;
+
+vec3 light=vec3(0.5,0.5,5.0);
+
+void main (void)
+{
+  //vecteurs pour le calcul d'illumination
+  vec3 n = normalize(vnormale);
+  vec3 d = normalize(light-coordonnee_3d_locale);
+  vec3 r = reflect(d,n);
+  vec3 o = normalize(-coordonnee_3d_locale);
+
+  //calcul d'illumination
+  float diffuse  = 0.7*clamp(dot(n,d),0.0,1.0);
+  float specular = 0.2*pow(clamp(dot(r,o),0.0,1.0),128.0);
+  float ambiant  = 0.2;
+
+  vec4 white = vec4(1.0,1.0,1.0,0.0);
+
+  //recuperation de la texture (dans l'atlas, les coordonnees restent dans le rectangle de l'objet)
+  vec4 color_texture;
+  if(use_atlas)
+    color_texture = texture(atlas, vec3(atlas_rect.xy + clamp(vtex,0.0,1.0)*atlas_rect.zw, float(atlas_layer)));
+  else
+    color_texture = texture(texture_objet, vtex);
+  vec4 color_final   = vcolor*color_texture;
+
+  //couleur finale
+  color = (ambiant+diffuse)*color_final+specular*white;
+
+}
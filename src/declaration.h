@@ -18,12 +18,22 @@
 #endif
 
 #include "glhelper.hpp"
+#include "async_loader.hpp"
+#include "asset_registry.hpp"
+#include "texture_cache.hpp"
+#include "texture_stream.hpp"
+#include "texture_atlas.hpp"
 #include "mat4.hpp"
 #include "vec3.hpp"
 #include "vec2.hpp"
 #include "triangle_index.hpp"
 #include "vertex_opengl.hpp"
 #include "mesh.hpp"
+#include "mesh_cache.hpp"
+#include "pack_file.hpp"
+#include "bvh.hpp"
+#include "broadphase.hpp"
+#include "ccd.hpp"
 
 
 //matrice de transformation
@@ -47,13 +57,21 @@ struct objet
   GLuint prog;        // identifiant du shader
   GLuint vao;         // identifiant du vao
   GLuint nb_triangle; // nombre de triangle du maillage
+  GLenum type_index;  // type des indices du vao (GL_UNSIGNED_SHORT ou GL_UNSIGNED_INT)
   GLuint texture_id;  // identifiant de la texture
   bool visible;       // montre ou cache l'objet
+  bool atlas;         // texture dans l'atlas (texture tableau) plutot que texture_id seule
+  int atlas_layer;    // couche de l'atlas
+  vec2 atlas_offset;  // coin du rectangle de la texture dans la couche (coordonnees normalisees)
+  vec2 atlas_scale;   // taille de ce rectangle
 };
 
 struct objet3d : public objet
 {
   transformation tr;
+  const bvh* forme;   // maillage de collision en espace objet (nullptr: pas de collision)
+  vec3 centre_forme;  // sphere englobante de la forme en espace objet
+  float rayon_forme;
 };
 
 struct text : public objet
@@ -72,4 +90,9 @@ void init_model_1();
 void init_model_2();
 void init_model_3();
 
-void draw_obj3d(const objet3d* const obj, camera cam);
\ No newline at end of file
+void draw_obj3d(const objet3d* const obj, camera cam);
+
+mat4 matrice_modele(const transformation& tr);
+
+void collision();
+void win();
\ No newline at end of file
@@ -19,6 +19,13 @@ objet3d obj[nb_obj];
 const int nb_text = 2;
 text text_to_draw[nb_text];
 
+//maillages et textures lus sur le pool de threads, envoyes sur le GPU au fil des images
+async_loader chargeur;
+//temps maximal consacre aux envois sur le GPU a chaque image (ms)
+const double budget_envoi = 4.0;
+//anneau de PBO ou le pool ecrit les textures, cree avec le contexte OpenGL et libere par termine()
+texture_stream* flux_textures = nullptr;
+
 
 
 /*****************************************************************************\
@@ -26,7 +33,10 @@ text text_to_draw[nb_text];
 \*****************************************************************************/
 static void init()
 {
-  shader_program_id = glhelper::create_program_from_file("shaders/shader.vert", "shaders/shader.frag"); CHECK_GL_ERROR();
+  shader_program_id = assets().acquire_program("shaders/shader.vert", "shaders/shader.frag"); CHECK_GL_ERROR();
+
+  flux_textures = new texture_stream(32*1024*1024);
+  chargeur.set_texture_stream(flux_textures);
 
   cam.projection = matrice_projection(60.0f*M_PI/180.0f,1.0f,0.01f,100.0f);
   cam.tr.translation = vec3(0.0f, 1.0f, 0.0f);
@@ -38,7 +48,7 @@ static void init()
   //init_model_2();
   init_model_3();
 
-  gui_program_id = glhelper::create_program_from_file("shaders/gui.vert", "shaders/gui.frag"); CHECK_GL_ERROR();
+  gui_program_id = assets().acquire_program("shaders/gui.vert", "shaders/gui.frag"); CHECK_GL_ERROR();
 
   text_to_draw[0].value = "CPE";
   text_to_draw[0].bottomLeft = vec2(-0.2, 0.5);
@@ -59,6 +69,8 @@ static void init()
   glClearColor(0.5f, 0.6f, 0.9f, 1.0f); CHECK_GL_ERROR();
   glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT); CHECK_GL_ERROR();
 
+  chargeur.update(budget_envoi);
+
   for(int i = 0; i < nb_obj; ++i)
     draw_obj3d(obj + i, cam);
 
@@ -68,6 +80,20 @@ static void init()
   glutSwapBuffers();
 }
 
+/*****************************************************************************\
+* termine                                                                     *
+\*****************************************************************************/
+// Les taches du pool peuvent encore ecrire dans l'anneau: on vide le chargeur avant de le liberer
+static void termine()
+{
+  while(chargeur.pending() > 0)
+    if(chargeur.update(budget_envoi) == 0)
+      default_thread_pool().run_pending_task();
+  chargeur.set_texture_stream(nullptr);
+  delete flux_textures;
+  flux_textures = nullptr;
+}
+
 /*****************************************************************************\
 * keyboard_callback                                                           *
 \*****************************************************************************/
@@ -81,6 +107,7 @@ static void keyboard_callback(unsigned char key, int, int)
     case 'q':
     case 'Q':
     case 27:
+      termine();
       exit(0);
       break;
   }
@@ -124,6 +151,10 @@ int main(int argc, char** argv)
 
   std::cout << "OpenGL: " << (GLchar *)(glGetString(GL_VERSION)) << std::endl;
 
+  // Les shaders, textures et maillages sont lus depuis data.pak s'il existe (assetc -pack data.pak shaders data)
+  if(asset_pack().open("data.pak"))
+    std::cout << "Pack data.pak: " << asset_pack().entries().size() << " fichiers" << std::endl;
+
   init();
   glutMainLoop();
 
@@ -215,7 +246,7 @@ void draw_obj3d(const objet3d* const obj, camera cam)
   glBindVertexArray(obj->vao);                                              CHECK_GL_ERROR();
 
   glBindTexture(GL_TEXTURE_2D, obj->texture_id);                            CHECK_GL_ERROR();
-  glDrawElements(GL_TRIANGLES, 3*obj->nb_triangle, GL_UNSIGNED_INT, 0);     CHECK_GL_ERROR();
+  glDrawElements(GL_TRIANGLES, 3*obj->nb_triangle, obj->type_index, 0);     CHECK_GL_ERROR();
 }
 
 void init_text(text *t){
@@ -243,7 +274,7 @@ void init_text(text *t){
   glBindBuffer(GL_ELEMENT_ARRAY_BUFFER,vboi);                                 CHECK_GL_ERROR();
   glBufferData(GL_ELEMENT_ARRAY_BUFFER,sizeof(index),index,GL_STATIC_DRAW);   CHECK_GL_ERROR();
 
-  t->texture_id = glhelper::load_texture("data/fontB.tga");
+  t->texture_id = assets().acquire_texture("data/fontB.tga");
 
   t->visible = true;
   t->prog = gui_program_id;
@@ -278,32 +309,44 @@ GLuint upload_mesh_to_gpu(const mesh& m)
   return vao;
 }
 
-void init_model_1()
+// Un objet devient visible quand son maillage et sa texture sont sur le GPU
+static void affiche_si_pret(objet3d* o)
 {
-  // Chargement d'un maillage a partir d'un fichier
-  mesh m = load_obj_file("data/stegosaurus.obj");
+  o->visible = o->vao != 0 && o->texture_id != 0;
+}
 
-  // Affecte une transformation sur les sommets du maillage
+void init_model_1()
+{
+  // Transformation des sommets, normales et couleur appliquees au chargement
   float s = 1.2f;
-  mat4 transform = mat4(   s, 0.0f, 0.0f, 0.0f,
+  mesh_processing traitement;
+  traitement.deformation = mat4(   s, 0.0f, 0.0f, 0.0f,
       0.0f,    s, 0.0f, 0.0f,
       0.0f, 0.0f,   s , 0.0f,
       0.0f, 0.0f, 0.0f, 1.0f);
-  apply_deformation(&m,transform);
+  traitement.compute_normals = true;
+  traitement.use_color = true;
+  traitement.color = vec3(1.0f,1.0f,1.0f);
 
   // Centre la rotation du modele 1 autour de son centre de gravite approximatif
   obj[0].tr.rotation_center = vec3(0.0f,0.0f,0.0f);
 
-  update_normals(&m);
-  fill_color(&m,vec3(1.0f,1.0f,1.0f));
-
-  obj[0].vao = upload_mesh_to_gpu(m);
-
-  obj[0].nb_triangle = m.connectivity.size();
-  obj[0].texture_id = glhelper::load_texture("data/nathan.tga");
-  obj[0].visible = true;
+  obj[0].visible = false;
   obj[0].prog = shader_program_id;
 
+  // Chargement asynchrone du maillage (relu depuis le cache binaire apres le premier lancement) et de la texture
+  assets().acquire_mesh(chargeur, "data/stegosaurus.obj", traitement, [](const gpu_mesh* m) {
+    if (m == nullptr) return; // fichier illisible: l'objet reste cache
+    obj[0].vao = m->vao;
+    obj[0].nb_triangle = m->nb_triangle;
+    obj[0].type_index = m->index_type;
+    affiche_si_pret(obj + 0);
+  });
+  assets().acquire_texture(chargeur, "data/nathan.tga", [](GLuint id) {
+    obj[0].texture_id = id;
+    affiche_si_pret(obj + 0);
+  });
+
   obj[0].tr.translation = vec3(-2.0, 0.0, -10.0);
 }
 
@@ -349,9 +392,10 @@ void init_model_2()
   m.connectivity = {tri0, tri1};
 
   obj[1].nb_triangle = 2;
+  obj[1].type_index = GL_UNSIGNED_INT;
   obj[1].vao = upload_mesh_to_gpu(m);
 
-  obj[1].texture_id = glhelper::load_texture("data/route1.tga");
+  obj[1].texture_id = assets().acquire_texture("data/route1.tga");
 
   obj[1].visible = true;
   obj[1].prog = shader_program_id;
@@ -360,29 +404,33 @@ void init_model_2()
 
 void init_model_3()
 {
-  // Chargement d'un maillage a partir d'un fichier
-  mesh m = load_obj_file("data/cube.obj");
-
-  //Affecte une transformation sur les sommets du maillage
+  //Transformation des sommets (rotations puis mise a l'echelle), normales et couleur appliquees au chargement
   float s = 1.1f;
   mat4 transform = mat4(   s, 0.0f, 0.0f, 0.0f,
       0.0f,    s, 0.0f, 0.50f,
       0.0f, 0.0f,   s , 0.0f,
       0.0f, 0.0f, 0.0f, 1.0f);
-  apply_deformation(&m,matrice_rotation(M_PI/2.0f,1.0f,0.0f,0.0f));
-  apply_deformation(&m,matrice_rotation(M_PI,0.0f,1.0f,0.0f));
-  apply_deformation(&m,transform);
-
-  update_normals(&m);
-  fill_color(&m,vec3(1.0f,1.0f,1.0f));
-
-  obj[2].vao = upload_mesh_to_gpu(m);
+  mesh_processing traitement;
+  traitement.deformation = transform*matrice_rotation(M_PI,0.0f,1.0f,0.0f)*matrice_rotation(M_PI/2.0f,1.0f,0.0f,0.0f);
+  traitement.compute_normals = true;
+  traitement.use_color = true;
+  traitement.color = vec3(1.0f,1.0f,1.0f);
 
-  obj[2].nb_triangle = m.connectivity.size();
-  obj[2].texture_id = glhelper::load_texture("data/nathan.tga");
-
-  obj[2].visible = true;
+  obj[2].visible = false;
   obj[2].prog = shader_program_id;
 
+  // Chargement asynchrone du maillage et de la texture (nathan.tga est partagee avec le modele 1 par le registre)
+  assets().acquire_mesh(chargeur, "data/cube.obj", traitement, [](const gpu_mesh* m) {
+    if (m == nullptr) return; // fichier illisible: l'objet reste cache
+    obj[2].vao = m->vao;
+    obj[2].nb_triangle = m->nb_triangle;
+    obj[2].type_index = m->index_type;
+    affiche_si_pret(obj + 2);
+  });
+  assets().acquire_texture(chargeur, "data/nathan.tga", [](GLuint id) {
+    obj[2].texture_id = id;
+    affiche_si_pret(obj + 2);
+  });
+
   obj[2].tr.translation = vec3(2.0, 0.0, -10.0);
 }
\ No newline at end of file
@@ -0,0 +1,75 @@
+
+#include "aabb.hpp"
+#include "mat4.hpp"
+
+#include <algorithm>
+#include <limits>
+
+
+aabb::aabb()
+  :p_min(vec3( std::numeric_limits<float>::max(), std::numeric_limits<float>::max(), std::numeric_limits<float>::max())),
+   p_max(vec3(-std::numeric_limits<float>::max(),-std::numeric_limits<float>::max(),-std::numeric_limits<float>::max()))
+{}
+
+aabb::aabb(const vec3& p_min_param,const vec3& p_max_param)
+  :p_min(p_min_param),p_max(p_max_param)
+{}
+
+void extend(aabb* b,const vec3& p)
+{
+  b->p_min.x=std::min(b->p_min.x,p.x); b->p_max.x=std::max(b->p_max.x,p.x);
+  b->p_min.y=std::min(b->p_min.y,p.y); b->p_max.y=std::max(b->p_max.y,p.y);
+  b->p_min.z=std::min(b->p_min.z,p.z); b->p_max.z=std::max(b->p_max.z,p.z);
+}
+
+void extend(aabb* b,const aabb& b2)
+{
+  extend(b,b2.p_min);
+  extend(b,b2.p_max);
+}
+
+bool is_empty(const aabb& b)
+{
+  return b.p_min.x>b.p_max.x || b.p_min.y>b.p_max.y || b.p_min.z>b.p_max.z;
+}
+
+bool overlap(const aabb& b0,const aabb& b1)
+{
+  return b0.p_min.x<=b1.p_max.x && b1.p_min.x<=b0.p_max.x &&
+      b0.p_min.y<=b1.p_max.y && b1.p_min.y<=b0.p_max.y &&
+      b0.p_min.z<=b1.p_max.z && b1.p_min.z<=b0.p_max.z;
+}
+
+vec3 center(const aabb& b)
+{
+  return 0.5f*(b.p_min+b.p_max);
+}
+
+float surface_area(const aabb& b)
+{
+  if(is_empty(b))
+    return 0.0f;
+  const vec3 d=b.p_max-b.p_min;
+  return 2.0f*(d.x*d.y+d.y*d.z+d.z*d.x);
+}
+
+aabb transform(const mat4& T,const aabb& b)
+{
+  //methode d'Arvo: on projette chaque colonne de la matrice sur les axes
+  aabb res(vec3(T(0,3),T(1,3),T(2,3)),vec3(T(0,3),T(1,3),T(2,3)));
+  const float b_min[3]={b.p_min.x,b.p_min.y,b.p_min.z};
+  const float b_max[3]={b.p_max.x,b.p_max.y,b.p_max.z};
+  float* r_min[3]={&res.p_min.x,&res.p_min.y,&res.p_min.z};
+  float* r_max[3]={&res.p_max.x,&res.p_max.y,&res.p_max.z};
+  for(int i=0;i<3;++i)
+  {
+    for(int j=0;j<3;++j)
+    {
+      const float e=T(i,j)*b_min[j];
+      const float f=T(i,j)*b_max[j];
+      *r_min[i]+=std::min(e,f);
+      *r_max[i]+=std::max(e,f);
+    }
+  }
+  return res;
+}
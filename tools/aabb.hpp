@@ -0,0 +1,41 @@
+#pragma once
+
+#ifndef AABB_HPP
+#define AABB_HPP
+
+#include "vec3.hpp"
+
+struct mat4;
+
+/** Une boite englobante alignee sur les axes */
+struct aabb
+{
+  /** Coin minimal */
+  vec3 p_min;
+  /** Coin maximal */
+  vec3 p_max;
+
+  /** Constructeur boite vide (min=+inf, max=-inf) */
+  aabb();
+  /** Constructeur boite [p_min,p_max] */
+  aabb(const vec3& p_min_param,const vec3& p_max_param);
+};
+
+/** Agrandit la boite pour contenir le point p */
+void extend(aabb* b,const vec3& p);
+/** Agrandit la boite pour contenir la boite b2 */
+void extend(aabb* b,const aabb& b2);
+
+/** Indique si la boite est vide */
+bool is_empty(const aabb& b);
+/** Indique si deux boites s'intersectent */
+bool overlap(const aabb& b0,const aabb& b1);
+/** Centre de la boite */
+vec3 center(const aabb& b);
+/** Aire de la surface de la boite (heuristique SAH) */
+float surface_area(const aabb& b);
+
+/** Boite englobant l'image de b par la transformation T */
+aabb transform(const mat4& T,const aabb& b);
+
+#endif
@@ -0,0 +1,83 @@
+
+#include "asset_manifest.hpp"
+
+#include "hash.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+
+
+asset_manifest read_asset_manifest(const std::string& filename)
+{
+  asset_manifest entries;
+  std::ifstream fid(filename.c_str());
+  std::string line;
+  while(std::getline(fid,line))
+  {
+    if(line.empty() || line[0]=='#')
+      continue;
+    std::istringstream tokens(line);
+    std::string hash_hex,relative,output;
+    tokens>>hash_hex>>relative;
+    std::vector<std::string> outputs;
+    while(tokens>>output)
+      outputs.push_back(output);
+    entries[relative]=std::make_pair(std::strtoull(hash_hex.c_str(),nullptr,16),outputs);
+  }
+  return entries;
+}
+
+void write_asset_manifest(const std::string& filename,const asset_manifest& entries)
+{
+  std::ofstream fid(filename.c_str());
+  fid<<"# assetc manifest, version "<<assetc_version<<std::endl;
+  for(asset_manifest::const_iterator it=entries.begin();it!=entries.end();++it)
+  {
+    char hash_hex[17];
+    std::snprintf(hash_hex,sizeof(hash_hex),"%016llx",it->second.first);
+    fid<<hash_hex<<" "<<it->first;
+    for(unsigned int k=0;k<it->second.second.size();++k)
+      fid<<" "<<it->second.second[k];
+    fid<<std::endl;
+  }
+}
+
+bool hash_asset_source(const std::string& filename,unsigned long long* hash)
+{
+  if(!hash_file(filename,hash))
+    return false;
+  *hash=hash_combine(*hash,assetc_version);
+  return true;
+}
+
+std::string compiled_asset_filename(const std::string& source_filename,const std::string& suffix)
+{
+  const std::string prefix=std::string(asset_source_directory)+"/";
+  if(source_filename.compare(0,prefix.size(),prefix)!=0)
+    return "";
+  const std::string relative=source_filename.substr(prefix.size());
+  const std::string output=relative+suffix;
+  const std::string directory=asset_directory;
+
+  const asset_manifest entries=read_asset_manifest(directory+"/manifest.txt");
+  const asset_manifest::const_iterator it=entries.find(relative);
+  if(it==entries.end())
+    return "";
+  const std::vector<std::string>& outputs=it->second.second;
+  bool listed=false;
+  for(unsigned int k=0;k<outputs.size() && !listed;++k)
+    listed=outputs[k]==output;
+  if(!listed)
+    return "";
+
+  //meme contenu et meme version d'assetc que lors de la conversion
+  unsigned long long hash;
+  if(hash_asset_source(source_filename,&hash) && hash!=it->second.first)
+    return "";
+
+  const std::string filename=directory+"/"+output;
+  std::ifstream fid(filename.c_str(),std::ios::binary);
+  return fid.good() ? filename : "";
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#ifndef ASSET_MANIFEST_HPP
+#define ASSET_MANIFEST_HPP
+
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+/** Version du format de sortie d'assetc, a incrementer quand une conversion change:
+ *  tous les assets sont alors reconstruits, et les anciens ignores a l'execution */
+const unsigned int assetc_version=2;
+
+/** Repertoires par defaut des sources et des assets compiles par assetc */
+const char* const asset_source_directory="data";
+const char* const asset_directory="assets";
+
+/** manifest.txt d'assetc: pour chaque source (chemin relatif), le hachage de son contenu
+ *  combine a assetc_version et les fichiers produits (chemins relatifs aux assets) */
+typedef std::map<std::string,std::pair<unsigned long long,std::vector<std::string> > > asset_manifest;
+
+/** Relit le manifest (vide si le fichier est absent) */
+asset_manifest read_asset_manifest(const std::string& filename);
+/** Ecrit le manifest, une ligne "hachage source sortie_1 sortie_2 ..." par source */
+void write_asset_manifest(const std::string& filename,const asset_manifest& entries);
+
+/** Hachage d'un source tel qu'il est enregistre dans le manifest, false si le fichier est illisible */
+bool hash_asset_source(const std::string& filename,unsigned long long* hash);
+
+/** Asset produit par assetc pour un fichier de data/ (data/x.obj et ".msh" -> assets/x.obj.msh).
+ *  Renvoie une chaine vide si l'asset est absent ou si le manifest ne correspond plus au contenu
+ *  du source. Un asset dont le source a disparu est accepte. */
+std::string compiled_asset_filename(const std::string& source_filename,const std::string& suffix);
+
+#endif
@@ -0,0 +1,483 @@
+
+#include "asset_registry.hpp"
+
+#include "async_loader.hpp"
+#include "glhelper.hpp"
+#include "hash.hpp"
+#include "mapped_file.hpp"
+#include "pack_file.hpp"
+#include "texture_cache.hpp"
+#include "texture_stream.hpp"
+#include "thread_pool.hpp"
+
+#include <cstdio>
+#include <exception>
+#include <iostream>
+#include <memory>
+
+
+namespace
+{
+  /** Contenu d'une ressource, lu depuis le pack ou le fichier projete */
+  struct asset_bytes
+  {
+    pack_data pack;
+    mapped_file file;
+    const unsigned char* data;
+    size_t size;
+
+    asset_bytes():data(nullptr),size(0) {}
+  };
+
+  bool read_bytes(const std::string& filename,asset_bytes* bytes)
+  {
+    if(asset_pack().read(filename,&bytes->pack))
+    {
+      bytes->data=bytes->pack.span.data;
+      bytes->size=bytes->pack.span.size;
+      return true;
+    }
+    if(!bytes->file.open(filename))
+      return false;
+    bytes->data=reinterpret_cast<const unsigned char*>(bytes->file.data());
+    bytes->size=bytes->file.size();
+    return true;
+  }
+
+  std::string mesh_key(const std::string& filename,const mesh_processing& processing)
+  {
+    char suffix[24];
+    std::snprintf(suffix,sizeof(suffix),"#%016llx",hash_processing(processing));
+    return filename+suffix;
+  }
+
+  /** Sommets entrelaces (vertex_opengl) et indices dans un VAO, attributs 0 a 3 comme les shaders */
+  void upload(gpu_mesh* m)
+  {
+    const mesh& c=m->cpu;
+    glGenVertexArrays(1,&m->vao);                                                      CHECK_GL_ERROR();
+    glBindVertexArray(m->vao);                                                         CHECK_GL_ERROR();
+
+    m->vbo=glhelper::create_buffer(GL_ARRAY_BUFFER,c.vertex.empty() ? nullptr : &c.vertex[0],c.vertex.size()*sizeof(vertex_opengl));
+    glEnableVertexAttribArray(0);                                                      CHECK_GL_ERROR();
+    glVertexAttribPointer(0,3,GL_FLOAT,GL_FALSE,sizeof(vertex_opengl),0);              CHECK_GL_ERROR();
+    glEnableVertexAttribArray(1);                                                      CHECK_GL_ERROR();
+    glVertexAttribPointer(1,3,GL_FLOAT,GL_TRUE,sizeof(vertex_opengl),(void*)sizeof(vec3)); CHECK_GL_ERROR();
+    glEnableVertexAttribArray(2);                                                      CHECK_GL_ERROR();
+    glVertexAttribPointer(2,3,GL_FLOAT,GL_FALSE,sizeof(vertex_opengl),(void*)(2*sizeof(vec3))); CHECK_GL_ERROR();
+    glEnableVertexAttribArray(3);                                                      CHECK_GL_ERROR();
+    glVertexAttribPointer(3,2,GL_FLOAT,GL_FALSE,sizeof(vertex_opengl),(void*)(3*sizeof(vec3))); CHECK_GL_ERROR();
+
+    //indices sur 16 bits quand le nombre de sommets le permet: moitie moins de memoire et de lecture pour le GPU
+    if(c.vertex.size()<=65536)
+    {
+      std::vector<unsigned short> index(3*c.connectivity.size());
+      for(unsigned int t=0;t<c.connectivity.size();++t)
+      {
+        index[3*t+0]=static_cast<unsigned short>(c.connectivity[t].u0);
+        index[3*t+1]=static_cast<unsigned short>(c.connectivity[t].u1);
+        index[3*t+2]=static_cast<unsigned short>(c.connectivity[t].u2);
+      }
+      m->vboi=glhelper::create_buffer(GL_ELEMENT_ARRAY_BUFFER,index.empty() ? nullptr : &index[0],index.size()*sizeof(unsigned short));
+      m->index_type=GL_UNSIGNED_SHORT;
+    }
+    else
+    {
+      m->vboi=glhelper::create_buffer(GL_ELEMENT_ARRAY_BUFFER,c.connectivity.empty() ? nullptr : &c.connectivity[0],c.connectivity.size()*sizeof(triangle_index));
+      m->index_type=GL_UNSIGNED_INT;
+    }
+    m->nb_triangle=c.connectivity.size();
+    glBindVertexArray(0);                                                              CHECK_GL_ERROR();
+  }
+
+  unsigned long long mesh_id(const gpu_mesh* m)
+  {
+    return static_cast<unsigned long long>(reinterpret_cast<size_t>(m));
+  }
+}
+
+
+asset_registry::asset_registry()
+  :request_count(0),load_count(0)
+{}
+
+void asset_registry::unregister(entry& e,std::map<std::string,unsigned long long>& by_key)
+{
+  for(unsigned int k=0;k<e.keys.size();++k)
+    by_key.erase(e.keys[k]);
+}
+
+GLuint asset_registry::insert_texture(const std::string& key,unsigned long long hash,const std::function<GLuint()>& create)
+{
+  //meme contenu sous un autre chemin: la texture existante est partagee
+  std::map<unsigned long long,unsigned long long>::const_iterator it=texture_by_hash.find(hash);
+  if(it!=texture_by_hash.end())
+  {
+    entry& e=textures[it->second];
+    e.references++;
+    e.keys.push_back(key);
+    texture_by_key[key]=it->second;
+    return static_cast<GLuint>(it->second);
+  }
+
+  const GLuint id=create();
+  load_count++;
+  entry& e=textures[id];
+  e.references=1;
+  e.hash=hash;
+  e.keys.push_back(key);
+  texture_by_key[key]=id;
+  texture_by_hash[hash]=id;
+  return id;
+}
+
+GLuint asset_registry::acquire_texture(const std::string& filename)
+{
+  request_count++;
+  std::map<std::string,unsigned long long>::const_iterator it=texture_by_key.find(filename);
+  if(it!=texture_by_key.end())
+  {
+    textures[it->second].references++;
+    return static_cast<GLuint>(it->second);
+  }
+
+  std::shared_ptr<texture_source> source=read_texture_file(filename);
+  if(!source)
+  {
+    std::cerr<<"Fichier introuvable: "<<filename<<std::endl;
+    return 0;
+  }
+  try
+  {
+    //le contenu n'est decode que s'il n'est pas deja sur le GPU sous un autre chemin
+    return insert_texture(filename,source->content_hash,[&source,&filename]() {
+      prepare_texture(source.get());
+      return glhelper::create_texture(source->view,filename);
+    });
+  }
+  catch(const std::string& e)
+  {
+    std::cerr<<e<<std::endl;
+    return 0;
+  }
+}
+
+std::vector<GLuint> asset_registry::acquire_textures(const std::vector<std::string>& filenames)
+{
+  //lecture, decodage et compression des textures absentes en meme temps sur le pool; le registre
+  //n'est que lu par les taches, il n'est modifie qu'ensuite sur ce thread
+  std::vector<std::shared_ptr<texture_source> > sources(filenames.size());
+  task_group group(default_thread_pool());
+  for(unsigned int k=0;k<filenames.size();++k)
+  {
+    if(texture_by_key.count(filenames[k])>0)
+      continue;
+    group.run([this,&filenames,&sources,k]() {
+      std::shared_ptr<texture_source> source=read_texture_file(filenames[k]);
+      if(!source)
+      {
+        std::cerr<<"Fichier introuvable: "<<filenames[k]<<std::endl;
+        return;
+      }
+      try
+      {
+        if(texture_by_hash.count(source->content_hash)==0)
+          prepare_texture(source.get());
+        sources[k]=source;
+      }
+      catch(const std::string& e)
+      {
+        std::cerr<<e<<std::endl;
+      }
+    });
+  }
+  group.wait();
+
+  //envois dans l'ordre demande, un meme fichier present deux fois n'est envoye qu'une fois
+  std::vector<GLuint> ids(filenames.size(),0);
+  for(unsigned int k=0;k<filenames.size();++k)
+  {
+    request_count++;
+    std::map<std::string,unsigned long long>::const_iterator it=texture_by_key.find(filenames[k]);
+    if(it!=texture_by_key.end())
+    {
+      textures[it->second].references++;
+      ids[k]=static_cast<GLuint>(it->second);
+    }
+    else if(sources[k])
+    {
+      const std::shared_ptr<texture_source>& source=sources[k];
+      const std::string& filename=filenames[k];
+      ids[k]=insert_texture(filename,source->content_hash,[&source,&filename]() { return glhelper::create_texture(source->view,filename); });
+    }
+  }
+  return ids;
+}
+
+void asset_registry::acquire_texture(async_loader& loader,const std::string& filename,const std::function<void(GLuint)>& on_ready)
+{
+  request_count++;
+  std::map<std::string,unsigned long long>::const_iterator it=texture_by_key.find(filename);
+  if(it!=texture_by_key.end())
+  {
+    textures[it->second].references++;
+    on_ready(static_cast<GLuint>(it->second));
+    return;
+  }
+
+  //deja en cours de lecture: on attend le meme chargement
+  std::vector<std::function<void(GLuint)> >& waiting=texture_waiting[filename];
+  waiting.push_back(on_ready);
+  if(waiting.size()>1)
+    return;
+
+  texture_stream* stream=loader.stream();
+  loader.submit([this,filename,stream]() -> std::function<void()> {
+    std::shared_ptr<texture_source> source;
+    try
+    {
+      source=open_texture_file(filename);
+    }
+    catch(const std::string& e)
+    {
+      std::cerr<<e<<std::endl;
+    }
+    catch(const std::exception& e)
+    {
+      std::cerr<<e.what()<<std::endl;
+    }
+
+    //niveaux ecrits dans l'anneau de transfert s'il y a la place, la source est alors liberee ici
+    texture_stream_block block;
+    const unsigned long long hash=source ? source->content_hash : 0;
+    if(source && stream!=nullptr && stream->write(source->view,&block))
+      source.reset();
+
+    //sur le thread OpenGL: envoi (sauf si le contenu est deja present) puis reponse a tous les demandeurs
+    return [this,filename,source,stream,block,hash]() {
+      std::vector<std::function<void(GLuint)> > callbacks;
+      callbacks.swap(texture_waiting[filename]);
+      texture_waiting.erase(filename);
+      if(!source && block.id==0)
+      {
+        std::cerr<<"Erreur chargement de l'image: "<<filename<<std::endl;
+        for(unsigned int k=0;k<callbacks.size();++k)
+          callbacks[k](0);
+        return;
+      }
+      bool uploaded=false;
+      const GLuint id=insert_texture(filename,hash,[&]() {
+        uploaded=true;
+        return block.id!=0 ? stream->upload(block,filename) : glhelper::create_texture(source->view,filename);
+      });
+      if(block.id!=0 && !uploaded)
+        stream->discard(block);
+      textures[id].references+=callbacks.size()-1;
+      for(unsigned int k=0;k<callbacks.size();++k)
+        callbacks[k](id);
+    };
+  });
+}
+
+void asset_registry::release_texture(GLuint texture)
+{
+  std::map<unsigned long long,entry>::iterator it=textures.find(texture);
+  if(it==textures.end() || --it->second.references>0)
+    return;
+  unregister(it->second,texture_by_key);
+  texture_by_hash.erase(it->second.hash);
+  textures.erase(it);
+  glhelper::delete_texture(texture);
+}
+
+const gpu_mesh* asset_registry::insert_mesh(const std::string& key,unsigned long long hash,const std::shared_ptr<gpu_mesh>& m)
+{
+  std::map<unsigned long long,unsigned long long>::const_iterator it=mesh_by_hash.find(hash);
+  if(it!=mesh_by_hash.end())
+  {
+    entry& e=meshes[it->second];
+    e.references++;
+    e.keys.push_back(key);
+    mesh_by_key[key]=it->second;
+    return e.mesh.get();
+  }
+
+  upload(m.get());
+  load_count++;
+  const unsigned long long id=mesh_id(m.get());
+  entry& e=meshes[id];
+  e.references=1;
+  e.hash=hash;
+  e.keys.push_back(key);
+  e.mesh=m;
+  mesh_by_key[key]=id;
+  mesh_by_hash[hash]=id;
+  return m.get();
+}
+
+const gpu_mesh* asset_registry::acquire_mesh(const std::string& filename,const mesh_processing& processing)
+{
+  request_count++;
+  const std::string key=mesh_key(filename,processing);
+  std::map<std::string,unsigned long long>::const_iterator it=mesh_by_key.find(key);
+  if(it!=mesh_by_key.end())
+  {
+    entry& e=meshes[it->second];
+    e.references++;
+    return e.mesh.get();
+  }
+
+  //meme source et memes traitements: le maillage existant est partage
+  asset_bytes bytes;
+  if(!read_bytes(filename,&bytes))
+    throw std::string("Cannot open file "+filename);
+  const unsigned long long hash=hash_combine(hash_bytes(bytes.data,bytes.size),hash_processing(processing));
+  std::map<unsigned long long,unsigned long long>::const_iterator it_hash=mesh_by_hash.find(hash);
+  if(it_hash!=mesh_by_hash.end())
+    return insert_mesh(key,hash,meshes[it_hash->second].mesh);
+
+  std::shared_ptr<gpu_mesh> m(new gpu_mesh());
+  m->cpu=load_mesh_processed(filename,processing);
+  return insert_mesh(key,hash,m);
+}
+
+void asset_registry::acquire_mesh(async_loader& loader,const std::string& filename,const mesh_processing& processing,
+                                  const std::function<void(const gpu_mesh*)>& on_ready)
+{
+  request_count++;
+  const std::string key=mesh_key(filename,processing);
+  std::map<std::string,unsigned long long>::const_iterator it=mesh_by_key.find(key);
+  if(it!=mesh_by_key.end())
+  {
+    entry& e=meshes[it->second];
+    e.references++;
+    on_ready(e.mesh.get());
+    return;
+  }
+
+  std::vector<std::function<void(const gpu_mesh*)> >& waiting=mesh_waiting[key];
+  waiting.push_back(on_ready);
+  if(waiting.size()>1)
+    return;
+
+  loader.submit([this,filename,processing,key]() -> std::function<void()> {
+    std::shared_ptr<gpu_mesh> m;
+    unsigned long long hash=0;
+    std::string error;
+    try
+    {
+      asset_bytes bytes;
+      if(!read_bytes(filename,&bytes))
+        throw std::string("Cannot open file "+filename);
+      hash=hash_combine(hash_bytes(bytes.data,bytes.size),hash_processing(processing));
+      m.reset(new gpu_mesh());
+      m->cpu=load_mesh_processed(filename,processing);
+    }
+    catch(const std::string& e)
+    {
+      error=e;
+      m.reset();
+    }
+    catch(const std::exception& e)
+    {
+      error=e.what();
+      m.reset();
+    }
+
+    return [this,key,m,hash,error]() {
+      std::vector<std::function<void(const gpu_mesh*)> > callbacks;
+      callbacks.swap(mesh_waiting[key]);
+      mesh_waiting.erase(key);
+      if(!m)
+      {
+        std::cerr<<"Erreur de chargement: "<<error<<std::endl;
+        for(unsigned int k=0;k<callbacks.size();++k)
+          callbacks[k](nullptr);
+        return;
+      }
+      const gpu_mesh* result=insert_mesh(key,hash,m);
+      meshes[mesh_id(result)].references+=callbacks.size()-1;
+      for(unsigned int k=0;k<callbacks.size();++k)
+        callbacks[k](result);
+    };
+  });
+}
+
+void asset_registry::release_mesh(const gpu_mesh* m)
+{
+  std::map<unsigned long long,entry>::iterator it=meshes.find(mesh_id(m));
+  if(it==meshes.end() || --it->second.references>0)
+    return;
+  gpu_mesh& g=*it->second.mesh;
+  glDeleteVertexArrays(1,&g.vao);                                                      CHECK_GL_ERROR();
+  glDeleteBuffers(1,&g.vbo);                                                           CHECK_GL_ERROR();
+  glDeleteBuffers(1,&g.vboi);                                                          CHECK_GL_ERROR();
+  unregister(it->second,mesh_by_key);
+  mesh_by_hash.erase(it->second.hash);
+  meshes.erase(it);
+}
+
+GLuint asset_registry::acquire_program(const std::string& vertex_file,const std::string& fragment_file)
+{
+  request_count++;
+  const std::string key=vertex_file+"|"+fragment_file;
+  std::map<std::string,unsigned long long>::const_iterator it=program_by_key.find(key);
+  if(it!=program_by_key.end())
+  {
+    programs[it->second].references++;
+    return static_cast<GLuint>(it->second);
+  }
+
+  const GLuint id=glhelper::create_program_from_file(vertex_file,fragment_file);
+  load_count++;
+  entry& e=programs[id];
+  e.references=1;
+  e.hash=0;
+  e.keys.push_back(key);
+  program_by_key[key]=id;
+  return id;
+}
+
+void asset_registry::release_program(GLuint program)
+{
+  std::map<unsigned long long,entry>::iterator it=programs.find(program);
+  if(it==programs.end() || --it->second.references>0)
+    return;
+  unregister(it->second,program_by_key);
+  programs.erase(it);
+  glDeleteProgram(program);                                                            CHECK_GL_ERROR();
+}
+
+int asset_registry::texture_references(GLuint texture) const
+{
+  std::map<unsigned long long,entry>::const_iterator it=textures.find(texture);
+  return it!=textures.end() ? it->second.references : 0;
+}
+
+int asset_registry::program_references(GLuint program) const
+{
+  std::map<unsigned long long,entry>::const_iterator it=programs.find(program);
+  return it!=programs.end() ? it->second.references : 0;
+}
+
+int asset_registry::mesh_references(const gpu_mesh* m) const
+{
+  std::map<unsigned long long,entry>::const_iterator it=meshes.find(mesh_id(m));
+  return it!=meshes.end() ? it->second.references : 0;
+}
+
+int asset_registry::nb_request() const
+{
+  return request_count;
+}
+
+int asset_registry::nb_load() const
+{
+  return load_count;
+}
+
+asset_registry& assets()
+{
+  static asset_registry registry;
+  return registry;
+}
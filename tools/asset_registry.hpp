@@ -0,0 +1,114 @@
+#pragma once
+
+#ifndef ASSET_REGISTRY_HPP
+#define ASSET_REGISTRY_HPP
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#define GLEW_STATIC 1
+#include <GL/glew.h>
+
+#include "mesh.hpp"
+#include "mesh_cache.hpp"
+
+class async_loader;
+
+/** Maillage partage par le registre: donnees CPU (pour les BVH) et objets OpenGL */
+struct gpu_mesh
+{
+  mesh cpu;
+  GLuint vao;
+  GLuint vbo;
+  GLuint vboi;
+  GLuint nb_triangle;
+  /** type des indices de vboi: GL_UNSIGNED_SHORT si moins de 65536 sommets, GL_UNSIGNED_INT sinon */
+  GLenum index_type;
+};
+
+/** Registre des ressources partagees: textures, maillages et programmes.
+ *
+ *  Chaque ressource est decodee et envoyee sur le GPU une seule fois. Elle est
+ *  retrouvee par son chemin (et ses traitements pour un maillage), puis par le
+ *  hachage de son contenu: deux fichiers identiques donnent le meme objet OpenGL.
+ *  Chaque acquire_* ajoute une reference et chaque release_* en retire une; la
+ *  ressource est liberee a la derniere. Le registre s'utilise depuis le thread
+ *  OpenGL, les versions asynchrones deleguent la lecture a un async_loader.
+ */
+class asset_registry
+{
+public:
+  asset_registry();
+
+  /** Texture du fichier (0 si le fichier est illisible) */
+  GLuint acquire_texture(const std::string& filename);
+  /** Textures de plusieurs fichiers lus et decodes en parallele sur le pool, envoyees sur ce thread
+   *  dans l'ordre demande (0 pour un fichier illisible) */
+  std::vector<GLuint> acquire_textures(const std::vector<std::string>& filenames);
+  /** Idem en lisant et decodant sur le pool; on_ready est appele par loader.update(), avec 0
+   *  pour tous les demandeurs en attente si le fichier est illisible */
+  void acquire_texture(async_loader& loader,const std::string& filename,const std::function<void(GLuint)>& on_ready);
+  void release_texture(GLuint texture);
+
+  /** Maillage du fichier avec ses traitements (exception std::string si illisible) */
+  const gpu_mesh* acquire_mesh(const std::string& filename,const mesh_processing& processing);
+  /** Idem en lisant et traitant sur le pool; on_ready est appele par loader.update(), avec nullptr
+   *  pour tous les demandeurs en attente si le fichier est illisible */
+  void acquire_mesh(async_loader& loader,const std::string& filename,const mesh_processing& processing,
+                    const std::function<void(const gpu_mesh*)>& on_ready);
+  void release_mesh(const gpu_mesh* m);
+
+  /** Programme GPU des deux fichiers de shaders */
+  GLuint acquire_program(const std::string& vertex_file,const std::string& fragment_file);
+  void release_program(GLuint program);
+
+  /** Nombre de references d'une ressource (0 si elle n'est pas dans le registre) */
+  int texture_references(GLuint texture) const;
+  int program_references(GLuint program) const;
+  int mesh_references(const gpu_mesh* m) const;
+
+  /** Nombre de demandes et de chargements effectifs (decodage + envoi) depuis le debut */
+  int nb_request() const;
+  int nb_load() const;
+
+private:
+  asset_registry(const asset_registry&);
+  asset_registry& operator=(const asset_registry&);
+
+  struct entry
+  {
+    int references;
+    unsigned long long hash;
+    std::vector<std::string> keys;
+    std::shared_ptr<gpu_mesh> mesh;
+  };
+
+  GLuint insert_texture(const std::string& key,unsigned long long hash,const std::function<GLuint()>& create);
+  const gpu_mesh* insert_mesh(const std::string& key,unsigned long long hash,const std::shared_ptr<gpu_mesh>& m);
+  void unregister(entry& e,std::map<std::string,unsigned long long>& by_key);
+
+  //textures et programmes: identifiant OpenGL; maillages: adresse du gpu_mesh
+  std::map<unsigned long long,entry> textures;
+  std::map<std::string,unsigned long long> texture_by_key;
+  std::map<unsigned long long,unsigned long long> texture_by_hash;
+  std::map<std::string,std::vector<std::function<void(GLuint)> > > texture_waiting;
+
+  std::map<unsigned long long,entry> meshes;
+  std::map<std::string,unsigned long long> mesh_by_key;
+  std::map<unsigned long long,unsigned long long> mesh_by_hash;
+  std::map<std::string,std::vector<std::function<void(const gpu_mesh*)> > > mesh_waiting;
+
+  std::map<unsigned long long,entry> programs;
+  std::map<std::string,unsigned long long> program_by_key;
+
+  int request_count;
+  int load_count;
+};
+
+/** Registre partage par le programme */
+asset_registry& assets();
+
+#endif
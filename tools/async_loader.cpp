@@ -0,0 +1,112 @@
+
+#include "async_loader.hpp"
+
+#include "glhelper.hpp"
+#include "mesh.hpp"
+#include "texture_cache.hpp"
+#include "texture_stream.hpp"
+
+#include <chrono>
+#include <exception>
+#include <iostream>
+#include <memory>
+#include <thread>
+
+
+async_loader::async_loader(thread_pool& pool_param)
+  :pool(pool_param),textures(nullptr),nb_pending(0),nb_running(0)
+{}
+
+async_loader::~async_loader()
+{
+  //les taches en cours ecrivent dans la file: on les laisse finir
+  while(nb_running.load()>0)
+  {
+    if(!pool.run_pending_task())
+      std::this_thread::yield();
+  }
+}
+
+void async_loader::submit(const job& work)
+{
+  nb_pending++;
+  nb_running++;
+  pool.push([this,work]() {
+    std::function<void()> upload;
+    try
+    {
+      upload=work();
+    }
+    catch(const std::string& error)
+    {
+      upload=[error]() { std::cerr<<"Erreur de chargement: "<<error<<std::endl; };
+    }
+    catch(const std::exception& error)
+    {
+      const std::string message=error.what();
+      upload=[message]() { std::cerr<<"Erreur de chargement: "<<message<<std::endl; };
+    }
+    catch(...)
+    {
+      upload=[]() { std::cerr<<"Erreur de chargement inconnue"<<std::endl; };
+    }
+    ready.push(upload);
+    nb_running--;
+  });
+}
+
+void async_loader::load_mesh(const std::string& filename,const mesh_processing& processing,const std::function<void(const mesh&)>& on_ready)
+{
+  submit([filename,processing,on_ready]() -> std::function<void()> {
+    std::shared_ptr<mesh> m(new mesh(load_mesh_processed(filename,processing)));
+    return [m,on_ready]() { on_ready(*m); };
+  });
+}
+
+void async_loader::load_texture(const std::string& filename,const std::function<void(GLuint)>& on_ready)
+{
+  texture_stream* stream=textures.load();
+  submit([filename,on_ready,stream]() -> std::function<void()> {
+    //decodage, mipmaps et compression (ou lecture sur place du conteneur / cache) ici,
+    //le thread OpenGL n'a plus qu'a envoyer les niveaux
+    std::shared_ptr<texture_source> source=open_texture_file(filename);
+
+    //niveaux copies ici dans l'anneau: l'envoi part du buffer et la source est deja liberee
+    texture_stream_block block;
+    if(stream!=nullptr && stream->write(source->view,&block))
+      return [stream,block,filename,on_ready]() { on_ready(stream->upload(block,filename)); };
+    return [source,on_ready]() { on_ready(glhelper::create_texture(source->view,source->filename)); };
+  });
+}
+
+void async_loader::set_texture_stream(texture_stream* stream)
+{
+  textures=stream;
+}
+
+texture_stream* async_loader::stream() const
+{
+  return textures.load();
+}
+
+int async_loader::update(double budget_ms)
+{
+  const std::chrono::high_resolution_clock::time_point start=std::chrono::high_resolution_clock::now();
+  int nb_upload=0;
+  std::function<void()> upload;
+  while(ready.pop(&upload))
+  {
+    upload();
+    nb_pending--;
+    ++nb_upload;
+    const double elapsed=std::chrono::duration<double,std::milli>(std::chrono::high_resolution_clock::now()-start).count();
+    if(elapsed>=budget_ms)
+      break;
+  }
+  return nb_upload;
+}
+
+int async_loader::pending() const
+{
+  return nb_pending.load();
+}
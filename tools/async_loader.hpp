@@ -0,0 +1,67 @@
+#pragma once
+
+#ifndef ASYNC_LOADER_HPP
+#define ASYNC_LOADER_HPP
+
+#include <atomic>
+#include <functional>
+#include <string>
+
+#define GLEW_STATIC 1
+#include <GL/glew.h>
+
+#include "mesh_cache.hpp"
+#include "mpsc_queue.hpp"
+#include "thread_pool.hpp"
+
+class mesh;
+class texture_stream;
+
+/** Chargement asynchrone des ressources.
+ *
+ *  La lecture disque, l'analyse des maillages et le decodage des images sont faits
+ *  sur un pool de threads. Le resultat est transmis au thread OpenGL par une file sans
+ *  verrou, sous la forme d'une fonction d'envoi executee par update() a chaque image
+ *  tant que le budget de temps n'est pas depasse. Les objets apparaissent donc au fur
+ *  et a mesure de l'arrivee de leurs ressources, sans figer la fenetre.
+ */
+class async_loader
+{
+public:
+  /** Travail execute sur le pool, qui renvoie l'envoi a faire sur le thread OpenGL */
+  typedef std::function<std::function<void()>()> job;
+
+  explicit async_loader(thread_pool& pool=default_thread_pool());
+  /** Attend la fin des lectures en cours, les envois non faits sont abandonnes */
+  ~async_loader();
+
+  /** Soumet un travail quelconque: work() sur le pool, puis la fonction renvoyee dans update() */
+  void submit(const job& work);
+
+  /** Lit et traite un maillage sur le pool, on_ready(m) est appele par update() sur le thread OpenGL */
+  void load_mesh(const std::string& filename,const mesh_processing& processing,const std::function<void(const mesh&)>& on_ready);
+  /** Lit et decode une image sur le pool, update() cree la texture puis appelle on_ready(identifiant) */
+  void load_texture(const std::string& filename,const std::function<void(GLuint)>& on_ready);
+
+  /** Anneau de transfert ou les taches ecrivent les niveaux des textures (nullptr: envoi direct) */
+  void set_texture_stream(texture_stream* stream);
+  texture_stream* stream() const;
+
+  /** A appeler a chaque image sur le thread OpenGL: fait les envois prets tant que budget_ms
+   *  n'est pas depasse (au moins un par appel), renvoie le nombre d'envois faits */
+  int update(double budget_ms);
+  /** Nombre de ressources soumises dont l'envoi n'est pas encore fait */
+  int pending() const;
+
+private:
+  async_loader(const async_loader&);
+  async_loader& operator=(const async_loader&);
+
+  thread_pool& pool;
+  std::atomic<texture_stream*> textures;
+  mpsc_queue<std::function<void()> > ready;
+  std::atomic<int> nb_pending;
+  std::atomic<int> nb_running;
+};
+
+#endif
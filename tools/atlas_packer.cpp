@@ -0,0 +1,149 @@
+
+#include "atlas_packer.hpp"
+
+#include <algorithm>
+#include <string>
+
+skyline_packer::skyline_packer(int width,int height)
+  :skyline(),page_width(width),page_height(height),used_area(0)
+{
+  segment s;
+  s.x=0;
+  s.y=0;
+  s.width=width;
+  skyline.push_back(s);
+}
+
+int skyline_packer::fit(unsigned int index,int w,int h) const
+{
+  const int x=skyline[index].x;
+  if(x+w>page_width)
+    return -1;
+  int y=0;
+  int remaining=w;
+  for(unsigned int k=index;remaining>0;++k)
+  {
+    y=std::max(y,skyline[k].y);
+    if(y+h>page_height)
+      return -1;
+    remaining-=skyline[k].width;
+  }
+  return y;
+}
+
+bool skyline_packer::insert(int w,int h,int* x,int* y)
+{
+  if(w<=0 || h<=0)
+    return false;
+
+  //position la plus basse (haut du rectangle), puis segment le plus etroit pour limiter les trous
+  int best=-1,best_top=0,best_y=0,best_width=0;
+  for(unsigned int k=0;k<skyline.size();++k)
+  {
+    const int yk=fit(k,w,h);
+    if(yk<0)
+      continue;
+    if(best<0 || yk+h<best_top || (yk+h==best_top && skyline[k].width<best_width))
+    {
+      best=k;
+      best_top=yk+h;
+      best_y=yk;
+      best_width=skyline[k].width;
+    }
+  }
+  if(best<0)
+    return false;
+
+  segment s;
+  s.x=skyline[best].x;
+  s.y=best_top;
+  s.width=w;
+  skyline.insert(skyline.begin()+best,s);
+
+  //les segments recouverts par le nouveau sont raccourcis ou retires
+  const int right=s.x+w;
+  for(unsigned int k=best+1;k<skyline.size();)
+  {
+    segment& t=skyline[k];
+    if(t.x>=right)
+      break;
+    const int shrink=right-t.x;
+    if(shrink>=t.width)
+    {
+      skyline.erase(skyline.begin()+k);
+      continue;
+    }
+    t.x+=shrink;
+    t.width-=shrink;
+    break;
+  }
+  //fusion des segments voisins de meme hauteur
+  for(unsigned int k=0;k+1<skyline.size();)
+  {
+    if(skyline[k].y==skyline[k+1].y)
+    {
+      skyline[k].width+=skyline[k+1].width;
+      skyline.erase(skyline.begin()+k+1);
+    }
+    else
+      ++k;
+  }
+
+  *x=s.x;
+  *y=best_y;
+  used_area+=static_cast<long long>(w)*h;
+  return true;
+}
+
+int skyline_packer::width() const
+{
+  return page_width;
+}
+
+int skyline_packer::height() const
+{
+  return page_height;
+}
+
+double skyline_packer::occupancy() const
+{
+  return static_cast<double>(used_area)/(static_cast<double>(page_width)*page_height);
+}
+
+std::vector<atlas_placement> pack_rectangles(const std::vector<std::pair<int,int> >& sizes,int page_width,int page_height,int* nb_page)
+{
+  std::vector<unsigned int> order(sizes.size());
+  for(unsigned int k=0;k<order.size();++k)
+  {
+    if(sizes[k].first>page_width || sizes[k].second>page_height)
+      throw std::string("Rectangle plus grand que la page de l'atlas");
+    order[k]=k;
+  }
+  std::stable_sort(order.begin(),order.end(),[&sizes](unsigned int a,unsigned int b) {
+    return sizes[a].second>sizes[b].second || (sizes[a].second==sizes[b].second && sizes[a].first>sizes[b].first);
+  });
+
+  //chaque rectangle va dans la premiere page ou il tient, une nouvelle page sinon
+  std::vector<skyline_packer> pages;
+  std::vector<atlas_placement> placements(sizes.size());
+  for(unsigned int i=0;i<order.size();++i)
+  {
+    const unsigned int k=order[i];
+    atlas_placement& p=placements[k];
+    bool placed=false;
+    for(unsigned int page=0;page<pages.size() && !placed;++page)
+      if(pages[page].insert(sizes[k].first,sizes[k].second,&p.x,&p.y))
+      {
+        p.page=page;
+        placed=true;
+      }
+    if(!placed)
+    {
+      pages.push_back(skyline_packer(page_width,page_height));
+      pages.back().insert(sizes[k].first,sizes[k].second,&p.x,&p.y);
+      p.page=pages.size()-1;
+    }
+  }
+  *nb_page=pages.size();
+  return placements;
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#ifndef ATLAS_PACKER_HPP
+#define ATLAS_PACKER_HPP
+
+#include <utility>
+#include <vector>
+
+/** Placement de rectangles dans une page de taille fixe par la methode skyline.
+ *
+ *  Le haut des rectangles deja places forme une ligne brisee (segments horizontaux);
+ *  chaque rectangle est pose sur la position qui garde cette ligne la plus basse,
+ *  a egalite la plus a gauche. Rapide et efficace pour des rectangles tries par
+ *  hauteur decroissante, comme des textures.
+ */
+class skyline_packer
+{
+public:
+  skyline_packer(int width,int height);
+
+  /** Place un rectangle w x h, renvoie false s'il ne tient plus dans la page */
+  bool insert(int w,int h,int* x,int* y);
+
+  int width() const;
+  int height() const;
+  /** Fraction de la page couverte par les rectangles places */
+  double occupancy() const;
+
+private:
+  struct segment
+  {
+    int x;
+    int y;
+    int width;
+  };
+
+  /** Hauteur a laquelle un rectangle de largeur w pose au segment index repose, -1 s'il deborde */
+  int fit(unsigned int index,int w,int h) const;
+
+  std::vector<segment> skyline;
+  int page_width;
+  int page_height;
+  long long used_area;
+};
+
+/** Position d'un rectangle dans un ensemble de pages */
+struct atlas_placement
+{
+  int page;
+  int x;
+  int y;
+};
+
+/** Place les rectangles (largeur, hauteur) dans autant de pages que necessaire, les plus hauts d'abord.
+ *  Renvoie une position par rectangle, dans l'ordre donne, et le nombre de pages dans nb_page.
+ *  Exception std::string si un rectangle est plus grand qu'une page. */
+std::vector<atlas_placement> pack_rectangles(const std::vector<std::pair<int,int> >& sizes,int page_width,int page_height,int* nb_page);
+
+#endif
@@ -0,0 +1,335 @@
+
+#include "broadphase.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
+
+namespace
+{
+  const int cell_bias=1<<20;
+
+  unsigned long long cell_key(int x,int y,int z)
+  {
+    const unsigned long long mask=(1ull<<21)-1;
+    return ((static_cast<unsigned long long>(x+cell_bias)&mask)<<42) |
+        ((static_cast<unsigned long long>(y+cell_bias)&mask)<<21) |
+        (static_cast<unsigned long long>(z+cell_bias)&mask);
+  }
+
+  int cell_coord(float v,float cell_size)
+  {
+    return static_cast<int>(std::floor(v/cell_size));
+  }
+
+  /** cellules couvertes par la boite, range[0..2]=min et range[3..5]=max (min>max si boite vide) */
+  void compute_cell_range(const aabb& b,float cell_size,int range[6])
+  {
+    if(is_empty(b))
+    {
+      range[0]=range[1]=range[2]=1;
+      range[3]=range[4]=range[5]=0;
+      return;
+    }
+    range[0]=cell_coord(b.p_min.x,cell_size); range[3]=cell_coord(b.p_max.x,cell_size);
+    range[1]=cell_coord(b.p_min.y,cell_size); range[4]=cell_coord(b.p_max.y,cell_size);
+    range[2]=cell_coord(b.p_min.z,cell_size); range[5]=cell_coord(b.p_max.z,cell_size);
+  }
+
+  void insert_object(spatial_hash* h,int id,const int range[6])
+  {
+    for(int x=range[0];x<=range[3];++x)
+      for(int y=range[1];y<=range[4];++y)
+        for(int z=range[2];z<=range[5];++z)
+          h->cells[cell_key(x,y,z)].push_back(id);
+  }
+
+  void remove_object(spatial_hash* h,int id,const int range[6])
+  {
+    for(int x=range[0];x<=range[3];++x)
+      for(int y=range[1];y<=range[4];++y)
+        for(int z=range[2];z<=range[5];++z)
+        {
+          std::unordered_map<unsigned long long,std::vector<int> >::iterator it=h->cells.find(cell_key(x,y,z));
+          if(it==h->cells.end())
+            continue;
+          std::vector<int>& c=it->second;
+          std::vector<int>::iterator it_id=std::find(c.begin(),c.end(),id);
+          if(it_id!=c.end())
+          {
+            *it_id=c.back();
+            c.pop_back();
+          }
+          if(c.empty())
+            h->cells.erase(it);
+        }
+  }
+
+  float axis_value(const vec3& v,int axis)
+  {
+    return axis==0 ? v.x : (axis==1 ? v.y : v.z);
+  }
+
+  bool endpoint_less(const sap_endpoint& e0,const sap_endpoint& e1)
+  {
+    //a valeur egale, le min passe avant le max pour compter les boites qui se touchent
+    return e0.value<e1.value || (e0.value==e1.value && (e0.id&1)<(e1.id&1));
+  }
+
+  /** Axe de balayage le moins cher pour boxes, previous: boites de la mise a jour precedente (meme
+   *  nombre d'objets) ou nullptr, current: axe courant a garder sauf gain net (-1 si aucun) */
+  int choose_sap_axis(const std::vector<aabb>& boxes,const std::vector<aabb>* previous,int current)
+  {
+    double sum[3]={0.0,0.0,0.0},sum2[3]={0.0,0.0,0.0},extent[3]={0.0,0.0,0.0},motion[3]={0.0,0.0,0.0};
+    int n=0;
+    for(unsigned int k=0;k<boxes.size();++k)
+    {
+      const aabb& b=boxes[k];
+      if(is_empty(b))
+        continue;
+      const bool moved=previous!=nullptr && !is_empty((*previous)[k]);
+      for(int a=0;a<3;++a)
+      {
+        const double c=0.5*(axis_value(b.p_min,a)+axis_value(b.p_max,a));
+        sum[a]+=c;
+        sum2[a]+=c*c;
+        extent[a]+=axis_value(b.p_max,a)-axis_value(b.p_min,a);
+        if(moved)
+          motion[a]+=std::fabs(c-0.5*(axis_value((*previous)[k].p_min,a)+axis_value((*previous)[k].p_max,a)));
+      }
+      ++n;
+    }
+    if(n<2)
+      return current>=0 ? current : 0;
+
+    double cost[3];
+    int best=0;
+    for(int a=0;a<3;++a)
+    {
+      const double mean=sum[a]/n;
+      const double variance=std::max(sum2[a]/n-mean*mean,0.0);
+      cost[a]=variance>0.0 ? (extent[a]+motion[a])/n/std::sqrt(variance) : std::numeric_limits<double>::max();
+      if(cost[a]<cost[best])
+        best=a;
+    }
+    return current>=0 && cost[current]<=1.25*cost[best] ? current : best;
+  }
+
+  double elapsed_ms(const std::chrono::high_resolution_clock::time_point& start)
+  {
+    return std::chrono::duration<double,std::milli>(std::chrono::high_resolution_clock::now()-start).count();
+  }
+}
+
+
+broadphase_stats::broadphase_stats()
+  :nb_object(0),nb_pair(0),update_ms(0.0)
+{}
+
+spatial_hash::spatial_hash(float cell_size_param)
+  :cell_size(cell_size_param)
+{}
+
+void spatial_hash_rebuild(spatial_hash* h,const std::vector<aabb>& boxes)
+{
+  const std::chrono::high_resolution_clock::time_point start=std::chrono::high_resolution_clock::now();
+
+  h->cells.clear();
+  h->boxes=boxes;
+  const int N=boxes.size();
+  h->cell_range.resize(6*N);
+  for(int k=0;k<N;++k)
+  {
+    compute_cell_range(boxes[k],h->cell_size,&h->cell_range[6*k]);
+    insert_object(h,k,&h->cell_range[6*k]);
+  }
+
+  h->stats.nb_object=N;
+  h->stats.update_ms=elapsed_ms(start);
+}
+
+void spatial_hash_update(spatial_hash* h,const std::vector<aabb>& boxes)
+{
+  const std::chrono::high_resolution_clock::time_point start=std::chrono::high_resolution_clock::now();
+
+  const int N_old=h->boxes.size();
+  const int N=boxes.size();
+
+  //les objets supprimes quittent la grille
+  for(int k=N;k<N_old;++k)
+    remove_object(h,k,&h->cell_range[6*k]);
+
+  h->cell_range.resize(6*N);
+  for(int k=0;k<N;++k)
+  {
+    int range[6];
+    compute_cell_range(boxes[k],h->cell_size,range);
+    int* old_range=&h->cell_range[6*k];
+    if(k<N_old && std::equal(range,range+6,old_range))
+      continue;
+
+    if(k<N_old)
+      remove_object(h,k,old_range);
+    insert_object(h,k,range);
+    std::copy(range,range+6,old_range);
+  }
+  h->boxes=boxes;
+
+  h->stats.nb_object=N;
+  h->stats.update_ms=elapsed_ms(start);
+}
+
+void spatial_hash_pairs(spatial_hash* h,std::vector<broadphase_pair>* pairs)
+{
+  const std::chrono::high_resolution_clock::time_point start=std::chrono::high_resolution_clock::now();
+
+  pairs->clear();
+  const float s=h->cell_size;
+  for(std::unordered_map<unsigned long long,std::vector<int> >::const_iterator it=h->cells.begin();it!=h->cells.end();++it)
+  {
+    const std::vector<int>& c=it->second;
+    for(unsigned int i=0;i<c.size();++i)
+    {
+      const aabb& b0=h->boxes[c[i]];
+      for(unsigned int j=i+1;j<c.size();++j)
+      {
+        const aabb& b1=h->boxes[c[j]];
+        if(!overlap(b0,b1))
+          continue;
+
+        //la paire n'est rapportee que par la cellule contenant le coin min de l'intersection
+        const unsigned long long owner=cell_key(cell_coord(std::max(b0.p_min.x,b1.p_min.x),s),
+            cell_coord(std::max(b0.p_min.y,b1.p_min.y),s),
+            cell_coord(std::max(b0.p_min.z,b1.p_min.z),s));
+        if(owner!=it->first)
+          continue;
+        pairs->push_back(std::make_pair(std::min(c[i],c[j]),std::max(c[i],c[j])));
+      }
+    }
+  }
+
+  h->stats.nb_pair=pairs->size();
+  h->stats.update_ms+=elapsed_ms(start);
+}
+
+void spatial_hash_query(const spatial_hash& h,const aabb& b,std::vector<int>* result)
+{
+  result->clear();
+  int range[6];
+  compute_cell_range(b,h.cell_size,range);
+  for(int x=range[0];x<=range[3];++x)
+    for(int y=range[1];y<=range[4];++y)
+      for(int z=range[2];z<=range[5];++z)
+      {
+        std::unordered_map<unsigned long long,std::vector<int> >::const_iterator it=h.cells.find(cell_key(x,y,z));
+        if(it==h.cells.end())
+          continue;
+        for(unsigned int k=0;k<it->second.size();++k)
+          if(overlap(b,h.boxes[it->second[k]]))
+            result->push_back(it->second[k]);
+      }
+
+  std::sort(result->begin(),result->end());
+  result->erase(std::unique(result->begin(),result->end()),result->end());
+}
+
+sweep_and_prune::sweep_and_prune(int axis_param)
+  :axis(axis_param<0 ? 0 : axis_param),automatic_axis(axis_param<0),nb_swap(0)
+{}
+
+void sweep_and_prune_update(sweep_and_prune* sap,const std::vector<aabb>& boxes)
+{
+  const std::chrono::high_resolution_clock::time_point start=std::chrono::high_resolution_clock::now();
+
+  const int N=boxes.size();
+  const bool same_objects=N==static_cast<int>(sap->boxes.size());
+  bool sorted=same_objects;
+  if(sap->automatic_axis)
+  {
+    const int axis=choose_sap_axis(boxes,same_objects ? &sap->boxes : nullptr,same_objects ? sap->axis : -1);
+    sorted=sorted && axis==sap->axis;
+    sap->axis=axis;
+  }
+  sap->boxes=boxes;
+  sap->nb_swap=0;
+
+  if(!same_objects)
+  {
+    sap->endpoints.resize(2*N);
+    for(int k=0;k<2*N;++k)
+      sap->endpoints[k].id=k;
+  }
+
+  //rafraichit les valeurs, les objets vides sont repousses en fin de liste
+  std::vector<sap_endpoint>& e=sap->endpoints;
+  for(int k=0,N_end=e.size();k<N_end;++k)
+  {
+    const aabb& b=boxes[e[k].id>>1];
+    if(is_empty(b))
+      e[k].value=std::numeric_limits<float>::max();
+    else
+      e[k].value=axis_value((e[k].id&1) ? b.p_max : b.p_min,sap->axis);
+  }
+
+  if(!sorted)
+    std::sort(e.begin(),e.end(),endpoint_less);
+  else
+  {
+    //tri par insertion: quasi lineaire quand l'ordre change peu
+    for(int i=1,N_end=e.size();i<N_end;++i)
+    {
+      const sap_endpoint current=e[i];
+      int j=i-1;
+      while(j>=0 && endpoint_less(current,e[j]))
+      {
+        e[j+1]=e[j];
+        --j;
+        sap->nb_swap++;
+      }
+      e[j+1]=current;
+    }
+  }
+
+  sap->stats.nb_object=N;
+  sap->stats.update_ms=elapsed_ms(start);
+}
+
+void sweep_and_prune_pairs(sweep_and_prune* sap,std::vector<broadphase_pair>* pairs)
+{
+  const std::chrono::high_resolution_clock::time_point start=std::chrono::high_resolution_clock::now();
+
+  pairs->clear();
+  std::vector<int> active;
+  //place de chaque objet actif dans active, pour le retirer sans le chercher
+  std::vector<int> slot(sap->boxes.size());
+  const std::vector<sap_endpoint>& e=sap->endpoints;
+  for(unsigned int k=0;k<e.size();++k)
+  {
+    const int id=e[k].id>>1;
+    const aabb& b=sap->boxes[id];
+    if(is_empty(b))
+      break;
+
+    if(e[k].id&1)
+    {
+      //fin d'intervalle: l'objet quitte la liste active
+      const int last=active.back();
+      active[slot[id]]=last;
+      slot[last]=slot[id];
+      active.pop_back();
+    }
+    else
+    {
+      //debut d'intervalle: intersection sur l'axe avec tous les actifs, on teste les autres axes
+      for(unsigned int i=0;i<active.size();++i)
+        if(overlap(b,sap->boxes[active[i]]))
+          pairs->push_back(std::make_pair(std::min(id,active[i]),std::max(id,active[i])));
+      slot[id]=active.size();
+      active.push_back(id);
+    }
+  }
+
+  sap->stats.nb_pair=pairs->size();
+  sap->stats.update_ms+=elapsed_ms(start);
+}
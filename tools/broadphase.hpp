@@ -0,0 +1,95 @@
+#pragma once
+
+#ifndef BROADPHASE_HPP
+#define BROADPHASE_HPP
+
+#include "aabb.hpp"
+
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/** Statistiques de la derniere mise a jour d'une broadphase */
+struct broadphase_stats
+{
+  /** nombre d'objets suivis */
+  unsigned int nb_object;
+  /** nombre de paires candidates */
+  unsigned int nb_pair;
+  /** duree de la mise a jour et de la recherche des paires (ms) */
+  double update_ms;
+
+  broadphase_stats();
+};
+
+/** Une paire d'objets dont les boites s'intersectent (first<second) */
+typedef std::pair<int,int> broadphase_pair;
+
+/** Une grille uniforme dont les cellules occupees sont stockees dans une table de hachage */
+struct spatial_hash
+{
+  /** taille d'une cellule */
+  float cell_size;
+  /** boites des objets lors de la derniere mise a jour (boite vide: objet ignore) */
+  std::vector<aabb> boxes;
+  /** cellules [min,max] couvertes par chaque objet */
+  std::vector<int> cell_range;
+  /** objets presents dans chaque cellule occupee */
+  std::unordered_map<unsigned long long,std::vector<int> > cells;
+  /** statistiques de la derniere mise a jour */
+  broadphase_stats stats;
+
+  /** Constructeur avec la taille de cellule (de l'ordre de la taille des objets) */
+  explicit spatial_hash(float cell_size_param=1.0f);
+};
+
+/** Une extremite d'intervalle sur l'axe de balayage */
+struct sap_endpoint
+{
+  /** coordonnee sur l'axe */
+  float value;
+  /** indice de l'objet, multiplie par 2, +1 pour l'extremite max */
+  int id;
+};
+
+/** Un balayage trie sur un axe (sweep and prune).
+ *  Les extremites restent triees d'une mise a jour a l'autre: quand les objets
+ *  bougent peu, le tri par insertion ne fait que quelques echanges. */
+struct sweep_and_prune
+{
+  /** axe de balayage (0:x, 1:y, 2:z) */
+  int axis;
+  /** axe reevalue a chaque mise a jour d'apres les boites (voir sweep_and_prune_update) */
+  bool automatic_axis;
+  /** boites des objets lors de la derniere mise a jour (boite vide: objet ignore) */
+  std::vector<aabb> boxes;
+  /** extremites triees selon l'axe */
+  std::vector<sap_endpoint> endpoints;
+  /** nombre d'echanges du dernier tri par insertion */
+  unsigned int nb_swap;
+  /** statistiques de la derniere mise a jour */
+  broadphase_stats stats;
+
+  /** Constructeur avec l'axe de balayage, -1 pour le choisir automatiquement */
+  explicit sweep_and_prune(int axis_param=-1);
+};
+
+/** Vide la grille et y insere toutes les boites */
+void spatial_hash_rebuild(spatial_hash* h,const std::vector<aabb>& boxes);
+/** Met a jour la grille en ne deplacant que les objets qui ont change de cellules */
+void spatial_hash_update(spatial_hash* h,const std::vector<aabb>& boxes);
+/** Renvoie les paires d'objets dont les boites s'intersectent (chaque paire une seule fois) */
+void spatial_hash_pairs(spatial_hash* h,std::vector<broadphase_pair>* pairs);
+/** Renvoie les objets dont la boite intersecte b */
+void spatial_hash_query(const spatial_hash& h,const aabb& b,std::vector<int>* result);
+
+/** Met a jour les extremites et les retrie par insertion (tri complet si le nombre d'objets ou l'axe change).
+ *  En mode automatique, l'axe retenu minimise (largeur moyenne des boites + deplacement moyen depuis la
+ *  mise a jour precedente) / ecart type des centres: une extremite croise les autres sur la largeur de
+ *  sa boite (liste active) et sur son deplacement (echanges du tri), en proportion de leur densite.
+ *  Il ne change que si le nouvel axe est nettement moins cher, pour ne pas retrier a chaque pas. */
+void sweep_and_prune_update(sweep_and_prune* sap,const std::vector<aabb>& boxes);
+/** Renvoie les paires d'objets dont les boites s'intersectent (chaque paire une seule fois) */
+void sweep_and_prune_pairs(sweep_and_prune* sap,std::vector<broadphase_pair>* pairs);
+
+#endif
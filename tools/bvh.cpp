@@ -0,0 +1,750 @@
+
+#include "bvh.hpp"
+#include "ccd.hpp"
+#include "mapped_file.hpp"
+#include "mesh.hpp"
+#include "mat4.hpp"
+#include "thread_pool.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <limits>
+
+namespace
+{
+  const int nb_bin=12;
+  const int leaf_size_max=8;
+  const int parallel_threshold=4096;
+  const int stack_size=64;
+  const int depth_max=stack_size-4;
+
+  struct build_context
+  {
+    std::vector<aabb> bounds;
+    std::vector<vec3> centroid;
+    std::vector<unsigned int> order;
+  };
+
+  float axis(const vec3& v,int k)
+  {
+    return k==0 ? v.x : (k==1 ? v.y : v.z);
+  }
+
+  bvh_node make_node(const aabb& b,int offset,int count)
+  {
+    bvh_node n;
+    n.p_min=b.p_min; n.p_max=b.p_max;
+    n.offset=offset; n.count=count;
+    return n;
+  }
+
+  aabb node_bounds(const bvh_node& n)
+  {
+    return aabb(n.p_min,n.p_max);
+  }
+
+  /** construit le sous-arbre [first,first+count[ dans out, les indices internes sont relatifs a out */
+  void build_recursive(build_context* ctx,int first,int count,int depth,std::vector<bvh_node>* out)
+  {
+    aabb b,b_centroid;
+    for(int k=first;k<first+count;++k)
+    {
+      extend(&b,ctx->bounds[ctx->order[k]]);
+      extend(&b_centroid,ctx->centroid[ctx->order[k]]);
+    }
+
+    const int index=out->size();
+    out->push_back(make_node(b,first,count));
+    //la profondeur est bornee par la taille des piles de parcours
+    if(count<=2 || depth>=depth_max)
+      return;
+
+    //meilleure coupe SAH par casiers sur les trois axes
+    float best_cost=std::numeric_limits<float>::max();
+    int best_axis=-1,best_bin=-1;
+    for(int a=0;a<3;++a)
+    {
+      const float c_min=axis(b_centroid.p_min,a);
+      const float extent=axis(b_centroid.p_max,a)-c_min;
+      if(extent<=1e-12f)
+        continue;
+
+      aabb bin_bounds[nb_bin];
+      int bin_count[nb_bin]={0};
+      const float scale=nb_bin/extent;
+      for(int k=first;k<first+count;++k)
+      {
+        const unsigned int t=ctx->order[k];
+        const int i=std::min(nb_bin-1,static_cast<int>((axis(ctx->centroid[t],a)-c_min)*scale));
+        bin_count[i]++;
+        extend(&bin_bounds[i],ctx->bounds[t]);
+      }
+
+      float area_right[nb_bin];
+      int count_right[nb_bin];
+      aabb acc;
+      int n_acc=0;
+      for(int i=nb_bin-1;i>0;--i)
+      {
+        extend(&acc,bin_bounds[i]);
+        n_acc+=bin_count[i];
+        area_right[i]=surface_area(acc);
+        count_right[i]=n_acc;
+      }
+      acc=aabb();
+      n_acc=0;
+      for(int i=0;i<nb_bin-1;++i)
+      {
+        extend(&acc,bin_bounds[i]);
+        n_acc+=bin_count[i];
+        const float cost=surface_area(acc)*n_acc+area_right[i+1]*count_right[i+1];
+        if(n_acc>0 && count_right[i+1]>0 && cost<best_cost)
+        {
+          best_cost=cost;
+          best_axis=a;
+          best_bin=i;
+        }
+      }
+    }
+
+    int mid=-1;
+    if(best_axis!=-1)
+    {
+      const float leaf_cost=static_cast<float>(count);
+      const float split_cost=1.0f+best_cost/surface_area(b);
+      if(split_cost>=leaf_cost && count<=leaf_size_max)
+        return;
+
+      const float c_min=axis(b_centroid.p_min,best_axis);
+      const float scale=nb_bin/(axis(b_centroid.p_max,best_axis)-c_min);
+      const std::vector<vec3>& centroid=ctx->centroid;
+      const int a=best_axis,split=best_bin;
+      unsigned int* it=std::partition(&ctx->order[first],&ctx->order[first]+count,
+          [&centroid,a,c_min,scale,split](unsigned int t) {
+            return std::min(nb_bin-1,static_cast<int>((axis(centroid[t],a)-c_min)*scale))<=split; });
+      mid=it-&ctx->order[0];
+    }
+    else
+    {
+      //centroides confondus: coupe au milieu si la feuille est trop grande
+      if(count<=leaf_size_max)
+        return;
+      mid=first+count/2;
+    }
+
+    const int count_left=mid-first;
+    const int count_right=count-count_left;
+    (*out)[index].count=0;
+
+    if(count>parallel_threshold)
+    {
+      //les deux sous-arbres travaillent sur des intervalles disjoints de order
+      std::vector<bvh_node> left,right;
+      task_group group(default_thread_pool());
+      group.run([ctx,mid,count_right,depth,&right]() { build_recursive(ctx,mid,count_right,depth+1,&right); });
+      build_recursive(ctx,first,count_left,depth+1,&left);
+      group.wait();
+
+      const int base_left=index+1;
+      const int base_right=base_left+left.size();
+      for(unsigned int k=0;k<left.size();++k)
+      {
+        if(left[k].count==0) left[k].offset+=base_left;
+        out->push_back(left[k]);
+      }
+      for(unsigned int k=0;k<right.size();++k)
+      {
+        if(right[k].count==0) right[k].offset+=base_right;
+        out->push_back(right[k]);
+      }
+      (*out)[index].offset=base_right;
+    }
+    else
+    {
+      build_recursive(ctx,first,count_left,depth+1,out);
+      (*out)[index].offset=out->size();
+      build_recursive(ctx,mid,count_right,depth+1,out);
+    }
+  }
+
+  bool ray_box(const aabb& b,const vec3& o,const vec3& inv_d,float t_max,float* t_enter)
+  {
+    float t0=0.0f,t1=t_max;
+    const float o_k[3]={o.x,o.y,o.z};
+    const float inv_k[3]={inv_d.x,inv_d.y,inv_d.z};
+    const float b_min[3]={b.p_min.x,b.p_min.y,b.p_min.z};
+    const float b_max[3]={b.p_max.x,b.p_max.y,b.p_max.z};
+    for(int k=0;k<3;++k)
+    {
+      float ta=(b_min[k]-o_k[k])*inv_k[k];
+      float tb=(b_max[k]-o_k[k])*inv_k[k];
+      if(ta>tb) std::swap(ta,tb);
+      t0=ta>t0 ? ta : t0;
+      t1=tb<t1 ? tb : t1;
+      if(t0>t1)
+        return false;
+    }
+    *t_enter=t0;
+    return true;
+  }
+
+  /** intersection rayon/triangle de Moller-Trumbore */
+  bool ray_triangle(const bvh_triangle& tri,const vec3& o,const vec3& d,float* t,float* u,float* v)
+  {
+    const vec3 e1=tri.p1-tri.p0;
+    const vec3 e2=tri.p2-tri.p0;
+    const vec3 p=cross(d,e2);
+    const float det=dot(e1,p);
+    if(std::fabs(det)<1e-12f)
+      return false;
+    const float inv_det=1.0f/det;
+    const vec3 s=o-tri.p0;
+    *u=dot(s,p)*inv_det;
+    if(*u<0.0f || *u>1.0f)
+      return false;
+    const vec3 q=cross(s,e1);
+    *v=dot(d,q)*inv_det;
+    if(*v<0.0f || *u+*v>1.0f)
+      return false;
+    *t=dot(e2,q)*inv_det;
+    return *t>=0.0f;
+  }
+
+  vec3 inverse_direction(const vec3& d)
+  {
+    const float big=std::numeric_limits<float>::max();
+    return vec3(d.x!=0.0f ? 1.0f/d.x : big,
+        d.y!=0.0f ? 1.0f/d.y : big,
+        d.z!=0.0f ? 1.0f/d.z : big);
+  }
+
+  /** point du triangle le plus proche de p (Ericson, Real-Time Collision Detection 5.1.5) */
+  vec3 closest_point_triangle(const vec3& p,const bvh_triangle& tri)
+  {
+    const vec3& a=tri.p0; const vec3& b=tri.p1; const vec3& c=tri.p2;
+    const vec3 ab=b-a,ac=c-a,ap=p-a;
+    const float d1=dot(ab,ap),d2=dot(ac,ap);
+    if(d1<=0.0f && d2<=0.0f) return a;
+
+    const vec3 bp=p-b;
+    const float d3=dot(ab,bp),d4=dot(ac,bp);
+    if(d3>=0.0f && d4<=d3) return b;
+
+    const float vc=d1*d4-d3*d2;
+    if(vc<=0.0f && d1>=0.0f && d3<=0.0f) return a+(d1/(d1-d3))*ab;
+
+    const vec3 cp=p-c;
+    const float d5=dot(ab,cp),d6=dot(ac,cp);
+    if(d6>=0.0f && d5<=d6) return c;
+
+    const float vb=d5*d2-d1*d6;
+    if(vb<=0.0f && d2>=0.0f && d6<=0.0f) return a+(d2/(d2-d6))*ac;
+
+    const float va=d3*d6-d5*d4;
+    if(va<=0.0f && (d4-d3)>=0.0f && (d5-d6)>=0.0f) return b+((d4-d3)/((d4-d3)+(d5-d6)))*(c-b);
+
+    const float denom=1.0f/(va+vb+vc);
+    return a+ab*(vb*denom)+ac*(vc*denom);
+  }
+
+  float distance2_box(const aabb& b,const vec3& p)
+  {
+    const float dx=std::max(std::max(b.p_min.x-p.x,0.0f),p.x-b.p_max.x);
+    const float dy=std::max(std::max(b.p_min.y-p.y,0.0f),p.y-b.p_max.y);
+    const float dz=std::max(std::max(b.p_min.z-p.z,0.0f),p.z-b.p_max.z);
+    return dx*dx+dy*dy+dz*dz;
+  }
+
+  /** test de separation de deux triangles selon un axe */
+  bool separated_on_axis(const vec3& n,const vec3 t0[3],const vec3 t1[3])
+  {
+    if(dot(n,n)<1e-20f)
+      return false;
+    float min0=dot(n,t0[0]),max0=min0;
+    float min1=dot(n,t1[0]),max1=min1;
+    for(int k=1;k<3;++k)
+    {
+      const float p0=dot(n,t0[k]),p1=dot(n,t1[k]);
+      min0=std::min(min0,p0); max0=std::max(max0,p0);
+      min1=std::min(min1,p1); max1=std::max(max1,p1);
+    }
+    return max0<min1 || max1<min0;
+  }
+
+  /** intersection triangle/triangle par le theoreme des axes separateurs */
+  bool triangle_overlap(const vec3 t0[3],const vec3 t1[3])
+  {
+    const vec3 e0[3]={t0[1]-t0[0],t0[2]-t0[1],t0[0]-t0[2]};
+    const vec3 e1[3]={t1[1]-t1[0],t1[2]-t1[1],t1[0]-t1[2]};
+    const vec3 n0=cross(e0[0],e0[1]);
+    const vec3 n1=cross(e1[0],e1[1]);
+
+    if(separated_on_axis(n0,t0,t1) || separated_on_axis(n1,t0,t1))
+      return false;
+    for(int i=0;i<3;++i)
+      for(int j=0;j<3;++j)
+        if(separated_on_axis(cross(e0[i],e1[j]),t0,t1))
+          return false;
+    //cas coplanaire: normales des aretes dans le plan
+    for(int i=0;i<3;++i)
+      if(separated_on_axis(cross(n0,e0[i]),t0,t1) || separated_on_axis(cross(n1,e1[i]),t0,t1))
+        return false;
+    return true;
+  }
+
+  const char bvh_magic[4]={'B','V','H','1'};
+}
+
+
+bvh build_bvh(const mesh* m)
+{
+  bvh res;
+  const int N=m->connectivity.size();
+  if(N==0)
+    return res;
+
+  build_context ctx;
+  ctx.bounds.resize(N);
+  ctx.centroid.resize(N);
+  ctx.order.resize(N);
+  parallel_for(0,N,1024,[&ctx,m](int begin,int end) {
+    for(int k=begin;k<end;++k)
+    {
+      const triangle_index& t=m->connectivity[k];
+      aabb b;
+      extend(&b,m->vertex[t.u0].position);
+      extend(&b,m->vertex[t.u1].position);
+      extend(&b,m->vertex[t.u2].position);
+      ctx.bounds[k]=b;
+      ctx.centroid[k]=center(b);
+      ctx.order[k]=k;
+    }
+  });
+
+  res.nodes.reserve(2*N);
+  build_recursive(&ctx,0,N,0,&res.nodes);
+
+  res.triangles.resize(N);
+  res.triangle_index=ctx.order;
+  parallel_for(0,N,1024,[&res,m](int begin,int end) {
+    for(int k=begin;k<end;++k)
+    {
+      const triangle_index& t=m->connectivity[res.triangle_index[k]];
+      bvh_triangle& tri=res.triangles[k];
+      tri.p0=m->vertex[t.u0].position;
+      tri.p1=m->vertex[t.u1].position;
+      tri.p2=m->vertex[t.u2].position;
+    }
+  });
+
+  return res;
+}
+
+aabb bvh_bounds(const bvh& b)
+{
+  if(b.nodes.empty())
+    return aabb();
+  return node_bounds(b.nodes[0]);
+}
+
+void bvh_bounding_sphere(const bvh& b,vec3* center,float* radius)
+{
+  const aabb box=bvh_bounds(b);
+  *center=b.nodes.empty() ? vec3() : 0.5f*(box.p_min+box.p_max);
+  float r2=0.0f;
+  for(unsigned int k=0;k<b.triangles.size();++k)
+  {
+    const bvh_triangle& t=b.triangles[k];
+    r2=std::max(r2,std::max(dot(t.p0-*center,t.p0-*center),std::max(dot(t.p1-*center,t.p1-*center),dot(t.p2-*center,t.p2-*center))));
+  }
+  *radius=std::sqrt(r2);
+}
+
+void transform_bvh(bvh* b,const mat4& T)
+{
+  for(unsigned int k=0;k<b->triangles.size();++k)
+  {
+    bvh_triangle& tri=b->triangles[k];
+    tri.p0=T*tri.p0;
+    tri.p1=T*tri.p1;
+    tri.p2=T*tri.p2;
+  }
+
+  //les enfants d'un noeud sont ranges apres lui: un parcours a rebours voit les enfants d'abord
+  for(int i=static_cast<int>(b->nodes.size())-1;i>=0;--i)
+  {
+    bvh_node& n=b->nodes[i];
+    aabb bounds;
+    if(n.count>0)
+    {
+      for(int k=n.offset;k<n.offset+n.count;++k)
+      {
+        extend(&bounds,b->triangles[k].p0);
+        extend(&bounds,b->triangles[k].p1);
+        extend(&bounds,b->triangles[k].p2);
+      }
+    }
+    else
+    {
+      extend(&bounds,node_bounds(b->nodes[i+1]));
+      extend(&bounds,node_bounds(b->nodes[n.offset]));
+    }
+    n.p_min=bounds.p_min;
+    n.p_max=bounds.p_max;
+  }
+}
+
+bool bvh_matches_mesh(const bvh& b,const mesh& m)
+{
+  if(b.triangles.size()!=m.connectivity.size() || b.triangle_index.size()!=m.connectivity.size())
+    return false;
+  for(unsigned int k=0;k<b.triangles.size();++k)
+  {
+    if(b.triangle_index[k]>=m.connectivity.size())
+      return false;
+    const triangle_index& t=m.connectivity[b.triangle_index[k]];
+    if(t.u0>=m.vertex.size() || t.u1>=m.vertex.size() || t.u2>=m.vertex.size())
+      return false;
+    const bvh_triangle& tri=b.triangles[k];
+    const vec3* p[3]={&tri.p0,&tri.p1,&tri.p2};
+    const unsigned int u[3]={t.u0,t.u1,t.u2};
+    for(int i=0;i<3;++i)
+    {
+      const vec3& q=m.vertex[u[i]].position;
+      if(p[i]->x!=q.x || p[i]->y!=q.y || p[i]->z!=q.z)
+        return false;
+    }
+  }
+  return true;
+}
+
+bool bvh_raycast(const bvh& b,const vec3& origin,const vec3& direction,float t_max,bvh_hit* hit)
+{
+  if(b.nodes.empty())
+    return false;
+
+  const vec3 inv_d=inverse_direction(direction);
+  bool found=false;
+  float t_best=t_max;
+
+  int stack[stack_size];
+  int top=0;
+  stack[top++]=0;
+  while(top>0)
+  {
+    const bvh_node& n=b.nodes[stack[--top]];
+    float t_enter;
+    if(!ray_box(node_bounds(n),origin,inv_d,t_best,&t_enter))
+      continue;
+
+    if(n.count>0)
+    {
+      for(int k=n.offset;k<n.offset+n.count;++k)
+      {
+        float t,u,v;
+        if(ray_triangle(b.triangles[k],origin,direction,&t,&u,&v) && t<=t_best)
+        {
+          t_best=t;
+          found=true;
+          hit->t=t; hit->u=u; hit->v=v;
+          hit->triangle=b.triangle_index[k];
+        }
+      }
+    }
+    else
+    {
+      //visite d'abord l'enfant le plus proche
+      const int left=(&n-&b.nodes[0])+1;
+      const int right=n.offset;
+      float t_left,t_right;
+      const bool hit_left=ray_box(node_bounds(b.nodes[left]),origin,inv_d,t_best,&t_left);
+      const bool hit_right=ray_box(node_bounds(b.nodes[right]),origin,inv_d,t_best,&t_right);
+      if(hit_left && hit_right)
+      {
+        if(t_left<t_right) { stack[top++]=right; stack[top++]=left; }
+        else               { stack[top++]=left; stack[top++]=right; }
+      }
+      else if(hit_left)  stack[top++]=left;
+      else if(hit_right) stack[top++]=right;
+    }
+  }
+  return found;
+}
+
+bool bvh_point_inside(const bvh& b,const vec3& p)
+{
+  if(b.nodes.empty() || distance2_box(bvh_bounds(b),p)>0.0f)
+    return false;
+
+  //compte les traversees d'un rayon legerement incline pour eviter aretes et sommets
+  const vec3 d=normalize(vec3(1.0f,0.0013f,0.0021f));
+  const vec3 inv_d=inverse_direction(d);
+  const float t_max=std::numeric_limits<float>::max();
+  int crossing=0;
+
+  int stack[stack_size];
+  int top=0;
+  stack[top++]=0;
+  while(top>0)
+  {
+    const int i=stack[--top];
+    const bvh_node& n=b.nodes[i];
+    float t_enter;
+    if(!ray_box(node_bounds(n),p,inv_d,t_max,&t_enter))
+      continue;
+    if(n.count>0)
+    {
+      for(int k=n.offset;k<n.offset+n.count;++k)
+      {
+        float t,u,v;
+        if(ray_triangle(b.triangles[k],p,d,&t,&u,&v))
+          crossing++;
+      }
+    }
+    else
+    {
+      stack[top++]=n.offset;
+      stack[top++]=i+1;
+    }
+  }
+  return crossing%2==1;
+}
+
+bool bvh_sphere_overlap(const bvh& b,const vec3& c,float radius)
+{
+  if(b.nodes.empty())
+    return false;
+
+  const float r2=radius*radius;
+  int stack[stack_size];
+  int top=0;
+  stack[top++]=0;
+  while(top>0)
+  {
+    const int i=stack[--top];
+    const bvh_node& n=b.nodes[i];
+    if(distance2_box(node_bounds(n),c)>r2)
+      continue;
+    if(n.count>0)
+    {
+      for(int k=n.offset;k<n.offset+n.count;++k)
+      {
+        const vec3 d=closest_point_triangle(c,b.triangles[k])-c;
+        if(dot(d,d)<=r2)
+          return true;
+      }
+    }
+    else
+    {
+      stack[top++]=n.offset;
+      stack[top++]=i+1;
+    }
+  }
+  return false;
+}
+
+bool bvh_swept_aabb_toi(const bvh& b,const aabb& box,const vec3& d,float* t)
+{
+  if(b.nodes.empty())
+    return false;
+
+  //seuls les noeuds touches par la boite balayee avant le premier impact connu sont visites
+  const aabb swept=swept_aabb(box,d);
+  const vec3 zero;
+  float t_min=std::numeric_limits<float>::infinity();
+  int stack[stack_size];
+  int top=0;
+  stack[top++]=0;
+  while(top>0)
+  {
+    const int i=stack[--top];
+    const bvh_node& n=b.nodes[i];
+    const aabb bounds=node_bounds(n);
+    float t_node;
+    if(!overlap(bounds,swept) || !swept_aabb_toi(bounds,zero,box,d,&t_node) || t_node>=t_min)
+      continue;
+    if(n.count>0)
+    {
+      for(int k=n.offset;k<n.offset+n.count;++k)
+      {
+        const bvh_triangle& tri=b.triangles[k];
+        aabb tri_bounds(tri.p0,tri.p0);
+        extend(&tri_bounds,tri.p1);
+        extend(&tri_bounds,tri.p2);
+        float t_tri;
+        if(swept_aabb_toi(tri_bounds,zero,box,d,&t_tri) && t_tri<t_min)
+          t_min=t_tri;
+      }
+    }
+    else
+    {
+      stack[top++]=n.offset;
+      stack[top++]=i+1;
+    }
+  }
+
+  if(t_min>1.0f)
+    return false;
+  *t=t_min;
+  return true;
+}
+
+bool bvh_overlap(const bvh& b0,const bvh& b1,const mat4& T1_to_0)
+{
+  if(b0.nodes.empty() || b1.nodes.empty())
+    return false;
+
+  std::vector<std::pair<int,int> > stack;
+  stack.push_back(std::make_pair(0,0));
+  while(!stack.empty())
+  {
+    const int i0=stack.back().first;
+    const int i1=stack.back().second;
+    stack.pop_back();
+
+    const bvh_node& n0=b0.nodes[i0];
+    const bvh_node& n1=b1.nodes[i1];
+    const aabb box0=node_bounds(n0);
+    const aabb box1=transform(T1_to_0,node_bounds(n1));
+    if(!overlap(box0,box1))
+      continue;
+
+    if(n0.count>0 && n1.count>0)
+    {
+      for(int k1=n1.offset;k1<n1.offset+n1.count;++k1)
+      {
+        const bvh_triangle& tri1=b1.triangles[k1];
+        const vec3 t1[3]={T1_to_0*tri1.p0,T1_to_0*tri1.p1,T1_to_0*tri1.p2};
+        aabb box_t1;
+        extend(&box_t1,t1[0]); extend(&box_t1,t1[1]); extend(&box_t1,t1[2]);
+        if(!overlap(box0,box_t1))
+          continue;
+        for(int k0=n0.offset;k0<n0.offset+n0.count;++k0)
+        {
+          const bvh_triangle& tri0=b0.triangles[k0];
+          const vec3 t0[3]={tri0.p0,tri0.p1,tri0.p2};
+          if(triangle_overlap(t0,t1))
+            return true;
+        }
+      }
+    }
+    else if(n1.count>0 || (n0.count==0 && surface_area(box0)>=surface_area(box1)))
+    {
+      stack.push_back(std::make_pair(n0.offset,i1));
+      stack.push_back(std::make_pair(i0+1,i1));
+    }
+    else
+    {
+      stack.push_back(std::make_pair(i0,n1.offset));
+      stack.push_back(std::make_pair(i0,i1+1));
+    }
+  }
+  return false;
+}
+
+std::vector<unsigned char> serialize_bvh(const bvh& b)
+{
+  const unsigned int nb_node=b.nodes.size();
+  const unsigned int nb_triangle=b.triangles.size();
+  const size_t size_header=sizeof(bvh_magic)+2*sizeof(unsigned int);
+  const size_t size_node=nb_node*sizeof(bvh_node);
+  const size_t size_triangle=nb_triangle*sizeof(bvh_triangle);
+  const size_t size_index=nb_triangle*sizeof(unsigned int);
+
+  std::vector<unsigned char> data(size_header+size_node+size_triangle+size_index);
+  unsigned char* p=&data[0];
+  std::memcpy(p,bvh_magic,sizeof(bvh_magic));       p+=sizeof(bvh_magic);
+  std::memcpy(p,&nb_node,sizeof(unsigned int));      p+=sizeof(unsigned int);
+  std::memcpy(p,&nb_triangle,sizeof(unsigned int));  p+=sizeof(unsigned int);
+  if(nb_node>0)     { std::memcpy(p,&b.nodes[0],size_node); p+=size_node; }
+  if(nb_triangle>0) { std::memcpy(p,&b.triangles[0],size_triangle); p+=size_triangle; }
+  if(nb_triangle>0) { std::memcpy(p,&b.triangle_index[0],size_index); }
+  return data;
+}
+
+namespace
+{
+  /** Verifie qu'un arbre relu peut etre parcouru sans sortir des tableaux: enfants apres leur parent
+   *  (donc sans cycle) et dans nodes, feuilles dans triangles, profondeur compatible avec les piles
+   *  de parcours de stack_size entrees */
+  bool valid_bvh_structure(const bvh& b)
+  {
+    const int nb_node=b.nodes.size();
+    const long long nb_triangle=b.triangles.size();
+    if(nb_node==0)
+      return nb_triangle==0;
+
+    std::vector<int> depth(nb_node,-1);
+    depth[0]=0;
+    for(int i=0;i<nb_node;++i)
+    {
+      const bvh_node& n=b.nodes[i];
+      if(depth[i]<0 || depth[i]>depth_max)
+        return false;
+      if(n.count>0)
+      {
+        if(n.offset<0 || n.offset+static_cast<long long>(n.count)>nb_triangle)
+          return false;
+      }
+      else if(n.count<0 || n.offset<=i+1 || n.offset>=nb_node)
+        return false;
+      else
+      {
+        //chaque noeud n'a qu'un parent: un noeud deja atteint ferait du partage
+        if(depth[i+1]>=0 || depth[n.offset]>=0)
+          return false;
+        depth[i+1]=depth[i]+1;
+        depth[n.offset]=depth[i]+1;
+      }
+    }
+    return true;
+  }
+}
+
+bool deserialize_bvh(const unsigned char* data,size_t size,bvh* b)
+{
+  const size_t size_header=sizeof(bvh_magic)+2*sizeof(unsigned int);
+  if(size<size_header || std::memcmp(data,bvh_magic,sizeof(bvh_magic))!=0)
+    return false;
+
+  unsigned int nb_node,nb_triangle;
+  std::memcpy(&nb_node,data+sizeof(bvh_magic),sizeof(unsigned int));
+  std::memcpy(&nb_triangle,data+sizeof(bvh_magic)+sizeof(unsigned int),sizeof(unsigned int));
+  const size_t size_node=static_cast<size_t>(nb_node)*sizeof(bvh_node);
+  const size_t size_triangle=static_cast<size_t>(nb_triangle)*sizeof(bvh_triangle);
+  const size_t size_index=static_cast<size_t>(nb_triangle)*sizeof(unsigned int);
+  if(size!=size_header+size_node+size_triangle+size_index)
+    return false;
+
+  const unsigned char* p=data+size_header;
+  b->nodes.resize(nb_node);
+  b->triangles.resize(nb_triangle);
+  b->triangle_index.resize(nb_triangle);
+  if(nb_node>0)     { std::memcpy(&b->nodes[0],p,size_node); p+=size_node; }
+  if(nb_triangle>0) { std::memcpy(&b->triangles[0],p,size_triangle); p+=size_triangle; }
+  if(nb_triangle>0) { std::memcpy(&b->triangle_index[0],p,size_index); }
+  return valid_bvh_structure(*b);
+}
+
+void save_bvh(const std::string& filename,const bvh& b)
+{
+  std::ofstream fid(filename.c_str(),std::ios::binary);
+  if(!fid.good())
+    throw std::string("Cannot open file "+filename);
+  const std::vector<unsigned char> data=serialize_bvh(b);
+  fid.write(reinterpret_cast<const char*>(&data[0]),data.size());
+}
+
+bvh load_bvh(const std::string& filename)
+{
+  mapped_file file(filename);
+  if(!file.is_open())
+    throw std::string("Cannot open file "+filename);
+
+  bvh b;
+  if(file.size()==0 || !deserialize_bvh(reinterpret_cast<const unsigned char*>(file.data()),file.size(),&b))
+    throw std::string("Invalid BVH file "+filename);
+  return b;
+}
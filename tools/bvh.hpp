@@ -0,0 +1,89 @@
+#pragma once
+
+#ifndef BVH_HPP
+#define BVH_HPP
+
+#include "aabb.hpp"
+
+#include <string>
+#include <vector>
+
+struct mesh;
+struct mat4;
+
+/** Un noeud de BVH aplati (32 octets).
+ *  Noeud interne (count==0): enfant gauche en i+1, enfant droit en offset.
+ *  Feuille (count>0): triangles [offset,offset+count[ */
+struct bvh_node
+{
+  vec3 p_min;
+  int offset;
+  vec3 p_max;
+  int count;
+};
+
+/** Les positions d'un triangle, copiees dans l'ordre des feuilles */
+struct bvh_triangle
+{
+  vec3 p0;
+  vec3 p1;
+  vec3 p2;
+};
+
+/** Une hierarchie de volumes englobants sur les triangles d'un maillage, en espace objet */
+struct bvh
+{
+  /** noeuds en ordre de parcours en profondeur, racine en 0 */
+  std::vector<bvh_node> nodes;
+  /** triangles ranges dans l'ordre des feuilles */
+  std::vector<bvh_triangle> triangles;
+  /** indice de chaque triangle dans mesh::connectivity */
+  std::vector<unsigned int> triangle_index;
+};
+
+/** Resultat d'un lancer de rayon */
+struct bvh_hit
+{
+  /** parametre du rayon au point d'impact */
+  float t;
+  /** indice du triangle touche dans mesh::connectivity */
+  unsigned int triangle;
+  /** coordonnees barycentriques du point d'impact */
+  float u;
+  float v;
+};
+
+/** Construit la BVH d'un maillage (heuristique SAH par casiers, construction parallele) */
+bvh build_bvh(const mesh* m);
+
+/** Boite englobante de la BVH */
+aabb bvh_bounds(const bvh& b);
+/** Sphere englobante des triangles, centree sur la boite englobante (rayon nul si la BVH est vide) */
+void bvh_bounding_sphere(const bvh& b,vec3* center,float* radius);
+/** Applique la transformation T aux triangles et recalcule les boites des noeuds (l'arbre est garde) */
+void transform_bvh(bvh* b,const mat4& T);
+/** Indique si les triangles de la BVH sont exactement ceux du maillage (memes indices, memes positions) */
+bool bvh_matches_mesh(const bvh& b,const mesh& m);
+
+/** Impact le plus proche du rayon origin+t*direction pour t dans [0,t_max] */
+bool bvh_raycast(const bvh& b,const vec3& origin,const vec3& direction,float t_max,bvh_hit* hit);
+/** Indique si le point est a l'interieur du maillage (suppose ferme) */
+bool bvh_point_inside(const bvh& b,const vec3& p);
+/** Indique si la sphere touche un triangle du maillage */
+bool bvh_sphere_overlap(const bvh& b,const vec3& center,float radius);
+/** Indique si deux maillages s'intersectent, T1_to_0 passant de l'espace de b1 a celui de b0 */
+bool bvh_overlap(const bvh& b0,const bvh& b1,const mat4& T1_to_0);
+/** Premier instant t dans [0,1] ou la boite box deplacee de d touche la boite d'un triangle (test conservatif) */
+bool bvh_swept_aabb_toi(const bvh& b,const aabb& box,const vec3& d,float* t);
+
+/** Serialise la BVH dans un tampon binaire */
+std::vector<unsigned char> serialize_bvh(const bvh& b);
+/** Relit une BVH serialisee, renvoie false si le tampon est invalide: taille, enfants hors de nodes ou
+ *  avant leur parent, feuilles hors de triangles, profondeur au-dela des piles de parcours */
+bool deserialize_bvh(const unsigned char* data,size_t size,bvh* b);
+/** Ecrit la BVH dans un fichier */
+void save_bvh(const std::string& filename,const bvh& b);
+/** Relit une BVH depuis un fichier */
+bvh load_bvh(const std::string& filename);
+
+#endif
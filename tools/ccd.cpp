@@ -0,0 +1,81 @@
+
+#include "ccd.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+
+aabb swept_aabb(const aabb& b,const vec3& d)
+{
+  aabb res=b;
+  extend(&res,b.p_min+d);
+  extend(&res,b.p_max+d);
+  return res;
+}
+
+bool swept_aabb_toi(const aabb& b0,const vec3& d0,const aabb& b1,const vec3& d1,float* t)
+{
+  if(overlap(b0,b1))
+  {
+    *t=0.0f;
+    return true;
+  }
+
+  //mouvement relatif de b1 vu depuis b0, puis intersection des intervalles de temps par axe
+  const vec3 v=d1-d0;
+  const float v_k[3]={v.x,v.y,v.z};
+  const float min0[3]={b0.p_min.x,b0.p_min.y,b0.p_min.z};
+  const float max0[3]={b0.p_max.x,b0.p_max.y,b0.p_max.z};
+  const float min1[3]={b1.p_min.x,b1.p_min.y,b1.p_min.z};
+  const float max1[3]={b1.p_max.x,b1.p_max.y,b1.p_max.z};
+
+  float t_enter=0.0f,t_exit=1.0f;
+  for(int k=0;k<3;++k)
+  {
+    if(v_k[k]==0.0f)
+    {
+      if(max1[k]<min0[k] || min1[k]>max0[k])
+        return false;
+      continue;
+    }
+    float ta=(min0[k]-max1[k])/v_k[k];
+    float tb=(max0[k]-min1[k])/v_k[k];
+    if(ta>tb) std::swap(ta,tb);
+    t_enter=std::max(t_enter,ta);
+    t_exit=std::min(t_exit,tb);
+    if(t_enter>t_exit)
+      return false;
+  }
+
+  *t=t_enter;
+  return true;
+}
+
+bool swept_sphere_toi(const vec3& c0,float r0,const vec3& d0,const vec3& c1,float r1,const vec3& d1,float* t)
+{
+  //|s+t*v|=r avec s l'ecart initial et v le mouvement relatif
+  const vec3 s=c1-c0;
+  const vec3 v=d1-d0;
+  const float r=r0+r1;
+  const float c=dot(s,s)-r*r;
+  if(c<=0.0f)
+  {
+    *t=0.0f;
+    return true;
+  }
+
+  const float a=dot(v,v);
+  const float b=dot(v,s);
+  if(a<=0.0f || b>=0.0f)
+    return false;
+
+  const float delta=b*b-a*c;
+  if(delta<0.0f)
+    return false;
+
+  const float t0=(-b-std::sqrt(delta))/a;
+  if(t0>1.0f)
+    return false;
+  *t=t0;
+  return true;
+}
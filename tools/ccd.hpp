@@ -0,0 +1,20 @@
+#pragma once
+
+#ifndef CCD_HPP
+#define CCD_HPP
+
+#include "aabb.hpp"
+
+/** Detection de collision continue entre deux pas de simulation.
+ *  Les objets sont supposes en translation uniforme pendant le pas, t=0 au debut et t=1 a la fin. */
+
+/** Boite englobant la boite b deplacee de 0 a d */
+aabb swept_aabb(const aabb& b,const vec3& d);
+
+/** Premier instant t dans [0,1] ou les boites b0 et b1 deplacees de d0 et d1 se touchent */
+bool swept_aabb_toi(const aabb& b0,const vec3& d0,const aabb& b1,const vec3& d1,float* t);
+
+/** Premier instant t dans [0,1] ou les spheres (c0,r0) et (c1,r1) deplacees de d0 et d1 se touchent */
+bool swept_sphere_toi(const vec3& c0,float r0,const vec3& d0,const vec3& c1,float r1,const vec3& d1,float* t);
+
+#endif
@@ -0,0 +1,153 @@
+
+#include "dds.hpp"
+
+#include "texture_compress.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+  /** format des pixels de l'en-tete DDS */
+  struct dds_pixel_format
+  {
+    unsigned int size;
+    unsigned int flags;
+    unsigned int four_cc;
+    unsigned int rgb_bit_count;
+    unsigned int r_mask;
+    unsigned int g_mask;
+    unsigned int b_mask;
+    unsigned int a_mask;
+  };
+
+  /** en-tete DDS apres le mot magique "DDS " */
+  struct dds_header
+  {
+    unsigned int size;
+    unsigned int flags;
+    unsigned int height;
+    unsigned int width;
+    unsigned int pitch_or_linear_size;
+    unsigned int depth;
+    unsigned int nb_mipmap;
+    unsigned int reserved1[11];
+    dds_pixel_format pixel_format;
+    unsigned int caps;
+    unsigned int caps2;
+    unsigned int caps3;
+    unsigned int caps4;
+    unsigned int reserved2;
+  };
+
+  /** extension DX10, presente quand four_cc vaut "DX10" */
+  struct dds_header_dx10
+  {
+    unsigned int dxgi_format;
+    unsigned int resource_dimension;
+    unsigned int misc_flag;
+    unsigned int array_size;
+    unsigned int misc_flags2;
+  };
+
+  const unsigned int dds_flag_mipmap_count=0x20000;
+  const unsigned int dds_pixel_four_cc=0x4;
+  const unsigned int dds_pixel_rgb=0x40;
+  const unsigned int dds_caps2_cubemap=0x200;
+  const unsigned int dds_caps2_volume=0x200000;
+
+  unsigned int four_cc(const char* s)
+  {
+    return static_cast<unsigned char>(s[0])|(static_cast<unsigned char>(s[1])<<8)|
+           (static_cast<unsigned char>(s[2])<<16)|(static_cast<unsigned int>(static_cast<unsigned char>(s[3]))<<24);
+  }
+
+  bool set_block_format(block_format format,texture_view* texture)
+  {
+    texture->gl_internal_format=block_gl_internal_format(format);
+    texture->gl_format=0;
+    texture->gl_type=0;
+    return true;
+  }
+
+  bool set_pixel_format(const dds_header& header,const unsigned char* data,size_t size,size_t* offset,texture_view* texture)
+  {
+    const dds_pixel_format& pf=header.pixel_format;
+    if(pf.flags&dds_pixel_four_cc)
+    {
+      if(pf.four_cc==four_cc("DXT1"))                                return set_block_format(block_bc1,texture);
+      if(pf.four_cc==four_cc("DXT5"))                                return set_block_format(block_bc3,texture);
+      if(pf.four_cc==four_cc("ATI1") || pf.four_cc==four_cc("BC4U")) return set_block_format(block_bc4,texture);
+      if(pf.four_cc==four_cc("ATI2") || pf.four_cc==four_cc("BC5U")) return set_block_format(block_bc5,texture);
+      if(pf.four_cc!=four_cc("DX10"))
+        return false;
+
+      dds_header_dx10 dx10;
+      if(*offset+sizeof(dx10)>size)
+        return false;
+      std::memcpy(&dx10,data+*offset,sizeof(dx10));
+      *offset+=sizeof(dx10);
+      //texture 2D (dimension 3) seule
+      if(dx10.resource_dimension!=3 || dx10.array_size>1)
+        return false;
+      switch(dx10.dxgi_format)
+      {
+      case 71: return set_block_format(block_bc1,texture); //DXGI_FORMAT_BC1_UNORM
+      case 77: return set_block_format(block_bc3,texture); //DXGI_FORMAT_BC3_UNORM
+      case 80: return set_block_format(block_bc4,texture); //DXGI_FORMAT_BC4_UNORM
+      case 83: return set_block_format(block_bc5,texture); //DXGI_FORMAT_BC5_UNORM
+      case 28:                                             //DXGI_FORMAT_R8G8B8A8_UNORM
+        texture->gl_internal_format=texture_gl_rgba8;
+        texture->gl_format=texture_gl_rgba;
+        texture->gl_type=texture_gl_unsigned_byte;
+        return true;
+      }
+      return false;
+    }
+
+    //pixels 32 bits non compresses, dans l'ordre RGBA ou BGRA (envoyes tels quels, le GPU fait la permutation)
+    if((pf.flags&dds_pixel_rgb) && pf.rgb_bit_count==32 && pf.g_mask==0x0000FF00)
+    {
+      texture->gl_internal_format=texture_gl_rgba8;
+      texture->gl_type=texture_gl_unsigned_byte;
+      if(pf.r_mask==0x000000FF && pf.b_mask==0x00FF0000) { texture->gl_format=texture_gl_rgba; return true; }
+      if(pf.r_mask==0x00FF0000 && pf.b_mask==0x000000FF) { texture->gl_format=texture_gl_bgra; return true; }
+    }
+    return false;
+  }
+}
+
+bool parse_dds_view(const unsigned char* data,size_t size,texture_view* texture)
+{
+  dds_header header;
+  if(size<4+sizeof(header) || std::memcmp(data,"DDS ",4)!=0)
+    return false;
+  std::memcpy(&header,data+4,sizeof(header));
+  if(header.size!=sizeof(header) || header.width==0 || header.height==0 ||
+     (header.caps2&(dds_caps2_cubemap|dds_caps2_volume))!=0)
+    return false;
+
+  size_t offset=4+sizeof(header);
+  if(!set_pixel_format(header,data,size,&offset,texture))
+    return false;
+
+  const unsigned int nb_level=(header.flags&dds_flag_mipmap_count) ? std::max(1u,header.nb_mipmap) : 1u;
+  if(nb_level>32)
+    return false;
+
+  block_format format=block_bc1;
+  const bool compressed=texture->compressed() && block_format_of(texture->gl_internal_format,&format);
+  texture->levels.resize(nb_level);
+  for(unsigned int k=0;k<nb_level;++k)
+  {
+    texture_level_view& level=texture->levels[k];
+    level.width=std::max(1u,header.width>>k);
+    level.height=std::max(1u,header.height>>k);
+    level.size=compressed ? block_size(format)*((level.width+3)/4)*((level.height+3)/4) : 4*static_cast<size_t>(level.width)*level.height;
+    if(level.size>size-offset)
+      return false;
+    level.data=data+offset;
+    offset+=level.size;
+  }
+  return true;
+}
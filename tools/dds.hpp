@@ -0,0 +1,15 @@
+#pragma once
+
+#ifndef DDS_HPP
+#define DDS_HPP
+
+#include "texture_data.hpp"
+
+#include <cstddef>
+
+/** Lit sur place une texture DDS 2D: blocs DXT1/DXT5/ATI1/ATI2 (BC1, BC3, BC4, BC5), en-tete DX10
+ *  avec les memes formats en UNORM, ou pixels 32 bits RGBA / BGRA. Les niveaux de la vue pointent
+ *  dans data. Renvoie false si le contenu n'est pas reconnu ou est tronque. */
+bool parse_dds_view(const unsigned char* data,size_t size,texture_view* texture);
+
+#endif
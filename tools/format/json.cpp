@@ -0,0 +1,342 @@
+/*
+ **    TP CPE Lyon
+ **    Copyright (C) 2015 Damien Rohmer
+ **
+ **    This program is free software: you can redistribute it and/or modify
+ **    it under the terms of the GNU General Public License as published by
+ **    the Free Software Foundation, either version 3 of the License, or
+ **    (at your option) any later version.
+ **
+ **   This program is distributed in the hope that it will be useful,
+ **    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ **    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ **    GNU General Public License for more details.
+ **
+ **    You should have received a copy of the GNU General Public License
+ **    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "json.hpp"
+#include "parse_number.hpp"
+
+#include <cmath>
+#include <cstring>
+
+
+namespace cpe
+{
+
+  namespace
+  {
+    const int json_max_depth=256;
+
+    inline const char* skip_space(const char* p,const char* end)
+    {
+      while(p<end && (*p==' ' || *p=='\n' || *p=='\r' || *p=='\t'))
+        ++p;
+      return p;
+    }
+
+    void append_utf8(std::string& s,unsigned int c)
+    {
+      if(c<0x80)
+        s+=static_cast<char>(c);
+      else if(c<0x800)
+      {
+        s+=static_cast<char>(0xC0|(c>>6));
+        s+=static_cast<char>(0x80|(c&0x3F));
+      }
+      else if(c<0x10000)
+      {
+        s+=static_cast<char>(0xE0|(c>>12));
+        s+=static_cast<char>(0x80|((c>>6)&0x3F));
+        s+=static_cast<char>(0x80|(c&0x3F));
+      }
+      else
+      {
+        s+=static_cast<char>(0xF0|(c>>18));
+        s+=static_cast<char>(0x80|((c>>12)&0x3F));
+        s+=static_cast<char>(0x80|((c>>6)&0x3F));
+        s+=static_cast<char>(0x80|(c&0x3F));
+      }
+    }
+
+    bool parse_hex4(const char* p,const char* end,unsigned int* value)
+    {
+      if(end-p<4)
+        return false;
+      unsigned int v=0;
+      for(int k=0;k<4;++k)
+      {
+        const char c=p[k];
+        v<<=4;
+        if(c>='0' && c<='9')      v|=c-'0';
+        else if(c>='a' && c<='f') v|=c-'a'+10;
+        else if(c>='A' && c<='F') v|=c-'A'+10;
+        else return false;
+      }
+      *value=v;
+      return true;
+    }
+  }
+
+  json_document::json_document()
+    :end(nullptr)
+  {}
+
+  json_document::json_document(const char* data,size_t size)
+    :end(nullptr)
+  {
+    parse(data,size);
+  }
+
+  void json_document::parse(const char* data,size_t size)
+  {
+    nodes.clear();
+    end=data+size;
+    const char* p=skip_space(data,end);
+    if(p==end)
+      throw std::string("Empty JSON document");
+    p=skip_space(parse_value(p),end);
+    if(p!=end)
+      throw std::string("Unexpected data after the JSON document");
+  }
+
+  const char* json_document::parse_string(const char* p,const char** text,size_t* text_size)
+  {
+    //p is after the opening quote, escapes are only validated here
+    const char* start=p;
+    while(p<end && *p!='"')
+    {
+      if(*p=='\\')
+        ++p;
+      ++p;
+    }
+    if(p>=end)
+      throw std::string("Unterminated JSON string");
+    *text=start;
+    *text_size=p-start;
+    return p+1;
+  }
+
+  const char* json_document::parse_value(const char* p)
+  {
+    //explicit stack of the open containers instead of recursion
+    std::vector<int> stack;
+    std::vector<int> last_child;
+
+    while(true)
+    {
+      p=skip_space(p,end);
+      if(p>=end)
+        throw std::string("Unexpected end of JSON document");
+
+      json_node n={json_null,0,-1,nullptr,0,nullptr,0,0.0};
+
+      //key when the current container is an object
+      if(!stack.empty() && nodes[stack.back()].type==json_object)
+      {
+        if(*p!='"')
+          throw std::string("Expected a key in JSON object");
+        p=parse_string(p+1,&n.key,&n.key_size);
+        p=skip_space(p,end);
+        if(p>=end || *p!=':')
+          throw std::string("Expected ':' in JSON object");
+        p=skip_space(p+1,end);
+        if(p>=end)
+          throw std::string("Unexpected end of JSON document");
+      }
+
+      bool open=false;
+      const char c=*p;
+      if(c=='{' || c=='[')
+      {
+        n.type=c=='{' ? json_object : json_array;
+        open=true;
+        ++p;
+      }
+      else if(c=='"')
+      {
+        n.type=json_string;
+        p=parse_string(p+1,&n.text,&n.text_size);
+      }
+      else if(c=='t' && end-p>=4 && std::strncmp(p,"true",4)==0)  { n.type=json_bool; n.number=1.0; p+=4; }
+      else if(c=='f' && end-p>=5 && std::strncmp(p,"false",5)==0) { n.type=json_bool; p+=5; }
+      else if(c=='n' && end-p>=4 && std::strncmp(p,"null",4)==0)  { p+=4; }
+      else
+      {
+        //integers are read exactly (byte offsets may exceed float precision)
+        const char* q=p;
+        const bool negative=q<end && *q=='-';
+        if(negative) ++q;
+        unsigned long long v=0;
+        const char* digits=q;
+        while(q<end && is_digit(*q) && q-digits<18)
+          v=10*v+(*q++-'0');
+        if(q==digits)
+          throw std::string("Invalid JSON value");
+        if(q<end && (*q=='.' || *q=='e' || *q=='E' || is_digit(*q)))
+        {
+          double f=0.0;
+          q=parse_float(p,end,&f);
+          n.number=f;
+        }
+        else
+          n.number=negative ? -static_cast<double>(v) : static_cast<double>(v);
+        n.type=json_number;
+        p=q;
+      }
+
+      //link to the parent
+      const int index=static_cast<int>(nodes.size());
+      if(!stack.empty())
+      {
+        ++nodes[stack.back()].size;
+        if(last_child.back()>=0)
+          nodes[last_child.back()].next=index;
+        last_child.back()=index;
+      }
+      nodes.push_back(n);
+
+      if(open)
+      {
+        if(stack.size()>=static_cast<size_t>(json_max_depth))
+          throw std::string("JSON document too deep");
+        stack.push_back(index);
+        last_child.push_back(-1);
+        p=skip_space(p,end);
+        const char close=n.type==json_object ? '}' : ']';
+        if(p<end && *p==close)
+        {
+          ++p;
+          stack.pop_back();
+          last_child.pop_back();
+        }
+        else
+          continue;
+      }
+
+      //after a value: ',' continues the container, '}' or ']' closes it
+      while(true)
+      {
+        if(stack.empty())
+          return p;
+        p=skip_space(p,end);
+        if(p>=end)
+          throw std::string("Unexpected end of JSON document");
+        const char close=nodes[stack.back()].type==json_object ? '}' : ']';
+        if(*p==',')
+        {
+          ++p;
+          break;
+        }
+        if(*p!=close)
+          throw std::string("Expected ',' or closing bracket in JSON document");
+        ++p;
+        stack.pop_back();
+        last_child.pop_back();
+      }
+    }
+  }
+
+  int json_document::root() const
+  {
+    return 0;
+  }
+
+  const json_node& json_document::node(int k) const
+  {
+    return nodes[k];
+  }
+
+  int json_document::find(int object,const char* key) const
+  {
+    if(object<0 || nodes[object].type!=json_object || nodes[object].size==0)
+      return -1;
+    const size_t key_size=std::strlen(key);
+    for(int k=object+1;k>=0;k=nodes[k].next)
+      if(nodes[k].key_size==key_size && std::strncmp(nodes[k].key,key,key_size)==0)
+        return k;
+    return -1;
+  }
+
+  int json_document::at(int array,int index) const
+  {
+    if(array<0 || nodes[array].type!=json_array || index<0 || index>=nodes[array].size)
+      return -1;
+    int k=array+1;
+    for(int i=0;i<index;++i)
+      k=nodes[k].next;
+    return k;
+  }
+
+  int json_document::size(int k) const
+  {
+    return k<0 ? 0 : nodes[k].size;
+  }
+
+  double json_document::number(int k,double default_value) const
+  {
+    if(k<0 || (nodes[k].type!=json_number && nodes[k].type!=json_bool))
+      return default_value;
+    return nodes[k].number;
+  }
+
+  long long json_document::integer(int k,long long default_value) const
+  {
+    if(k<0 || nodes[k].type!=json_number)
+      return default_value;
+    return static_cast<long long>(std::floor(nodes[k].number+0.5));
+  }
+
+  std::string json_document::string(int k,const std::string& default_value) const
+  {
+    if(k<0 || nodes[k].type!=json_string)
+      return default_value;
+
+    const char* p=nodes[k].text;
+    const char* const p_end=p+nodes[k].text_size;
+    std::string s;
+    s.reserve(nodes[k].text_size);
+    while(p<p_end)
+    {
+      if(*p!='\\')
+      {
+        s+=*p++;
+        continue;
+      }
+      ++p;
+      if(p>=p_end)
+        break;
+      const char c=*p++;
+      switch(c)
+      {
+        case 'b': s+='\b'; break;
+        case 'f': s+='\f'; break;
+        case 'n': s+='\n'; break;
+        case 'r': s+='\r'; break;
+        case 't': s+='\t'; break;
+        case 'u':
+        {
+          unsigned int u=0;
+          if(!parse_hex4(p,p_end,&u))
+            throw std::string("Invalid \\u escape in JSON string");
+          p+=4;
+          //surrogate pair
+          unsigned int low=0;
+          if(u>=0xD800 && u<0xDC00 && p_end-p>=6 && p[0]=='\\' && p[1]=='u' && parse_hex4(p+2,p_end,&low) && low>=0xDC00 && low<0xE000)
+          {
+            u=0x10000+((u-0xD800)<<10)+(low-0xDC00);
+            p+=6;
+          }
+          append_utf8(s,u);
+          break;
+        }
+        default: s+=c; break;
+      }
+    }
+    return s;
+  }
+
+}
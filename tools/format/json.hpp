@@ -0,0 +1,96 @@
+/*
+ **    TP CPE Lyon
+ **    Copyright (C) 2015 Damien Rohmer
+ **
+ **    This program is free software: you can redistribute it and/or modify
+ **    it under the terms of the GNU General Public License as published by
+ **    the Free Software Foundation, either version 3 of the License, or
+ **    (at your option) any later version.
+ **
+ **   This program is distributed in the hope that it will be useful,
+ **    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ **    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ **    GNU General Public License for more details.
+ **
+ **    You should have received a copy of the GNU General Public License
+ **    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#ifndef JSON_HPP
+#define JSON_HPP
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace cpe
+{
+
+  enum json_type {json_null,json_bool,json_number,json_string,json_array,json_object};
+
+  /** A node of a parsed JSON document.
+   *
+   *  Nodes are stored in document order: the first child of a node k (if any)
+   *  is node k+1 and siblings are linked through next. Keys and strings point
+   *  into the source text, escape sequences are only resolved by
+   *  json_document::string().
+   */
+  struct json_node
+  {
+    json_type type;
+    int size;            //number of children (array and object)
+    int next;            //index of the next sibling, -1 for the last one
+    const char* key;     //key in the parent object (nullptr otherwise)
+    size_t key_size;
+    const char* text;    //raw string content (without quotes)
+    size_t text_size;
+    double number;       //number value, 0/1 for booleans
+  };
+
+  /** A minimal JSON reader: one pass, no allocation per value.
+   *
+   *  The source text must stay alive as long as the document is used.
+   *  Syntax errors are thrown as std::string.
+   */
+  class json_document
+  {
+  public:
+    json_document();
+    /** Parse the text [data,data+size[ */
+    json_document(const char* data,size_t size);
+
+    /** Parse the text [data,data+size[ (replaces the previous content) */
+    void parse(const char* data,size_t size);
+
+    /** Index of the root node */
+    int root() const;
+    /** Access to node k */
+    const json_node& node(int k) const;
+
+    /** Value associated to key in an object node, -1 when absent or not an object */
+    int find(int object,const char* key) const;
+    /** Element of an array node, -1 when out of range or not an array */
+    int at(int array,int index) const;
+    /** Number of children of an array or object node (0 for k=-1) */
+    int size(int k) const;
+
+    /** Value of a number node, default_value for k=-1 or another type */
+    double number(int k,double default_value=0.0) const;
+    /** Value of a number node rounded to an integer */
+    long long integer(int k,long long default_value=0) const;
+    /** Unescaped value of a string node, default_value for k=-1 or another type */
+    std::string string(int k,const std::string& default_value="") const;
+
+  private:
+    const char* parse_value(const char* p);
+    const char* parse_string(const char* p,const char** text,size_t* text_size);
+
+    const char* end;
+    std::vector<json_node> nodes;
+  };
+
+}
+
+#endif
@@ -0,0 +1,531 @@
+/*
+ **    TP CPE Lyon
+ **    Copyright (C) 2015 Damien Rohmer
+ **
+ **    This program is free software: you can redistribute it and/or modify
+ **    it under the terms of the GNU General Public License as published by
+ **    the Free Software Foundation, either version 3 of the License, or
+ **    (at your option) any later version.
+ **
+ **   This program is distributed in the hope that it will be useful,
+ **    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ **    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ **    GNU General Public License for more details.
+ **
+ **    You should have received a copy of the GNU General Public License
+ **    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "mesh_io_gltf.hpp"
+#include "json.hpp"
+#include "../mesh.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+
+namespace cpe
+{
+
+  namespace
+  {
+    const unsigned int glb_magic=0x46546C67;       //"glTF"
+    const unsigned int glb_chunk_json=0x4E4F534A;  //"JSON"
+    const unsigned int glb_chunk_bin=0x004E4942;   //"BIN\0"
+
+    unsigned int read_u32(const unsigned char* p)
+    {
+      return p[0] | (p[1]<<8) | (p[2]<<16) | (static_cast<unsigned int>(p[3])<<24);
+    }
+
+    bool decode_base64(const char* p,const char* end,std::vector<unsigned char>* out)
+    {
+      out->clear();
+      out->reserve((end-p)/4*3);
+      unsigned int bits=0;
+      int nb_bit=0;
+      for(;p<end && *p!='=';++p)
+      {
+        const char c=*p;
+        int v;
+        if(c>='A' && c<='Z')      v=c-'A';
+        else if(c>='a' && c<='z') v=c-'a'+26;
+        else if(c>='0' && c<='9') v=c-'0'+52;
+        else if(c=='+' || c=='-') v=62;
+        else if(c=='/' || c=='_') v=63;
+        else return false;
+        bits=(bits<<6)|v;
+        nb_bit+=6;
+        if(nb_bit>=8)
+        {
+          nb_bit-=8;
+          out->push_back(static_cast<unsigned char>(bits>>nb_bit));
+        }
+      }
+      return true;
+    }
+
+    /** Decode a data uri (data:...;base64,...), false if uri is not a data uri */
+    bool decode_data_uri(const std::string& uri,std::vector<unsigned char>* out)
+    {
+      if(uri.compare(0,5,"data:")!=0)
+        return false;
+      const size_t comma=uri.find(',');
+      if(comma==std::string::npos || uri.rfind(";base64",comma)==std::string::npos)
+        throw std::string("Unsupported data uri in glTF file");
+      if(!decode_base64(uri.c_str()+comma+1,uri.c_str()+uri.size(),out))
+        throw std::string("Invalid base64 data in glTF file");
+      return true;
+    }
+
+    /** Relative uri to file path (%xx escapes) */
+    std::string uri_path(const std::string& directory,const std::string& uri)
+    {
+      std::string path=directory;
+      for(size_t k=0;k<uri.size();++k)
+      {
+        if(uri[k]=='%' && k+2<uri.size())
+        {
+          path+=static_cast<char>(std::strtol(uri.substr(k+1,2).c_str(),nullptr,16));
+          k+=2;
+        }
+        else
+          path+=uri[k];
+      }
+      return path;
+    }
+
+    int component_size(int component_type)
+    {
+      switch(component_type)
+      {
+        case gltf_byte: case gltf_unsigned_byte:   return 1;
+        case gltf_short: case gltf_unsigned_short: return 2;
+        case gltf_unsigned_int: case gltf_float:   return 4;
+        default: return 0;
+      }
+    }
+
+    int nb_component_of(const std::string& type)
+    {
+      if(type=="SCALAR") return 1;
+      if(type=="VEC2")   return 2;
+      if(type=="VEC3")   return 3;
+      if(type=="VEC4")   return 4;
+      if(type=="MAT2")   return 4;
+      if(type=="MAT3")   return 9;
+      if(type=="MAT4")   return 16;
+      return 0;
+    }
+
+    /** Children of an array node */
+    std::vector<int> elements(const json_document& json,int array)
+    {
+      std::vector<int> e;
+      if(array<0 || json.node(array).type!=json_array)
+        return e;
+      e.reserve(json.size(array));
+      for(int k=json.size(array)>0 ? array+1 : -1;k>=0;k=json.node(k).next)
+        e.push_back(k);
+      return e;
+    }
+
+    int checked_index(const json_document& json,int node,size_t size,const char* what)
+    {
+      if(node<0)
+        return -1;
+      const long long k=json.integer(node,-1);
+      if(k<0 || static_cast<size_t>(k)>=size)
+        throw std::string("Invalid ")+what+" index in glTF file";
+      return static_cast<int>(k);
+    }
+  }
+
+  gltf_file::gltf_file()
+  {}
+
+  gltf_file::gltf_file(const std::string& filename)
+  {
+    open(filename);
+  }
+
+  void gltf_file::clear()
+  {
+    buffer_views.clear();
+    accessors.clear();
+    meshes.clear();
+    images.clear();
+    materials.clear();
+    external.clear();
+    decoded.clear();
+    buffer_data.clear();
+    buffer_size.clear();
+    image_decoded.clear();
+  }
+
+  void gltf_file::open(const std::string& filename)
+  {
+    clear();
+    if(!file.open(filename))
+      throw std::string("Cannot open file "+filename);
+    const size_t slash=filename.find_last_of("/\\");
+    open_memory(file.data(),file.size(),slash==std::string::npos ? "" : filename.substr(0,slash+1));
+  }
+
+  void gltf_file::open_memory(const char* data,size_t size,const std::string& directory_param)
+  {
+    clear();
+    if(data!=file.data())
+      file.close();
+    directory=directory_param;
+
+    const unsigned char* u=reinterpret_cast<const unsigned char*>(data);
+    if(size<12 || read_u32(u)!=glb_magic)
+    {
+      read_json(data,size,nullptr,0);
+      return;
+    }
+
+    //glb: header then JSON chunk and optional BIN chunk
+    if(read_u32(u+4)!=2)
+      throw std::string("Unsupported glb version");
+    const size_t length=std::min<size_t>(read_u32(u+8),size);
+    const char* json=nullptr;
+    size_t json_size=0;
+    const unsigned char* bin=nullptr;
+    size_t bin_size=0;
+    for(size_t offset=12;offset+8<=length;)
+    {
+      const size_t chunk_size=read_u32(u+offset);
+      const unsigned int chunk_type=read_u32(u+offset+4);
+      if(chunk_size>length-offset-8)
+        throw std::string("Truncated glb chunk");
+      if(chunk_type==glb_chunk_json && json==nullptr)
+      {
+        json=data+offset+8;
+        json_size=chunk_size;
+      }
+      else if(chunk_type==glb_chunk_bin && bin==nullptr)
+      {
+        bin=u+offset+8;
+        bin_size=chunk_size;
+      }
+      offset+=8+((chunk_size+3)&~size_t(3));
+    }
+    if(json==nullptr)
+      throw std::string("Missing JSON chunk in glb file");
+    read_json(json,json_size,bin,bin_size);
+  }
+
+  void gltf_file::read_json(const char* text,size_t text_size,const unsigned char* bin,size_t bin_size)
+  {
+    const json_document json(text,text_size);
+    const int root=json.root();
+
+    //buffers: glb binary chunk, data uri or external file (mapped)
+    const std::vector<int> buffers=elements(json,json.find(root,"buffers"));
+    for(unsigned int k=0;k<buffers.size();++k)
+    {
+      const size_t byte_length=static_cast<size_t>(json.integer(json.find(buffers[k],"byteLength")));
+      const std::string uri=json.string(json.find(buffers[k],"uri"));
+      const unsigned char* data=nullptr;
+      size_t size=0;
+      if(uri.empty())
+      {
+        if(k!=0 || bin==nullptr)
+          throw std::string("glTF buffer without uri nor glb binary chunk");
+        data=bin;
+        size=bin_size;
+      }
+      else
+      {
+        std::vector<unsigned char> bytes;
+        if(decode_data_uri(uri,&bytes))
+        {
+          decoded.push_back(std::vector<unsigned char>());
+          decoded.back().swap(bytes);
+          data=decoded.back().empty() ? nullptr : &decoded.back()[0];
+          size=decoded.back().size();
+        }
+        else
+        {
+          const std::string path=uri_path(directory,uri);
+          external.push_back(std::unique_ptr<mapped_file>(new mapped_file(path)));
+          if(!external.back()->is_open())
+            throw std::string("Cannot open glTF buffer "+path);
+          data=reinterpret_cast<const unsigned char*>(external.back()->data());
+          size=external.back()->size();
+        }
+      }
+      if(size<byte_length)
+        throw std::string("glTF buffer shorter than its byteLength");
+      buffer_data.push_back(data);
+      buffer_size.push_back(byte_length);
+    }
+
+    const std::vector<int> views=elements(json,json.find(root,"bufferViews"));
+    for(unsigned int k=0;k<views.size();++k)
+    {
+      gltf_buffer_view v;
+      v.buffer=checked_index(json,json.find(views[k],"buffer"),buffer_data.size(),"buffer");
+      v.offset=static_cast<size_t>(json.integer(json.find(views[k],"byteOffset"),0));
+      v.size=static_cast<size_t>(json.integer(json.find(views[k],"byteLength"),0));
+      v.stride=static_cast<size_t>(json.integer(json.find(views[k],"byteStride"),0));
+      if(v.buffer<0 || v.offset>buffer_size[v.buffer] || v.size>buffer_size[v.buffer]-v.offset)
+        throw std::string("glTF buffer view out of its buffer");
+      buffer_views.push_back(v);
+    }
+
+    const std::vector<int> accessor_nodes=elements(json,json.find(root,"accessors"));
+    for(unsigned int k=0;k<accessor_nodes.size();++k)
+    {
+      const int n=accessor_nodes[k];
+      if(json.find(n,"sparse")>=0)
+        throw std::string("Sparse glTF accessors are not supported");
+      gltf_accessor a;
+      a.buffer_view=checked_index(json,json.find(n,"bufferView"),buffer_views.size(),"bufferView");
+      a.offset=static_cast<size_t>(json.integer(json.find(n,"byteOffset"),0));
+      a.count=static_cast<size_t>(json.integer(json.find(n,"count"),0));
+      a.component_type=static_cast<int>(json.integer(json.find(n,"componentType"),0));
+      a.nb_component=nb_component_of(json.string(json.find(n,"type")));
+      a.normalized=json.number(json.find(n,"normalized"),0.0)!=0.0;
+      if(component_size(a.component_type)==0 || a.nb_component==0)
+        throw std::string("Invalid glTF accessor type");
+      accessors.push_back(a);
+
+      if(a.buffer_view>=0 && a.count>0)
+      {
+        const size_t end=a.offset+(a.count-1)*accessor_stride(k)+element_size(k);
+        if(end>buffer_views[a.buffer_view].size)
+          throw std::string("glTF accessor out of its buffer view");
+      }
+    }
+
+    //images: bufferView (glb), data uri (decoded once) or external file
+    const std::vector<int> image_nodes=elements(json,json.find(root,"images"));
+    image_decoded.resize(image_nodes.size());
+    for(unsigned int k=0;k<image_nodes.size();++k)
+    {
+      gltf_image im;
+      im.buffer_view=checked_index(json,json.find(image_nodes[k],"bufferView"),buffer_views.size(),"bufferView");
+      im.uri=json.string(json.find(image_nodes[k],"uri"));
+      im.mime_type=json.string(json.find(image_nodes[k],"mimeType"));
+      decode_data_uri(im.uri,&image_decoded[k]);
+      images.push_back(im);
+    }
+
+    std::vector<int> texture_image;
+    const std::vector<int> textures=elements(json,json.find(root,"textures"));
+    for(unsigned int k=0;k<textures.size();++k)
+      texture_image.push_back(checked_index(json,json.find(textures[k],"source"),images.size(),"image"));
+
+    const std::vector<int> material_nodes=elements(json,json.find(root,"materials"));
+    for(unsigned int k=0;k<material_nodes.size();++k)
+    {
+      gltf_material mat;
+      const int pbr=json.find(material_nodes[k],"pbrMetallicRoughness");
+      const int factor=json.find(pbr,"baseColorFactor");
+      for(int c=0;c<4;++c)
+        mat.base_color[c]=static_cast<float>(json.number(json.at(factor,c),1.0));
+      const int texture=checked_index(json,json.find(json.find(pbr,"baseColorTexture"),"index"),texture_image.size(),"texture");
+      mat.base_color_texture=texture<0 ? -1 : texture_image[texture];
+      materials.push_back(mat);
+    }
+
+    const char* attribute_names[gltf_nb_attribute]={"POSITION","NORMAL","COLOR_0","TEXCOORD_0"};
+    const std::vector<int> mesh_nodes=elements(json,json.find(root,"meshes"));
+    for(unsigned int k=0;k<mesh_nodes.size();++k)
+    {
+      gltf_mesh gm;
+      gm.name=json.string(json.find(mesh_nodes[k],"name"));
+      const std::vector<int> primitives=elements(json,json.find(mesh_nodes[k],"primitives"));
+      for(unsigned int i=0;i<primitives.size();++i)
+      {
+        gltf_primitive p;
+        const int attributes=json.find(primitives[i],"attributes");
+        for(int a=0;a<gltf_nb_attribute;++a)
+          p.attribute[a]=checked_index(json,json.find(attributes,attribute_names[a]),accessors.size(),"accessor");
+        p.indices=checked_index(json,json.find(primitives[i],"indices"),accessors.size(),"accessor");
+        p.material=checked_index(json,json.find(primitives[i],"material"),materials.size(),"material");
+        p.mode=static_cast<int>(json.integer(json.find(primitives[i],"mode"),gltf_triangles));
+        if(p.indices>=0)
+        {
+          const int type=accessors[p.indices].component_type;
+          if(type!=gltf_unsigned_byte && type!=gltf_unsigned_short && type!=gltf_unsigned_int)
+            throw std::string("Invalid glTF index type");
+        }
+        gm.primitives.push_back(p);
+      }
+      meshes.push_back(gm);
+    }
+  }
+
+  const unsigned char* gltf_file::view_data(int view) const
+  {
+    const gltf_buffer_view& v=buffer_views[view];
+    return buffer_data[v.buffer]+v.offset;
+  }
+
+  const unsigned char* gltf_file::accessor_data(int accessor) const
+  {
+    const gltf_accessor& a=accessors[accessor];
+    return a.buffer_view<0 ? nullptr : view_data(a.buffer_view)+a.offset;
+  }
+
+  size_t gltf_file::element_size(int accessor) const
+  {
+    const gltf_accessor& a=accessors[accessor];
+    return component_size(a.component_type)*a.nb_component;
+  }
+
+  size_t gltf_file::accessor_stride(int accessor) const
+  {
+    const gltf_accessor& a=accessors[accessor];
+    if(a.buffer_view>=0 && buffer_views[a.buffer_view].stride>0)
+      return buffer_views[a.buffer_view].stride;
+    return element_size(accessor);
+  }
+
+  void gltf_file::read_float(int accessor,size_t element,float* value,int nb_value) const
+  {
+    const gltf_accessor& a=accessors[accessor];
+    const int n=std::min(nb_value,a.nb_component);
+    const unsigned char* p=accessor_data(accessor);
+    if(p==nullptr)
+    {
+      for(int k=0;k<n;++k)
+        value[k]=0.0f;
+      return;
+    }
+    p+=element*accessor_stride(accessor);
+
+    if(a.component_type==gltf_float)
+    {
+      std::memcpy(value,p,n*sizeof(float));
+      return;
+    }
+    for(int k=0;k<n;++k)
+    {
+      float v=0.0f;
+      switch(a.component_type)
+      {
+        case gltf_byte:           { signed char c; std::memcpy(&c,p+k,1); v=a.normalized ? std::max(c/127.0f,-1.0f) : c; break; }
+        case gltf_unsigned_byte:  { v=a.normalized ? p[k]/255.0f : p[k]; break; }
+        case gltf_short:          { short c; std::memcpy(&c,p+2*k,2); v=a.normalized ? std::max(c/32767.0f,-1.0f) : c; break; }
+        case gltf_unsigned_short: { unsigned short c; std::memcpy(&c,p+2*k,2); v=a.normalized ? c/65535.0f : c; break; }
+        case gltf_unsigned_int:   { unsigned int c; std::memcpy(&c,p+4*k,4); v=static_cast<float>(c); break; }
+      }
+      value[k]=v;
+    }
+  }
+
+  unsigned int gltf_file::read_index(int accessor,size_t element) const
+  {
+    const unsigned char* p=accessor_data(accessor);
+    if(p==nullptr)
+      return 0;
+    p+=element*accessor_stride(accessor);
+    switch(accessors[accessor].component_type)
+    {
+      case gltf_unsigned_byte:  return p[0];
+      case gltf_unsigned_short: { unsigned short v; std::memcpy(&v,p,2); return v; }
+      default:                  { unsigned int v; std::memcpy(&v,p,4); return v; }
+    }
+  }
+
+  bool gltf_file::image_data(int image,const unsigned char** data,size_t* size) const
+  {
+    const gltf_image& im=images[image];
+    if(im.buffer_view>=0)
+    {
+      *data=view_data(im.buffer_view);
+      *size=buffer_views[im.buffer_view].size;
+      return true;
+    }
+    if(!image_decoded[image].empty())
+    {
+      *data=&image_decoded[image][0];
+      *size=image_decoded[image].size();
+      return true;
+    }
+    return false;
+  }
+
+  std::string gltf_file::image_path(int image) const
+  {
+    return uri_path(directory,images[image].uri);
+  }
+
+
+  mesh mesh_from_gltf(const gltf_file& gltf)
+  {
+    mesh m;
+    for(unsigned int k_mesh=0;k_mesh<gltf.meshes.size();++k_mesh)
+    {
+      const std::vector<gltf_primitive>& primitives=gltf.meshes[k_mesh].primitives;
+      for(unsigned int k=0;k<primitives.size();++k)
+      {
+        const gltf_primitive& p=primitives[k];
+        const int position=p.attribute[gltf_position];
+        if(position<0 || (p.mode!=gltf_triangles && p.mode!=gltf_triangle_strip && p.mode!=gltf_triangle_fan))
+          continue;
+
+        //vertices: base color of the material, modulated by COLOR_0
+        float base_color[4]={1.0f,1.0f,1.0f,1.0f};
+        if(p.material>=0)
+          std::memcpy(base_color,gltf.materials[p.material].base_color,sizeof(base_color));
+
+        const size_t offset=m.vertex.size();
+        const size_t nb_vertex=gltf.accessors[position].count;
+        m.vertex.resize(offset+nb_vertex);
+        for(size_t i=0;i<nb_vertex;++i)
+        {
+          vertex_opengl& v=m.vertex[offset+i];
+          gltf.read_float(position,i,&v.position.x,3);
+          if(p.attribute[gltf_normal]>=0)   gltf.read_float(p.attribute[gltf_normal],i,&v.normal.x,3);
+          if(p.attribute[gltf_texcoord]>=0) gltf.read_float(p.attribute[gltf_texcoord],i,&v.texture.x,2);
+          v.color=vec3(1.0f,1.0f,1.0f);
+          if(p.attribute[gltf_color]>=0)    gltf.read_float(p.attribute[gltf_color],i,&v.color.x,3);
+          v.color=vec3(v.color.x*base_color[0],v.color.y*base_color[1],v.color.z*base_color[2]);
+        }
+
+        //triangles (strips and fans are unrolled)
+        const size_t nb_index=p.indices>=0 ? gltf.accessors[p.indices].count : nb_vertex;
+        std::vector<unsigned int> index(nb_index);
+        for(size_t i=0;i<nb_index;++i)
+        {
+          index[i]=p.indices>=0 ? gltf.read_index(p.indices,i) : static_cast<unsigned int>(i);
+          if(index[i]>=nb_vertex)
+            throw std::string("Vertex index out of range in glTF file");
+          index[i]+=static_cast<unsigned int>(offset);
+        }
+        if(p.mode==gltf_triangles)
+          for(size_t i=0;i+2<nb_index;i+=3)
+            m.connectivity.push_back(triangle_index(index[i],index[i+1],index[i+2]));
+        else if(p.mode==gltf_triangle_strip)
+          for(size_t i=2;i<nb_index;++i)
+            m.connectivity.push_back(i%2==0 ? triangle_index(index[i-2],index[i-1],index[i]) : triangle_index(index[i-1],index[i-2],index[i]));
+        else
+          for(size_t i=2;i<nb_index;++i)
+            m.connectivity.push_back(triangle_index(index[0],index[i-1],index[i]));
+      }
+    }
+    return m;
+  }
+
+  mesh load_mesh_file_gltf(std::string const& filename)
+  {
+    const gltf_file gltf(filename);
+    return mesh_from_gltf(gltf);
+  }
+
+  mesh load_mesh_memory_gltf(const char* data,size_t size)
+  {
+    gltf_file gltf;
+    gltf.open_memory(data,size);
+    return mesh_from_gltf(gltf);
+  }
+
+}
@@ -0,0 +1,160 @@
+/*
+ **    TP CPE Lyon
+ **    Copyright (C) 2015 Damien Rohmer
+ **
+ **    This program is free software: you can redistribute it and/or modify
+ **    it under the terms of the GNU General Public License as published by
+ **    the Free Software Foundation, either version 3 of the License, or
+ **    (at your option) any later version.
+ **
+ **   This program is distributed in the hope that it will be useful,
+ **    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ **    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ **    GNU General Public License for more details.
+ **
+ **    You should have received a copy of the GNU General Public License
+ **    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#ifndef MESH_IO_GLTF_HPP
+#define MESH_IO_GLTF_HPP
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "../mapped_file.hpp"
+
+class mesh;
+
+namespace cpe
+{
+
+  /** Component types and primitive modes use the OpenGL enum values, as in the glTF specification */
+  enum gltf_component_type {gltf_byte=5120,gltf_unsigned_byte=5121,gltf_short=5122,gltf_unsigned_short=5123,
+                            gltf_unsigned_int=5125,gltf_float=5126};
+  enum gltf_mode {gltf_points=0,gltf_lines=1,gltf_triangles=4,gltf_triangle_strip=5,gltf_triangle_fan=6};
+
+  /** Vertex attributes read from a primitive, numbered as the shader locations of vertex_opengl */
+  enum gltf_attribute {gltf_position=0,gltf_normal=1,gltf_color=2,gltf_texcoord=3,gltf_nb_attribute=4};
+
+  struct gltf_buffer_view
+  {
+    int buffer;
+    size_t offset;
+    size_t size;
+    size_t stride;   //0 when tightly packed
+  };
+
+  struct gltf_accessor
+  {
+    int buffer_view;  //-1: all elements are zero
+    size_t offset;    //offset in the buffer view
+    size_t count;
+    int component_type;
+    int nb_component;
+    bool normalized;
+  };
+
+  struct gltf_primitive
+  {
+    int attribute[gltf_nb_attribute];  //accessor of each attribute, -1 if absent
+    int indices;                       //accessor of the indices, -1 if not indexed
+    int material;
+    int mode;
+  };
+
+  struct gltf_mesh
+  {
+    std::string name;
+    std::vector<gltf_primitive> primitives;
+  };
+
+  struct gltf_image
+  {
+    int buffer_view;        //embedded image (glb), -1 otherwise
+    std::string uri;        //external file or data uri
+    std::string mime_type;
+  };
+
+  struct gltf_material
+  {
+    float base_color[4];
+    int base_color_texture; //image index, -1 if none
+  };
+
+  /** A glTF 2.0 file (.gltf with external or data uri buffers, or binary .glb).
+   *
+   *  The file and its external buffers are memory mapped: buffer views and
+   *  embedded images point directly into the mapping, so they can be handed to
+   *  glBufferData / image decoders without any intermediate copy. Only data
+   *  uris (base64) are decoded into owned memory. The scene graph is not read,
+   *  meshes stay in their own frame. Errors are thrown as std::string.
+   */
+  class gltf_file
+  {
+  public:
+    gltf_file();
+    /** Open a .gltf or .glb file */
+    explicit gltf_file(const std::string& filename);
+
+    /** Open a .gltf or .glb file (replaces the previous content) */
+    void open(const std::string& filename);
+    /** Read a file already in memory, data must outlive this object.
+     *  External uris are resolved relative to directory. */
+    void open_memory(const char* data,size_t size,const std::string& directory="");
+
+    /** Start of a buffer view */
+    const unsigned char* view_data(int view) const;
+    /** First element of an accessor (nullptr if it has no buffer view) */
+    const unsigned char* accessor_data(int accessor) const;
+    /** Distance in bytes between two elements of an accessor */
+    size_t accessor_stride(int accessor) const;
+    /** Size in bytes of one element of an accessor */
+    size_t element_size(int accessor) const;
+
+    /** Read one element of an accessor as floats (normalized integers are mapped to [0,1] or [-1,1]) */
+    void read_float(int accessor,size_t element,float* value,int nb_value) const;
+    /** Read one element of an index accessor */
+    unsigned int read_index(int accessor,size_t element) const;
+
+    /** Bytes of an image stored in the file (bufferView or data uri), false for an external image */
+    bool image_data(int image,const unsigned char** data,size_t* size) const;
+    /** Path of an external image */
+    std::string image_path(int image) const;
+
+    std::vector<gltf_buffer_view> buffer_views;
+    std::vector<gltf_accessor> accessors;
+    std::vector<gltf_mesh> meshes;
+    std::vector<gltf_image> images;
+    std::vector<gltf_material> materials;
+
+  private:
+    gltf_file(const gltf_file&);
+    gltf_file& operator=(const gltf_file&);
+
+    void clear();
+    void read_json(const char* json,size_t json_size,const unsigned char* bin,size_t bin_size);
+
+    std::string directory;
+    mapped_file file;
+    std::vector<std::unique_ptr<mapped_file> > external;
+    std::vector<std::vector<unsigned char> > decoded;
+    std::vector<const unsigned char*> buffer_data;
+    std::vector<size_t> buffer_size;
+    std::vector<std::vector<unsigned char> > image_decoded;
+  };
+
+  /** Merge the triangles of all primitives of a glTF file in one mesh */
+  mesh mesh_from_gltf(const gltf_file& gltf);
+  /** Load a mesh structure from a .gltf or .glb file */
+  mesh load_mesh_file_gltf(std::string const& filename);
+  /** Load a mesh structure from a .glb (or a .gltf with data uris) held in memory (ex. a pack entry) */
+  mesh load_mesh_memory_gltf(const char* data,size_t size);
+
+}
+
+#endif
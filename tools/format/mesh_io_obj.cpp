@@ -17,13 +17,16 @@
  */
 
 #include "mesh_io_obj.hpp"
+#include "parse_number.hpp"
 #include "../mesh.hpp"
+#include "../mapped_file.hpp"
+#include "../thread_pool.hpp"
 
-#include <sstream>
-#include <fstream>
-#include <assert.h>
-#include <map>
+#include <algorithm>
 #include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
 
 namespace cpe
 {
@@ -31,247 +34,681 @@ namespace cpe
   std::vector<int> split_face_data(std::string const& face_data_str)
   {
     std::vector<int> data;
-    std::string current_str=face_data_str;
+    const char* p=face_data_str.c_str();
+    const char* const end=p+face_data_str.size();
 
-    while(current_str.length()>0)
+    while(p<end)
     {
-      while(current_str.length()>0 && current_str[0]=='/')
-      {
-        std::string temp_str=current_str.substr(1,current_str.length()-1);
-        current_str=temp_str;
-      }
+      while(p<end && (*p=='/' || is_blank(*p)))
+        ++p;
 
       int value;
-      std::stringstream tokenizer(current_str);
-      tokenizer>>value;
+      const char* next=parse_int(p,end,&value);
+      if(next==p)
+        break;
       data.push_back(value);
-
-      std::string residual;
-      tokenizer>>residual;
-
-      current_str=residual;
+      p=next;
     }
 
     return data;
   }
 
-  void read_vertex_obj(std::stringstream& tokens,obj_structure& obj)
+  namespace
   {
-    vec3 v;
-    tokens >> v.x;
-    tokens >> v.y;
-    tokens >> v.z;
-    obj.data_vertex.push_back(v);
-  }
+    /** Convert an obj index (1-based, or negative relative to the current end) to a 0-based index */
+    int resolve_index(int value,int count)
+    {
+      return value>0 ? value-1 : count+value;
+    }
 
-  void read_texture_obj(std::stringstream& tokens,obj_structure& obj)
-  {
-    vec2 t;
-    tokens >> t.x;
-    tokens >> t.y;
-    obj.data_texture.push_back(t);
-  }
+    const char* read_vec3(const char* p,const char* end,vec3* v)
+    {
+      p=parse_float(skip_blank(p,end),end,&v->x);
+      p=parse_float(skip_blank(p,end),end,&v->y);
+      p=parse_float(skip_blank(p,end),end,&v->z);
+      return p;
+    }
 
-  void read_normal_obj(std::stringstream& tokens,obj_structure& obj)
-  {
-    vec3 n;
-    tokens >> n.x;
-    tokens >> n.y;
-    tokens >> n.z;
-    obj.data_normal.push_back(n);
-  }
+    /** Face indices are gathered in fixed buffers so that each stored polygon costs one allocation */
+    struct face_buffer
+    {
+      int data[16];
+      std::vector<int> overflow;
+      int size;
 
-  void read_face_obj(std::stringstream& tokens,obj_structure& obj)
-  {
-    std::vector<std::vector<int> > face_data;
-    while(tokens.good())
+      face_buffer():size(0) {}
+      void push_back(int value)
+      {
+        if(size<16)       data[size]=value;
+        else if(size==16) { overflow.assign(data,data+16); overflow.push_back(value); }
+        else              overflow.push_back(value);
+        ++size;
+      }
+      void store(std::vector<std::vector<int> >& faces) const
+      {
+        if(size==0)
+          return;
+        faces.push_back(std::vector<int>());
+        if(size<=16) faces.back().assign(data,data+size);
+        else         faces.back()=overflow;
+      }
+    };
+
+    /** A negative index read in a chunk, relative to the data of the chunk only */
+    struct obj_fixup
     {
-      std::string polygon_index_str;
-      tokens >> polygon_index_str;
+      int kind;        //0: vertex, 1: texture, 2: normal
+      int face;        //index of the face in the chunk
+      int slot;        //position in the face
+    };
 
-      std::vector<int> const current_data=split_face_data(polygon_index_str);
-      face_data.push_back(current_data);
+    /** The entries of a range of lines, with indices not yet shifted by previous chunks */
+    struct obj_chunk
+    {
+      obj_structure obj;
+      std::vector<obj_fixup> fixup;
+    };
+
+    void push_index(int value,int kind,int count,face_buffer& face,int face_index,obj_chunk& chunk)
+    {
+      if(value<0)
+      {
+        obj_fixup f={kind,face_index,face.size};
+        chunk.fixup.push_back(f);
+      }
+      face.push_back(resolve_index(value,count));
     }
 
-    std::vector<int> temp_vertex;
-    std::vector<int> temp_texture;
-    std::vector<int> temp_normal;
-    for(int k=0,N=face_data.size() ; k<N ; ++k)
+    const char* read_face(const char* p,const char* end,obj_chunk& chunk)
     {
-      std::vector<int> const& index_face = face_data[k];
-      int const N_dim=index_face.size();
-      for(int k_dim=0;k_dim<N_dim;++k_dim)
+      obj_structure& obj=chunk.obj;
+      face_buffer temp_vertex;
+      face_buffer temp_texture;
+      face_buffer temp_normal;
+
+      const int N_vertex=obj.data_vertex.size();
+      const int N_texture=obj.data_texture.size();
+      const int N_normal=obj.data_normal.size();
+
+      while(true)
       {
-        int const value=index_face[k_dim];
+        p=skip_blank(p,end);
+        int value;
+        const char* next=parse_int(p,end,&value);
+        if(next==p)
+          break;
+        p=next;
+        push_index(value,0,N_vertex,temp_vertex,obj.data_face_vertex.size(),chunk);
+
+        //v/vt, v/vt/vn or v//vn
+        if(p<end && *p=='/')
+        {
+          ++p;
+          next=parse_int(p,end,&value);
+          if(next!=p)
+            push_index(value,1,N_texture,temp_texture,obj.data_face_texture.size(),chunk);
+          p=next;
+          if(p<end && *p=='/')
+          {
+            ++p;
+            next=parse_int(p,end,&value);
+            if(next!=p)
+              push_index(value,2,N_normal,temp_normal,obj.data_face_normal.size(),chunk);
+            p=next;
+          }
+        }
+      }
+
+      temp_vertex.store(obj.data_face_vertex);
+      temp_texture.store(obj.data_face_texture);
+      temp_normal.store(obj.data_face_normal);
+
+      return p;
+    }
+
+    void parse_obj_chunk(const char* begin,const char* end,obj_chunk& chunk)
+    {
+      obj_structure& structure=chunk.obj;
 
-        switch(k_dim)
+      //count the entries first so that every array is allocated once
+      size_t N_vertex=0,N_texture=0,N_normal=0,N_face=0;
+      for(const char* p=begin;p<end;)
+      {
+        if(p+1<end)
         {
-          case 0:
-            temp_vertex.push_back(value-1);
-            break;
-          case 1:
-            temp_texture.push_back(value-1);
-            break;
-          case 2:
-            temp_normal.push_back(value-1);
-            break;
-          default:
-            std::cerr<<"Error reading file "<<std::endl;
-            exit(1);
+          if(p[0]=='v')
+          {
+            N_vertex+=is_blank(p[1]);
+            N_texture+=p[1]=='t';
+            N_normal+=p[1]=='n';
+          }
+          N_face+=p[0]=='f';
+        }
+        const char* eol=static_cast<const char*>(std::memchr(p,'\n',end-p));
+        p=eol ? eol+1 : end;
+      }
+      structure.data_vertex.reserve(N_vertex);
+      structure.data_texture.reserve(N_texture);
+      structure.data_normal.reserve(N_normal);
+      structure.data_face_vertex.reserve(N_face);
+      if(N_texture>0) structure.data_face_texture.reserve(N_face);
+      if(N_normal>0)  structure.data_face_normal.reserve(N_face);
+
+      //scan the lines in place, without copy
+      const char* p=begin;
+      while(p<end)
+      {
+        p=skip_blank(p,end);
+        if(p+1<end && p[0]=='v')
+        {
+          //vertices
+          if(is_blank(p[1]))
+          {
+            vec3 v;
+            p=read_vec3(p+1,end,&v);
+            structure.data_vertex.push_back(v);
+          }
+
+          //texture
+          else if(p[1]=='t' && p+2<end && is_blank(p[2]))
+          {
+            vec2 t;
+            p=parse_float(skip_blank(p+2,end),end,&t.x);
+            p=parse_float(skip_blank(p,end),end,&t.y);
+            structure.data_texture.push_back(t);
+          }
+
+          //normal
+          else if(p[1]=='n' && p+2<end && is_blank(p[2]))
+          {
+            vec3 n;
+            p=read_vec3(p+2,end,&n);
+            structure.data_normal.push_back(n);
+          }
         }
+
+        //connectivity
+        else if(p+1<end && p[0]=='f' && is_blank(p[1]))
+          p=read_face(p+1,end,chunk);
+
+        //comments and unsupported entries
+        p=skip_line(p,end);
       }
     }
 
-    if(temp_vertex.size()>0)
-      obj.data_face_vertex.push_back(temp_vertex);
-    if(temp_texture.size()>0)
-      obj.data_face_texture.push_back(temp_texture);
-    if(temp_normal.size()>0)
-      obj.data_face_normal.push_back(temp_normal);
+    template <typename T>
+    void append(std::vector<T>& dst,std::vector<T>& src)
+    {
+      dst.insert(dst.end(),std::make_move_iterator(src.begin()),std::make_move_iterator(src.end()));
+    }
   }
 
   obj_structure load_file_obj_structure(std::string const& filename)
   {
-    std::ifstream fid(filename.c_str());
-    if(!fid.good())
+    mapped_file file(filename);
+    if(!file.is_open())
       throw std::string("Cannot open file "+filename);
 
-    std::string buffer;
+    return parse_obj_structure(file.data(),file.size());
+  }
 
+  obj_structure parse_obj_structure(const char* data,size_t size)
+  {
+    const char* const begin=data;
+    const char* const end=begin+size;
+
+    //chunks cut at line boundaries are parsed independently
+    const std::vector<const char*> bounds=split_lines(begin,end,default_thread_pool().size()+1);
+    const int N_chunk=bounds.size()-1;
+    std::vector<obj_chunk> chunks(N_chunk);
+    parallel_for(0,N_chunk,1,[&bounds,&chunks](int k_begin,int k_end) {
+      for(int k=k_begin;k<k_end;++k)
+        parse_obj_chunk(bounds[k],bounds[k+1],chunks[k]);
+    });
+    if(N_chunk==1)
+      return chunks[0].obj;
+
+    //merge, relative indices are shifted by the number of entries of the previous chunks
     obj_structure structure;
-
-    //read the whole file
-    while(fid.good()==true)
+    size_t N_vertex=0,N_texture=0,N_normal=0;
+    size_t N_face_vertex=0,N_face_texture=0,N_face_normal=0;
+    for(int k=0;k<N_chunk;++k)
     {
-      //read line
-      std::getline(fid,buffer);
+      const obj_structure& c=chunks[k].obj;
+      N_vertex+=c.data_vertex.size(); N_texture+=c.data_texture.size(); N_normal+=c.data_normal.size();
+      N_face_vertex+=c.data_face_vertex.size(); N_face_texture+=c.data_face_texture.size(); N_face_normal+=c.data_face_normal.size();
+    }
+    structure.data_vertex.reserve(N_vertex);
+    structure.data_texture.reserve(N_texture);
+    structure.data_normal.reserve(N_normal);
+    structure.data_face_vertex.reserve(N_face_vertex);
+    structure.data_face_texture.reserve(N_face_texture);
+    structure.data_face_normal.reserve(N_face_normal);
+
+    for(int k=0;k<N_chunk;++k)
+    {
+      obj_structure& c=chunks[k].obj;
+      const int prefix[3]={static_cast<int>(structure.data_vertex.size()),
+                           static_cast<int>(structure.data_texture.size()),
+                           static_cast<int>(structure.data_normal.size())};
+      std::vector<std::vector<int> >* faces[3]={&c.data_face_vertex,&c.data_face_texture,&c.data_face_normal};
+      for(unsigned int i=0;i<chunks[k].fixup.size();++i)
+      {
+        const obj_fixup& f=chunks[k].fixup[i];
+        (*faces[f.kind])[f.face][f.slot]+=prefix[f.kind];
+      }
+
+      append(structure.data_vertex,c.data_vertex);
+      append(structure.data_texture,c.data_texture);
+      append(structure.data_normal,c.data_normal);
+      append(structure.data_face_vertex,c.data_face_vertex);
+      append(structure.data_face_texture,c.data_face_texture);
+      append(structure.data_face_normal,c.data_face_normal);
+    }
 
-      if(buffer.size()>0)
+    return structure;
+  }
+
+
+
+  namespace
+  {
+    /** Open addressing table (linear probing) from a (v,vt,vn) corner to its vertex in the mesh.
+     *  The capacity doubles when the table gets half full. */
+    class corner_table
+    {
+    public:
+      explicit corner_table(size_t N_corner_max)
+        :nb_used(0)
       {
-        std::stringstream tokens_buffer(buffer);
-        std::string first_word;
-        tokens_buffer>>first_word;
+        size_t capacity=16;
+        while(capacity<2*N_corner_max)
+          capacity*=2;
+        mask=capacity-1;
+        slots.assign(capacity,slot());
+      }
 
-        //skip comments
-        if(first_word.length()>0 && first_word[0]!='#')
+      /** Index stored for the corner, or insert next_index and return it */
+      int find_or_insert(int v,int vt,int vn,int next_index)
+      {
+        if(2*(nb_used+1)>slots.size())
+          grow();
+        size_t h=hash(v,vt,vn)&mask;
+        while(true)
         {
-          //vertices
-          if(first_word=="v")
-            read_vertex_obj(tokens_buffer,structure);
+          slot& s=slots[h];
+          if(s.index<0)
+          {
+            s.v=v; s.vt=vt; s.vn=vn; s.index=next_index;
+            ++nb_used;
+            return next_index;
+          }
+          if(s.v==v && s.vt==vt && s.vn==vn)
+            return s.index;
+          h=(h+1)&mask;
+        }
+      }
 
-          //texture
-          if(first_word=="vt")
-            read_texture_obj(tokens_buffer,structure);
+      /** Memory used by the table in bytes */
+      size_t memory() const
+      {
+        return slots.capacity()*sizeof(slot);
+      }
 
-          //normal
-          if(first_word=="vn")
-            read_normal_obj(tokens_buffer,structure);
+    private:
+      struct slot
+      {
+        int v,vt,vn,index;
+        slot():v(0),vt(0),vn(0),index(-1) {}
+      };
 
-          //connectivity
-          if(first_word=="f")
-            read_face_obj(tokens_buffer,structure);
-        }
+      static size_t hash(int v,int vt,int vn)
+      {
+        unsigned long long h=static_cast<unsigned int>(v);
+        h=h*0x9E3779B97F4A7C15ull^static_cast<unsigned int>(vt);
+        h=h*0x9E3779B97F4A7C15ull^static_cast<unsigned int>(vn);
+        h^=h>>29;
+        h*=0xBF58476D1CE4E5B9ull;
+        h^=h>>32;
+        return static_cast<size_t>(h);
+      }
 
+      void grow()
+      {
+        std::vector<slot> old(2*slots.size());
+        old.swap(slots);
+        mask=slots.size()-1;
+        for(size_t k=0;k<old.size();++k)
+        {
+          if(old[k].index<0)
+            continue;
+          size_t h=hash(old[k].v,old[k].vt,old[k].vn)&mask;
+          while(slots[h].index>=0)
+            h=(h+1)&mask;
+          slots[h]=old[k];
+        }
       }
 
-    }
+      std::vector<slot> slots;
+      size_t mask;
+      size_t nb_used;
+    };
 
-    return structure;
+    /** Attribute index of a polygon corner, -1 when the face does not give it */
+    /** attribute index of a corner, -1 when the face does not give this attribute for every corner */
+    int corner_attribute(const std::vector<std::vector<int> >& faces,bool used,int k_face,int k_dim,int dim,int size)
+    {
+      if(!used)
+        return -1;
+      const std::vector<int>& face=faces[k_face];
+      if(static_cast<int>(face.size())!=dim)
+        return -1;
+      const int idx=face[k_dim];
+      if(idx<0 || idx>=size)
+        throw std::string("Index out of range in OBJ data");
+      return idx;
+    }
   }
 
+  mesh load_mesh_file_obj(const std::string& filename)
+  {
+    const obj_structure obj=load_file_obj_structure(filename);
+    try
+    {
+      return mesh_from_obj_structure(obj);
+    }
+    catch(const std::string&)
+    {
+      throw std::string("Index out of range in OBJ file "+filename);
+    }
+  }
 
+  mesh load_mesh_memory_obj(const char* data,size_t size)
+  {
+    return mesh_from_obj_structure(parse_obj_structure(data,size));
+  }
 
-  mesh load_mesh_file_obj(const std::string& filename)
+  mesh mesh_from_obj_structure(const obj_structure& obj)
   {
     mesh mesh_loaded;
 
-    obj_structure obj=load_file_obj_structure(filename);
+    int const N_face=obj.data_face_vertex.size();
+    bool is_vertex=obj.data_vertex.size()>0 && N_face>0;
+    //attributes are only usable when every face gives them (otherwise faces cannot be matched)
+    bool is_normal=obj.data_normal.size()>0 && static_cast<int>(obj.data_face_normal.size())==N_face;
+    bool is_texture=obj.data_texture.size()>0 && static_cast<int>(obj.data_face_texture.size())==N_face;
 
-    bool is_vertex=obj.data_vertex.size()>0 && obj.data_face_vertex.size()>0;
-    bool is_normal=obj.data_normal.size()>0 && obj.data_face_normal.size()>0;
-    bool is_texture=obj.data_texture.size()>0 && obj.data_face_texture.size()>0;
+    if(!is_vertex)
+      return mesh_loaded;
 
-    if(is_vertex && !is_normal && !is_texture)
+    size_t N_corner=0,N_triangle=0;
+    for(int k_face=0;k_face<N_face;++k_face)
+    {
+      size_t const dim=obj.data_face_vertex[k_face].size();
+      N_corner+=dim;
+      N_triangle+=dim>2 ? dim-2 : 0;
+    }
+    mesh_loaded.connectivity.reserve(N_triangle);
+
+    int const N_vertex=obj.data_vertex.size();
+
+    //positions only: the obj indices are directly the mesh indices
+    if(!is_normal && !is_texture)
     {
-      int const N_face=obj.data_face_vertex.size();
       for(int k_face=0;k_face<N_face;++k_face)
       {
         std::vector<int> const& polygon=obj.data_face_vertex[k_face];
         int const dim=polygon.size();
 
-        assert(dim>=2);
+        //faces with less than 3 corners give no triangle, as in the streamed loader
+        for(int k=0;k<dim;++k)
+          if(polygon[k]<0 || polygon[k]>=N_vertex)
+            throw std::string("Index out of range in OBJ data");
         for(int k=2;k<dim;++k)
           mesh_loaded.connectivity.push_back(triangle_index(polygon[0],polygon[1],polygon[k]));
       }
 
-      int const N_vertex=obj.data_vertex.size();
+      mesh_loaded.vertex.reserve(N_vertex);
       for(int k_vertex=0;k_vertex<N_vertex;++k_vertex)
         mesh_loaded.vertex.push_back( vertex_opengl(obj.data_vertex[k_vertex],vec3(),vec3(),vec2()) );
+
+      return mesh_loaded;
     }
 
-    if(is_vertex && !is_normal && is_texture)
-    {
-      std::vector<vec3> data_vertex;
-      std::vector<vec2> data_texture;
+    //one mesh vertex per distinct (v,vt,vn) corner
+    int const N_texture=obj.data_texture.size();
+    int const N_normal=obj.data_normal.size();
+    //sized for about two distinct corners per position, the table grows if there are more
+    corner_table table(std::min(N_corner,static_cast<size_t>(N_vertex)*2));
+    mesh_loaded.vertex.reserve(std::min(N_corner,static_cast<size_t>(N_vertex)*2));
 
-      std::map<int,int> map_vertex;
-      std::map<int,int> map_texture;
-      long int counter_max=0;
+    std::vector<int> polygon;
+    for(int k_face=0;k_face<N_face;++k_face)
+    {
+      std::vector<int> const& face_vertex=obj.data_face_vertex[k_face];
+      int const dim=face_vertex.size();
 
-      int const N_face=obj.data_face_vertex.size();
-      assert(static_cast<int>(obj.data_face_texture.size())==N_face);
-      for(int k_face=0;k_face<N_face;++k_face)
+      polygon.resize(dim);
+      for(int k_dim=0;k_dim<dim;++k_dim)
       {
-        std::vector<int> const& face_vertex=obj.data_face_vertex[k_face];
-        std::vector<int> const& face_texture=obj.data_face_texture[k_face];
-
-        int const dim=face_vertex.size();
-        assert(dim>2);
-        assert(static_cast<int>(face_texture.size())==dim);
-        for(int k_dim=0;k_dim<dim;++k_dim)
+        int const idx_vertex=face_vertex[k_dim];
+        if(idx_vertex<0 || idx_vertex>=N_vertex)
+          throw std::string("Index out of range in OBJ data");
+        int const idx_texture=corner_attribute(obj.data_face_texture,is_texture,k_face,k_dim,dim,N_texture);
+        int const idx_normal=corner_attribute(obj.data_face_normal,is_normal,k_face,k_dim,dim,N_normal);
+
+        int const next_index=mesh_loaded.vertex.size();
+        int const index=table.find_or_insert(idx_vertex,idx_texture,idx_normal,next_index);
+        if(index==next_index)
         {
-          int const idx_vertex=face_vertex[k_dim];
-          int const idx_texture=face_texture[k_dim];
+          vec3 const normal=idx_normal>=0 ? obj.data_normal[idx_normal] : vec3();
+          vec2 const texture=idx_texture>=0 ? obj.data_texture[idx_texture] : vec2();
+          mesh_loaded.vertex.push_back( vertex_opengl(obj.data_vertex[idx_vertex],normal,vec3(),texture) );
+        }
+        polygon[k_dim]=index;
+      }
 
-          std::map<int,int>::const_iterator it_vertex=map_vertex.find(idx_vertex);
-          std::map<int,int>::const_iterator it_texture=map_texture.find(idx_texture);
+      for(int k_dim=1;k_dim<dim-1;++k_dim)
+        mesh_loaded.connectivity.push_back( triangle_index(polygon[0],polygon[k_dim],polygon[k_dim+1]) );
+    }
 
-          if(it_vertex==map_vertex.end() || it_texture==map_texture.end())
-          {
-            map_vertex[idx_vertex]=counter_max;
-            map_texture[idx_texture]=counter_max;
+    return mesh_loaded;
+
+  }
 
-            counter_max++;
 
-            assert(static_cast<int>(obj.data_vertex.size())>idx_vertex);
-            assert(static_cast<int>(obj.data_texture.size())>idx_texture);
 
-            mesh_loaded.vertex.push_back( vertex_opengl(obj.data_vertex[idx_vertex],vec3(),vec3(),obj.data_texture[idx_texture]) );
+  namespace
+  {
+    /** State kept between the windows of a streamed obj file.
+     *
+     *  Faces may use any attribute read before them, so positions, texture
+     *  coordinates and normals are kept (packed, 8 to 12 bytes each), as well
+     *  as the mesh vertex of each corner already emitted. Faces, text and
+     *  finalized vertices are only held for the current window.
+     */
+    class obj_stream
+    {
+    public:
+      obj_stream():table(0),nb_vertex(0) {}
+
+      /** Parse the complete lines of [p,end[ into the current batch */
+      void parse(const char* p,const char* end,std::string const& filename)
+      {
+        while(p<end)
+        {
+          p=skip_blank(p,end);
+          if(p+1<end && p[0]=='v' && is_blank(p[1]))
+          {
+            vec3 v;
+            p=read_vec3(p+1,end,&v);
+            position.push_back(v);
+            position_vertex.push_back(-1);
+          }
+          else if(p+2<end && p[0]=='v' && p[1]=='t' && is_blank(p[2]))
+          {
+            vec2 t;
+            p=parse_float(skip_blank(p+2,end),end,&t.x);
+            p=parse_float(skip_blank(p,end),end,&t.y);
+            texture.push_back(t);
+          }
+          else if(p+2<end && p[0]=='v' && p[1]=='n' && is_blank(p[2]))
+          {
+            vec3 n;
+            p=read_vec3(p+2,end,&n);
+            normal.push_back(n);
+          }
+          else if(p+1<end && p[0]=='f' && is_blank(p[1]))
+            p=read_face(p+1,end,filename);
+          p=skip_line(p,end);
+        }
+      }
 
-            data_vertex.push_back(obj.data_vertex[idx_vertex]);
-            data_texture.push_back(obj.data_texture[idx_texture]);
+      /** Hand the vertices and triangles of the batch to the callback */
+      void flush(const obj_stream_callback& callback)
+      {
+        if(batch_vertex.empty() && batch_triangle.empty())
+          return;
+        callback(batch_vertex.empty() ? nullptr : &batch_vertex[0],batch_vertex.size(),
+                 batch_triangle.empty() ? nullptr : &batch_triangle[0],batch_triangle.size());
+        batch_vertex.clear();
+        batch_triangle.clear();
+      }
 
-            assert(static_cast<int>(data_vertex.size())==counter_max);
-            assert(static_cast<int>(data_texture.size())==counter_max);
+      /** Memory held by the state in bytes */
+      size_t memory() const
+      {
+        return position.capacity()*sizeof(vec3)+texture.capacity()*sizeof(vec2)+normal.capacity()*sizeof(vec3)+
+            position_vertex.capacity()*sizeof(int)+table.memory()+
+            batch_vertex.capacity()*sizeof(vertex_opengl)+batch_triangle.capacity()*sizeof(triangle_index);
+      }
+
+      size_t vertex_count() const { return nb_vertex; }
+
+    private:
+      /** Index of the mesh vertex of a corner, emitted at its first use */
+      int corner_vertex(int v,int vt,int vn)
+      {
+        if(vt<0 && vn<0)
+        {
+          int& index=position_vertex[v];
+          if(index<0)
+          {
+            index=nb_vertex++;
+            batch_vertex.push_back(vertex_opengl(position[v],vec3(),vec3(),vec2()));
           }
+          return index;
         }
 
-        int const index_0=map_vertex[face_vertex[0]];
-        for(int k_dim=1;k_dim<dim-1;++k_dim)
+        const int index=table.find_or_insert(v,vt,vn,nb_vertex);
+        if(index==nb_vertex)
         {
-          int const index_1=map_vertex[face_vertex[k_dim]];
-          int const index_2=map_vertex[face_vertex[k_dim+1]];
-          mesh_loaded.connectivity.push_back( triangle_index(index_0,index_1,index_2) );
+          ++nb_vertex;
+          batch_vertex.push_back(vertex_opengl(position[v],vn>=0 ? normal[vn] : vec3(),vec3(),vt>=0 ? texture[vt] : vec2()));
         }
+        return index;
+      }
 
+      const char* read_face(const char* p,const char* end,std::string const& filename)
+      {
+        const int N_position=position.size();
+        const int N_texture=texture.size();
+        const int N_normal=normal.size();
+        polygon.clear();
+        while(true)
+        {
+          p=skip_blank(p,end);
+          int value;
+          const char* next=parse_int(p,end,&value);
+          if(next==p)
+            break;
+          p=next;
+          const int v=resolve_index(value,N_position);
+          int vt=-1,vn=-1;
+          if(p<end && *p=='/')
+          {
+            ++p;
+            next=parse_int(p,end,&value);
+            if(next!=p)
+              vt=resolve_index(value,N_texture);
+            p=next;
+            if(p<end && *p=='/')
+            {
+              ++p;
+              next=parse_int(p,end,&value);
+              if(next!=p)
+                vn=resolve_index(value,N_normal);
+              p=next;
+            }
+          }
+          if(v<0 || v>=N_position || vt>=N_texture || vn>=N_normal || vt<-1 || vn<-1)
+            throw std::string("Index out of range in OBJ file "+filename);
+          polygon.push_back(corner_vertex(v,vt,vn));
+        }
+        for(size_t k=2;k<polygon.size();++k)
+          batch_triangle.push_back(triangle_index(polygon[0],polygon[k-1],polygon[k]));
+        return p;
       }
-    }
 
+      std::vector<vec3> position;
+      std::vector<vec2> texture;
+      std::vector<vec3> normal;
+      std::vector<int> position_vertex;
+      corner_table table;
+      int nb_vertex;
+
+      std::vector<int> polygon;
+      std::vector<vertex_opengl> batch_vertex;
+      std::vector<triangle_index> batch_triangle;
+    };
+  }
 
+  obj_stream_stats stream_mesh_file_obj(std::string const& filename,const obj_stream_callback& callback,size_t window_size)
+  {
+    std::ifstream fid(filename.c_str(),std::ios::binary);
+    if(!fid.good())
+      throw std::string("Cannot open file "+filename);
 
-    return mesh_loaded;
+    obj_stream stream;
+    obj_stream_stats stats={0,0,0};
+    std::vector<char> window(std::max<size_t>(window_size,1024));
+    size_t carry=0;
+    bool eof=false;
+    while(!eof)
+    {
+      fid.read(&window[carry],window.size()-carry);
+      const size_t size=carry+static_cast<size_t>(fid.gcount());
+      eof=!fid.good();
+
+      //only complete lines are parsed, the last partial line moves to the next window
+      const char* const begin=&window[0];
+      const char* const end=begin+size;
+      const char* last=end;
+      if(!eof)
+      {
+        while(last>begin && last[-1]!='\n')
+          --last;
+        if(last==begin)
+        {
+          //a single line longer than the window
+          carry=size;
+          window.resize(2*window.size());
+          continue;
+        }
+      }
+
+      stream.parse(begin,last,filename);
+      stats.peak_memory=std::max(stats.peak_memory,stream.memory()+window.capacity());
+      stream.flush([&stats,&callback](const vertex_opengl* vertex,size_t N_vertex,const triangle_index* triangle,size_t N_triangle) {
+        stats.nb_triangle+=N_triangle;
+        callback(vertex,N_vertex,triangle,N_triangle);
+      });
 
+      carry=end-last;
+      std::memmove(&window[0],last,carry);
+    }
+    stats.nb_vertex=stream.vertex_count();
+    return stats;
   }
 
 }
-
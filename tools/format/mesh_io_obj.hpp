@@ -21,9 +21,14 @@
 #ifndef MESH_IO_OBJ_HPP
 #define MESH_IO_OBJ_HPP
 
+#include <cstddef>
+#include <functional>
+#include <string>
 #include <vector>
 #include "../vec3.hpp"
 #include "../vec2.hpp"
+#include "../vertex_opengl.hpp"
+#include "../triangle_index.hpp"
 
 class mesh;
 
@@ -32,8 +37,36 @@ namespace cpe
 
 
 
-  /** Load a mesh structure from a OFF file */
+  struct obj_structure;
+
+  /** Load a mesh structure from a OBJ file */
   mesh load_mesh_file_obj(std::string const& filename);
+  /** Load a mesh structure from OBJ text held in memory (ex. a pack entry) */
+  mesh load_mesh_memory_obj(const char* data,size_t size);
+  /** Build a mesh with one vertex per distinct (v,vt,vn) corner of an obj structure
+   *  (throws a std::string when a face index is out of range) */
+  mesh mesh_from_obj_structure(const obj_structure& obj);
+
+  /** Receives the vertices and triangles finalized while streaming an OBJ file.
+   *  Triangle indices refer to all the vertices received so far, this batch included. */
+  typedef std::function<void(const vertex_opengl* vertex,size_t N_vertex,const triangle_index* triangle,size_t N_triangle)> obj_stream_callback;
+
+  struct obj_stream_stats
+  {
+    size_t nb_vertex;
+    size_t nb_triangle;
+    size_t peak_memory;  //largest memory held by the loader, in bytes
+  };
+
+  /** Stream an OBJ file through a window of window_size bytes.
+   *
+   *  After each window, the vertices emitted for new (v,vt,vn) corners and the
+   *  fan triangulated faces are handed to callback (ex. appended to a mapped
+   *  GPU buffer), then dropped. Neither the file nor the faces are ever fully
+   *  in memory: the loader only keeps the packed v/vt/vn attributes and the
+   *  corner to vertex map that later faces may refer to.
+   */
+  obj_stream_stats stream_mesh_file_obj(std::string const& filename,const obj_stream_callback& callback,size_t window_size=1024*1024);
 
 
   /** An obj structure following the definition of an obj file */
@@ -58,12 +91,15 @@ namespace cpe
    */
   std::vector<int> split_face_data(std::string const& face_data_str);
 
-  /** Read an obj file and return an obj structure. */
+  /** Read an obj file and return an obj structure.
+   *
+   *  The file is memory mapped and scanned in place; numbers are parsed
+   *  without locale nor temporary strings. Indices are stored 0-based,
+   *  negative (relative) indices are resolved.
+   */
   obj_structure load_file_obj_structure(std::string const& filename);
-
-
-  void read_vertex_obj(std::stringstream& tokens,obj_structure& obj);
-  void read_texture_obj(std::stringstream& tokens,obj_structure& obj);
+  /** Same as load_file_obj_structure on OBJ text held in memory */
+  obj_structure parse_obj_structure(const char* data,size_t size);
 
 
 }
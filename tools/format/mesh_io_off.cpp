@@ -17,98 +17,394 @@
  */
 
 #include "mesh_io_off.hpp"
+#include "parse_number.hpp"
 #include "../mesh.hpp"
+#include "../mapped_file.hpp"
+#include "../thread_pool.hpp"
 
-#include <iostream>
-#include <fstream>
-#include <sstream>
+#include <algorithm>
+#include <cstring>
 
 
 namespace cpe
 {
 
-  mesh load_mesh_file_off(std::string const& filename)
+  namespace
   {
-    mesh m;
+    enum off_error {off_ok=0,off_bad_number,off_bad_index};
 
-    std::vector<vec3> v_vertices;
-    std::vector<int> v_connectivity;
+    /** Vertex layout given by the header keyword [ST][C][N][4]OFF [BINARY] */
+    struct off_format
+    {
+      bool texture;
+      bool color;
+      bool normal;
+      bool homogeneous;
+      bool binary;
+    };
 
-    std::ifstream fid(filename.c_str());
-    if(!fid.good())
-      throw std::string("Cannot open file "+filename);
+    /** Start of the next line holding data (skipping blank and comment lines), or end */
+    const char* next_data_line(const char* p,const char* end)
+    {
+      while(p<end)
+      {
+        const char* q=skip_blank(p,end);
+        if(q<end && *q!='\n' && *q!='#')
+          return q;
+        p=skip_line(q,end);
+      }
+      return end;
+    }
 
-    std::string buffer;
+    /** Number of data lines in [begin,end[ */
+    int count_data_lines(const char* begin,const char* end)
+    {
+      int N=0;
+      for(const char* p=next_data_line(begin,end);p<end;p=next_data_line(skip_line(p,end),end))
+        ++N;
+      return N;
+    }
 
-    //find OFF header
-    bool find_off=false;
-    while(find_off==false)
+    /** Colors given as integers in [0,255] are brought back to [0,1] */
+    vec3 normalize_color(const vec3& c)
     {
-      if(!fid.good())
-        throw std::string("Cannot find OFF header in file "+filename);
-      std::getline(fid,buffer);
-      if(buffer.find("OFF")!=std::string::npos)
-        find_off=true;
+      if(c.x>1.0f || c.y>1.0f || c.z>1.0f)
+        return vec3(c.x/255.0f,c.y/255.0f,c.z/255.0f);
+      return c;
     }
 
-    //read number of vertices + triangles
-    int N_vertex=0,N_triangle=0;
-    std::getline(fid,buffer);
-    std::stringstream tokens(buffer);
-    tokens>>N_vertex>>N_triangle;
+    /** Parse one ascii vertex line, returns nullptr on error */
+    const char* parse_vertex(const char* p,const char* end,const off_format& format,vertex_opengl* v)
+    {
+      float value[14];
+      int N=format.homogeneous ? 4 : 3;
+      if(format.normal)  N+=3;
+      if(format.color)   N+=4;
+      if(format.texture) N+=2;
+
+      const char* eol=static_cast<const char*>(std::memchr(p,'\n',end-p));
+      if(eol==nullptr)
+        eol=end;
+      int k=0;
+      for(;k<N;++k)
+      {
+        p=skip_blank(p,eol);
+        const char* q=parse_float(p,eol,&value[k]);
+        if(q==p)
+          break;
+        p=q;
+      }
 
+      int mandatory=N;
+      if(format.color && !format.texture) mandatory-=1;  //alpha is optional
+      if(k<mandatory)
+        return nullptr;
 
-    //read vertices
-    for(int k=0;k<N_vertex;++k)
+      int i=0;
+      vec3 position(value[0],value[1],value[2]);
+      i=3;
+      if(format.homogeneous)
+      {
+        if(value[3]!=0.0f)
+          position/=value[3];
+        i=4;
+      }
+      *v=vertex_opengl(position,vec3(),vec3(),vec2());
+      if(format.normal)
+      {
+        v->normal=vec3(value[i],value[i+1],value[i+2]);
+        i+=3;
+      }
+      if(format.color)
+      {
+        v->color=normalize_color(vec3(value[i],value[i+1],value[i+2]));
+        i+=4;
+      }
+      if(format.texture)
+        v->texture=vec2(value[i],value[i+1]);
+      return p;
+    }
+
+    /** Parse the data lines of [begin,end[, the first one having the global index first_line.
+     *
+     *  Vertices are written in place. Faces are written in place too assuming they
+     *  are all triangles (one triangle per face line); the number of triangles of
+     *  the range is returned so that polygons can be handled by a second pass.
+     */
+    off_error parse_off_range(const char* begin,const char* end,int first_line,int N_vertex,int N_face,const off_format& format,
+                              mesh& m,size_t* nb_triangle,bool* polygon)
     {
-      std::getline(fid,buffer);
-      if(buffer.size()>0 && buffer[0]=='#') {--k; continue;}
+      *nb_triangle=0;
+      *polygon=false;
+      int line=first_line;
+      for(const char* p=next_data_line(begin,end);p<end && line<N_vertex+N_face;p=next_data_line(skip_line(p,end),end),++line)
+      {
+        if(line<N_vertex)
+        {
+          if(parse_vertex(p,end,format,&m.vertex[line])==nullptr)
+            return off_bad_number;
+          continue;
+        }
 
-      vec3 p;
-      std::stringstream tokens_vertices(buffer);
-      tokens_vertices>>p.x>>p.y>>p.z;
+        int size;
+        const char* q=parse_int(p,end,&size);
+        if(q==p || size<0)
+          return off_bad_number;
+        if(size!=3)
+        {
+          *polygon=true;
+          *nb_triangle+=size>2 ? size-2 : 0;
+          continue;
+        }
+        int u[3];
+        for(int k=0;k<3;++k)
+        {
+          p=skip_blank(q,end);
+          q=parse_int(p,end,&u[k]);
+          if(q==p) return off_bad_number;
+          if(u[k]<0 || u[k]>=N_vertex) return off_bad_index;
+        }
+        m.connectivity[line-N_vertex]=triangle_index(u[0],u[1],u[2]);
+        ++(*nb_triangle);
+      }
+      return off_ok;
+    }
 
-      v_vertices.push_back(p);
+    /** Second pass when some faces are polygons: fan triangulation of the faces of [begin,end[ from triangle first_triangle */
+    off_error fill_off_polygons(const char* begin,const char* end,int first_line,int N_vertex,int N_face,size_t first_triangle,mesh& m)
+    {
+      std::vector<int> u;
+      size_t t=first_triangle;
+      int line=first_line;
+      for(const char* p=next_data_line(begin,end);p<end && line<N_vertex+N_face;p=next_data_line(skip_line(p,end),end),++line)
+      {
+        if(line<N_vertex)
+          continue;
+        int size;
+        const char* q=parse_int(p,end,&size);
+        if(q==p || size<0)
+          return off_bad_number;
+        u.resize(size);
+        for(int k=0;k<size;++k)
+        {
+          p=skip_blank(q,end);
+          q=parse_int(p,end,&u[k]);
+          if(q==p) return off_bad_number;
+          if(u[k]<0 || u[k]>=N_vertex) return off_bad_index;
+        }
+        for(int k=2;k<size;++k)
+          m.connectivity[t++]=triangle_index(u[0],u[k-1],u[k]);
+      }
+      return off_ok;
     }
 
-    //read connectivity
-    for(int k=0;k<N_triangle;++k)
+    void throw_off_error(off_error error,std::string const& filename)
     {
-      std::getline(fid,buffer);
-      if(buffer.size()>0 && buffer[0]=='#') {--k; continue;}
+      if(error==off_bad_number)
+        throw std::string("Cannot read number in OFF file "+filename);
+      if(error==off_bad_index)
+        throw std::string("Vertex index out of range in OFF file "+filename);
+    }
 
-      int N_size,u0,u1,u2;
-      std::stringstream tokens_connectivity(buffer);
-      tokens_connectivity>>N_size>>u0>>u1>>u2;
+    /** Binary OFF: big endian int32 and float32 values after the header line */
+    class off_binary_reader
+    {
+    public:
+      off_binary_reader(const char* p,const char* end):p(reinterpret_cast<const unsigned char*>(p)),end(reinterpret_cast<const unsigned char*>(end)) {}
 
+      bool remaining(size_t nb_value) const { return static_cast<size_t>(end-p)/4>=nb_value; }
+      unsigned int next_u32()
+      {
+        const unsigned int v=(p[0]<<24) | (p[1]<<16) | (p[2]<<8) | p[3];
+        p+=4;
+        return v;
+      }
+      int next_int() { const unsigned int u=next_u32(); int v; std::memcpy(&v,&u,4); return v; }
+      float next_float() { const unsigned int u=next_u32(); float v; std::memcpy(&v,&u,4); return v; }
 
-      if(N_size!=3)
-        throw std::string("Cannot read OFF with non triangular faces for file "+filename);
+    private:
+      const unsigned char* p;
+      const unsigned char* end;
+    };
 
-      v_connectivity.push_back(u0);v_connectivity.push_back(u1);v_connectivity.push_back(u2);
-    }
+    mesh parse_off_binary(const char* p,const char* end,const off_format& format,std::string const& filename)
+    {
+      off_binary_reader reader(p,end);
+      if(!reader.remaining(3))
+        throw std::string("Problem with size of connectivity in file "+filename);
+      const int N_vertex=reader.next_int();
+      const int N_face=reader.next_int();
+      reader.next_int();  //number of edges
+      if(N_vertex<0 || N_face<0)
+        throw std::string("Problem with size of connectivity in file "+filename);
 
-    fid.close();
+      int N_value=format.homogeneous ? 4 : 3;
+      if(format.normal)  N_value+=3;
+      if(format.color)   N_value+=4;
+      if(format.texture) N_value+=2;
+      if(!reader.remaining(static_cast<size_t>(N_vertex)*N_value))
+        throw std::string("Truncated vertex data in OFF file "+filename);
 
-    if(v_connectivity.size()%3!=0)
-      throw std::string("Problem with size of connectivity in file "+filename);
+      mesh m;
+      m.vertex.resize(N_vertex);
+      for(int k=0;k<N_vertex;++k)
+      {
+        float value[13];
+        for(int i=0;i<N_value;++i)
+          value[i]=reader.next_float();
+        vertex_opengl& v=m.vertex[k];
+        v=vertex_opengl(vec3(value[0],value[1],value[2]),vec3(),vec3(),vec2());
+        int i=3;
+        if(format.homogeneous) { if(value[3]!=0.0f) v.position/=value[3]; i=4; }
+        if(format.normal)      { v.normal=vec3(value[i],value[i+1],value[i+2]); i+=3; }
+        if(format.color)       { v.color=normalize_color(vec3(value[i],value[i+1],value[i+2])); i+=4; }
+        if(format.texture)     v.texture=vec2(value[i],value[i+1]);
+      }
 
-    for(int k=0,N=v_connectivity.size()/3;k<N;++k)
+      //faces: size, indices, then a number of color components to skip
+      m.connectivity.reserve(N_face);
+      for(int k=0;k<N_face;++k)
+      {
+        if(!reader.remaining(1))
+          throw std::string("Truncated face data in OFF file "+filename);
+        const int size=reader.next_int();
+        if(size<0 || !reader.remaining(static_cast<size_t>(size)+1))
+          throw std::string("Truncated face data in OFF file "+filename);
+        int u0=0,u_prev=0;
+        for(int i=0;i<size;++i)
+        {
+          const int u=reader.next_int();
+          if(u<0 || u>=N_vertex)
+            throw std::string("Vertex index out of range in OFF file "+filename);
+          if(i==0)     u0=u;
+          else if(i>1) m.connectivity.push_back(triangle_index(u0,u_prev,u));
+          u_prev=u;
+        }
+        const int N_color=reader.next_int();
+        if(N_color<0 || !reader.remaining(N_color))
+          throw std::string("Truncated face data in OFF file "+filename);
+        for(int i=0;i<N_color;++i)
+          reader.next_u32();
+      }
+      return m;
+    }
+
+    mesh parse_off(const char* data,size_t size,std::string const& filename)
     {
-      int const u0=v_connectivity[3*k+0];
-      int const u1=v_connectivity[3*k+1];
-      int const u2=v_connectivity[3*k+2];
+      mesh m;
+
+      const char* const begin=data;
+      const char* const end=begin+size;
+
+      //find the OFF keyword and its [ST][C][N][4] prefix
+      const char* p=begin;
+      const char* keyword=nullptr;
+      while(keyword==nullptr)
+      {
+        if(p>=end)
+          throw std::string("Cannot find OFF header in file "+filename);
+        const char* eol=skip_line(p,end);
+        for(const char* q=p;q+2<eol && keyword==nullptr;++q)
+          if(q[0]=='O' && q[1]=='F' && q[2]=='F')
+            keyword=q;
+        if(keyword==nullptr)
+          p=eol;
+      }
+      const char* word=keyword;
+      while(word>p && !is_blank(word[-1]))
+        --word;
+      const std::string prefix(word,keyword);
+      off_format format={false,false,false,false,false};
+      for(unsigned int k=0;k<prefix.size();++k)
+      {
+        const char c=prefix[k];
+        if(c=='S' || c=='T')  format.texture=true;
+        else if(c=='C')       format.color=true;
+        else if(c=='N')       format.normal=true;
+        else if(c=='4')       format.homogeneous=true;
+        else
+          throw std::string("Unsupported OFF variant "+prefix+"OFF in file "+filename);
+      }
+      p=skip_blank(keyword+3,end);
+      if(end-p>=6 && std::strncmp(p,"BINARY",6)==0)
+      {
+        format.binary=true;
+        return parse_off_binary(skip_line(p,end),end,format,filename);
+      }
+
+      //read number of vertices + faces (possibly on the header line)
+      int N_vertex=0,N_face=0;
+      if(p>=end || *p=='\n' || *p=='#')
+        p=next_data_line(p,end);
+      p=parse_int(p,end,&N_vertex);
+      p=parse_int(skip_blank(p,end),end,&N_face);
+      if(N_vertex<0 || N_face<0)
+        throw std::string("Problem with size of connectivity in file "+filename);
+      p=skip_line(p,end);
+
+      m.vertex.resize(N_vertex);
+      m.connectivity.resize(N_face);
+
+      //chunks are cut at line boundaries: a first pass counts the data lines of each chunk
+      // so that every chunk knows the global index of its first line, a second pass fills the mesh in place
+      const std::vector<const char*> bounds=split_lines(p,end,default_thread_pool().size()+1);
+      const int N_chunk=bounds.size()-1;
+      std::vector<int> first_line(N_chunk+1,0);
+      parallel_for(0,N_chunk,1,[&bounds,&first_line](int k_begin,int k_end) {
+        for(int k=k_begin;k<k_end;++k)
+          first_line[k+1]=count_data_lines(bounds[k],bounds[k+1]);
+      });
+      for(int k=0;k<N_chunk;++k)
+        first_line[k+1]+=first_line[k];
+      if(first_line[N_chunk]<N_vertex+N_face)
+        throw std::string("Problem with size of connectivity in file "+filename);
+
+      std::vector<int> error(N_chunk,off_ok);
+      std::vector<size_t> first_triangle(N_chunk+1,0);
+      std::vector<char> polygon(N_chunk,0);
+      parallel_for(0,N_chunk,1,[&](int k_begin,int k_end) {
+        for(int k=k_begin;k<k_end;++k)
+        {
+          bool has_polygon=false;
+          error[k]=parse_off_range(bounds[k],bounds[k+1],first_line[k],N_vertex,N_face,format,m,&first_triangle[k+1],&has_polygon);
+          polygon[k]=has_polygon;
+        }
+      });
+      for(int k=0;k<N_chunk;++k)
+        throw_off_error(static_cast<off_error>(error[k]),filename);
+
+      //faces that are not triangles: the exact number of triangles is now known, faces are filled again
+      if(std::find(polygon.begin(),polygon.end(),1)!=polygon.end())
+      {
+        for(int k=0;k<N_chunk;++k)
+          first_triangle[k+1]+=first_triangle[k];
+        m.connectivity.resize(first_triangle[N_chunk]);
+        parallel_for(0,N_chunk,1,[&](int k_begin,int k_end) {
+          for(int k=k_begin;k<k_end;++k)
+            error[k]=fill_off_polygons(bounds[k],bounds[k+1],first_line[k],N_vertex,N_face,first_triangle[k],m);
+        });
+        for(int k=0;k<N_chunk;++k)
+          throw_off_error(static_cast<off_error>(error[k]),filename);
+      }
 
-      m.connectivity.push_back( triangle_index(u0,u1,u2) );
+      return m;
     }
-    for(int k=0,N=v_vertices.size();k<N;++k)
-      m.vertex.push_back( vertex_opengl(v_vertices[k],vec3(),vec3(),vec2()) );
+  }
+
+  mesh load_mesh_file_off(std::string const& filename)
+  {
+    mapped_file file(filename);
+    if(!file.is_open())
+      throw std::string("Cannot open file "+filename);
 
+    return parse_off(file.data(),file.size(),filename);
+  }
 
-    return m;
+  mesh load_mesh_memory_off(const char* data,size_t size)
+  {
+    return parse_off(data,size,"(memory)");
   }
 
 
 
 }
-
@@ -21,6 +21,7 @@
 #ifndef MESH_IO_OFF_HPP
 #define MESH_IO_OFF_HPP
 
+#include <cstddef>
 #include <string>
 
 class mesh;
@@ -28,8 +29,16 @@ class mesh;
 namespace cpe
 {
 
-  /** Load a mesh structure from a OFF file */
+  /** Load a mesh structure from a OFF file.
+   *
+   *  The [ST][C][N][4]OFF variants are read in ascii and binary form: texture
+   *  coordinates, colors (floats or 0-255 integers) and normals go to the
+   *  vertex attributes, homogeneous coordinates are divided by w. Polygonal
+   *  faces are triangulated as fans.
+   */
   mesh load_mesh_file_off(std::string const& filename);
+  /** Load a mesh structure from OFF text held in memory (ex. a pack entry) */
+  mesh load_mesh_memory_off(const char* data,size_t size);
 
 }
 
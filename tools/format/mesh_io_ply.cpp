@@ -0,0 +1,473 @@
+/*
+ **    TP CPE Lyon
+ **    Copyright (C) 2015 Damien Rohmer
+ **
+ **    This program is free software: you can redistribute it and/or modify
+ **    it under the terms of the GNU General Public License as published by
+ **    the Free Software Foundation, either version 3 of the License, or
+ **    (at your option) any later version.
+ **
+ **   This program is distributed in the hope that it will be useful,
+ **    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ **    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ **    GNU General Public License for more details.
+ **
+ **    You should have received a copy of the GNU General Public License
+ **    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "mesh_io_ply.hpp"
+#include "parse_number.hpp"
+#include "../mesh.hpp"
+#include "../mapped_file.hpp"
+#include "../thread_pool.hpp"
+
+#include <cstring>
+#include <vector>
+
+
+namespace cpe
+{
+
+  namespace
+  {
+    enum ply_format {ply_ascii,ply_binary_little_endian,ply_binary_big_endian};
+    enum ply_type {ply_int8,ply_uint8,ply_int16,ply_uint16,ply_int32,ply_uint32,ply_float32,ply_float64,ply_invalid};
+
+    /** Destination of a vertex property in vertex_opengl */
+    enum ply_target {target_none=-1,target_x,target_y,target_z,target_nx,target_ny,target_nz,
+                     target_red,target_green,target_blue,target_s,target_t};
+
+    struct ply_property
+    {
+      std::string name;
+      ply_type type;
+      bool is_list;
+      ply_type count_type;
+      int target;
+    };
+
+    struct ply_element
+    {
+      std::string name;
+      size_t count;
+      std::vector<ply_property> properties;
+    };
+
+    int type_size(ply_type type)
+    {
+      static const int size[]={1,1,2,2,4,4,4,8};
+      return size[type];
+    }
+
+    ply_type parse_type(const std::string& name)
+    {
+      if(name=="char"   || name=="int8")    return ply_int8;
+      if(name=="uchar"  || name=="uint8")   return ply_uint8;
+      if(name=="short"  || name=="int16")   return ply_int16;
+      if(name=="ushort" || name=="uint16")  return ply_uint16;
+      if(name=="int"    || name=="int32")   return ply_int32;
+      if(name=="uint"   || name=="uint32")  return ply_uint32;
+      if(name=="float"  || name=="float32") return ply_float32;
+      if(name=="double" || name=="float64") return ply_float64;
+      return ply_invalid;
+    }
+
+    int parse_target(const std::string& name)
+    {
+      static const char* names[]={"x","y","z","nx","ny","nz","red","green","blue","s","t"};
+      for(int k=0;k<11;++k)
+        if(name==names[k])
+          return k;
+      if(name=="u" || name=="texture_u") return target_s;
+      if(name=="v" || name=="texture_v") return target_t;
+      return target_none;
+    }
+
+    /** Read one binary value, converted to double (swap bytes for big endian data) */
+    double read_binary(const unsigned char* p,ply_type type,bool swap)
+    {
+      unsigned char b[8];
+      const int n=type_size(type);
+      if(swap) for(int k=0;k<n;++k) b[k]=p[n-1-k];
+      else     std::memcpy(b,p,n);
+
+      switch(type)
+      {
+        case ply_int8:    { signed char v; std::memcpy(&v,b,1); return v; }
+        case ply_uint8:   return b[0];
+        case ply_int16:   { short v; std::memcpy(&v,b,2); return v; }
+        case ply_uint16:  { unsigned short v; std::memcpy(&v,b,2); return v; }
+        case ply_int32:   { int v; std::memcpy(&v,b,4); return v; }
+        case ply_uint32:  { unsigned int v; std::memcpy(&v,b,4); return v; }
+        case ply_float32: { float v; std::memcpy(&v,b,4); return v; }
+        case ply_float64: { double v; std::memcpy(&v,b,8); return v; }
+        default:          return 0.0;
+      }
+    }
+
+    /** Store a vertex property; integer colors are normalized to [0,1] */
+    void store_property(vertex_opengl& v,int target,ply_type type,double value)
+    {
+      float* const fields[]={&v.position.x,&v.position.y,&v.position.z,&v.normal.x,&v.normal.y,&v.normal.z,
+                             &v.color.x,&v.color.y,&v.color.z,&v.texture.x,&v.texture.y};
+      if(target>=target_red && target<=target_blue && type==ply_uint8)
+        value/=255.0;
+      *fields[target]=static_cast<float>(value);
+    }
+
+    /** Vertex index read as a double; negative, too large or NaN values give an index that the
+     *  final range check of parse_ply rejects, instead of an undefined conversion */
+    unsigned int to_index(double value)
+    {
+      return value>=0.0 && value<4294967295.0 ? static_cast<unsigned int>(value) : 0xFFFFFFFFu;
+    }
+
+    bool is_face_indices(const ply_property& p)
+    {
+      return p.is_list && (p.name=="vertex_indices" || p.name=="vertex_index");
+    }
+
+    void push_polygon(mesh& m,const unsigned int* index,int size)
+    {
+      for(int k=2;k<size;++k)
+        m.connectivity.push_back(triangle_index(index[0],index[k-1],index[k]));
+    }
+
+    /** Read the header, returns the position of the data */
+    const char* read_header(const char* begin,const char* end,ply_format* format,std::vector<ply_element>* elements,std::string const& filename)
+    {
+      const char* p=begin;
+      if(end-p<3 || std::strncmp(p,"ply",3)!=0)
+        throw std::string("Cannot find PLY header in file "+filename);
+
+      bool has_format=false;
+      while(true)
+      {
+        p=skip_line(p,end);
+        if(p>=end)
+          throw std::string("Cannot find end_header in PLY file "+filename);
+
+        //split the line in words
+        const char* eol=p;
+        while(eol<end && *eol!='\n') ++eol;
+        std::vector<std::string> words;
+        for(const char* q=skip_blank(p,eol);q<eol;q=skip_blank(q,eol))
+        {
+          const char* w=q;
+          while(q<eol && !is_blank(*q)) ++q;
+          words.push_back(std::string(w,q));
+        }
+        if(words.empty() || words[0]=="comment" || words[0]=="obj_info")
+          continue;
+
+        if(words[0]=="end_header")
+          break;
+        if(words[0]=="format" && words.size()>=2)
+        {
+          if(words[1]=="ascii")                     *format=ply_ascii;
+          else if(words[1]=="binary_little_endian") *format=ply_binary_little_endian;
+          else if(words[1]=="binary_big_endian")    *format=ply_binary_big_endian;
+          else throw std::string("Unknown PLY format in file "+filename);
+          has_format=true;
+        }
+        else if(words[0]=="element" && words.size()>=3)
+        {
+          ply_element e;
+          e.name=words[1];
+          e.count=std::strtoull(words[2].c_str(),nullptr,10);
+          elements->push_back(e);
+        }
+        else if(words[0]=="property" && !elements->empty())
+        {
+          ply_property prop;
+          prop.is_list=words.size()>=5 && words[1]=="list";
+          if(prop.is_list)
+          {
+            prop.count_type=parse_type(words[2]);
+            prop.type=parse_type(words[3]);
+            prop.name=words[4];
+          }
+          else if(words.size()>=3)
+          {
+            prop.count_type=ply_invalid;
+            prop.type=parse_type(words[1]);
+            prop.name=words[2];
+          }
+          else
+            throw std::string("Invalid property in PLY file "+filename);
+          if(prop.type==ply_invalid || (prop.is_list && prop.count_type==ply_invalid))
+            throw std::string("Unknown property type in PLY file "+filename);
+          prop.target=prop.is_list ? target_none : parse_target(prop.name);
+          elements->back().properties.push_back(prop);
+        }
+      }
+      if(!has_format)
+        throw std::string("Missing format in PLY file "+filename);
+      return skip_line(p,end);
+    }
+
+    /** Size in bytes of one record of an element without list property, 0 otherwise */
+    size_t fixed_record_size(const ply_element& e)
+    {
+      size_t size=0;
+      for(unsigned int k=0;k<e.properties.size();++k)
+      {
+        if(e.properties[k].is_list)
+          return 0;
+        size+=type_size(e.properties[k].type);
+      }
+      return size;
+    }
+
+    /** Binary vertices: fixed stride, decoded in parallel straight into the mesh */
+    const char* read_binary_vertices(const char* p,const char* end,const ply_element& e,bool swap,mesh& m,std::string const& filename)
+    {
+      const size_t stride=fixed_record_size(e);
+      if(stride==0)
+        throw std::string("List properties on vertices are not supported in PLY file "+filename);
+      if(static_cast<size_t>(end-p)/stride<e.count)
+        throw std::string("Truncated vertex data in PLY file "+filename);
+
+      std::vector<size_t> offset(e.properties.size());
+      for(unsigned int k=1;k<e.properties.size();++k)
+        offset[k]=offset[k-1]+type_size(e.properties[k-1].type);
+
+      //common case: x,y,z as consecutive little endian floats
+      const bool xyz_float=!swap && e.properties.size()>=3 && e.properties[0].target==target_x &&
+          e.properties[1].target==target_y && e.properties[2].target==target_z &&
+          e.properties[0].type==ply_float32 && e.properties[1].type==ply_float32 && e.properties[2].type==ply_float32;
+
+      m.vertex.resize(e.count);
+      const unsigned char* data=reinterpret_cast<const unsigned char*>(p);
+      parallel_for(0,static_cast<int>(e.count),4096,[&](int k_begin,int k_end) {
+        for(int k=k_begin;k<k_end;++k)
+        {
+          const unsigned char* record=data+k*stride;
+          vertex_opengl& v=m.vertex[k];
+          unsigned int first=0;
+          if(xyz_float)
+          {
+            std::memcpy(&v.position,record,3*sizeof(float));
+            first=3;
+          }
+          for(unsigned int i=first;i<e.properties.size();++i)
+            if(e.properties[i].target!=target_none)
+              store_property(v,e.properties[i].target,e.properties[i].type,read_binary(record+offset[i],e.properties[i].type,swap));
+        }
+      });
+      return p+e.count*stride;
+    }
+
+    /** Binary faces. Triangle-only files whose face records are just the index list are decoded in parallel */
+    const char* read_binary_faces(const char* p,const char* end,const ply_element& e,bool swap,mesh& m,std::string const& filename)
+    {
+      const unsigned char* data=reinterpret_cast<const unsigned char*>(p);
+      const unsigned char* const data_end=reinterpret_cast<const unsigned char*>(end);
+
+      if(e.properties.size()==1 && is_face_indices(e.properties[0]))
+      {
+        const ply_property& prop=e.properties[0];
+        const size_t size_count=type_size(prop.count_type);
+        const size_t size_index=type_size(prop.type);
+        const size_t stride=size_count+3*size_index;
+        bool triangles=static_cast<size_t>(data_end-data)/stride>=e.count;
+        for(size_t k=0;triangles && k<e.count;++k)
+          triangles=read_binary(data+k*stride,prop.count_type,swap)==3.0;
+
+        if(triangles)
+        {
+          const size_t offset=m.connectivity.size();
+          m.connectivity.resize(offset+e.count);
+          parallel_for(0,static_cast<int>(e.count),4096,[&](int k_begin,int k_end) {
+            for(int k=k_begin;k<k_end;++k)
+            {
+              const unsigned char* record=data+k*stride+size_count;
+              m.connectivity[offset+k]=triangle_index(
+                  to_index(read_binary(record,prop.type,swap)),
+                  to_index(read_binary(record+size_index,prop.type,swap)),
+                  to_index(read_binary(record+2*size_index,prop.type,swap)));
+            }
+          });
+          return p+e.count*stride;
+        }
+      }
+
+      //general case: any number of properties, polygons of any size
+      std::vector<unsigned int> polygon;
+      for(size_t k=0;k<e.count;++k)
+      {
+        for(unsigned int i=0;i<e.properties.size();++i)
+        {
+          const ply_property& prop=e.properties[i];
+          if(!prop.is_list)
+          {
+            if(data_end-data<type_size(prop.type))
+              throw std::string("Truncated face data in PLY file "+filename);
+            data+=type_size(prop.type);
+            continue;
+          }
+          if(data_end-data<type_size(prop.count_type))
+            throw std::string("Truncated face data in PLY file "+filename);
+          const size_t count=static_cast<size_t>(read_binary(data,prop.count_type,swap));
+          data+=type_size(prop.count_type);
+          if(static_cast<size_t>(data_end-data)<count*type_size(prop.type))
+            throw std::string("Truncated face data in PLY file "+filename);
+          if(is_face_indices(prop))
+          {
+            polygon.resize(count);
+            for(size_t j=0;j<count;++j)
+              polygon[j]=to_index(read_binary(data+j*type_size(prop.type),prop.type,swap));
+            if(count>=3)
+              push_polygon(m,&polygon[0],count);
+          }
+          data+=count*type_size(prop.type);
+        }
+      }
+      return reinterpret_cast<const char*>(data);
+    }
+
+    /** Binary element that is not used: skipped */
+    const char* skip_binary_element(const char* p,const char* end,const ply_element& e,bool swap,std::string const& filename)
+    {
+      if(e.properties.empty())
+        return p;
+      const size_t stride=fixed_record_size(e);
+      if(stride>0)
+      {
+        if(static_cast<size_t>(end-p)/stride<e.count)
+          throw std::string("Truncated data in PLY file "+filename);
+        return p+e.count*stride;
+      }
+
+      //data never goes past end, so that end-data stays positive for the following elements
+      const unsigned char* data=reinterpret_cast<const unsigned char*>(p);
+      const unsigned char* const data_end=reinterpret_cast<const unsigned char*>(end);
+      for(size_t k=0;k<e.count;++k)
+        for(unsigned int i=0;i<e.properties.size();++i)
+        {
+          const ply_property& prop=e.properties[i];
+          size_t size=type_size(prop.is_list ? prop.count_type : prop.type);
+          if(static_cast<size_t>(data_end-data)<size)
+            throw std::string("Truncated data in PLY file "+filename);
+          if(prop.is_list)
+          {
+            const size_t count=static_cast<size_t>(read_binary(data,prop.count_type,swap));
+            data+=size;
+            size=count*type_size(prop.type);
+            if(static_cast<size_t>(data_end-data)<size)
+              throw std::string("Truncated data in PLY file "+filename);
+          }
+          data+=size;
+        }
+      return reinterpret_cast<const char*>(data);
+    }
+
+    const char* read_ascii_value(const char* p,const char* end,double* value,std::string const& filename)
+    {
+      float v;
+      p=skip_blank(p,end);
+      while(p<end && *p=='\n') p=skip_blank(p+1,end);
+      const char* q=parse_float(p,end,&v);
+      if(q==p)
+        throw std::string("Cannot read number in PLY file "+filename);
+      *value=v;
+      return q;
+    }
+
+    /** Upper bound on the number of ASCII values left: each one takes a digit and a separator */
+    size_t max_ascii_values(const char* p,const char* end)
+    {
+      return (static_cast<size_t>(end-p)+1)/2;
+    }
+
+    const char* read_ascii_element(const char* p,const char* end,const ply_element& e,int kind,mesh& m,std::string const& filename)
+    {
+      //the counts of the header and of the lists are checked against the data before any allocation
+      const size_t nb_value=e.properties.empty() ? 1 : e.properties.size();
+      if(e.count>max_ascii_values(p,end)/nb_value)
+        throw std::string("Element count larger than the data in PLY file "+filename);
+      if(kind==0)
+        m.vertex.resize(e.count);
+      std::vector<unsigned int> polygon;
+      for(size_t k=0;k<e.count;++k)
+      {
+        for(unsigned int i=0;i<e.properties.size();++i)
+        {
+          const ply_property& prop=e.properties[i];
+          double value;
+          if(!prop.is_list)
+          {
+            p=read_ascii_value(p,end,&value,filename);
+            if(kind==0 && prop.target!=target_none)
+              store_property(m.vertex[k],prop.target,prop.type,value);
+            continue;
+          }
+          p=read_ascii_value(p,end,&value,filename);
+          if(!(value>=0.0 && value<=static_cast<double>(max_ascii_values(p,end))))
+            throw std::string("Invalid list size in PLY file "+filename);
+          const size_t count=static_cast<size_t>(value);
+          polygon.resize(count);
+          for(size_t j=0;j<count;++j)
+          {
+            p=read_ascii_value(p,end,&value,filename);
+            polygon[j]=to_index(value);
+          }
+          if(kind==1 && is_face_indices(prop) && count>=3)
+            push_polygon(m,&polygon[0],count);
+        }
+      }
+      return p;
+    }
+
+    mesh parse_ply(const char* data,size_t size,std::string const& filename)
+    {
+      const char* const end=data+size;
+      ply_format format=ply_ascii;
+      std::vector<ply_element> elements;
+      const char* p=read_header(data,end,&format,&elements,filename);
+      const bool swap=format==ply_binary_big_endian;
+
+      mesh m;
+      for(unsigned int k=0;k<elements.size();++k)
+      {
+        const ply_element& e=elements[k];
+        const int kind=e.name=="vertex" ? 0 : (e.name=="face" ? 1 : 2);
+        if(format==ply_ascii)
+          p=read_ascii_element(p,end,e,kind,m,filename);
+        else if(kind==0)
+          p=read_binary_vertices(p,end,e,swap,m,filename);
+        else if(kind==1)
+          p=read_binary_faces(p,end,e,swap,m,filename);
+        else
+          p=skip_binary_element(p,end,e,swap,filename);
+        if(p>end)
+          throw std::string("Truncated data in PLY file "+filename);
+      }
+
+      for(unsigned int k=0;k<m.connectivity.size();++k)
+      {
+        const triangle_index& t=m.connectivity[k];
+        if(t.u0>=m.vertex.size() || t.u1>=m.vertex.size() || t.u2>=m.vertex.size())
+          throw std::string("Vertex index out of range in PLY file "+filename);
+      }
+      return m;
+    }
+  }
+
+  mesh load_mesh_file_ply(std::string const& filename)
+  {
+    mapped_file file(filename);
+    if(!file.is_open())
+      throw std::string("Cannot open file "+filename);
+
+    return parse_ply(file.data(),file.size(),filename);
+  }
+
+  mesh load_mesh_memory_ply(const char* data,size_t size)
+  {
+    return parse_ply(data,size,"(memory)");
+  }
+
+}
@@ -0,0 +1,44 @@
+/*
+ **    TP CPE Lyon
+ **    Copyright (C) 2015 Damien Rohmer
+ **
+ **    This program is free software: you can redistribute it and/or modify
+ **    it under the terms of the GNU General Public License as published by
+ **    the Free Software Foundation, either version 3 of the License, or
+ **    (at your option) any later version.
+ **
+ **   This program is distributed in the hope that it will be useful,
+ **    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ **    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ **    GNU General Public License for more details.
+ **
+ **    You should have received a copy of the GNU General Public License
+ **    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#ifndef MESH_IO_PLY_HPP
+#define MESH_IO_PLY_HPP
+
+#include <cstddef>
+#include <string>
+
+class mesh;
+
+namespace cpe
+{
+
+  /** Load a mesh structure from a PLY file (ascii, binary little or big endian).
+   *
+   *  Vertex properties x,y,z, nx,ny,nz, red,green,blue and s,t (or u,v) are
+   *  read, any other property or element is skipped. Polygonal faces
+   *  (vertex_indices or vertex_index list) are triangulated as fans.
+   */
+  mesh load_mesh_file_ply(std::string const& filename);
+  /** Load a mesh structure from PLY data held in memory (ex. a pack entry) */
+  mesh load_mesh_memory_ply(const char* data,size_t size);
+
+}
+
+#endif
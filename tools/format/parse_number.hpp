@@ -0,0 +1,155 @@
+#pragma once
+
+#ifndef PARSE_NUMBER_HPP
+#define PARSE_NUMBER_HPP
+
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+namespace cpe
+{
+
+  /** Locale-independent scanning helpers working on a [p,end[ character range.
+   *
+   *  Each parse function returns the position after the parsed token, or p
+   *  itself when no number could be read.
+   */
+
+  inline bool is_blank(char c) { return c==' ' || c=='\t' || c=='\r'; }
+  inline bool is_digit(char c) { return c>='0' && c<='9'; }
+
+  /** Skip spaces and tabs (not end of lines) */
+  inline const char* skip_blank(const char* p,const char* end)
+  {
+    while(p<end && is_blank(*p))
+      ++p;
+    return p;
+  }
+
+  /** Skip everything up to and including the next end of line */
+  inline const char* skip_line(const char* p,const char* end)
+  {
+    while(p<end && *p!='\n')
+      ++p;
+    return p<end ? p+1 : end;
+  }
+
+  /** Cut [begin,end[ in at most nb_chunk ranges ending on a line boundary.
+   *
+   *  Returns the N+1 bounds of the N ranges. Ranges are not made smaller than
+   *  chunk_size_min bytes so that small files stay in a single range.
+   */
+  inline std::vector<const char*> split_lines(const char* begin,const char* end,size_t nb_chunk,size_t chunk_size_min=64*1024)
+  {
+    std::vector<const char*> bounds(1,begin);
+    const size_t size=end-begin;
+    size_t chunk_size=nb_chunk>0 ? size/nb_chunk : size;
+    if(chunk_size<chunk_size_min)
+      chunk_size=chunk_size_min;
+
+    const char* p=begin;
+    while(static_cast<size_t>(end-p)>chunk_size)
+    {
+      const char* eol=static_cast<const char*>(std::memchr(p+chunk_size,'\n',end-p-chunk_size));
+      if(eol==nullptr)
+        break;
+      p=eol+1;
+      bounds.push_back(p);
+    }
+    if(bounds.back()!=end || bounds.size()==1)
+      bounds.push_back(end);
+    return bounds;
+  }
+
+  /** Parse a signed decimal integer */
+  inline const char* parse_int(const char* p,const char* end,int* value)
+  {
+    const char* start=p;
+    bool negative=false;
+    if(p<end && (*p=='-' || *p=='+'))
+    {
+      negative=*p=='-';
+      ++p;
+    }
+    if(p==end || !is_digit(*p))
+      return start;
+
+    int v=0;
+    while(p<end && is_digit(*p))
+      v=10*v+(*p++-'0');
+    *value=negative ? -v : v;
+    return p;
+  }
+
+  /** Parse a decimal floating point value (123, -1.5, .5e-3, 2E+10) */
+  inline const char* parse_float(const char* p,const char* end,double* value)
+  {
+    static const double power10[]={1e0,1e1,1e2,1e3,1e4,1e5,1e6,1e7,1e8,1e9,1e10,1e11,
+                                   1e12,1e13,1e14,1e15,1e16,1e17,1e18,1e19,1e20,1e21,1e22};
+    const char* start=p;
+    bool negative=false;
+    if(p<end && (*p=='-' || *p=='+'))
+    {
+      negative=*p=='-';
+      ++p;
+    }
+
+    //mantissa on 64 bits, digits beyond 19 only shift the exponent
+    unsigned long long mantissa=0;
+    int exponent=0;
+    int nb_digit=0;
+    bool any_digit=false;
+    while(p<end && is_digit(*p))
+    {
+      if(nb_digit<19) { mantissa=10*mantissa+(*p-'0'); if(mantissa>0) ++nb_digit; }
+      else            ++exponent;
+      any_digit=true;
+      ++p;
+    }
+    if(p<end && *p=='.')
+    {
+      ++p;
+      while(p<end && is_digit(*p))
+      {
+        if(nb_digit<19) { mantissa=10*mantissa+(*p-'0'); if(mantissa>0) ++nb_digit; --exponent; }
+        any_digit=true;
+        ++p;
+      }
+    }
+    if(!any_digit)
+      return start;
+
+    if(p<end && (*p=='e' || *p=='E'))
+    {
+      int e=0;
+      const char* q=parse_int(p+1,end,&e);
+      if(q!=p+1)
+      {
+        exponent+=e;
+        p=q;
+      }
+    }
+
+    double v=static_cast<double>(mantissa);
+    if(exponent<0 && exponent>=-22)     v/=power10[-exponent];
+    else if(exponent>0 && exponent<=22) v*=power10[exponent];
+    else if(exponent!=0)                v*=std::pow(10.0,exponent);
+
+    *value=negative ? -v : v;
+    return p;
+  }
+
+  /** Same as above, rounded to single precision */
+  inline const char* parse_float(const char* p,const char* end,float* value)
+  {
+    double v=0.0;
+    const char* q=parse_float(p,end,&v);
+    if(q!=p)
+      *value=static_cast<float>(v);
+    return q;
+  }
+
+}
+
+#endif
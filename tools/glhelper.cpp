@@ -6,12 +6,18 @@
  *
  \*****************************************************************************/
 
+#include <algorithm>
 #include <ctime>
 #include <chrono>
+#include <cstdio>
 #include <iostream>
 #include <fstream>
+#include <map>
 
 #include "glhelper.hpp" 
+#include "pack_file.hpp"
+#include "texture_cache.hpp"
+#include "format/mesh_io_gltf.hpp"
 
 /*****************************************************************************\
  * print_opengl_error                                                        *
@@ -58,9 +64,14 @@ namespace glhelper
    * Compile a shader and check compilation with log
    \*****************************************************************************/
   GLuint compile_shader(const char* shader_content, GLenum shader_type)
+  {
+    return compile_shader(shader_content, -1, shader_type);
+  }
+
+  GLuint compile_shader(const char* shader_content, GLint length, GLenum shader_type)
   {
     GLuint shader_id = glCreateShader(shader_type); CHECK_GL_ERROR();
-    glShaderSource(shader_id, 1, &shader_content, nullptr); CHECK_GL_ERROR();
+    glShaderSource(shader_id, 1, &shader_content, length<0 ? nullptr : &length); CHECK_GL_ERROR();
     glCompileShader(shader_id); CHECK_GL_ERROR();
 
     int success;
@@ -75,7 +86,7 @@ namespace glhelper
         glGetShaderInfoLog(shader_id, log_length, nullptr, log); CHECK_GL_ERROR();
         std::cerr << "-------------------------\n";
         std::cerr << "Error compiling shader: \n";
-        std::cerr << shader_content << "\n";
+        std::cerr << (length<0 ? std::string(shader_content) : std::string(shader_content, length)) << "\n";
         std::cerr << "------\n";
         std::cerr << log << "\n";
         std::cerr << "-------------------------" << std::endl;
@@ -90,8 +101,13 @@ namespace glhelper
    \*****************************************************************************/
   GLuint create_program(const std::string& vs_content, const std::string& fs_content)
   {
-    GLuint vs_id = compile_shader(vs_content.c_str(),GL_VERTEX_SHADER);
-    GLuint fs_id = compile_shader(fs_content.c_str(),GL_FRAGMENT_SHADER);
+    return create_program(vs_content.c_str(), vs_content.size(), fs_content.c_str(), fs_content.size());
+  }
+
+  GLuint create_program(const char* vs_content, size_t vs_size, const char* fs_content, size_t fs_size)
+  {
+    GLuint vs_id = compile_shader(vs_content,static_cast<GLint>(vs_size),GL_VERTEX_SHADER);
+    GLuint fs_id = compile_shader(fs_content,static_cast<GLint>(fs_size),GL_FRAGMENT_SHADER);
 
     GLuint program_id = glCreateProgram(); CHECK_GL_ERROR();
     glAttachShader(program_id, vs_id); CHECK_GL_ERROR();
@@ -128,6 +144,10 @@ namespace glhelper
       const std::string& vs_file,
       const std::string& fs_file)
   {
+    pack_data vs_data, fs_data;
+    if(asset_pack().read(vs_file, &vs_data) && asset_pack().read(fs_file, &fs_data))
+      return create_program(reinterpret_cast<const char*>(vs_data.span.data), vs_data.span.size,
+          reinterpret_cast<const char*>(fs_data.span.data), fs_data.span.size);
     return create_program(extract_file_content(vs_file), extract_file_content(fs_file));
   }
 
@@ -174,43 +194,407 @@ namespace glhelper
 
   GLuint load_texture(const char* filename)
   {
-    GLuint texture_id;
-    // Chargement d'une texture (seul les textures tga sont supportes)
-    Image  *image = image_load_tga(filename);
-    if (image) //verification que l'image est bien chargee
+    // Conteneur dds/ktx lu sur place, cache KTX relu sur place, ou decodage, mipmaps et compression par blocs
+    std::shared_ptr<texture_source> source;
+    try
+    {
+      source = open_texture_file(filename);
+    }
+    catch(const std::string& e)
     {
+      std::cerr<<e<<", etes-vous dans le bon repertoire?"<<std::endl;
+      abort();
+    }
+    return create_texture(source->view, filename);
+  }
 
-      //Creation d'un identifiant pour la texture
-      glPixelStorei(GL_UNPACK_ALIGNMENT, 1); CHECK_GL_ERROR();
-      glGenTextures(1, &texture_id); CHECK_GL_ERROR();
+  GLuint load_texture_memory(const unsigned char* data, size_t size, const std::string& label)
+  {
+    // niveaux deja prets (dds, ktx, ktx2): envoyes depuis la memoire donnee
+    texture_view view;
+    if(parse_texture_container(data, size, &view))
+      return create_texture(view, label);
+    // tga non compressee en haut a gauche: lignes BGR(A) envoyees telles quelles, le GPU fait la conversion
+    if(image_view_tga(data, size, &view))
+      return create_texture(view, label);
 
-      //Selection de la texture courante a partir de son identifiant
-      glBindTexture(GL_TEXTURE_2D, texture_id); CHECK_GL_ERROR();
+    Image  *image = image_load_memory(data, size);
+    if (!image) //verification que l'image est bien chargee
+    {
+      std::cerr<<"Erreur chargement de l'image, etes-vous dans le bon repertoire?"<<std::endl;
+      abort();
+    }
+
+    GLuint texture_id = create_texture(image, label);
+    delete image;
+    return texture_id;
+  }
+
+  namespace
+  {
+    // Memoire occupee par chaque texture creee par create_texture
+    struct texture_stats
+    {
+      std::string label;
+      int width;
+      int height;
+      int nb_level;
+      GLenum internal_format;
+      size_t size;
+    };
+    std::map<GLuint, texture_stats> texture_memory_table;
+
+    bool immutable_storage()
+    {
+      return GLEW_VERSION_4_2 || GLEW_ARB_texture_storage;
+    }
+
+    // Allocation des niveaux: immuable (glTexStorage2D) si possible, sinon chaque niveau a l'envoi
+    GLuint allocate_texture(GLenum internal_format, int width, int height, int nb_level)
+    {
+      GLuint texture_id;
+      glGenTextures(1, &texture_id);                                                         CHECK_GL_ERROR();
+      glBindTexture(GL_TEXTURE_2D, texture_id);                                              CHECK_GL_ERROR();
+      if(immutable_storage())
+      {
+        glTexStorage2D(GL_TEXTURE_2D, nb_level, internal_format, width, height);             CHECK_GL_ERROR();
+      }
+      return texture_id;
+    }
+
+    void upload_level(const texture_view& texture, int level, const void* data, size_t size, int width, int height)
+    {
+      if(texture.compressed())
+      {
+        if(immutable_storage())
+          glCompressedTexSubImage2D(GL_TEXTURE_2D, level, 0, 0, width, height, texture.gl_internal_format, static_cast<GLsizei>(size), data);
+        else
+          glCompressedTexImage2D(GL_TEXTURE_2D, level, texture.gl_internal_format, width, height, 0, static_cast<GLsizei>(size), data);
+      }
+      else
+      {
+        if(immutable_storage())
+          glTexSubImage2D(GL_TEXTURE_2D, level, 0, 0, width, height, texture.gl_format, texture.gl_type, data);
+        else
+          glTexImage2D(GL_TEXTURE_2D, level, texture.gl_internal_format, width, height, 0, texture.gl_format, texture.gl_type, data);
+      }
+      CHECK_GL_ERROR();
+    }
+
+    // Filtrage trilineaire et anisotrope (au maximum permis par le materiel) des que la chaine est presente
+    void set_sampling(int nb_level)
+    {
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);                          CHECK_GL_ERROR();
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);                          CHECK_GL_ERROR();
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);                      CHECK_GL_ERROR();
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, nb_level > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR); CHECK_GL_ERROR();
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, nb_level - 1);                    CHECK_GL_ERROR();
+      if(nb_level > 1 && GLEW_EXT_texture_filter_anisotropic)
+      {
+        GLfloat anisotropy = 1.0f;
+        glGetFloatv(GL_MAX_TEXTURE_MAX_ANISOTROPY_EXT, &anisotropy);                         CHECK_GL_ERROR();
+        glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAX_ANISOTROPY_EXT, anisotropy);           CHECK_GL_ERROR();
+      }
+    }
+  }
+
+  bool texture_format_supported(const texture_view& texture)
+  {
+    block_format format;
+    if(!texture.compressed() || !block_format_of(texture.gl_internal_format, &format))
+      return true;
+    const bool s3tc = format == block_bc1 || format == block_bc3;
+    return s3tc ? GLEW_EXT_texture_compression_s3tc : (GLEW_VERSION_3_0 || GLEW_ARB_texture_compression_rgtc);
+  }
+
+  GLuint create_texture(const texture_view& texture, const std::string& label)
+  {
+    if(texture.levels.empty())
+      return 0;
+
+    // blocs que le GPU ne sait pas lire: envoyes decompresses
+    if(!texture_format_supported(texture))
+      return create_texture(decompress_texture(copy_of(texture)), label);
+    const int width = texture.levels[0].width;
+    const int height = texture.levels[0].height;
+
+    // un seul niveau non compresse: la chaine complete est calculee par le GPU
+    const bool generate = !texture.compressed() && texture.levels.size() == 1;
+    const int nb_level = generate ? texture_level_count(width, height) : static_cast<int>(texture.levels.size());
+
+    // lignes RGBA8 et blocs compresses alignes sur 4 octets, lignes BGR des tga serrees
+    glPixelStorei(GL_UNPACK_ALIGNMENT, texture.gl_format == texture_gl_bgr ? 1 : 4);        CHECK_GL_ERROR();
+    const GLuint texture_id = allocate_texture(texture.gl_internal_format, width, height, nb_level);
+    for(unsigned int k = 0; k < texture.levels.size(); ++k)
+    {
+      const texture_level_view& l = texture.levels[k];
+      upload_level(texture, k, l.data, l.size, l.width, l.height);
+    }
+    if(generate)
+    {
+      glGenerateMipmap(GL_TEXTURE_2D);                                                       CHECK_GL_ERROR();
+    }
+    set_sampling(nb_level);
+
+    texture_stats& stats = texture_memory_table[texture_id];
+    stats.label = label;
+    stats.width = width;
+    stats.height = height;
+    stats.nb_level = nb_level;
+    stats.internal_format = texture.gl_internal_format;
+    // texels non compresses stockes en RGBA8 par le GPU, quel que soit le format envoye
+    stats.size = 0;
+    for(unsigned int k = 0; k < texture.levels.size(); ++k)
+      stats.size += texture.compressed() ? texture.levels[k].size : 4*static_cast<size_t>(texture.levels[k].width)*texture.levels[k].height;
+    if(generate)
+      for(int k = 1, w = width, h = height; k < nb_level; ++k)
+      {
+        w = std::max(1, w/2);
+        h = std::max(1, h/2);
+        stats.size += 4*static_cast<size_t>(w)*h;
+      }
+
+    return texture_id;
+  }
+
+  GLuint create_texture(const texture_data& texture, const std::string& label)
+  {
+    return create_texture(view_of(texture), label);
+  }
 
-      //Parametres de la texture
-      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT); CHECK_GL_ERROR();
-      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT); CHECK_GL_ERROR();
-      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR); CHECK_GL_ERROR();
-      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR); CHECK_GL_ERROR();
+  GLuint create_texture(const Image* image, const std::string& label)
+  {
+    return create_texture(texture_from_image(*image, false), label);
+  }
 
-      //Envoie de l'image en memoire video
-      if(image->type==IMAGE_TYPE_RGB){ //image RGB
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, image->width, image->height, 0, GL_RGB, GL_UNSIGNED_BYTE, image->data); CHECK_GL_ERROR();}
-      else if(image->type==IMAGE_TYPE_RGBA){ //image RGBA
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, image->width, image->height, 0, GL_RGBA, GL_UNSIGNED_BYTE, image->data); CHECK_GL_ERROR();}
-      else{
-        std::cout<<"Image type not handled"<<std::endl;}
+  GLuint create_texture_array(const std::vector<texture_data>& layers, const std::string& label)
+  {
+    if(layers.empty() || layers[0].levels.empty())
+      return 0;
+    const texture_data& first = layers[0];
+    const int width = first.levels[0].width;
+    const int height = first.levels[0].height;
+    const int nb_level = static_cast<int>(first.levels.size());
+    const GLsizei nb_layer = static_cast<GLsizei>(layers.size());
 
-      delete image;
+    GLuint texture_id;
+    glGenTextures(1, &texture_id);                                                           CHECK_GL_ERROR();
+    glBindTexture(GL_TEXTURE_2D_ARRAY, texture_id);                                          CHECK_GL_ERROR();
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);                                                   CHECK_GL_ERROR();
+    if(immutable_storage())
+    {
+      glTexStorage3D(GL_TEXTURE_2D_ARRAY, nb_level, first.gl_internal_format, width, height, nb_layer); CHECK_GL_ERROR();
     }
     else
+      for(int k = 0; k < nb_level; ++k)
+      {
+        const texture_level& l = first.levels[k];
+        if(first.compressed())
+          glCompressedTexImage3D(GL_TEXTURE_2D_ARRAY, k, first.gl_internal_format, l.width, l.height, nb_layer, 0,
+                                 static_cast<GLsizei>(l.data.size()*nb_layer), nullptr);
+        else
+          glTexImage3D(GL_TEXTURE_2D_ARRAY, k, first.gl_internal_format, l.width, l.height, nb_layer, 0,
+                       first.gl_format, first.gl_type, nullptr);
+        CHECK_GL_ERROR();
+      }
+
+    // chaque couche et chacun de ses niveaux a sa place dans le stockage commun
+    size_t size = 0;
+    for(GLsizei layer = 0; layer < nb_layer; ++layer)
+      for(int k = 0; k < nb_level; ++k)
+      {
+        const texture_level& l = layers[layer].levels[k];
+        if(first.compressed())
+          glCompressedTexSubImage3D(GL_TEXTURE_2D_ARRAY, k, 0, 0, layer, l.width, l.height, 1, first.gl_internal_format,
+                                    static_cast<GLsizei>(l.data.size()), &l.data[0]);
+        else
+          glTexSubImage3D(GL_TEXTURE_2D_ARRAY, k, 0, 0, layer, l.width, l.height, 1, first.gl_format, first.gl_type, &l.data[0]);
+        CHECK_GL_ERROR();
+        size += l.data.size();
+      }
+
+    // bords tenus par la bordure de l'atlas, pas de repetition entre textures voisines
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);               CHECK_GL_ERROR();
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);               CHECK_GL_ERROR();
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);                  CHECK_GL_ERROR();
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, nb_level > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR); CHECK_GL_ERROR();
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, nb_level - 1);                CHECK_GL_ERROR();
+    if(nb_level > 1 && GLEW_EXT_texture_filter_anisotropic)
     {
-      std::cerr<<"Erreur chargement de l'image, etes-vous dans le bon repertoire?"<<std::endl;
-      abort();
+      GLfloat anisotropy = 1.0f;
+      glGetFloatv(GL_MAX_TEXTURE_MAX_ANISOTROPY_EXT, &anisotropy);                           CHECK_GL_ERROR();
+      glTexParameterf(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_ANISOTROPY_EXT, anisotropy);       CHECK_GL_ERROR();
     }
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);                                                   CHECK_GL_ERROR();
 
+    texture_stats& stats = texture_memory_table[texture_id];
+    stats.label = label;
+    stats.width = width;
+    stats.height = height;
+    stats.nb_level = nb_level;
+    stats.internal_format = first.gl_internal_format;
+    stats.size = size;
     return texture_id;
-}
+  }
+
+  void delete_texture(GLuint texture_id)
+  {
+    if(texture_id == 0)
+      return;
+    texture_memory_table.erase(texture_id);
+    glDeleteTextures(1, &texture_id);                                                        CHECK_GL_ERROR();
+  }
+
+  size_t texture_memory(GLuint texture_id)
+  {
+    std::map<GLuint, texture_stats>::const_iterator it = texture_memory_table.find(texture_id);
+    return it != texture_memory_table.end() ? it->second.size : 0;
+  }
+
+  void print_texture_memory()
+  {
+    size_t total = 0;
+    for(const std::pair<const GLuint, texture_stats>& t : texture_memory_table)
+    {
+      const texture_stats& s = t.second;
+      std::printf("texture %3u %-28s %5dx%-5d %2d niveaux format 0x%04x %9.1f Ko\n", t.first, s.label.c_str(),
+          s.width, s.height, s.nb_level, s.internal_format, s.size/1024.0);
+      total += s.size;
+    }
+    std::printf("%u textures, %.2f Mo\n", static_cast<unsigned int>(texture_memory_table.size()), total/(1024.0*1024.0));
+  }
+
+
+  GLuint create_buffer(GLenum target, const void* data, size_t size)
+  {
+    GLuint buffer;
+    glGenBuffers(1, &buffer);                                                   CHECK_GL_ERROR();
+    glBindBuffer(target, buffer);                                               CHECK_GL_ERROR();
+    glBufferData(target, size, data, GL_STATIC_DRAW);                           CHECK_GL_ERROR();
+    return buffer;
+  }
+
+
+  gltf_gpu_model upload_gltf(const cpe::gltf_file& gltf)
+  {
+    gltf_gpu_model model;
 
+    // un buffer par bufferView utilisee, cree a la premiere utilisation
+    std::vector<GLuint> view_buffer(gltf.buffer_views.size(), 0);
+    std::vector<GLuint> image_texture(gltf.images.size(), 0);
+    auto buffer_of = [&](int view, GLenum target) -> GLuint
+    {
+      if(view_buffer[view] == 0)
+      {
+        view_buffer[view] = create_buffer(target, gltf.view_data(view), gltf.buffer_views[view].size);
+        model.buffers.push_back(view_buffer[view]);
+      }
+      return view_buffer[view];
+    };
+
+    for(const cpe::gltf_mesh& m : gltf.meshes)
+    {
+      for(const cpe::gltf_primitive& p : m.primitives)
+      {
+        const int position = p.attribute[cpe::gltf_position];
+        if(position < 0)
+          continue;
+
+        gltf_gpu_primitive gp;
+        gp.mode = p.mode;
+        gp.index_type = 0;
+        gp.index_offset = 0;
+        gp.count = static_cast<GLsizei>(gltf.accessors[position].count);
+        gp.texture = 0;
+        gp.has_color = p.attribute[cpe::gltf_color] >= 0;
+        gp.has_normal = p.attribute[cpe::gltf_normal] >= 0;
+        for(int k = 0; k < 4; ++k)
+          gp.color[k] = p.material >= 0 ? gltf.materials[p.material].base_color[k] : 1.0f;
+
+        glGenVertexArrays(1, &gp.vao);                                          CHECK_GL_ERROR();
+        glBindVertexArray(gp.vao);                                              CHECK_GL_ERROR();
+
+        for(int a = 0; a < cpe::gltf_nb_attribute; ++a)
+        {
+          const int accessor = p.attribute[a];
+          if(accessor < 0 || gltf.accessors[accessor].buffer_view < 0)
+            continue;
+          const cpe::gltf_accessor& acc = gltf.accessors[accessor];
+          glBindBuffer(GL_ARRAY_BUFFER, buffer_of(acc.buffer_view, GL_ARRAY_BUFFER)); CHECK_GL_ERROR();
+          glEnableVertexAttribArray(a);                                         CHECK_GL_ERROR();
+          const GLint size = a == cpe::gltf_color ? 3 : acc.nb_component;
+          glVertexAttribPointer(a, size, acc.component_type, acc.normalized ? GL_TRUE : GL_FALSE,
+              static_cast<GLsizei>(gltf.buffer_views[acc.buffer_view].stride), reinterpret_cast<void*>(acc.offset)); CHECK_GL_ERROR();
+        }
+
+        if(p.indices >= 0 && gltf.accessors[p.indices].buffer_view >= 0)
+        {
+          const cpe::gltf_accessor& acc = gltf.accessors[p.indices];
+          glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffer_of(acc.buffer_view, GL_ELEMENT_ARRAY_BUFFER)); CHECK_GL_ERROR();
+          gp.index_type = acc.component_type;
+          gp.index_offset = acc.offset;
+          gp.count = static_cast<GLsizei>(acc.count);
+        }
+        glBindVertexArray(0);                                                   CHECK_GL_ERROR();
+
+        // texture de couleur de base: image du glb decodee depuis le fichier projete, sinon fichier externe
+        const int image = p.material >= 0 ? gltf.materials[p.material].base_color_texture : -1;
+        if(image >= 0)
+        {
+          if(image_texture[image] == 0)
+          {
+            const unsigned char* data = nullptr;
+            size_t size = 0;
+            if(gltf.image_data(image, &data, &size))
+              image_texture[image] = load_texture_memory(data, size);
+            else
+              image_texture[image] = load_texture(gltf.image_path(image).c_str());
+            model.textures.push_back(image_texture[image]);
+          }
+          gp.texture = image_texture[image];
+        }
+
+        model.primitives.push_back(gp);
+      }
+    }
+    return model;
+  }
+
+  void draw_gltf(const gltf_gpu_model& model)
+  {
+    for(const gltf_gpu_primitive& p : model.primitives)
+    {
+      glBindVertexArray(p.vao);                                                 CHECK_GL_ERROR();
+      // attributs absents: valeur constante hors VAO
+      if(!p.has_color)
+        glVertexAttrib3f(2, p.color[0], p.color[1], p.color[2]);
+      if(!p.has_normal)
+        glVertexAttrib3f(1, 0.0f, 0.0f, 1.0f);
+      if(p.texture != 0)
+      {
+        glBindTexture(GL_TEXTURE_2D, p.texture);                                CHECK_GL_ERROR();
+      }
+
+      if(p.index_type != 0)
+        glDrawElements(p.mode, p.count, p.index_type, reinterpret_cast<void*>(p.index_offset));
+      else
+        glDrawArrays(p.mode, 0, p.count);
+      CHECK_GL_ERROR();
+    }
+    glBindVertexArray(0);
+  }
+
+  void release_gltf(gltf_gpu_model* model)
+  {
+    for(const gltf_gpu_primitive& p : model->primitives)
+      glDeleteVertexArrays(1, &p.vao);
+    if(!model->buffers.empty())
+      glDeleteBuffers(static_cast<GLsizei>(model->buffers.size()), &model->buffers[0]);
+    for(GLuint t : model->textures)
+      delete_texture(t);
+    model->primitives.clear();
+    model->buffers.clear();
+    model->textures.clear();
+  }
 
 }
@@ -10,16 +10,20 @@
 #define GL_HELPER_H
 
 #include <string>
+#include <vector>
 
 #define GLEW_STATIC 1
 #include <GL/glew.h>
 
 #include "image.hpp"
+#include "texture_data.hpp"
 
 // based on https://blog.nobel-joergensen.com/2013/01/29/debugging-opengl-using-glgeterror/
 void _check_gl_error(const char *file, int line);
 #define CHECK_GL_ERROR() _check_gl_error(__FILE__, __LINE__)
 
+namespace cpe { class gltf_file; }
+
 namespace glhelper
 {
   // Renvoie le contenu d'un fichier
@@ -30,14 +34,19 @@ namespace glhelper
   // shader_type : enum représentant le type de shader (GL_VERTEX_SHADER ou GL_FRAGMENT_SHADER)
   // Renvoie l'identifiant du shader
   GLuint compile_shader(const char* shader_source, GLenum shader_type);
+  // Idem avec un code GLSL de longueur donnee (pas forcement termine par un zero)
+  GLuint compile_shader(const char* shader_source, GLint length, GLenum shader_type);
 
   // Creation programme GPU (vertex + fragment)
   // vertex_content : Contenu du vertex shader
   // fragment_content : Contenu du fragment shader
   // Renvoie l'identifiant du programme
   GLuint create_program(const std::string& vertex_content, const std::string& fragment_content);
+  // Idem avec des codes GLSL de longueur donnee (ex. entrees du pack, sans copie)
+  GLuint create_program(const char* vertex_content, size_t vertex_size, const char* fragment_content, size_t fragment_size);
 
   // Creation programme GPU à partir de fichiers (vertex + fragment)
+  // Les fichiers presents dans asset_pack() sont lus depuis le pack
   // vertex_file : Nom du fichier contenant le vertex shader
   // fragment_file : Nom du fichier contenant le fragment shader
   // Renvoie l'identifiant du programme
@@ -47,11 +56,83 @@ namespace glhelper
   // filename : Nom de la capture d'écran, par défaut utilise un timestamp
   void print_screen(std::string filename = "");
 
-  // Fonction pour charger une texture sur le GPU
-  // filename : Nom du fichier contenant la texture
+  // Fonction pour charger une texture sur le GPU (conteneur dds/ktx envoye sur place, image compressee par blocs, voir prepare_texture)
+  // filename : Nom du fichier contenant la texture (lu depuis asset_pack() s'il y est present)
   // Renvoie l'identifiant de la texture
   GLuint load_texture(const char* filename);
 
+  // Fonction pour charger sur le GPU une texture dont le fichier est deja en memoire
+  // data, size : contenu du fichier (tga, jpg, ou dds/ktx/ktx2 dont les niveaux sont envoyes sans copie)
+  // label : nom affiche par print_texture_memory
+  // Renvoie l'identifiant de la texture
+  GLuint load_texture_memory(const unsigned char* data, size_t size, const std::string& label = "");
+
+  // Fonction pour envoyer sur le GPU une image deja decodee (ex. sur un autre thread)
+  // L'image est envoyee en RGBA8, ses mipmaps sont calculees par le GPU
+  // Renvoie l'identifiant de la texture
+  GLuint create_texture(const Image* image, const std::string& label = "");
+
+  // Envoi d'une texture et de ses niveaux (ex. mipmaps calculees sur un autre thread, blocs compresses)
+  // Stockage immuable (glTexStorage2D) quand il est disponible, filtrage trilineaire et anisotrope.
+  // Une texture non compressee a un seul niveau recoit sa chaine complete par glGenerateMipmap.
+  // Renvoie l'identifiant de la texture
+  GLuint create_texture(const texture_data& texture, const std::string& label = "");
+  // Idem avec des niveaux lus sur place (ex. fichier projete, voir texture_source)
+  // Avec un GL_PIXEL_UNPACK_BUFFER lie, les pointeurs des niveaux sont des positions dans ce buffer
+  GLuint create_texture(const texture_view& texture, const std::string& label = "");
+  // Faux si les blocs compresses de la texture ne sont pas lisibles par le GPU (create_texture les decompresse alors)
+  bool texture_format_supported(const texture_view& texture);
+
+  // Texture tableau (GL_TEXTURE_2D_ARRAY) dont chaque couche est une des textures donnees
+  // (memes dimensions, format et nombre de niveaux, ex. couches d'un texture_atlas)
+  // Pas de repetition: les coordonnees sont bornees au bord, l'atlas gere ses bordures
+  // Renvoie l'identifiant de la texture, a lier sur GL_TEXTURE_2D_ARRAY
+  GLuint create_texture_array(const std::vector<texture_data>& layers, const std::string& label = "");
+
+  // Libere une texture creee par create_texture ou create_texture_array
+  void delete_texture(GLuint texture_id);
+
+  // Memoire video occupee par une texture (tous niveaux), 0 si elle est inconnue
+  size_t texture_memory(GLuint texture_id);
+  // Affiche la memoire de chaque texture et le total
+  void print_texture_memory();
+
+  // Creation d'un buffer OpenGL rempli directement depuis une zone memoire (ex. fichier projete)
+  // target : GL_ARRAY_BUFFER ou GL_ELEMENT_ARRAY_BUFFER
+  // Renvoie l'identifiant du buffer
+  GLuint create_buffer(GLenum target, const void* data, size_t size);
+
+  // Primitive glTF sur le GPU: un VAO dont les attributs pointent dans les buffers des bufferViews
+  struct gltf_gpu_primitive
+  {
+    GLuint vao;
+    GLenum mode;
+    GLsizei count;
+    GLenum index_type;     // 0 si la primitive n'est pas indexee
+    size_t index_offset;
+    GLuint texture;        // texture de couleur de base, 0 si aucune
+    float color[4];        // couleur constante quand COLOR_0 est absent
+    bool has_color;
+    bool has_normal;
+  };
+
+  // Ensemble des objets OpenGL crees pour un fichier glTF
+  struct gltf_gpu_model
+  {
+    std::vector<GLuint> buffers;
+    std::vector<GLuint> textures;
+    std::vector<gltf_gpu_primitive> primitives;
+  };
+
+  // Envoie un fichier glTF sur le GPU sans copie element par element: chaque bufferView utilisee
+  // devient un buffer OpenGL rempli depuis le fichier projete, chaque accesseur un glVertexAttribPointer
+  // (positions 0, normales 1, couleurs 2, coordonnees de texture 3 comme pour vertex_opengl)
+  gltf_gpu_model upload_gltf(const cpe::gltf_file& gltf);
+  // Affiche toutes les primitives, la texture de couleur de base est liee sur l'unite courante
+  void draw_gltf(const gltf_gpu_model& model);
+  // Libere les buffers, VAO et textures
+  void release_gltf(gltf_gpu_model* model);
+
 
 }// namespace glhelper
 
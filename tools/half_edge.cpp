@@ -0,0 +1,211 @@
+
+#include "half_edge.hpp"
+#include "mesh.hpp"
+
+#include <cassert>
+
+
+half_edge_structure build_half_edge_structure(const mesh* m)
+{
+  half_edge_structure he;
+
+  const std::vector<triangle_index>& c=m->connectivity;
+  const int N_face=c.size();
+  const int N_half_edge=3*N_face;
+  const int N_vertex=m->vertex.size();
+
+  he.origin.resize(N_half_edge);
+  for(int k=0;k<N_face;++k)
+  {
+    he.origin[3*k+0]=c[k].u0;
+    he.origin[3*k+1]=c[k].u1;
+    he.origin[3*k+2]=c[k].u2;
+  }
+
+  //regroupe les demi-aretes par sommet d'origine (tri par comptage)
+  std::vector<int> offset(N_vertex+1,0);
+  for(int h=0;h<N_half_edge;++h)
+  {
+    assert(static_cast<int>(he.origin[h])<N_vertex);
+    offset[he.origin[h]+1]++;
+  }
+  for(int k=0;k<N_vertex;++k)
+    offset[k+1]+=offset[k];
+
+  std::vector<int> outgoing(N_half_edge);
+  std::vector<int> fill(offset.begin(),offset.end()-1);
+  for(int h=0;h<N_half_edge;++h)
+    outgoing[fill[he.origin[h]]++]=h;
+
+  //appariement: l'opposee de a->b est cherchee parmi les demi-aretes sortantes de b
+  he.opposite.assign(N_half_edge,-1);
+  for(int h=0;h<N_half_edge;++h)
+  {
+    if(he.opposite[h]!=-1)
+      continue;
+
+    const unsigned int a=he.origin[h];
+    const unsigned int b=he_target(he,h);
+    for(int k=offset[b],k_end=offset[b+1];k<k_end;++k)
+    {
+      const int g=outgoing[k];
+      if(he.opposite[g]==-1 && he_target(he,g)==a)
+      {
+        he.opposite[h]=g;
+        he.opposite[g]=h;
+        break;
+      }
+    }
+  }
+
+  //demi-arete sortante par sommet, de preference sur le bord
+  he.vertex_half_edge.assign(N_vertex,-1);
+  for(int v=0;v<N_vertex;++v)
+  {
+    for(int k=offset[v],k_end=offset[v+1];k<k_end;++k)
+    {
+      const int h=outgoing[k];
+      if(he.vertex_half_edge[v]==-1 || he.opposite[h]==-1)
+        he.vertex_half_edge[v]=h;
+      if(he.opposite[h]==-1)
+        break;
+    }
+  }
+
+  return he;
+}
+
+int he_rotate(const half_edge_structure& he,int h)
+{
+  return he.opposite[he_prev(h)];
+}
+
+void vertex_one_ring(const half_edge_structure& he,int v,std::vector<int>* neighbors)
+{
+  neighbors->clear();
+  const int h_start=he.vertex_half_edge[v];
+  if(h_start==-1)
+    return;
+
+  int h=h_start;
+  do
+  {
+    neighbors->push_back(he_target(he,h));
+    const int h_next=he_rotate(he,h);
+    if(h_next==-1)
+    {
+      //sommet de bord: le dernier voisin est l'origine de la demi-arete precedente
+      neighbors->push_back(he.origin[he_prev(h)]);
+      break;
+    }
+    h=h_next;
+  } while(h!=h_start);
+}
+
+void vertex_star(const half_edge_structure& he,int v,std::vector<int>* faces)
+{
+  faces->clear();
+  const int h_start=he.vertex_half_edge[v];
+  if(h_start==-1)
+    return;
+
+  int h=h_start;
+  do
+  {
+    faces->push_back(he_face(h));
+    h=he_rotate(he,h);
+  } while(h!=-1 && h!=h_start);
+}
+
+bool is_boundary_edge(const half_edge_structure& he,int h)
+{
+  return he.opposite[h]==-1;
+}
+
+bool is_boundary_vertex(const half_edge_structure& he,int v)
+{
+  const int h=he.vertex_half_edge[v];
+  return h==-1 || he.opposite[h]==-1;
+}
+
+std::vector<int> boundary_half_edges(const half_edge_structure& he)
+{
+  std::vector<int> boundary;
+  for(int h=0,N=he.opposite.size();h<N;++h)
+    if(he.opposite[h]==-1)
+      boundary.push_back(h);
+  return boundary;
+}
+
+bool flip_edge(half_edge_structure* he,mesh* m,int h)
+{
+  const int o=he->opposite[h];
+  if(o==-1)
+    return false;
+
+  //triangle t0=(a,b,c) porte h=a->b, triangle t1=(b,a,d) porte o=b->a
+  const int h1=he_next(h),h2=he_prev(h);
+  const int o1=he_next(o),o2=he_prev(o);
+  const unsigned int a=he->origin[h];
+  const unsigned int b=he->origin[h1];
+  const unsigned int c=he->origin[h2];
+  const unsigned int d=he->origin[o2];
+  if(c==d)
+    return false;
+
+  std::vector<int> ring;
+  vertex_one_ring(*he,c,&ring);
+  for(int k=0,N=ring.size();k<N;++k)
+    if(ring[k]==static_cast<int>(d))
+      return false;
+
+  const int opp_h1=he->opposite[h1],opp_h2=he->opposite[h2];
+  const int opp_o1=he->opposite[o1],opp_o2=he->opposite[o2];
+
+  //nouveaux triangles t0=(c,d,b) et t1=(d,c,a)
+  const int t0=he_face(h),t1=he_face(o);
+  const int base0=3*t0,base1=3*t1;
+  const unsigned int v0[3]={c,d,b};
+  const unsigned int v1[3]={d,c,a};
+  const int opp0[3]={base1,opp_o2,opp_h1};
+  const int opp1[3]={base0,opp_h2,opp_o1};
+  for(int k=0;k<3;++k)
+  {
+    he->origin[base0+k]=v0[k];
+    he->origin[base1+k]=v1[k];
+    he->opposite[base0+k]=opp0[k];
+    he->opposite[base1+k]=opp1[k];
+    if(k>0)
+    {
+      if(opp0[k]!=-1) he->opposite[opp0[k]]=base0+k;
+      if(opp1[k]!=-1) he->opposite[opp1[k]]=base1+k;
+    }
+  }
+
+  m->connectivity[t0]=triangle_index(c,d,b);
+  m->connectivity[t1]=triangle_index(d,c,a);
+
+  //les demi-aretes sortantes des sommets du quadrilatere ont pu changer d'indice
+  const unsigned int quad[4]={a,b,c,d};
+  for(int q=0;q<4;++q)
+  {
+    const unsigned int v=quad[q];
+    const int current=he->vertex_half_edge[v];
+    if(he_face(current)!=t0 && he_face(current)!=t1)
+      continue;
+    int best=-1;
+    for(int k=0;k<3;++k)
+    {
+      const int candidates[2]={base0+k,base1+k};
+      for(int i=0;i<2;++i)
+      {
+        const int g=candidates[i];
+        if(he->origin[g]==v && (best==-1 || he->opposite[g]==-1))
+          best=g;
+      }
+    }
+    he->vertex_half_edge[v]=best;
+  }
+
+  return true;
+}
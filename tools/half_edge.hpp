@@ -0,0 +1,57 @@
+#pragma once
+
+#ifndef HALF_EDGE_HPP
+#define HALF_EDGE_HPP
+
+#include <vector>
+
+struct mesh;
+
+/** Une structure de demi-aretes indexee construite a partir de mesh::connectivity
+ *
+ *  La demi-arete h=3*t+k appartient au triangle t et part de son k-ieme sommet
+ *  vers le sommet suivant. Les relations next/prev/face sont donc implicites,
+ *  seules les opposees et une demi-arete sortante par sommet sont stockees.
+ */
+struct half_edge_structure
+{
+  /** sommet d'origine de chaque demi-arete */
+  std::vector<unsigned int> origin;
+  /** demi-arete opposee (-1 si la demi-arete est sur le bord) */
+  std::vector<int> opposite;
+  /** une demi-arete sortante par sommet (-1 si sommet isole), sur le bord si le sommet est au bord */
+  std::vector<int> vertex_half_edge;
+};
+
+/** demi-arete suivante dans le meme triangle */
+inline int he_next(int h) { return h%3==2 ? h-2 : h+1; }
+/** demi-arete precedente dans le meme triangle */
+inline int he_prev(int h) { return h%3==0 ? h+2 : h-1; }
+/** triangle contenant la demi-arete */
+inline int he_face(int h) { return h/3; }
+/** sommet d'arrivee de la demi-arete */
+inline unsigned int he_target(const half_edge_structure& he,int h) { return he.origin[he_next(h)]; }
+
+/** construit la structure de demi-aretes d'un maillage (temps lineaire) */
+half_edge_structure build_half_edge_structure(const mesh* m);
+
+/** demi-arete sortante suivante autour du sommet d'origine de h (-1 si on atteint le bord) */
+int he_rotate(const half_edge_structure& he,int h);
+
+/** remplit la liste des sommets voisins du sommet v */
+void vertex_one_ring(const half_edge_structure& he,int v,std::vector<int>* neighbors);
+/** remplit la liste des triangles adjacents au sommet v */
+void vertex_star(const half_edge_structure& he,int v,std::vector<int>* faces);
+
+/** indique si la demi-arete h est sur le bord */
+bool is_boundary_edge(const half_edge_structure& he,int h);
+/** indique si le sommet v est sur le bord */
+bool is_boundary_vertex(const half_edge_structure& he,int v);
+/** renvoie l'ensemble des demi-aretes de bord */
+std::vector<int> boundary_half_edges(const half_edge_structure& he);
+
+/** bascule l'arete interieure portee par h, met a jour la structure et la connectivite du maillage
+ *  renvoie false si l'arete est au bord ou si la bascule creerait une arete existante */
+bool flip_edge(half_edge_structure* he,mesh* m,int h);
+
+#endif
@@ -0,0 +1,73 @@
+
+#include "hash.hpp"
+
+#include "mapped_file.hpp"
+
+#include <cstring>
+
+namespace
+{
+  const unsigned long long prime_0=0x9E3779B97F4A7C15ull;
+  const unsigned long long prime_1=0xBF58476D1CE4E5B9ull;
+  const unsigned long long prime_2=0x94D049BB133111EBull;
+
+  unsigned long long rotate(unsigned long long x,int r)
+  {
+    return (x<<r)|(x>>(64-r));
+  }
+
+  /** melange final (splitmix64) */
+  unsigned long long finalize(unsigned long long h)
+  {
+    h^=h>>30; h*=prime_1;
+    h^=h>>27; h*=prime_2;
+    h^=h>>31;
+    return h;
+  }
+}
+
+unsigned long long hash_bytes(const void* data,size_t size,unsigned long long seed)
+{
+  const unsigned char* p=static_cast<const unsigned char*>(data);
+  const unsigned char* const end=p+size;
+
+  //quatre accumulateurs independants pour ne pas etre limite par la latence de la multiplication
+  unsigned long long h[4]={seed+prime_0,seed+prime_1,seed+prime_2,seed-prime_0};
+  while(end-p>=32)
+  {
+    for(int k=0;k<4;++k)
+    {
+      unsigned long long w;
+      std::memcpy(&w,p+8*k,8);
+      h[k]=rotate(h[k]+w*prime_1,31)*prime_0;
+    }
+    p+=32;
+  }
+
+  unsigned long long res=rotate(h[0],1)+rotate(h[1],7)+rotate(h[2],12)+rotate(h[3],18)+size;
+  while(end-p>=8)
+  {
+    unsigned long long w;
+    std::memcpy(&w,p,8);
+    res=rotate(res^(w*prime_1),27)*prime_0;
+    p+=8;
+  }
+  while(p<end)
+    res=rotate(res^(*p++*prime_2),11)*prime_0;
+
+  return finalize(res);
+}
+
+unsigned long long hash_combine(unsigned long long h,unsigned long long value)
+{
+  return finalize(h^(value+prime_0+(h<<6)+(h>>2)));
+}
+
+bool hash_file(const std::string& filename,unsigned long long* h)
+{
+  mapped_file file(filename);
+  if(!file.is_open())
+    return false;
+  *h=hash_bytes(file.data(),file.size());
+  return true;
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#ifndef HASH_HPP
+#define HASH_HPP
+
+#include <cstddef>
+#include <string>
+
+/** Hachage 64 bits non cryptographique d'un bloc memoire (lecture par mots de 8 octets) */
+unsigned long long hash_bytes(const void* data,size_t size,unsigned long long seed=0);
+
+/** Combine une valeur dans un hachage existant */
+unsigned long long hash_combine(unsigned long long h,unsigned long long value);
+
+/** Hachage du contenu d'un fichier (projete en memoire), renvoie false si le fichier est illisible */
+bool hash_file(const std::string& filename,unsigned long long* h);
+
+#endif
@@ -3,8 +3,11 @@
 #ifndef IMAGE_H
 #define IMAGE_H
 
+#include <cstddef>
 #include <string>
 
+#include "texture_data.hpp"
+
 enum ImageType
 {
   IMAGE_TYPE_GRAY,
@@ -19,9 +22,35 @@ struct Image
   int            height;
   ImageType      type;
   unsigned char *data;
-  ~Image() { delete[] data; }
+  // liberation des pixels: delete[] par defaut, stbi_image_free pour une image decodee par stb
+  void         (*release)(unsigned char *);
+
+  Image();
+  ~Image();
+
+private:
+  Image(const Image &);
+  Image &operator=(const Image &);
 };
 
+// nombre d'octets par pixel (1 a 4)
+int image_channels(ImageType type);
+
+// decode une image tga (decodeur natif: non compressee ou RLE, 8/24/32 bits, alpha conserve)
+// ou jpg/png (stb) depuis un fichier projete en memoire; la premiere ligne de data est en haut de l'image
 Image *image_load_tga(const std::string &filename);
+// decode une image (tga, jpg, png) deja en memoire, par exemple une entree de pack
+Image *image_load_memory(const unsigned char *data, size_t size);
+// decodeur tga natif seul, nullptr si data n'est pas une tga geree (palette, 16 bits)
+Image *image_decode_tga(const unsigned char *data, size_t size);
+
+// jpg baseline a intervalles de redemarrage (marqueur DRI) decoupee en bandes de lignes de MCU
+// decodees en parallele sur le pool; nullptr si l'image est petite, progressive ou sans redemarrage
+Image *image_decode_jpeg_strips(const unsigned char *data, size_t size);
+
+// lecture sur place d'une tga non compressee 24/32 bits dont la premiere ligne est en haut:
+// la vue pointe sur les pixels BGR(A) du fichier, le GPU fait la permutation a l'envoi.
+// false pour une 32 bits sans bits d'alpha declares, a passer par le decodeur qui rend l'alpha opaque
+bool image_view_tga(const unsigned char *data, size_t size, texture_view *view);
 
 #endif
@@ -0,0 +1,210 @@
+
+#include "image.hpp"
+#include "stb_image.h"
+#include "thread_pool.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <vector>
+
+namespace
+{
+  int read_u16_be(const unsigned char* p) { return (p[0] << 8) | p[1]; }
+
+  int gcd(int a, int b)
+  {
+    while(b != 0)
+    {
+      const int r = a % b;
+      a = b;
+      b = r;
+    }
+    return a;
+  }
+
+  // decoupage d'une jpg baseline: en-tetes jusqu'au SOS, puis segments entropiques entre marqueurs RST
+  struct jpeg_layout
+  {
+    size_t sof;
+    size_t scan_begin;
+    size_t scan_end;
+    int width;
+    int height;
+    int nb_component;
+    int mcu_width;
+    int mcu_height;
+    int restart_interval;
+    // debut de chaque intervalle de redemarrage dans le flux (juste apres son marqueur RST)
+    std::vector<size_t> intervals;
+  };
+
+  bool parse_layout(const unsigned char* data, size_t size, jpeg_layout* layout)
+  {
+    if(size < 4 || data[0] != 0xFF || data[1] != 0xD8)
+      return false;
+    layout->sof = 0;
+    layout->restart_interval = 0;
+
+    size_t p = 2;
+    int hmax = 1, vmax = 1;
+    for(;;)
+    {
+      if(p + 4 > size || data[p] != 0xFF)
+        return false;
+      const int marker = data[p + 1];
+      if(marker == 0xFF)
+      {
+        ++p;
+        continue;
+      }
+      const size_t end = p + 2 + read_u16_be(data + p + 2);
+      if(end > size)
+        return false;
+
+      if(marker == 0xC0 || marker == 0xC1)
+      {
+        if(end - p < 10)
+          return false;
+        layout->sof = p;
+        layout->height = read_u16_be(data + p + 5);
+        layout->width = read_u16_be(data + p + 7);
+        layout->nb_component = data[p + 9];
+        if(end - p < 10 + 3*static_cast<size_t>(layout->nb_component))
+          return false;
+        for(int c = 0; c < layout->nb_component; ++c)
+        {
+          hmax = std::max(hmax, data[p + 11 + 3*c] >> 4);
+          vmax = std::max(vmax, data[p + 11 + 3*c] & 15);
+        }
+      }
+      else if(marker >= 0xC2 && marker <= 0xCF && marker != 0xC4 && marker != 0xC8 && marker != 0xCC)
+        return false; // progressive, sans perte ou arithmetique: un seul flux a lire dans l'ordre
+      else if(marker == 0xDD)
+        layout->restart_interval = read_u16_be(data + p + 4);
+      else if(marker == 0xDA)
+      {
+        // un seul balayage entrelace couvrant toutes les composantes
+        if(layout->sof == 0 || data[p + 4] != layout->nb_component)
+          return false;
+        layout->scan_begin = end;
+        break;
+      }
+      p = end;
+    }
+    if(layout->restart_interval == 0 || layout->width == 0 || layout->height == 0 ||
+       (layout->nb_component != 1 && layout->nb_component != 3))
+      return false;
+
+    // une composante seule n'est pas entrelacee: un bloc 8x8 par MCU
+    layout->mcu_width = layout->nb_component == 1 ? 8 : 8*hmax;
+    layout->mcu_height = layout->nb_component == 1 ? 8 : 8*vmax;
+
+    // marqueurs RST dans le flux; 0xFF00 est un octet de donnees, tout autre marqueur termine le balayage
+    layout->intervals.assign(1, layout->scan_begin);
+    layout->scan_end = size;
+    for(size_t q = layout->scan_begin; q + 1 < size;)
+    {
+      const unsigned char* ff = static_cast<const unsigned char*>(std::memchr(data + q, 0xFF, size - 1 - q));
+      if(ff == nullptr)
+        break;
+      q = ff - data;
+      const int next = data[q + 1];
+      if(next == 0x00)
+        q += 2;
+      else if(next >= 0xD0 && next <= 0xD7)
+      {
+        q += 2;
+        layout->intervals.push_back(q);
+      }
+      else if(next == 0xFF)
+        ++q;
+      else
+      {
+        layout->scan_end = q;
+        break;
+      }
+    }
+
+    const size_t nb_mcu = static_cast<size_t>((layout->width + layout->mcu_width - 1)/layout->mcu_width)*
+                          ((layout->height + layout->mcu_height - 1)/layout->mcu_height);
+    return layout->intervals.size() == (nb_mcu + layout->restart_interval - 1)/layout->restart_interval;
+  }
+}
+
+Image *image_decode_jpeg_strips(const unsigned char* data, size_t size)
+{
+  jpeg_layout layout;
+  if(!parse_layout(data, size, &layout))
+    return nullptr;
+
+  const int mcu_per_row = (layout.width + layout.mcu_width - 1)/layout.mcu_width;
+  const int mcu_rows = (layout.height + layout.mcu_height - 1)/layout.mcu_height;
+  const int R = layout.restart_interval;
+  // une bande commence sur une ligne de MCU qui commence aussi un intervalle de redemarrage
+  const int unit = R/gcd(R, mcu_per_row);
+  const int nb_unit = (mcu_rows + unit - 1)/unit;
+
+  // au moins 256 Kpixels par bande: en dessous, le decoupage coute plus qu'il ne rapporte
+  const int nb_strip = std::min(nb_unit, std::min(static_cast<int>(default_thread_pool().size()) + 1,
+                                                  static_cast<int>(static_cast<long long>(layout.width)*layout.height/(256*1024))));
+  if(nb_strip < 2)
+    return nullptr;
+
+  const int channels = layout.nb_component;
+  const size_t row_size = static_cast<size_t>(channels)*layout.width;
+  unsigned char* pixels = new unsigned char[row_size*layout.height];
+  std::atomic<bool> failed(false);
+
+  parallel_for(0, nb_strip, 1, [&](int begin, int end) {
+    for(int s = begin; s < end && !failed.load(); ++s)
+    {
+      // lignes de MCU gardees [a,b[, decodees [a0,b0[: une unite de plus de chaque cote pour que
+      // le suressantillonnage de la chrominance voie les memes voisins que dans l'image entiere
+      const int a = unit*(nb_unit*s/nb_strip);
+      const int b = std::min(mcu_rows, unit*(nb_unit*(s + 1)/nb_strip));
+      const int a0 = std::max(0, a - unit);
+      const int b0 = std::min(mcu_rows, b + unit);
+      const size_t first = static_cast<size_t>(a0)*mcu_per_row/R;
+      const size_t last = (static_cast<size_t>(b0)*mcu_per_row + R - 1)/R;
+      const size_t scan_begin = layout.intervals[first];
+      const size_t scan_end = last < layout.intervals.size() ? layout.intervals[last] - 2 : layout.scan_end;
+      const int y0 = a0*layout.mcu_height;
+      const int strip_height = std::min(layout.height, b0*layout.mcu_height) - y0;
+
+      // jpg autonome: memes en-tetes (hauteur corrigee), segments entropiques de la bande, EOI
+      std::vector<unsigned char> strip;
+      strip.reserve(layout.scan_begin + scan_end - scan_begin + 2);
+      strip.insert(strip.end(), data, data + layout.scan_begin);
+      strip[layout.sof + 5] = static_cast<unsigned char>(strip_height >> 8);
+      strip[layout.sof + 6] = static_cast<unsigned char>(strip_height & 255);
+      strip.insert(strip.end(), data + scan_begin, data + scan_end);
+      strip.push_back(0xFF);
+      strip.push_back(0xD9);
+
+      int width = 0, height = 0, comp = 0;
+      unsigned char* decoded = stbi_load_from_memory(&strip[0], static_cast<int>(strip.size()), &width, &height, &comp, 0);
+      if(decoded == nullptr || width != layout.width || height != strip_height || comp != channels)
+        failed = true;
+      else
+      {
+        const int y = a*layout.mcu_height;
+        const int nb_row = std::min(layout.height, b*layout.mcu_height) - y;
+        std::memcpy(pixels + row_size*y, decoded + row_size*(y - y0), row_size*nb_row);
+      }
+      stbi_image_free(decoded);
+    }
+  });
+
+  if(failed.load())
+  {
+    delete[] pixels;
+    return nullptr;
+  }
+  Image* im = new Image;
+  im->width = layout.width;
+  im->height = layout.height;
+  im->data = pixels;
+  im->type = channels == 3 ? IMAGE_TYPE_RGB : IMAGE_TYPE_GRAY;
+  return im;
+}
@@ -0,0 +1,226 @@
+
+#include "ktx.hpp"
+
+#include "mapped_file.hpp"
+#include "texture_compress.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+namespace
+{
+  const unsigned char ktx_identifier[12]={0xAB,'K','T','X',' ','1','1',0xBB,'\r','\n',0x1A,'\n'};
+
+  /** en-tete KTX 1.1 apres l'identifiant (13 mots de 32 bits) */
+  struct ktx_header
+  {
+    unsigned int endianness;
+    unsigned int gl_type;
+    unsigned int gl_type_size;
+    unsigned int gl_format;
+    unsigned int gl_internal_format;
+    unsigned int gl_base_internal_format;
+    unsigned int width;
+    unsigned int height;
+    unsigned int depth;
+    unsigned int nb_array_element;
+    unsigned int nb_face;
+    unsigned int nb_mipmap_level;
+    unsigned int bytes_key_value;
+  };
+
+  /** Taille d'un niveau width x height pour les formats acceptes (RGBA8, blocs BC1/3/4/5) comme
+   *  parse_dds_view la calcule, 0 pour tout autre triplet format interne / format / type */
+  size_t level_bytes(const texture_view& texture,unsigned int width,unsigned int height)
+  {
+    block_format format=block_bc1;
+    if(texture.gl_format==0 && texture.gl_type==0 && block_format_of(texture.gl_internal_format,&format))
+      return block_size(format)*((width+3)/4)*((height+3)/4);
+    if(texture.gl_internal_format==texture_gl_rgba8 && texture.gl_type==texture_gl_unsigned_byte &&
+       (texture.gl_format==texture_gl_rgba || texture.gl_format==texture_gl_bgra))
+      return 4*static_cast<size_t>(width)*height;
+    return 0;
+  }
+
+  /** Au dela de toute taille de texture OpenGL; borne aussi les tailles de niveau calculees */
+  const unsigned int ktx_max_size=65536;
+
+  const unsigned char ktx2_identifier[12]={0xAB,'K','T','X',' ','2','0',0xBB,'\r','\n',0x1A,'\n'};
+
+  /** en-tete KTX 2.0 apres l'identifiant, suivi de l'index des descripteurs */
+  struct ktx2_header
+  {
+    unsigned int vk_format;
+    unsigned int type_size;
+    unsigned int pixel_width;
+    unsigned int pixel_height;
+    unsigned int pixel_depth;
+    unsigned int layer_count;
+    unsigned int face_count;
+    unsigned int level_count;
+    unsigned int supercompression_scheme;
+    unsigned int dfd_byte_offset;
+    unsigned int dfd_byte_length;
+    unsigned int kvd_byte_offset;
+    unsigned int kvd_byte_length;
+    //decalage et taille 64 bits, en deux mots pour garder l'en-tete sans remplissage
+    unsigned int sgd_byte_offset[2];
+    unsigned int sgd_byte_length[2];
+  };
+
+  void append(std::vector<unsigned char>& data,const void* p,size_t size)
+  {
+    const unsigned char* c=static_cast<const unsigned char*>(p);
+    data.insert(data.end(),c,c+size);
+  }
+}
+
+std::vector<unsigned char> serialize_ktx(const texture_data& texture)
+{
+  ktx_header header;
+  std::memset(&header,0,sizeof(header));
+  header.endianness=0x04030201;
+  header.gl_type=texture.gl_type;
+  header.gl_type_size=1;
+  header.gl_format=texture.gl_format;
+  header.gl_internal_format=texture.gl_internal_format;
+  header.gl_base_internal_format=texture.compressed() ? texture_gl_rgba : texture.gl_format;
+  header.width=texture.levels.empty() ? 0 : texture.levels[0].width;
+  header.height=texture.levels.empty() ? 0 : texture.levels[0].height;
+  header.nb_face=1;
+  header.nb_mipmap_level=texture.levels.size();
+
+  std::vector<unsigned char> data;
+  append(data,ktx_identifier,sizeof(ktx_identifier));
+  append(data,&header,sizeof(header));
+  for(unsigned int k=0;k<texture.levels.size();++k)
+  {
+    const std::vector<unsigned char>& level=texture.levels[k].data;
+    const unsigned int size=level.size();
+    append(data,&size,sizeof(size));
+    if(size>0)
+      append(data,&level[0],size);
+    //chaque niveau commence sur 4 octets
+    data.resize((data.size()+3)&~static_cast<size_t>(3),0);
+  }
+  return data;
+}
+
+void save_ktx(const std::string& filename,const texture_data& texture)
+{
+  std::ofstream fid(filename.c_str(),std::ios::binary);
+  if(!fid.good())
+    throw std::string("Cannot open file "+filename);
+  const std::vector<unsigned char> data=serialize_ktx(texture);
+  fid.write(reinterpret_cast<const char*>(&data[0]),data.size());
+}
+
+bool parse_ktx_view(const unsigned char* data,size_t size,texture_view* texture)
+{
+  if(size<sizeof(ktx_identifier)+sizeof(ktx_header) || std::memcmp(data,ktx_identifier,sizeof(ktx_identifier))!=0)
+    return false;
+  ktx_header header;
+  std::memcpy(&header,data+sizeof(ktx_identifier),sizeof(header));
+  if(header.endianness!=0x04030201 || header.depth>1 || header.nb_array_element>0 || header.nb_face!=1 ||
+     header.width==0 || header.height==0 || header.width>ktx_max_size || header.height>ktx_max_size || header.nb_mipmap_level>32)
+    return false;
+
+  size_t offset=sizeof(ktx_identifier)+sizeof(header);
+  if(header.bytes_key_value>size-offset)
+    return false;
+  offset+=header.bytes_key_value;
+  texture->gl_internal_format=header.gl_internal_format;
+  texture->gl_format=header.gl_format;
+  texture->gl_type=header.gl_type;
+  texture->levels.resize(std::max(1u,header.nb_mipmap_level));
+  for(unsigned int k=0;k<texture->levels.size();++k)
+  {
+    unsigned int level_size=0;
+    if(offset+sizeof(level_size)>size)
+      return false;
+    std::memcpy(&level_size,data+offset,sizeof(level_size));
+    offset+=sizeof(level_size);
+    if(level_size>size-offset)
+      return false;
+
+    texture_level_view& level=texture->levels[k];
+    level.width=std::max(1u,header.width>>k);
+    level.height=std::max(1u,header.height>>k);
+    const size_t expected=level_bytes(*texture,level.width,level.height);
+    if(expected==0 || level_size<expected)
+      return false;
+    level.data=data+offset;
+    level.size=expected;
+    offset=(offset+level_size+3)&~static_cast<size_t>(3);
+  }
+  return true;
+}
+
+bool parse_ktx2_view(const unsigned char* data,size_t size,texture_view* texture)
+{
+  if(size<sizeof(ktx2_identifier)+sizeof(ktx2_header) || std::memcmp(data,ktx2_identifier,sizeof(ktx2_identifier))!=0)
+    return false;
+  ktx2_header header;
+  std::memcpy(&header,data+sizeof(ktx2_identifier),sizeof(header));
+  if(header.pixel_depth>1 || header.layer_count>0 || header.face_count!=1 || header.supercompression_scheme!=0 ||
+     header.pixel_width==0 || header.pixel_height==0 || header.pixel_width>ktx_max_size || header.pixel_height>ktx_max_size ||
+     header.level_count>32)
+    return false;
+
+  //formats Vulkan vers constantes OpenGL
+  switch(header.vk_format)
+  {
+  case 37:  //VK_FORMAT_R8G8B8A8_UNORM
+    texture->gl_internal_format=texture_gl_rgba8;
+    texture->gl_format=texture_gl_rgba;
+    texture->gl_type=texture_gl_unsigned_byte;
+    break;
+  case 131: texture->gl_internal_format=0x83F0; texture->gl_format=0; texture->gl_type=0; break; //BC1_RGB_UNORM
+  case 137: texture->gl_internal_format=0x83F3; texture->gl_format=0; texture->gl_type=0; break; //BC3_UNORM
+  case 139: texture->gl_internal_format=0x8DBB; texture->gl_format=0; texture->gl_type=0; break; //BC4_UNORM
+  case 141: texture->gl_internal_format=0x8DBD; texture->gl_format=0; texture->gl_type=0; break; //BC5_UNORM
+  default:
+    return false;
+  }
+
+  //index des niveaux: decalage, taille et taille decompressee (64 bits chacun) par niveau
+  const unsigned int nb_level=std::max(1u,header.level_count);
+  const size_t index_offset=sizeof(ktx2_identifier)+sizeof(ktx2_header);
+  if(index_offset+24*static_cast<size_t>(nb_level)>size)
+    return false;
+  texture->levels.resize(nb_level);
+  for(unsigned int k=0;k<nb_level;++k)
+  {
+    unsigned long long level_offset=0,level_size=0;
+    std::memcpy(&level_offset,data+index_offset+24*k,8);
+    std::memcpy(&level_size,data+index_offset+24*k+8,8);
+    if(level_offset>size || level_size>size-level_offset)
+      return false;
+
+    texture_level_view& level=texture->levels[k];
+    level.width=std::max(1u,header.pixel_width>>k);
+    level.height=std::max(1u,header.pixel_height>>k);
+    const size_t expected=level_bytes(*texture,level.width,level.height);
+    if(level_size<expected)
+      return false;
+    level.data=data+level_offset;
+    level.size=expected;
+  }
+  return true;
+}
+
+bool parse_ktx(const unsigned char* data,size_t size,texture_data* texture)
+{
+  texture_view view;
+  if(!parse_ktx_view(data,size,&view))
+    return false;
+  *texture=copy_of(view);
+  return true;
+}
+
+bool load_ktx(const std::string& filename,texture_data* texture)
+{
+  mapped_file file(filename);
+  return file.is_open() && parse_ktx(reinterpret_cast<const unsigned char*>(file.data()),file.size(),texture);
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#ifndef KTX_HPP
+#define KTX_HPP
+
+#include "texture_data.hpp"
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+/** Serialise une texture au format KTX 1.1 (en-tete, puis taille et pixels de chaque niveau) */
+std::vector<unsigned char> serialize_ktx(const texture_data& texture);
+/** Ecrit une texture dans un fichier KTX */
+void save_ktx(const std::string& filename,const texture_data& texture);
+
+/** Lit sur place une texture KTX 1.1 (2D, une face) ecrite dans l'ordre des octets de la machine:
+ *  les niveaux de la vue pointent dans data. Renvoie false si le contenu n'est pas reconnu ou est tronque. */
+bool parse_ktx_view(const unsigned char* data,size_t size,texture_view* texture);
+/** Idem pour KTX 2.0 sans supercompression, formats Vulkan RGBA8, BC1, BC3, BC4 et BC5 (UNORM) */
+bool parse_ktx2_view(const unsigned char* data,size_t size,texture_view* texture);
+/** Copie d'une texture KTX 1.1 */
+bool parse_ktx(const unsigned char* data,size_t size,texture_data* texture);
+/** Relit un fichier KTX projete en memoire */
+bool load_ktx(const std::string& filename,texture_data* texture);
+
+#endif
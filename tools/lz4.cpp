@@ -0,0 +1,247 @@
+
+#include "lz4.hpp"
+
+#include "thread_pool.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+  const size_t min_match=4;
+  //les 5 derniers octets sont toujours des litteraux et une copie commence au plus 12 octets avant la fin
+  const size_t last_literals=5;
+  const size_t match_limit=12;
+  const int hash_bits=14;
+  const size_t max_offset=65535;
+
+  unsigned int read32(const unsigned char* p)
+  {
+    unsigned int v;
+    std::memcpy(&v,p,4);
+    return v;
+  }
+
+  unsigned int hash_sequence(unsigned int v)
+  {
+    return (v*2654435761u)>>(32-hash_bits);
+  }
+
+  /** longueur au dela de 15: suite d'octets 255 terminee par un octet <255 */
+  unsigned char* write_length(unsigned char* op,size_t length)
+  {
+    while(length>=255)
+    {
+      *op++=255;
+      length-=255;
+    }
+    *op++=static_cast<unsigned char>(length);
+    return op;
+  }
+
+  bool read_length(const unsigned char*& ip,const unsigned char* end,size_t* length)
+  {
+    unsigned char c;
+    do
+    {
+      if(ip>=end)
+        return false;
+      c=*ip++;
+      *length+=c;
+    } while(c==255);
+    return true;
+  }
+
+  unsigned char* write_sequence(unsigned char* op,const unsigned char* literals,size_t nb_literal,size_t offset,size_t match_length)
+  {
+    unsigned char* token=op++;
+    *token=static_cast<unsigned char>((nb_literal>=15 ? 15 : nb_literal)<<4);
+    if(nb_literal>=15)
+      op=write_length(op,nb_literal-15);
+    std::memcpy(op,literals,nb_literal);
+    op+=nb_literal;
+
+    //derniere sequence: litteraux seuls
+    if(match_length==0)
+      return op;
+
+    *op++=static_cast<unsigned char>(offset&0xFF);
+    *op++=static_cast<unsigned char>(offset>>8);
+    const size_t m=match_length-min_match;
+    *token|=static_cast<unsigned char>(m>=15 ? 15 : m);
+    if(m>=15)
+      op=write_length(op,m-15);
+    return op;
+  }
+}
+
+size_t lz4_compress_bound(size_t size)
+{
+  return size+size/255+16;
+}
+
+size_t lz4_compress(const unsigned char* src,size_t size,unsigned char* dst,size_t capacity)
+{
+  if(capacity<lz4_compress_bound(size))
+    return 0;
+
+  unsigned char* op=dst;
+  size_t anchor=0;
+  if(size>match_limit)
+  {
+    std::vector<int> table(1<<hash_bits,-1);
+    size_t ip=0;
+    const size_t ip_limit=size-match_limit;
+    while(ip<ip_limit)
+    {
+      const unsigned int sequence=read32(src+ip);
+      const unsigned int h=hash_sequence(sequence);
+      const int ref=table[h];
+      table[h]=static_cast<int>(ip);
+
+      if(ref<0 || ip-ref>max_offset || read32(src+ref)!=sequence)
+      {
+        //les zones peu compressibles sont parcourues de plus en plus vite
+        ip+=1+((ip-anchor)>>6);
+        continue;
+      }
+
+      size_t match_length=min_match;
+      while(ip+match_length<size-last_literals && src[ref+match_length]==src[ip+match_length])
+        ++match_length;
+
+      op=write_sequence(op,src+anchor,ip-anchor,ip-ref,match_length);
+      ip+=match_length;
+      anchor=ip;
+    }
+  }
+  op=write_sequence(op,src+anchor,size-anchor,0,0);
+  return op-dst;
+}
+
+bool lz4_decompress(const unsigned char* src,size_t size,unsigned char* dst,size_t raw_size)
+{
+  const unsigned char* ip=src;
+  const unsigned char* const ip_end=src+size;
+  unsigned char* op=dst;
+  unsigned char* const op_end=dst+raw_size;
+
+  while(ip<ip_end)
+  {
+    const unsigned char token=*ip++;
+
+    size_t nb_literal=token>>4;
+    if(nb_literal==15 && !read_length(ip,ip_end,&nb_literal))
+      return false;
+    if(nb_literal>static_cast<size_t>(ip_end-ip) || nb_literal>static_cast<size_t>(op_end-op))
+      return false;
+    //copie de taille fixe quand il reste de la marge (cas courant des sequences courtes)
+    if(nb_literal<=16 && ip_end-ip>=16 && op_end-op>=16)
+      std::memcpy(op,ip,16);
+    else
+      std::memcpy(op,ip,nb_literal);
+    ip+=nb_literal;
+    op+=nb_literal;
+
+    if(ip==ip_end)
+      break;
+
+    if(ip_end-ip<2)
+      return false;
+    const size_t offset=ip[0]|(ip[1]<<8);
+    ip+=2;
+    if(offset==0 || offset>static_cast<size_t>(op-dst))
+      return false;
+
+    size_t match_length=token&15;
+    if(match_length==15 && !read_length(ip,ip_end,&match_length))
+      return false;
+    match_length+=min_match;
+    if(match_length>static_cast<size_t>(op_end-op))
+      return false;
+
+    //une copie peut recouvrir sa propre sortie (offset<longueur): copie octet par octet
+    const unsigned char* match=op-offset;
+    if(offset>=16 && match_length<=16 && op_end-op>=16)
+      std::memcpy(op,match,16);
+    else if(offset>=match_length)
+      std::memcpy(op,match,match_length);
+    else
+      for(size_t k=0;k<match_length;++k)
+        op[k]=match[k];
+    op+=match_length;
+  }
+  return op==op_end;
+}
+
+std::vector<unsigned char> lz4_compress_blocks(const void* data,size_t size,size_t block_size)
+{
+  const unsigned char* src=static_cast<const unsigned char*>(data);
+  const unsigned int nb_block=static_cast<unsigned int>((size+block_size-1)/block_size);
+
+  //chaque bloc est compresse dans son propre tampon, puis les tampons sont concatenes
+  std::vector<std::vector<unsigned char> > blocks(nb_block);
+  parallel_for(0,nb_block,1,[&](int k_begin,int k_end) {
+    for(int k=k_begin;k<k_end;++k)
+    {
+      const size_t begin=k*block_size;
+      const size_t n=std::min(block_size,size-begin);
+      std::vector<unsigned char>& block=blocks[k];
+      block.resize(lz4_compress_bound(n));
+      const size_t compressed=lz4_compress(src+begin,n,&block[0],block.size());
+      if(compressed>=n)
+        block.assign(src+begin,src+begin+n);
+      else
+        block.resize(compressed);
+    }
+  });
+
+  std::vector<unsigned char> stream(8+4*nb_block);
+  const unsigned int block_size_u32=static_cast<unsigned int>(block_size);
+  std::memcpy(&stream[0],&nb_block,4);
+  std::memcpy(&stream[4],&block_size_u32,4);
+  for(unsigned int k=0;k<nb_block;++k)
+  {
+    const unsigned int n=blocks[k].size();
+    std::memcpy(&stream[8+4*k],&n,4);
+  }
+  for(unsigned int k=0;k<nb_block;++k)
+    stream.insert(stream.end(),blocks[k].begin(),blocks[k].end());
+  return stream;
+}
+
+bool lz4_decompress_blocks(const unsigned char* src,size_t size,unsigned char* dst,size_t raw_size)
+{
+  if(size<8)
+    return false;
+  const unsigned int nb_block=read32(src);
+  const size_t block_size=read32(src+4);
+  if(block_size==0 || size<8+4*static_cast<size_t>(nb_block) || (raw_size+block_size-1)/block_size!=nb_block)
+    return false;
+
+  //position de chaque bloc compresse
+  std::vector<size_t> offset(nb_block+1);
+  offset[0]=8+4*static_cast<size_t>(nb_block);
+  for(unsigned int k=0;k<nb_block;++k)
+    offset[k+1]=offset[k]+read32(src+8+4*k);
+  if(offset[nb_block]!=size)
+    return false;
+
+  std::vector<char> valid(nb_block,1);
+  parallel_for(0,nb_block,1,[&](int k_begin,int k_end) {
+    for(int k=k_begin;k<k_end;++k)
+    {
+      const size_t begin=k*block_size;
+      const size_t n=std::min(block_size,raw_size-begin);
+      const size_t compressed=offset[k+1]-offset[k];
+      if(compressed==n)
+        std::memcpy(dst+begin,src+offset[k],n);
+      else
+        valid[k]=lz4_decompress(src+offset[k],compressed,dst+begin,n);
+    }
+  });
+  for(unsigned int k=0;k<nb_block;++k)
+    if(!valid[k])
+      return false;
+  return true;
+}
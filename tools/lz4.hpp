@@ -0,0 +1,29 @@
+#pragma once
+
+#ifndef LZ4_HPP
+#define LZ4_HPP
+
+#include <cstddef>
+#include <vector>
+
+/** Compression rapide au format de bloc LZ4 (sequences litteraux + copie a distance <64Ko).
+ *
+ *  Le flux par blocs decoupe les donnees en blocs independants de taille fixe,
+ *  compresses et decompresses en parallele:
+ *    nombre de blocs, taille d'un bloc, taille compressee de chaque bloc, blocs.
+ *  Un bloc que la compression n'a pas reduit est stocke tel quel (taille compressee == taille du bloc).
+ */
+
+/** Taille maximale du resultat de lz4_compress pour size octets */
+size_t lz4_compress_bound(size_t size);
+/** Compresse un bloc, renvoie la taille compressee (0 si capacity est insuffisante) */
+size_t lz4_compress(const unsigned char* src,size_t size,unsigned char* dst,size_t capacity);
+/** Decompresse un bloc de raw_size octets, renvoie false si les donnees sont invalides */
+bool lz4_decompress(const unsigned char* src,size_t size,unsigned char* dst,size_t raw_size);
+
+/** Compresse des donnees en flux de blocs independants (en parallele) */
+std::vector<unsigned char> lz4_compress_blocks(const void* data,size_t size,size_t block_size=64*1024);
+/** Decompresse un flux de blocs directement dans dst (en parallele), renvoie false si le flux est invalide */
+bool lz4_decompress_blocks(const unsigned char* src,size_t size,unsigned char* dst,size_t raw_size);
+
+#endif
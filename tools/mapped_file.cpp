@@ -0,0 +1,147 @@
+
+#include "mapped_file.hpp"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+
+mapped_file::mapped_file()
+  :content(nullptr),content_size(0),opened(false)
+#ifdef _WIN32
+  ,file_handle(nullptr),mapping_handle(nullptr)
+#endif
+{}
+
+mapped_file::mapped_file(const std::string& filename)
+  :content(nullptr),content_size(0),opened(false)
+#ifdef _WIN32
+  ,file_handle(nullptr),mapping_handle(nullptr)
+#endif
+{
+  open(filename);
+}
+
+mapped_file::~mapped_file()
+{
+  close();
+}
+
+#ifdef _WIN32
+
+bool mapped_file::open(const std::string& filename)
+{
+  close();
+
+  HANDLE file=CreateFileA(filename.c_str(),GENERIC_READ,FILE_SHARE_READ,nullptr,OPEN_EXISTING,FILE_FLAG_SEQUENTIAL_SCAN,nullptr);
+  if(file==INVALID_HANDLE_VALUE)
+    return false;
+
+  LARGE_INTEGER size;
+  if(!GetFileSizeEx(file,&size))
+  {
+    CloseHandle(file);
+    return false;
+  }
+
+  file_handle=file;
+  opened=true;
+  content_size=static_cast<size_t>(size.QuadPart);
+  if(content_size==0)
+    return true;
+
+  mapping_handle=CreateFileMappingA(file,nullptr,PAGE_READONLY,0,0,nullptr);
+  if(mapping_handle!=nullptr)
+    content=static_cast<const char*>(MapViewOfFile(mapping_handle,FILE_MAP_READ,0,0,0));
+  if(content==nullptr)
+  {
+    close();
+    return false;
+  }
+  return true;
+}
+
+void mapped_file::close()
+{
+  if(content!=nullptr)
+    UnmapViewOfFile(content);
+  if(mapping_handle!=nullptr)
+    CloseHandle(mapping_handle);
+  if(file_handle!=nullptr)
+    CloseHandle(file_handle);
+  content=nullptr;
+  content_size=0;
+  opened=false;
+  file_handle=nullptr;
+  mapping_handle=nullptr;
+}
+
+#else
+
+bool mapped_file::open(const std::string& filename)
+{
+  close();
+
+  const int fd=::open(filename.c_str(),O_RDONLY);
+  if(fd<0)
+    return false;
+
+  struct stat info;
+  if(fstat(fd,&info)!=0)
+  {
+    ::close(fd);
+    return false;
+  }
+
+  content_size=static_cast<size_t>(info.st_size);
+  if(content_size>0)
+  {
+    void* p=mmap(nullptr,content_size,PROT_READ,MAP_PRIVATE,fd,0);
+    if(p==MAP_FAILED)
+    {
+      ::close(fd);
+      content_size=0;
+      return false;
+    }
+    madvise(p,content_size,MADV_SEQUENTIAL);
+    content=static_cast<const char*>(p);
+  }
+
+  //la projection reste valide apres fermeture du descripteur
+  ::close(fd);
+  opened=true;
+  return true;
+}
+
+void mapped_file::close()
+{
+  if(content!=nullptr)
+    munmap(const_cast<char*>(content),content_size);
+  content=nullptr;
+  content_size=0;
+  opened=false;
+}
+
+#endif
+
+bool mapped_file::is_open() const
+{
+  return opened;
+}
+
+const char* mapped_file::data() const
+{
+  return content;
+}
+
+size_t mapped_file::size() const
+{
+  return content_size;
+}
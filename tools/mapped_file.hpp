@@ -0,0 +1,45 @@
+#pragma once
+
+#ifndef MAPPED_FILE_HPP
+#define MAPPED_FILE_HPP
+
+#include <cstddef>
+#include <string>
+
+/** Un fichier projete en memoire en lecture seule (mmap / MapViewOfFile).
+ *  Les pages ne sont lues qu'au premier acces, sans copie dans un tampon intermediaire. */
+class mapped_file
+{
+public:
+  /** Constructeur fichier non ouvert */
+  mapped_file();
+  /** Ouvre et projette le fichier, is_open() indique le succes */
+  explicit mapped_file(const std::string& filename);
+  ~mapped_file();
+
+  /** Ouvre et projette le fichier (ferme le precedent), renvoie false en cas d'echec */
+  bool open(const std::string& filename);
+  /** Libere la projection */
+  void close();
+
+  /** Indique si le fichier est projete */
+  bool is_open() const;
+  /** Debut du contenu (nullptr pour un fichier vide) */
+  const char* data() const;
+  /** Taille du contenu en octets */
+  size_t size() const;
+
+private:
+  mapped_file(const mapped_file&);
+  mapped_file& operator=(const mapped_file&);
+
+  const char* content;
+  size_t content_size;
+  bool opened;
+#ifdef _WIN32
+  void* file_handle;
+  void* mapping_handle;
+#endif
+};
+
+#endif
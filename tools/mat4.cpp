@@ -88,6 +88,42 @@ mat4 transpose(const mat4& m)
       m(0,3),m(1,3),m(2,3),m(3,3));
 }
 
+mat4 inverse(const mat4& m)
+{
+  //developpement par cofacteurs sur le tableau colonne majeur
+  const float* a=m.M;
+  float inv[16];
+
+  inv[0]  =  a[5]*a[10]*a[15]-a[5]*a[11]*a[14]-a[9]*a[6]*a[15]+a[9]*a[7]*a[14]+a[13]*a[6]*a[11]-a[13]*a[7]*a[10];
+  inv[4]  = -a[4]*a[10]*a[15]+a[4]*a[11]*a[14]+a[8]*a[6]*a[15]-a[8]*a[7]*a[14]-a[12]*a[6]*a[11]+a[12]*a[7]*a[10];
+  inv[8]  =  a[4]*a[9]*a[15] -a[4]*a[11]*a[13]-a[8]*a[5]*a[15]+a[8]*a[7]*a[13]+a[12]*a[5]*a[11]-a[12]*a[7]*a[9];
+  inv[12] = -a[4]*a[9]*a[14] +a[4]*a[10]*a[13]+a[8]*a[5]*a[14]-a[8]*a[6]*a[13]-a[12]*a[5]*a[10]+a[12]*a[6]*a[9];
+  inv[1]  = -a[1]*a[10]*a[15]+a[1]*a[11]*a[14]+a[9]*a[2]*a[15]-a[9]*a[3]*a[14]-a[13]*a[2]*a[11]+a[13]*a[3]*a[10];
+  inv[5]  =  a[0]*a[10]*a[15]-a[0]*a[11]*a[14]-a[8]*a[2]*a[15]+a[8]*a[3]*a[14]+a[12]*a[2]*a[11]-a[12]*a[3]*a[10];
+  inv[9]  = -a[0]*a[9]*a[15] +a[0]*a[11]*a[13]+a[8]*a[1]*a[15]-a[8]*a[3]*a[13]-a[12]*a[1]*a[11]+a[12]*a[3]*a[9];
+  inv[13] =  a[0]*a[9]*a[14] -a[0]*a[10]*a[13]-a[8]*a[1]*a[14]+a[8]*a[2]*a[13]+a[12]*a[1]*a[10]-a[12]*a[2]*a[9];
+  inv[2]  =  a[1]*a[6]*a[15] -a[1]*a[7]*a[14] -a[5]*a[2]*a[15]+a[5]*a[3]*a[14]+a[13]*a[2]*a[7] -a[13]*a[3]*a[6];
+  inv[6]  = -a[0]*a[6]*a[15] +a[0]*a[7]*a[14] +a[4]*a[2]*a[15]-a[4]*a[3]*a[14]-a[12]*a[2]*a[7] +a[12]*a[3]*a[6];
+  inv[10] =  a[0]*a[5]*a[15] -a[0]*a[7]*a[13] -a[4]*a[1]*a[15]+a[4]*a[3]*a[13]+a[12]*a[1]*a[7] -a[12]*a[3]*a[5];
+  inv[14] = -a[0]*a[5]*a[14] +a[0]*a[6]*a[13] +a[4]*a[1]*a[14]-a[4]*a[2]*a[13]-a[12]*a[1]*a[6] +a[12]*a[2]*a[5];
+  inv[3]  = -a[1]*a[6]*a[11] +a[1]*a[7]*a[10] +a[5]*a[2]*a[11]-a[5]*a[3]*a[10]-a[9]*a[2]*a[7]  +a[9]*a[3]*a[6];
+  inv[7]  =  a[0]*a[6]*a[11] -a[0]*a[7]*a[10] -a[4]*a[2]*a[11]+a[4]*a[3]*a[10]+a[8]*a[2]*a[7]  -a[8]*a[3]*a[6];
+  inv[11] = -a[0]*a[5]*a[11] +a[0]*a[7]*a[9]  +a[4]*a[1]*a[11]-a[4]*a[3]*a[9] -a[8]*a[1]*a[7]  +a[8]*a[3]*a[5];
+  inv[15] =  a[0]*a[5]*a[10] -a[0]*a[6]*a[9]  -a[4]*a[1]*a[10]+a[4]*a[2]*a[9] +a[8]*a[1]*a[6]  -a[8]*a[2]*a[5];
+
+  const float det=a[0]*inv[0]+a[1]*inv[4]+a[2]*inv[8]+a[3]*inv[12];
+  mat4 res;
+  if(std::fabs(det)<1e-12f)
+  {
+    std::cout<<"Attention, matrice non inversible"<<std::endl;
+    return res;
+  }
+
+  for(int k=0;k<16;++k)
+    res.M[k]=inv[k]/det;
+  return res;
+}
+
 mat4 matrice_rotation(float angle,float axe_x,float axe_y,float axe_z)
 {
   const float n=std::sqrt(axe_x*axe_x+axe_y*axe_y+axe_z*axe_z);
@@ -45,6 +45,9 @@ const float *pointeur(const mat4& m);
 /** Calcule la transposee d'une matrice */
 mat4 transpose(const mat4& m);
 
+/** Calcule l'inverse d'une matrice (renvoie l'identite si la matrice n'est pas inversible) */
+mat4 inverse(const mat4& m);
+
 /** Construit une matrice de rotation ayant pour axe: (axe_x,axe_y,axe_z) et l'angle donne */
 mat4 matrice_rotation(float angle,float axe_x,float axe_y,float axe_z);
 
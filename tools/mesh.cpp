@@ -1,16 +1,17 @@
 
 #include "mesh.hpp"
 
+#include "half_edge.hpp"
 #include "mat4.hpp"
+#include "mesh_cache.hpp"
 
 #include "format/mesh_io_obj.hpp"
 #include "format/mesh_io_off.hpp"
+#include "format/mesh_io_ply.hpp"
 
 #include <cstdlib>
 #include <fstream>
 #include <sstream>
-#include <map>
-#include <list>
 #include <cmath>
 #include <algorithm>
 
@@ -18,59 +19,93 @@
 
 mesh load_off_file(const std::string& filename)
 {
-  return cpe::load_mesh_file_off(filename);
+  return load_mesh_cached(filename,mesh_processing(),cpe::load_mesh_file_off);
 }
 
 
 mesh load_obj_file(const std::string& filename)
 {
-  return cpe::load_mesh_file_obj(filename);
+  return load_mesh_cached(filename,mesh_processing(),cpe::load_mesh_file_obj);
+}
+
+
+mesh load_ply_file(const std::string& filename)
+{
+  return load_mesh_cached(filename,mesh_processing(),cpe::load_mesh_file_ply);
 }
 
 
 
 void update_normals(mesh* m)
+{
+  update_normals(m,build_half_edge_structure(m));
+}
+
+void update_normals(mesh* m,const half_edge_structure& he)
 {
   const std::vector<triangle_index>& c=m->connectivity;
 
-  //compute star
-  std::map<int,std::list<int> > star;
+  //compute per polygon normal, and the number of polygons around each vertex
+  std::vector<vec3> normal_polygon(c.size());
+  std::vector<unsigned int> valence(m->vertex.size(),0);
   for(unsigned int k=0,N=c.size();k<N;++k)
   {
     const triangle_index& t=c[k];
-    star[t.u0].push_back(k);
-    star[t.u1].push_back(k);
-    star[t.u2].push_back(k);
-  }
-
-  //compute per polygon normal
-  std::vector<vec3> normal_polygon;
-  normal_polygon.resize(m->connectivity.size());
-  for(unsigned int k=0,N=m->connectivity.size();k<N;++k)
-  {
-    const triangle_index& t=m->connectivity[k];
     const vec3& p0=m->vertex[t.u0].position;
     const vec3& p1=m->vertex[t.u1].position;
     const vec3& p2=m->vertex[t.u2].position;
 
     const vec3 u0=normalize(p1-p0);
     const vec3 u1=normalize(p2-p0);
-    const vec3 n=normalize(cross(u0,u1));
+    normal_polygon[k]=normalize(cross(u0,u1));
 
-    normal_polygon[k]=n;
+    valence[t.u0]++;
+    valence[t.u1]++;
+    valence[t.u2]++;
   }
 
-  //compute per vertex normal
+  //compute per vertex normal over its star
+  std::vector<int> star;
+  std::vector<bool> non_manifold(m->vertex.size(),false);
+  bool has_non_manifold=false;
   for(unsigned int k=0,N=m->vertex.size();k<N;++k)
   {
+    vertex_star(he,k,&star);
     vec3 temp_normal;
-    for(std::list<int>::const_iterator it=star[k].begin(),it_end=star[k].end();
-        it!=it_end;++it)
-      temp_normal += normal_polygon[*it];
-
+    for(unsigned int i=0;i<star.size();++i)
+      temp_normal+=normal_polygon[star[i]];
     m->vertex[k].normal=normalize(temp_normal);
+    non_manifold[k]=star.size()!=valence[k];
+    has_non_manifold=has_non_manifold || non_manifold[k];
   }
 
+  //a non-manifold vertex has several fans and the star walks only one: sum over every polygon instead
+  if(!has_non_manifold)
+    return;
+  std::vector<vec3> normal_vertex(m->vertex.size());
+  for(unsigned int k=0,N=c.size();k<N;++k)
+  {
+    const unsigned int* u=&c[k].u0;
+    for(int i=0;i<3;++i)
+      if(non_manifold[u[i]])
+        normal_vertex[u[i]]+=normal_polygon[k];
+  }
+  for(unsigned int k=0,N=m->vertex.size();k<N;++k)
+    if(non_manifold[k])
+      m->vertex[k].normal=normalize(normal_vertex[k]);
+}
+
+bool has_normals(const mesh* m)
+{
+  if(m->vertex.empty())
+    return false;
+  for(unsigned int k=0,N=m->vertex.size();k<N;++k)
+  {
+    const vec3& n=m->vertex[k].normal;
+    if(n.x==0.0f && n.y==0.0f && n.z==0.0f)
+      return false;
+  }
+  return true;
 }
 
 void fill_color(mesh* m,const vec3& color)
@@ -89,10 +124,21 @@ void fill_color_normal(mesh* m)
 
 void apply_deformation(mesh* m,const mat4 T)
 {
+  //partie lineaire de T pour les normales
+  mat4 L=T;
+  L(0,3)=L(1,3)=L(2,3)=0.0f;
+  L(3,0)=L(3,1)=L(3,2)=0.0f;
+  L(3,3)=1.0f;
+  const mat4 T_normal=transpose(inverse(L));
+
   for(unsigned int k=0,N=m->vertex.size();k<N;++k)
   {
     vec3& v=m->vertex[k].position;
     v=T*v;
+
+    vec3& n=m->vertex[k].normal;
+    if(n.x!=0.0f || n.y!=0.0f || n.z!=0.0f)
+      n=normalize(T_normal*n);
   }
 }
 
@@ -112,5 +158,9 @@ void get_aabb(const mesh* m, vec3* min, vec3* max)
     min->x = min->x > m->vertex[k].position.x ? m->vertex[k].position.x : min->x;
     min->y = min->y > m->vertex[k].position.y ? m->vertex[k].position.y : min->y;
     min->z = min->z > m->vertex[k].position.z ? m->vertex[k].position.z : min->z;
+
+    max->x = max->x < m->vertex[k].position.x ? m->vertex[k].position.x : max->x;
+    max->y = max->y < m->vertex[k].position.y ? m->vertex[k].position.y : max->y;
+    max->z = max->z < m->vertex[k].position.z ? m->vertex[k].position.z : max->z;
   }
 }
\ No newline at end of file
@@ -6,6 +6,7 @@
 #include <vector>
 #include <string>
 
+struct half_edge_structure;
 struct mat4;
 struct vec3;
 
@@ -19,19 +20,26 @@ struct mesh
   std::vector<triangle_index> connectivity;
 };
 
-/** chargement d'un fichier off */
+/** chargement d'un fichier off (relu depuis le cache binaire source.mesh quand il est a jour) */
 mesh load_off_file(const std::string& filename);
-/** chargement d'un fichier obj (gere potentiellement la texture) */
+/** chargement d'un fichier obj, gere potentiellement la texture (relu depuis le cache binaire source.mesh quand il est a jour) */
 mesh load_obj_file(const std::string& filename);
+/** chargement d'un fichier ply ascii ou binaire (relu depuis le cache binaire source.mesh quand il est a jour) */
+mesh load_ply_file(const std::string& filename);
 
-/** calcule les normales du maillage passe en parametre */
+/** calcule les normales du maillage passe en parametre (somme des normales des triangles de l'etoile de chaque sommet) */
 void update_normals(mesh* m);
+/** idem avec la structure de demi-aretes deja construite pour ce maillage */
+void update_normals(mesh* m,const half_edge_structure& he);
+/** indique si tous les sommets ont une normale (par exemple lue dans le fichier) */
+bool has_normals(const mesh* m);
 /** donne une couleur uniforme au maillage passe en parametre */
 void fill_color(mesh* m,const vec3& color);
 /** chaque sommet du maillage recoit une couleur correspondante a sa normale */
 void fill_color_normal(mesh* m);
 
-/** applique la matrice passee en parametre a l'ensemble des sommets du maillage */
+/** applique la matrice passee en parametre a l'ensemble des sommets du maillage
+ *  (les normales non nulles sont transformees par la transposee de l'inverse) */
 void apply_deformation(mesh* m,const mat4 T);
 /** inverse le sens de toutes les normales du maillage */
 void invert_normals(mesh* m);
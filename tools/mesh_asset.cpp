@@ -0,0 +1,152 @@
+
+#include "mesh_asset.hpp"
+
+#include "mapped_file.hpp"
+#include "mesh.hpp"
+
+#include <cstring>
+#include <fstream>
+
+namespace
+{
+  const char mesh_asset_magic[4]={'M','S','H','A'};
+  const unsigned int mesh_asset_version=1;
+
+  struct mesh_asset_header
+  {
+    char magic[4];
+    unsigned int version;
+    unsigned int vertex_size;
+    unsigned int nb_vertex;
+    unsigned int nb_index;
+    unsigned int index_size;
+    float bounds[6];
+  };
+}
+
+mesh_asset::mesh_asset()
+  :vertex(),index(),index_size(4),nb_index(0),bounds()
+{}
+
+mesh_asset build_mesh_asset(const mesh& m)
+{
+  mesh_asset asset;
+  asset.vertex=m.vertex;
+  asset.nb_index=3*m.connectivity.size();
+  asset.index_size=m.vertex.size()<=65536 ? 2 : 4;
+  asset.index.resize(asset.nb_index*asset.index_size);
+
+  for(unsigned int t=0;t<m.connectivity.size();++t)
+  {
+    const triangle_index& tri=m.connectivity[t];
+    const unsigned int u[3]={tri.u0,tri.u1,tri.u2};
+    for(int k=0;k<3;++k)
+    {
+      if(asset.index_size==2)
+      {
+        const unsigned short v=static_cast<unsigned short>(u[k]);
+        std::memcpy(&asset.index[(3*t+k)*2],&v,2);
+      }
+      else
+        std::memcpy(&asset.index[(3*t+k)*4],&u[k],4);
+    }
+  }
+
+  for(unsigned int k=0;k<m.vertex.size();++k)
+    extend(&asset.bounds,m.vertex[k].position);
+  return asset;
+}
+
+mesh mesh_from_asset(const mesh_asset& asset)
+{
+  mesh m;
+  m.vertex=asset.vertex;
+  m.connectivity.resize(asset.nb_index/3);
+  for(unsigned int t=0;t<m.connectivity.size();++t)
+  {
+    unsigned int u[3];
+    for(int k=0;k<3;++k)
+    {
+      if(asset.index_size==2)
+      {
+        unsigned short v;
+        std::memcpy(&v,&asset.index[(3*t+k)*2],2);
+        u[k]=v;
+      }
+      else
+        std::memcpy(&u[k],&asset.index[(3*t+k)*4],4);
+    }
+    m.connectivity[t]=triangle_index(u[0],u[1],u[2]);
+  }
+  return m;
+}
+
+std::vector<unsigned char> serialize_mesh_asset(const mesh_asset& asset)
+{
+  mesh_asset_header header;
+  std::memset(&header,0,sizeof(header));
+  std::memcpy(header.magic,mesh_asset_magic,sizeof(mesh_asset_magic));
+  header.version=mesh_asset_version;
+  header.vertex_size=sizeof(vertex_opengl);
+  header.nb_vertex=asset.vertex.size();
+  header.nb_index=asset.nb_index;
+  header.index_size=asset.index_size;
+  const float bounds[6]={asset.bounds.p_min.x,asset.bounds.p_min.y,asset.bounds.p_min.z,
+                         asset.bounds.p_max.x,asset.bounds.p_max.y,asset.bounds.p_max.z};
+  std::memcpy(header.bounds,bounds,sizeof(bounds));
+
+  const size_t size_vertex=asset.vertex.size()*sizeof(vertex_opengl);
+  std::vector<unsigned char> data(sizeof(header)+size_vertex+asset.index.size());
+  unsigned char* p=&data[0];
+  std::memcpy(p,&header,sizeof(header)); p+=sizeof(header);
+  if(size_vertex>0)         { std::memcpy(p,&asset.vertex[0],size_vertex); p+=size_vertex; }
+  if(!asset.index.empty())  { std::memcpy(p,&asset.index[0],asset.index.size()); }
+  return data;
+}
+
+bool deserialize_mesh_asset(const unsigned char* data,size_t size,mesh_asset* asset)
+{
+  mesh_asset_header header;
+  if(size<sizeof(header))
+    return false;
+  std::memcpy(&header,data,sizeof(header));
+  if(std::memcmp(header.magic,mesh_asset_magic,sizeof(mesh_asset_magic))!=0 || header.version!=mesh_asset_version ||
+     header.vertex_size!=sizeof(vertex_opengl) || (header.index_size!=2 && header.index_size!=4) || header.nb_index%3!=0)
+    return false;
+
+  const size_t size_vertex=static_cast<size_t>(header.nb_vertex)*sizeof(vertex_opengl);
+  const size_t size_index=static_cast<size_t>(header.nb_index)*header.index_size;
+  if(size!=sizeof(header)+size_vertex+size_index)
+    return false;
+
+  const unsigned char* p=data+sizeof(header);
+  asset->vertex.resize(header.nb_vertex);
+  asset->index.assign(p+size_vertex,p+size_vertex+size_index);
+  if(size_vertex>0)
+    std::memcpy(&asset->vertex[0],p,size_vertex);
+  asset->index_size=header.index_size;
+  asset->nb_index=header.nb_index;
+  asset->bounds=aabb(vec3(header.bounds[0],header.bounds[1],header.bounds[2]),vec3(header.bounds[3],header.bounds[4],header.bounds[5]));
+  return true;
+}
+
+void save_mesh_asset(const std::string& filename,const mesh_asset& asset)
+{
+  std::ofstream fid(filename.c_str(),std::ios::binary);
+  if(!fid.good())
+    throw std::string("Cannot open file "+filename);
+  const std::vector<unsigned char> data=serialize_mesh_asset(asset);
+  fid.write(reinterpret_cast<const char*>(&data[0]),data.size());
+}
+
+mesh_asset load_mesh_asset(const std::string& filename)
+{
+  mapped_file file(filename);
+  if(!file.is_open())
+    throw std::string("Cannot open file "+filename);
+
+  mesh_asset asset;
+  if(!deserialize_mesh_asset(reinterpret_cast<const unsigned char*>(file.data()),file.size(),&asset))
+    throw std::string("Invalid mesh asset file "+filename);
+  return asset;
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#ifndef MESH_ASSET_HPP
+#define MESH_ASSET_HPP
+
+#include "aabb.hpp"
+#include "vertex_opengl.hpp"
+
+#include <string>
+#include <vector>
+
+struct mesh;
+
+/** Un maillage pret pour le GPU, produit hors ligne par assetc.
+ *
+ *  Fichier: en-tete, sommets (vertex_opengl), indices sur 16 bits si le maillage
+ *  a moins de 65536 sommets et 32 bits sinon. */
+struct mesh_asset
+{
+  /** sommets dans l'ordre de leur premiere utilisation */
+  std::vector<vertex_opengl> vertex;
+  /** indices des triangles (3 par triangle) sur index_size octets */
+  std::vector<unsigned char> index;
+  /** 2 ou 4 */
+  unsigned int index_size;
+  /** nombre d'indices */
+  unsigned int nb_index;
+  /** boite englobante des sommets */
+  aabb bounds;
+
+  mesh_asset();
+};
+
+/** Construit l'asset a partir d'un maillage (indices 16 bits quand c'est possible) */
+mesh_asset build_mesh_asset(const mesh& m);
+/** Reconstruit un maillage a partir d'un asset */
+mesh mesh_from_asset(const mesh_asset& asset);
+
+/** Serialise l'asset dans un tampon binaire */
+std::vector<unsigned char> serialize_mesh_asset(const mesh_asset& asset);
+/** Relit un asset serialise (par exemple depuis un fichier projete), renvoie false si le tampon est invalide */
+bool deserialize_mesh_asset(const unsigned char* data,size_t size,mesh_asset* asset);
+/** Ecrit l'asset dans un fichier */
+void save_mesh_asset(const std::string& filename,const mesh_asset& asset);
+/** Relit un asset depuis un fichier (projete en memoire) */
+mesh_asset load_mesh_asset(const std::string& filename);
+
+#endif
@@ -0,0 +1,286 @@
+
+#include "mesh_cache.hpp"
+
+#include "asset_manifest.hpp"
+#include "bvh.hpp"
+#include "hash.hpp"
+#include "mapped_file.hpp"
+#include "mesh.hpp"
+#include "mesh_asset.hpp"
+#include "pack_file.hpp"
+#include "format/mesh_io_obj.hpp"
+#include "format/mesh_io_gltf.hpp"
+#include "format/mesh_io_off.hpp"
+#include "format/mesh_io_ply.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+namespace
+{
+  const char mesh_cache_magic[4]={'M','S','H','C'};
+  const unsigned int mesh_cache_version=1;
+
+  /** En-tete du fichier cache, suivi des sommets (vertex_opengl) puis des triangles (3 x 32 bits) */
+  struct mesh_cache_header
+  {
+    char magic[4];
+    unsigned int version;
+    unsigned int vertex_size;
+    unsigned int nb_vertex;
+    unsigned int nb_triangle;
+    unsigned int reserved;
+    unsigned long long source_size;
+    long long source_time;
+    unsigned long long source_hash;
+    unsigned long long options_hash;
+    float bounds[6];
+  };
+
+  bool cache_enabled=true;
+
+  bool file_status(const std::string& filename,unsigned long long* size,long long* time)
+  {
+    struct stat info;
+    if(stat(filename.c_str(),&info)!=0)
+      return false;
+    *size=static_cast<unsigned long long>(info.st_size);
+    *time=static_cast<long long>(info.st_mtime);
+    return true;
+  }
+
+  std::string lower_extension(const std::string& filename)
+  {
+    const size_t dot=filename.find_last_of('.');
+    std::string ext=dot==std::string::npos ? "" : filename.substr(dot+1);
+    std::transform(ext.begin(),ext.end(),ext.begin(),::tolower);
+    return ext;
+  }
+
+}
+
+mesh_processing::mesh_processing()
+  :deformation(),compute_normals(false),use_color(false),color()
+{}
+
+unsigned long long hash_processing(const mesh_processing& processing)
+{
+  unsigned long long h=hash_bytes(processing.deformation.M,sizeof(processing.deformation.M));
+  h=hash_combine(h,processing.compute_normals);
+  h=hash_combine(h,processing.use_color);
+  if(processing.use_color)
+  {
+    const float c[3]={processing.color.x,processing.color.y,processing.color.z};
+    h=hash_combine(h,hash_bytes(c,sizeof(c)));
+  }
+  return h;
+}
+
+void apply_processing(mesh* m,const mesh_processing& processing)
+{
+  if(std::memcmp(processing.deformation.M,mat4().M,sizeof(processing.deformation.M))!=0)
+    apply_deformation(m,processing.deformation);
+  if(processing.compute_normals && !has_normals(m))
+    update_normals(m);
+  if(processing.use_color)
+    fill_color(m,processing.color);
+}
+
+std::string mesh_cache_filename(const std::string& source_filename,unsigned long long options_hash)
+{
+  if(options_hash==hash_processing(mesh_processing()))
+    return source_filename+".mesh";
+
+  char hex[17];
+  std::snprintf(hex,sizeof(hex),"%016llx",options_hash);
+  return source_filename+"."+hex+".mesh";
+}
+
+bool save_mesh_cache(const std::string& cache_filename,const std::string& source_filename,unsigned long long options_hash,const mesh& m)
+{
+  mesh_cache_header header;
+  std::memset(&header,0,sizeof(header));
+  std::memcpy(header.magic,mesh_cache_magic,sizeof(mesh_cache_magic));
+  header.version=mesh_cache_version;
+  header.vertex_size=sizeof(vertex_opengl);
+  header.nb_vertex=m.vertex.size();
+  header.nb_triangle=m.connectivity.size();
+  header.options_hash=options_hash;
+  if(!file_status(source_filename,&header.source_size,&header.source_time) ||
+     !hash_file(source_filename,&header.source_hash))
+    return false;
+
+  if(!m.vertex.empty())
+  {
+    vec3 p_min,p_max;
+    get_aabb(&m,&p_min,&p_max);
+    const float bounds[6]={p_min.x,p_min.y,p_min.z,p_max.x,p_max.y,p_max.z};
+    std::memcpy(header.bounds,bounds,sizeof(bounds));
+  }
+
+  //un lecteur concurrent ne voit jamais de fichier partiel
+  const std::string temporary=cache_filename+".tmp";
+  FILE* fid=std::fopen(temporary.c_str(),"wb");
+  if(fid==nullptr)
+    return false;
+  bool ok=std::fwrite(&header,sizeof(header),1,fid)==1;
+  if(ok && !m.vertex.empty())
+    ok=std::fwrite(&m.vertex[0],sizeof(vertex_opengl),m.vertex.size(),fid)==m.vertex.size();
+  if(ok && !m.connectivity.empty())
+    ok=std::fwrite(&m.connectivity[0],sizeof(triangle_index),m.connectivity.size(),fid)==m.connectivity.size();
+  ok=std::fclose(fid)==0 && ok;
+
+  std::remove(cache_filename.c_str());
+  if(!ok || std::rename(temporary.c_str(),cache_filename.c_str())!=0)
+  {
+    std::remove(temporary.c_str());
+    return false;
+  }
+  return true;
+}
+
+bool load_mesh_cache(const std::string& cache_filename,const std::string& source_filename,unsigned long long options_hash,mesh* m,aabb* bounds)
+{
+  mapped_file file(cache_filename);
+  if(!file.is_open() || file.size()<sizeof(mesh_cache_header))
+    return false;
+
+  mesh_cache_header header;
+  std::memcpy(&header,file.data(),sizeof(header));
+  if(std::memcmp(header.magic,mesh_cache_magic,sizeof(mesh_cache_magic))!=0 ||
+     header.version!=mesh_cache_version || header.vertex_size!=sizeof(vertex_opengl) ||
+     header.options_hash!=options_hash)
+    return false;
+
+  const size_t size_vertex=static_cast<size_t>(header.nb_vertex)*sizeof(vertex_opengl);
+  const size_t size_triangle=static_cast<size_t>(header.nb_triangle)*sizeof(triangle_index);
+  if(file.size()!=sizeof(header)+size_vertex+size_triangle)
+    return false;
+
+  //source modifie: la date seule ne suffit pas a invalider (copie, checkout), on compare le contenu
+  unsigned long long source_size;
+  long long source_time;
+  if(file_status(source_filename,&source_size,&source_time))
+  {
+    if(source_size!=header.source_size)
+      return false;
+    unsigned long long source_hash;
+    if(source_time!=header.source_time && (!hash_file(source_filename,&source_hash) || source_hash!=header.source_hash))
+      return false;
+  }
+
+  const char* p=file.data()+sizeof(header);
+  m->vertex.resize(header.nb_vertex);
+  m->connectivity.resize(header.nb_triangle);
+  if(size_vertex>0)   std::memcpy(&m->vertex[0],p,size_vertex);
+  if(size_triangle>0) std::memcpy(&m->connectivity[0],p+size_vertex,size_triangle);
+
+  if(bounds!=nullptr)
+    *bounds=aabb(vec3(header.bounds[0],header.bounds[1],header.bounds[2]),vec3(header.bounds[3],header.bounds[4],header.bounds[5]));
+  return true;
+}
+
+mesh load_mesh_cached(const std::string& filename,const mesh_processing& processing,mesh (*loader)(const std::string&))
+{
+  const unsigned long long options_hash=hash_processing(processing);
+  const std::string cache_filename=mesh_cache_filename(filename,options_hash);
+
+  mesh m;
+
+  //source present dans le pack: lu sans ouvrir de fichier, sans cache disque
+  pack_data source;
+  if(asset_pack().read(filename,&source))
+  {
+    const char* data=reinterpret_cast<const char*>(source.span.data);
+    const size_t size=source.span.size;
+    const std::string ext=lower_extension(filename);
+    if(ext=="off")      m=cpe::load_mesh_memory_off(data,size);
+    else if(ext=="ply") m=cpe::load_mesh_memory_ply(data,size);
+    else if(ext=="glb" || ext=="gltf") m=cpe::load_mesh_memory_gltf(data,size);
+    else                m=cpe::load_mesh_memory_obj(data,size);
+    apply_processing(&m,processing);
+    return m;
+  }
+
+  if(!cache_enabled)
+  {
+    m=loader(filename);
+    apply_processing(&m,processing);
+    return m;
+  }
+
+  //asset compile par assetc: sommets deja ordonnes pour le cache et normales presentes, aucun format texte a analyser
+  const std::string compiled=compiled_asset_filename(filename,".msh");
+  if(!compiled.empty())
+  {
+    try
+    {
+      m=mesh_from_asset(load_mesh_asset(compiled));
+      apply_processing(&m,processing);
+      return m;
+    }
+    catch(const std::string&)
+    {
+      m=mesh();
+    }
+  }
+
+  if(load_mesh_cache(cache_filename,filename,options_hash,&m))
+    return m;
+
+  m=loader(filename);
+  apply_processing(&m,processing);
+  save_mesh_cache(cache_filename,filename,options_hash,m);
+  return m;
+}
+
+mesh_file_loader mesh_loader_for(const std::string& filename)
+{
+  const std::string ext=lower_extension(filename);
+  if(ext=="off")
+    return cpe::load_mesh_file_off;
+  if(ext=="ply")
+    return cpe::load_mesh_file_ply;
+  if(ext=="gltf" || ext=="glb")
+    return cpe::load_mesh_file_gltf;
+  return cpe::load_mesh_file_obj;
+}
+
+mesh load_mesh_processed(const std::string& filename,const mesh_processing& processing)
+{
+  return load_mesh_cached(filename,processing,mesh_loader_for(filename));
+}
+
+bvh load_bvh_processed(const std::string& filename,const mesh_processing& processing,const mesh& m)
+{
+  const std::string compiled=cache_enabled ? compiled_asset_filename(filename,".bvh") : "";
+  if(!compiled.empty())
+  {
+    try
+    {
+      //meme deformation que les sommets: les positions doivent coincider exactement avec celles de m
+      bvh b=load_bvh(compiled);
+      transform_bvh(&b,processing.deformation);
+      if(bvh_matches_mesh(b,m))
+        return b;
+    }
+    catch(const std::string&)
+    {
+    }
+  }
+  return build_bvh(&m);
+}
+
+void set_mesh_cache_enabled(bool enabled)
+{
+  cache_enabled=enabled;
+}
+
+bool mesh_cache_enabled()
+{
+  return cache_enabled;
+}
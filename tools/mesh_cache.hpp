@@ -0,0 +1,68 @@
+#pragma once
+
+#ifndef MESH_CACHE_HPP
+#define MESH_CACHE_HPP
+
+#include "aabb.hpp"
+#include "mat4.hpp"
+#include "vec3.hpp"
+
+#include <string>
+
+struct bvh;
+struct mesh;
+
+/** Les traitements appliques au maillage apres lecture, dans cet ordre:
+ *  deformation, calcul des normales absentes du fichier, couleur uniforme */
+struct mesh_processing
+{
+  /** matrice appliquee aux sommets (identite par defaut) */
+  mat4 deformation;
+  /** calcule les normales si le fichier n'en fournit pas */
+  bool compute_normals;
+  /** remplit la couleur des sommets avec color */
+  bool use_color;
+  vec3 color;
+
+  /** Aucun traitement */
+  mesh_processing();
+};
+
+/** Hachage des options de traitement, stocke dans le cache */
+unsigned long long hash_processing(const mesh_processing& processing);
+/** Applique les traitements au maillage */
+void apply_processing(mesh* m,const mesh_processing& processing);
+
+/** Nom du fichier cache associe a un fichier source et a des options:
+ *  source.mesh sans traitement, source.<hachage>.mesh sinon */
+std::string mesh_cache_filename(const std::string& source_filename,unsigned long long options_hash);
+
+/** Ecrit le maillage dans le fichier cache (ecriture dans un fichier temporaire puis renommage).
+ *  Renvoie false si le fichier ne peut pas etre ecrit (repertoire en lecture seule, etc.) */
+bool save_mesh_cache(const std::string& cache_filename,const std::string& source_filename,unsigned long long options_hash,const mesh& m);
+/** Relit un fichier cache projete en memoire.
+ *  Le cache est refuse si sa version, ses options ou son fichier source ne correspondent plus:
+ *  la taille et la date du source sont comparees, puis son contenu si la date a change.
+ *  Un cache dont le source a disparu est accepte. */
+bool load_mesh_cache(const std::string& cache_filename,const std::string& source_filename,unsigned long long options_hash,mesh* m,aabb* bounds=nullptr);
+
+/** Charge un maillage avec la fonction de lecture donnee puis ses traitements,
+ *  en passant par le cache quand il est valide et en le creant sinon.
+ *  Un fichier present dans asset_pack() est lu depuis le pack, sinon le .msh produit
+ *  par assetc est prefere au source quand il est a jour. */
+mesh load_mesh_cached(const std::string& filename,const mesh_processing& processing,mesh (*loader)(const std::string&));
+/** Chargeur de fichier (sans cache) correspondant a l'extension: off, ply, gltf/glb, obj par defaut */
+typedef mesh (*mesh_file_loader)(const std::string&);
+mesh_file_loader mesh_loader_for(const std::string& filename);
+/** Charge un maillage obj, off, ply ou gltf/glb (selon l'extension) avec ses traitements,
+ *  en passant par le cache quand il est valide et en le creant sinon */
+mesh load_mesh_processed(const std::string& filename,const mesh_processing& processing);
+/** BVH du maillage m rendu par load_mesh_processed: le .bvh d'assetc transforme par la deformation
+ *  s'il est a jour et porte exactement les triangles de m, construite sinon */
+bvh load_bvh_processed(const std::string& filename,const mesh_processing& processing,const mesh& m);
+
+/** Active ou desactive l'utilisation des fichiers cache et des assets compiles (active par defaut) */
+void set_mesh_cache_enabled(bool enabled);
+bool mesh_cache_enabled();
+
+#endif
@@ -0,0 +1,205 @@
+
+#include "mesh_optimize.hpp"
+
+#include "mesh.hpp"
+
+#include <cmath>
+#include <vector>
+
+namespace
+{
+  const int cache_size=32;
+
+  /** score d'un sommet selon sa position dans le cache et le nombre de triangles restant a emettre */
+  float vertex_score(int cache_position,int remaining)
+  {
+    if(remaining==0)
+      return -1.0f;
+
+    float score=0.0f;
+    if(cache_position>=0)
+    {
+      //les sommets du dernier triangle ont un score fixe pour ne pas favoriser les bandes trop longues
+      if(cache_position<3)
+        score=0.75f;
+      else
+        score=std::pow(1.0f-(cache_position-3)/static_cast<float>(cache_size-3),1.5f);
+    }
+
+    //les sommets avec peu de triangles restants sont termines en priorite
+    score+=2.0f/std::sqrt(static_cast<float>(remaining));
+    return score;
+  }
+}
+
+void optimize_vertex_cache(mesh* m)
+{
+  const int N_vertex=m->vertex.size();
+  const int N_triangle=m->connectivity.size();
+  if(N_triangle==0)
+    return;
+
+  //triangles adjacents a chaque sommet (tableau compact)
+  std::vector<int> remaining(N_vertex,0);
+  for(int t=0;t<N_triangle;++t)
+  {
+    const triangle_index& tri=m->connectivity[t];
+    ++remaining[tri.u0]; ++remaining[tri.u1]; ++remaining[tri.u2];
+  }
+  std::vector<int> offset(N_vertex+1,0);
+  for(int v=0;v<N_vertex;++v)
+    offset[v+1]=offset[v]+remaining[v];
+  std::vector<int> adjacency(offset[N_vertex]);
+  std::vector<int> fill(offset.begin(),offset.end()-1);
+  for(int t=0;t<N_triangle;++t)
+  {
+    const triangle_index& tri=m->connectivity[t];
+    adjacency[fill[tri.u0]++]=t;
+    adjacency[fill[tri.u1]++]=t;
+    adjacency[fill[tri.u2]++]=t;
+  }
+
+  std::vector<float> score(N_vertex);
+  for(int v=0;v<N_vertex;++v)
+    score[v]=vertex_score(-1,remaining[v]);
+  std::vector<float> triangle_score(N_triangle);
+  std::vector<bool> emitted(N_triangle,false);
+  for(int t=0;t<N_triangle;++t)
+  {
+    const triangle_index& tri=m->connectivity[t];
+    triangle_score[t]=score[tri.u0]+score[tri.u1]+score[tri.u2];
+  }
+
+  std::vector<int> cache_position(N_vertex,-1);
+  std::vector<int> cache;
+  cache.reserve(cache_size+3);
+  std::vector<int> new_cache;
+  new_cache.reserve(cache_size+3);
+
+  std::vector<triangle_index> result;
+  result.reserve(N_triangle);
+
+  int best=0;
+  for(int t=1;t<N_triangle;++t)
+    if(triangle_score[t]>triangle_score[best])
+      best=t;
+  int scan=0;
+
+  while(best>=0)
+  {
+    const triangle_index tri=m->connectivity[best];
+    result.push_back(tri);
+    emitted[best]=true;
+
+    //le triangle emis passe en tete du cache LRU
+    const int u[3]={static_cast<int>(tri.u0),static_cast<int>(tri.u1),static_cast<int>(tri.u2)};
+    new_cache.clear();
+    for(int k=0;k<3;++k)
+    {
+      new_cache.push_back(u[k]);
+      //retire le triangle de la liste des triangles restants du sommet
+      int* begin=&adjacency[offset[u[k]]];
+      int* end=begin+remaining[u[k]];
+      for(int* p=begin;p<end;++p)
+        if(*p==best) { *p=*(end-1); break; }
+      --remaining[u[k]];
+    }
+    for(unsigned int k=0;k<cache.size();++k)
+      if(cache[k]!=u[0] && cache[k]!=u[1] && cache[k]!=u[2])
+        new_cache.push_back(cache[k]);
+    cache.swap(new_cache);
+
+    //mise a jour des scores des sommets du cache et des sommets sortis
+    for(unsigned int k=0;k<cache.size();++k)
+    {
+      const int v=cache[k];
+      const int position=k<static_cast<unsigned int>(cache_size) ? static_cast<int>(k) : -1;
+      cache_position[v]=position;
+      score[v]=vertex_score(position,remaining[v]);
+    }
+    if(cache.size()>static_cast<unsigned int>(cache_size))
+      cache.resize(cache_size);
+
+    //meilleur triangle parmi ceux touchant le cache
+    best=-1;
+    float best_score=-1.0f;
+    for(unsigned int k=0;k<cache.size();++k)
+    {
+      const int v=cache[k];
+      for(int i=offset[v];i<offset[v]+remaining[v];++i)
+      {
+        const int t=adjacency[i];
+        const triangle_index& tt=m->connectivity[t];
+        const float s=score[tt.u0]+score[tt.u1]+score[tt.u2];
+        triangle_score[t]=s;
+        if(s>best_score)
+        {
+          best_score=s;
+          best=t;
+        }
+      }
+    }
+
+    //aucun triangle adjacent au cache: on repart du premier triangle non emis
+    if(best<0)
+    {
+      while(scan<N_triangle && emitted[scan])
+        ++scan;
+      if(scan<N_triangle)
+        best=scan;
+    }
+  }
+
+  m->connectivity.swap(result);
+}
+
+void optimize_vertex_fetch(mesh* m)
+{
+  const int N_vertex=m->vertex.size();
+  std::vector<int> remap(N_vertex,-1);
+  std::vector<vertex_opengl> vertex;
+  vertex.reserve(N_vertex);
+
+  for(unsigned int t=0;t<m->connectivity.size();++t)
+  {
+    unsigned int* u[3]={&m->connectivity[t].u0,&m->connectivity[t].u1,&m->connectivity[t].u2};
+    for(int k=0;k<3;++k)
+    {
+      int& r=remap[*u[k]];
+      if(r<0)
+      {
+        r=vertex.size();
+        vertex.push_back(m->vertex[*u[k]]);
+      }
+      *u[k]=r;
+    }
+  }
+
+  m->vertex.swap(vertex);
+}
+
+float average_cache_miss_ratio(const mesh* m,int cache_size)
+{
+  const int N_triangle=m->connectivity.size();
+  if(N_triangle==0 || cache_size<=0)
+    return 0.0f;
+
+  //cache FIFO: un sommet est dans le cache si son instant d'entree est assez recent
+  std::vector<int> timestamp(m->vertex.size(),-cache_size-1);
+  int time=0;
+  int miss=0;
+  for(int t=0;t<N_triangle;++t)
+  {
+    const triangle_index& tri=m->connectivity[t];
+    const unsigned int u[3]={tri.u0,tri.u1,tri.u2};
+    for(int k=0;k<3;++k)
+    {
+      if(time-timestamp[u[k]]>=cache_size)
+      {
+        timestamp[u[k]]=++time;
+        ++miss;
+      }
+    }
+  }
+  return miss/static_cast<float>(N_triangle);
+}
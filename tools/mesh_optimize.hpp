@@ -0,0 +1,20 @@
+#pragma once
+
+#ifndef MESH_OPTIMIZE_HPP
+#define MESH_OPTIMIZE_HPP
+
+struct mesh;
+
+/** Reordonne les triangles pour le cache post-transformation des sommets (algorithme de Forsyth,
+ *  cache LRU simule de 32 entrees). La geometrie affichee est inchangee. */
+void optimize_vertex_cache(mesh* m);
+
+/** Renumerote les sommets dans l'ordre de leur premiere utilisation par les triangles
+ *  (lectures memoire sequentielles), les sommets inutilises sont supprimes */
+void optimize_vertex_fetch(mesh* m);
+
+/** Nombre moyen de sommets transformes par triangle pour un cache FIFO de taille donnee
+ *  (ACMR, entre 0.5 dans le meilleur cas et 3) */
+float average_cache_miss_ratio(const mesh* m,int cache_size);
+
+#endif
@@ -0,0 +1,71 @@
+#pragma once
+
+#ifndef MPSC_QUEUE_HPP
+#define MPSC_QUEUE_HPP
+
+#include <atomic>
+#include <utility>
+
+/** File sans verrou a plusieurs producteurs et un seul consommateur.
+ *  push() empile depuis n'importe quel thread par compare-and-swap; pop(), reserve au
+ *  consommateur, recupere toute la pile en un echange atomique et la remet dans l'ordre d'arrivee. */
+template <typename T>
+class mpsc_queue
+{
+public:
+  mpsc_queue():head(nullptr),output(nullptr) {}
+  ~mpsc_queue()
+  {
+    T value;
+    while(pop(&value)) {}
+  }
+
+  /** Ajoute un element (tout thread) */
+  void push(T value)
+  {
+    node* n=new node(std::move(value));
+    n->next=head.load(std::memory_order_relaxed);
+    while(!head.compare_exchange_weak(n->next,n,std::memory_order_release,std::memory_order_relaxed)) {}
+  }
+
+  /** Retire le plus ancien element (consommateur seulement), renvoie false si la file est vide */
+  bool pop(T* value)
+  {
+    if(output==nullptr)
+    {
+      //la pile est dans l'ordre inverse d'arrivee
+      node* stack=head.exchange(nullptr,std::memory_order_acquire);
+      while(stack!=nullptr)
+      {
+        node* next=stack->next;
+        stack->next=output;
+        output=stack;
+        stack=next;
+      }
+    }
+    if(output==nullptr)
+      return false;
+
+    node* n=output;
+    output=n->next;
+    *value=std::move(n->value);
+    delete n;
+    return true;
+  }
+
+private:
+  mpsc_queue(const mpsc_queue&);
+  mpsc_queue& operator=(const mpsc_queue&);
+
+  struct node
+  {
+    T value;
+    node* next;
+    explicit node(T v):value(std::move(v)),next(nullptr) {}
+  };
+
+  std::atomic<node*> head;
+  node* output;
+};
+
+#endif
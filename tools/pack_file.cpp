@@ -0,0 +1,262 @@
+
+#include "pack_file.hpp"
+
+#include "hash.hpp"
+#include "lz4.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+namespace
+{
+  const char pack_magic[4]={'P','A','K','1'};
+  const unsigned int pack_version=2;
+  const unsigned int pack_flag_compressed=1;
+
+  struct pack_header
+  {
+    char magic[4];
+    unsigned int version;
+    unsigned int nb_entry;
+    unsigned int alignment;
+  };
+
+  /** entree de la table des matieres telle qu'ecrite sur le disque */
+  struct pack_toc_entry
+  {
+    unsigned int name_offset;
+    unsigned int name_size;
+    unsigned long long offset;
+    unsigned long long size;
+    unsigned long long raw_size;
+    unsigned long long hash;
+    unsigned int flags;
+    unsigned int reserved;
+  };
+
+  bool entry_less(const pack_entry& e,const std::string& name)
+  {
+    return e.name<name;
+  }
+
+  size_t align(size_t value)
+  {
+    return (value+pack_alignment-1)/pack_alignment*pack_alignment;
+  }
+}
+
+pack_span::pack_span()
+  :data(nullptr),size(0)
+{}
+
+pack_span::pack_span(const unsigned char* data_param,size_t size_param)
+  :data(data_param),size(size_param)
+{}
+
+pack_file::pack_file()
+  :file(),toc()
+{}
+
+bool pack_file::open(const std::string& filename)
+{
+  close();
+  if(!file.open(filename))
+    return false;
+
+  const unsigned char* data=reinterpret_cast<const unsigned char*>(file.data());
+  const size_t size=file.size();
+  pack_header header;
+  if(size<sizeof(header))
+  {
+    close();
+    return false;
+  }
+  std::memcpy(&header,data,sizeof(header));
+  const size_t size_toc=static_cast<size_t>(header.nb_entry)*sizeof(pack_toc_entry);
+  if(std::memcmp(header.magic,pack_magic,sizeof(pack_magic))!=0 || header.version!=pack_version ||
+     size<sizeof(header)+size_toc)
+  {
+    close();
+    return false;
+  }
+
+  const unsigned char* names=data+sizeof(header)+size_toc;
+  toc.resize(header.nb_entry);
+  for(unsigned int k=0;k<header.nb_entry;++k)
+  {
+    pack_toc_entry e;
+    std::memcpy(&e,data+sizeof(header)+k*sizeof(pack_toc_entry),sizeof(e));
+    if(names+e.name_offset+e.name_size>data+size || e.offset>size || e.size>size-e.offset)
+    {
+      close();
+      return false;
+    }
+    toc[k].name.assign(reinterpret_cast<const char*>(names+e.name_offset),e.name_size);
+    toc[k].offset=e.offset;
+    toc[k].size=e.size;
+    toc[k].raw_size=e.raw_size;
+    toc[k].hash=e.hash;
+    toc[k].compressed=(e.flags&pack_flag_compressed)!=0;
+    if(!toc[k].compressed && e.raw_size!=e.size)
+    {
+      close();
+      return false;
+    }
+  }
+  return true;
+}
+
+void pack_file::close()
+{
+  file.close();
+  toc.clear();
+}
+
+bool pack_file::is_open() const
+{
+  return file.is_open();
+}
+
+const pack_entry* pack_file::find(const std::string& name) const
+{
+  std::vector<pack_entry>::const_iterator it=std::lower_bound(toc.begin(),toc.end(),name,entry_less);
+  if(it==toc.end() || it->name!=name)
+    return nullptr;
+  return &*it;
+}
+
+bool pack_file::get(const std::string& name,pack_span* span) const
+{
+  const pack_entry* e=find(name);
+  if(e==nullptr)
+    return false;
+  *span=pack_span(reinterpret_cast<const unsigned char*>(file.data())+e->offset,static_cast<size_t>(e->size));
+  return true;
+}
+
+bool pack_file::read(const std::string& name,pack_data* data) const
+{
+  const pack_entry* e=find(name);
+  return e!=nullptr && read(*e,data);
+}
+
+bool pack_file::read(const pack_entry& entry,pack_data* data) const
+{
+  const unsigned char* stored=reinterpret_cast<const unsigned char*>(file.data())+entry.offset;
+  if(!entry.compressed)
+  {
+    data->buffer.clear();
+    data->span=pack_span(stored,static_cast<size_t>(entry.size));
+    return true;
+  }
+
+  //les blocs sont decompresses directement dans le tampon final
+  data->buffer.resize(static_cast<size_t>(entry.raw_size));
+  if(!lz4_decompress_blocks(stored,static_cast<size_t>(entry.size),data->buffer.empty() ? nullptr : &data->buffer[0],data->buffer.size()))
+    return false;
+  data->span=pack_span(data->buffer.empty() ? nullptr : &data->buffer[0],data->buffer.size());
+  return true;
+}
+
+bool pack_file::verify(const pack_entry& entry) const
+{
+  pack_data data;
+  return read(entry,&data) && hash_bytes(data.span.data,data.span.size)==entry.hash;
+}
+
+const std::vector<pack_entry>& pack_file::entries() const
+{
+  return toc;
+}
+
+void pack_writer::add(const std::string& name,const void* data,size_t size,bool compress)
+{
+  const unsigned char* p=static_cast<const unsigned char*>(data);
+  item it;
+  it.name=name;
+  it.raw_size=size;
+  it.hash=hash_bytes(p,size);
+  it.compressed=false;
+  if(compress && size>0)
+  {
+    it.data=lz4_compress_blocks(p,size);
+    it.compressed=it.data.size()<=size-size/8;
+  }
+  if(!it.compressed)
+    it.data.assign(p,p+size);
+  items.push_back(it);
+}
+
+bool pack_writer::add_file(const std::string& name,const std::string& filename,bool compress)
+{
+  mapped_file f(filename);
+  if(!f.is_open())
+    return false;
+  add(name,f.data(),f.size(),compress);
+  return true;
+}
+
+bool pack_writer::write(const std::string& filename) const
+{
+  //table triee par nom pour la recherche par dichotomie
+  std::vector<unsigned int> order(items.size());
+  for(unsigned int k=0;k<order.size();++k)
+    order[k]=k;
+  std::sort(order.begin(),order.end(),[this](unsigned int a,unsigned int b) { return items[a].name<items[b].name; });
+
+  pack_header header;
+  std::memcpy(header.magic,pack_magic,sizeof(pack_magic));
+  header.version=pack_version;
+  header.nb_entry=items.size();
+  header.alignment=pack_alignment;
+
+  std::string names;
+  std::vector<pack_toc_entry> toc(items.size());
+  for(unsigned int k=0;k<order.size();++k)
+  {
+    toc[k].name_offset=names.size();
+    toc[k].name_size=items[order[k]].name.size();
+    names+=items[order[k]].name;
+  }
+
+  size_t offset=align(sizeof(header)+toc.size()*sizeof(pack_toc_entry)+names.size());
+  for(unsigned int k=0;k<order.size();++k)
+  {
+    const item& it=items[order[k]];
+    toc[k].offset=offset;
+    toc[k].size=it.data.size();
+    toc[k].raw_size=it.raw_size;
+    toc[k].hash=it.hash;
+    toc[k].flags=it.compressed ? pack_flag_compressed : 0;
+    toc[k].reserved=0;
+    const std::vector<unsigned char>& data=it.data;
+    offset=align(offset+data.size());
+  }
+
+  FILE* fid=std::fopen(filename.c_str(),"wb");
+  if(fid==nullptr)
+    return false;
+  bool ok=std::fwrite(&header,sizeof(header),1,fid)==1;
+  if(ok && !toc.empty())
+    ok=std::fwrite(&toc[0],sizeof(pack_toc_entry),toc.size(),fid)==toc.size();
+  if(ok && !names.empty())
+    ok=std::fwrite(names.data(),1,names.size(),fid)==names.size();
+  size_t position=sizeof(header)+toc.size()*sizeof(pack_toc_entry)+names.size();
+  const char zeros[pack_alignment]={0};
+  for(unsigned int k=0;ok && k<order.size();++k)
+  {
+    const std::vector<unsigned char>& data=items[order[k]].data;
+    ok=std::fwrite(zeros,1,toc[k].offset-position,fid)==toc[k].offset-position;
+    if(ok && !data.empty())
+      ok=std::fwrite(&data[0],1,data.size(),fid)==data.size();
+    position=toc[k].offset+data.size();
+  }
+  return std::fclose(fid)==0 && ok;
+}
+
+pack_file& asset_pack()
+{
+  static pack_file pack;
+  return pack;
+}
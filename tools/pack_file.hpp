@@ -0,0 +1,111 @@
+#pragma once
+
+#ifndef PACK_FILE_HPP
+#define PACK_FILE_HPP
+
+#include "mapped_file.hpp"
+
+#include <string>
+#include <vector>
+
+/** Une zone memoire en lecture seule (pas de copie, valide tant que le pack est ouvert) */
+struct pack_span
+{
+  const unsigned char* data;
+  size_t size;
+
+  pack_span();
+  pack_span(const unsigned char* data_param,size_t size_param);
+};
+
+/** Une entree de la table des matieres */
+struct pack_entry
+{
+  /** nom de l'asset (chemin relatif, par exemple data/nathan.tga) */
+  std::string name;
+  /** position du contenu stocke depuis le debut du fichier (multiple de pack_alignment) */
+  unsigned long long offset;
+  /** taille du contenu stocke */
+  unsigned long long size;
+  /** taille du contenu une fois decompresse (egale a size si non compresse) */
+  unsigned long long raw_size;
+  /** hachage du contenu decompresse (hash_bytes) */
+  unsigned long long hash;
+  /** contenu stocke en flux de blocs LZ4 (lz4_compress_blocks) */
+  bool compressed;
+};
+
+/** Contenu d'une entree: vue directe dans la projection si elle n'est pas compressee,
+ *  sinon vue sur le tampon dans lequel elle a ete decompressee */
+struct pack_data
+{
+  pack_span span;
+  std::vector<unsigned char> buffer;
+};
+
+/** Alignement des contenus dans le pack */
+const unsigned int pack_alignment=64;
+
+/** Un fichier pack projete en memoire en une seule fois.
+ *
+ *  Format: en-tete, table des matieres triee par nom, noms, puis contenus alignes
+ *  (bruts, ou compresses par blocs LZ4 independants).
+ *  Les recherches se font par dichotomie sur la table. */
+class pack_file
+{
+public:
+  pack_file();
+
+  /** Ouvre le pack (ferme le precedent), renvoie false si le fichier est absent ou invalide */
+  bool open(const std::string& filename);
+  void close();
+  bool is_open() const;
+
+  /** Entree de nom donne, nullptr si absente */
+  const pack_entry* find(const std::string& name) const;
+  /** Contenu stocke de l'entree de nom donne (compresse ou non), renvoie false si absente */
+  bool get(const std::string& name,pack_span* span) const;
+  /** Contenu de l'entree de nom donne: sans copie si elle n'est pas compressee,
+   *  sinon decompresse en parallele par blocs. Renvoie false si absente ou invalide */
+  bool read(const std::string& name,pack_data* data) const;
+  bool read(const pack_entry& entry,pack_data* data) const;
+  /** Verifie le hachage du contenu de l'entree */
+  bool verify(const pack_entry& entry) const;
+
+  /** Table des matieres triee par nom */
+  const std::vector<pack_entry>& entries() const;
+
+private:
+  mapped_file file;
+  std::vector<pack_entry> toc;
+};
+
+/** Construction d'un pack: les contenus sont ajoutes puis ecrits d'un bloc */
+class pack_writer
+{
+public:
+  /** Ajoute un contenu (copie). Avec compress, le contenu est stocke en blocs LZ4
+   *  si cela le reduit d'au moins un huitieme */
+  void add(const std::string& name,const void* data,size_t size,bool compress=false);
+  /** Ajoute le contenu d'un fichier, renvoie false si illisible */
+  bool add_file(const std::string& name,const std::string& filename,bool compress=false);
+  /** Ecrit le pack, renvoie false en cas d'echec */
+  bool write(const std::string& filename) const;
+
+private:
+  struct item
+  {
+    std::string name;
+    std::vector<unsigned char> data;
+    unsigned long long raw_size;
+    unsigned long long hash;
+    bool compressed;
+  };
+  std::vector<item> items;
+};
+
+/** Le pack utilise par les chargeurs (maillages, textures, shaders) avant de lire les fichiers.
+ *  Non ouvert par defaut: les chargeurs lisent alors directement les fichiers. */
+pack_file& asset_pack();
+
+#endif
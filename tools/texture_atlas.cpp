@@ -0,0 +1,263 @@
+
+#include "texture_atlas.hpp"
+
+#include "atlas_packer.hpp"
+#include "hash.hpp"
+#include "ktx.hpp"
+#include "texture_cache.hpp"
+#include "thread_pool.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <memory>
+
+namespace
+{
+  /** Copie une image RGBA8 en (x,y) et etend ses bords sur padding texels autour */
+  void blit_with_border(const unsigned char* rgba,int w,int h,int x,int y,int padding,texture_level* layer)
+  {
+    for(int j=-padding;j<h+padding;++j)
+    {
+      const int source_row=std::min(std::max(j,0),h-1);
+      const unsigned char* src=rgba+4*static_cast<size_t>(source_row)*w;
+      unsigned char* dst=&layer->data[4*(static_cast<size_t>(y+j)*layer->width+x)];
+      for(int i=-padding;i<0;++i)
+        std::memcpy(dst+4*i,src,4);
+      std::memcpy(dst,src,4*static_cast<size_t>(w));
+      for(int i=w;i<w+padding;++i)
+        std::memcpy(dst+4*i,src+4*(w-1),4);
+    }
+  }
+
+  int round_up(int n,int alignment)
+  {
+    return (n+alignment-1)/alignment*alignment;
+  }
+
+  /** version des atlas en cache, a incrementer quand la construction change */
+  const unsigned int atlas_cache_version=2;
+
+  /** Prefixe des fichiers cache d'un atlas, dans le repertoire de la premiere image: le hachage couvre
+   *  le contenu de chaque image dans l'ordre, la taille des couches, la bordure et les options de
+   *  compression, un atlas perime n'est donc jamais relu */
+  std::string atlas_cache_filename(const std::vector<std::shared_ptr<texture_source> >& sources,int layer_size,int padding)
+  {
+    unsigned long long h=hash_combine(atlas_cache_version,layer_size);
+    h=hash_combine(h,padding);
+    for(unsigned int k=0;k<sources.size();++k)
+      h=hash_combine(h,sources[k]->content_hash);
+    const std::string& first=sources[0]->filename;
+    const size_t slash=first.find_last_of("/\\");
+    char hex[17];
+    std::snprintf(hex,sizeof(hex),"%016llx",texture_options_hash(h));
+    return (slash==std::string::npos ? std::string() : first.substr(0,slash+1))+"atlas."+hex;
+  }
+
+  /** <prefixe>.<couche>.ktx: une texture ktx par couche */
+  std::string atlas_layer_filename(const std::string& cache_filename,int layer)
+  {
+    return cache_filename+"."+std::to_string(layer)+".ktx";
+  }
+
+  /** Relit un atlas en cache: <prefixe>.txt (nombre de couches et de niveaux, puis couche et rectangle
+   *  de chaque entree) et les couches ktx */
+  bool load_atlas_cache(const std::string& cache_filename,int layer_size,int padding,texture_atlas* atlas)
+  {
+    std::ifstream fid((cache_filename+".txt").c_str());
+    unsigned int nb_layer=0,nb_entry=0;
+    if(!(fid>>nb_layer>>atlas->nb_level>>nb_entry))
+      return false;
+    atlas->width=layer_size;
+    atlas->height=layer_size;
+    atlas->entries.resize(nb_entry);
+    for(unsigned int k=0;k<nb_entry;++k)
+    {
+      atlas_entry& e=atlas->entries[k];
+      if(!(fid>>e.layer>>e.x>>e.y>>e.width>>e.height) || e.layer<0 || static_cast<unsigned int>(e.layer)>=nb_layer)
+        return false;
+      e.offset[0]=static_cast<float>(e.x)/layer_size;
+      e.offset[1]=static_cast<float>(e.y)/layer_size;
+      e.scale[0]=static_cast<float>(e.width)/layer_size;
+      e.scale[1]=static_cast<float>(e.height)/layer_size;
+    }
+    atlas->layers.resize(nb_layer);
+    for(unsigned int l=0;l<nb_layer;++l)
+    {
+      const texture_data& t=atlas->layers[l];
+      if(!load_ktx(atlas_layer_filename(cache_filename,l),&atlas->layers[l]) || static_cast<int>(t.levels.size())!=atlas->nb_level ||
+         t.levels[0].width!=layer_size || t.levels[0].height!=layer_size)
+        return false;
+    }
+    return true;
+  }
+
+  /** Ecrit les couches puis la description, qui n'existe donc que si toutes les couches ont ete ecrites */
+  void save_atlas_cache(const std::string& cache_filename,const texture_atlas& atlas)
+  {
+    for(unsigned int l=0;l<atlas.layers.size();++l)
+      save_texture_cache(atlas_layer_filename(cache_filename,l),atlas.layers[l]);
+    const std::string temporary=cache_filename+".txt.tmp";
+    {
+      std::ofstream fid(temporary.c_str());
+      fid<<atlas.layers.size()<<" "<<atlas.nb_level<<" "<<atlas.entries.size()<<std::endl;
+      for(unsigned int k=0;k<atlas.entries.size();++k)
+      {
+        const atlas_entry& e=atlas.entries[k];
+        fid<<e.layer<<" "<<e.x<<" "<<e.y<<" "<<e.width<<" "<<e.height<<std::endl;
+      }
+      if(!fid)
+      {
+        //repertoire en lecture seule: l'atlas sera reconstruit au prochain lancement
+        fid.close();
+        std::remove(temporary.c_str());
+        return;
+      }
+    }
+    std::remove((cache_filename+".txt").c_str());
+    if(std::rename(temporary.c_str(),(cache_filename+".txt").c_str())!=0)
+      std::remove(temporary.c_str());
+  }
+}
+
+texture_atlas::texture_atlas()
+  :width(0),height(0),layers(),nb_level(0),entries()
+{}
+
+texture_atlas build_texture_atlas(const std::vector<const Image*>& images,int layer_size,int padding)
+{
+  //rectangles bordure comprise, arrondis a la bordure pour garder les positions alignees
+  std::vector<std::pair<int,int> > sizes(images.size());
+  for(unsigned int k=0;k<images.size();++k)
+    sizes[k]=std::make_pair(round_up(images[k]->width+2*padding,padding),round_up(images[k]->height+2*padding,padding));
+  int nb_layer=0;
+  const std::vector<atlas_placement> placements=pack_rectangles(sizes,layer_size,layer_size,&nb_layer);
+
+  texture_atlas atlas;
+  atlas.width=layer_size;
+  atlas.height=layer_size;
+  //niveau k: la bordure fait padding/2^k texels, au moins un jusqu'a log2(padding)
+  atlas.nb_level=1;
+  for(int p=padding;p>1 && atlas.nb_level<texture_level_count(layer_size,layer_size);p/=2)
+    ++atlas.nb_level;
+
+  std::vector<texture_level> base(nb_layer);
+  for(int l=0;l<nb_layer;++l)
+  {
+    base[l].width=layer_size;
+    base[l].height=layer_size;
+    //texels libres opaques: seules les images decident entre BC1 et BC3 a la compression
+    base[l].data.assign(4*static_cast<size_t>(layer_size)*layer_size,0);
+    for(size_t k=3;k<base[l].data.size();k+=4)
+      base[l].data[k]=255;
+  }
+
+  atlas.entries.resize(images.size());
+  for(unsigned int k=0;k<images.size();++k)
+  {
+    const Image& image=*images[k];
+    const atlas_placement& p=placements[k];
+    atlas_entry& e=atlas.entries[k];
+    e.layer=p.page;
+    e.x=p.x+padding;
+    e.y=p.y+padding;
+    e.width=image.width;
+    e.height=image.height;
+    e.offset[0]=static_cast<float>(e.x)/layer_size;
+    e.offset[1]=static_cast<float>(e.y)/layer_size;
+    e.scale[0]=static_cast<float>(e.width)/layer_size;
+    e.scale[1]=static_cast<float>(e.height)/layer_size;
+
+    const std::vector<unsigned char> rgba=image_rgba8(image);
+    blit_with_border(&rgba[0],image.width,image.height,e.x,e.y,padding,&base[p.page]);
+  }
+
+  //mipmaps de chaque couche sur le pool
+  atlas.layers.resize(nb_layer);
+  parallel_for(0,nb_layer,1,[&](int begin,int end) {
+    for(int l=begin;l<end;++l)
+    {
+      texture_data& t=atlas.layers[l];
+      t.gl_internal_format=texture_gl_rgba8;
+      t.gl_format=texture_gl_rgba;
+      t.gl_type=texture_gl_unsigned_byte;
+      t.levels=build_mipmaps_rgba8(&base[l].data[0],layer_size,layer_size);
+      t.levels.resize(atlas.nb_level);
+    }
+  });
+  return atlas;
+}
+
+std::string texture_atlas_cache_filename(const std::vector<std::string>& filenames,int layer_size,int padding)
+{
+  std::vector<std::shared_ptr<texture_source> > sources(filenames.size());
+  for(unsigned int k=0;k<filenames.size();++k)
+    if(!(sources[k]=read_texture_bytes(filenames[k])))
+      return "";
+  return atlas_cache_filename(sources,layer_size,padding);
+}
+
+texture_atlas load_texture_atlas(const std::vector<std::string>& filenames,int layer_size,int padding)
+{
+  //les fichiers demandes eux-memes, sans la substitution de calibrate_texture_sources
+  std::vector<std::shared_ptr<texture_source> > sources(filenames.size());
+  task_group group(default_thread_pool());
+  for(unsigned int k=0;k<filenames.size();++k)
+    group.run([&filenames,&sources,k]() { sources[k]=read_texture_bytes(filenames[k]); });
+  group.wait();
+  bool from_pack=false;
+  for(unsigned int k=0;k<filenames.size();++k)
+  {
+    if(!sources[k])
+      throw std::string("Impossible de lire l'image "+filenames[k]);
+    from_pack=from_pack || sources[k]->from_pack;
+  }
+
+  const bool use_cache=texture_cache_enabled() && !from_pack && !filenames.empty();
+  const std::string cache_filename=use_cache ? atlas_cache_filename(sources,layer_size,padding) : "";
+  texture_atlas atlas;
+  if(use_cache && load_atlas_cache(cache_filename,layer_size,padding,&atlas))
+    return atlas;
+
+  std::vector<std::unique_ptr<Image> > images(filenames.size());
+  for(unsigned int k=0;k<filenames.size();++k)
+    group.run([&sources,&images,k]() { images[k].reset(image_load_memory(sources[k]->bytes,sources[k]->size)); });
+  group.wait();
+
+  std::vector<const Image*> pointers(filenames.size());
+  for(unsigned int k=0;k<filenames.size();++k)
+  {
+    if(!images[k])
+      throw std::string("Impossible de decoder l'image "+filenames[k]);
+    pointers[k]=images[k].get();
+  }
+  atlas=build_texture_atlas(pointers,layer_size,padding);
+  images.clear();
+
+  //couches compressees comme les autres textures; bordure multiple de 4: aucun bloc a cheval sur deux images
+  if(texture_compression_enabled() && padding%4==0)
+  {
+    block_format format=block_bc1;
+    for(unsigned int l=0;l<atlas.layers.size();++l)
+    {
+      const texture_level& base=atlas.layers[l].levels[0];
+      if(choose_block_format(&base.data[0],static_cast<size_t>(base.width)*base.height)==block_bc3)
+        format=block_bc3;
+    }
+    for(unsigned int l=0;l<atlas.layers.size();++l)
+      atlas.layers[l]=compress_texture(atlas.layers[l],format,texture_compression_quality());
+  }
+
+  if(use_cache)
+    save_atlas_cache(cache_filename,atlas);
+  return atlas;
+}
+
+size_t texture_memory(const texture_atlas& atlas)
+{
+  size_t size=0;
+  for(unsigned int k=0;k<atlas.layers.size();++k)
+    size+=texture_memory(atlas.layers[k]);
+  return size;
+}
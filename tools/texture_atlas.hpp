@@ -0,0 +1,67 @@
+#pragma once
+
+#ifndef TEXTURE_ATLAS_HPP
+#define TEXTURE_ATLAS_HPP
+
+#include "image.hpp"
+#include "texture_data.hpp"
+
+#include <string>
+#include <vector>
+
+/** Position d'une texture dans l'atlas */
+struct atlas_entry
+{
+  /** couche du GL_TEXTURE_2D_ARRAY */
+  int layer;
+  /** rectangle de la texture dans la couche, en texels (sans la bordure) */
+  int x;
+  int y;
+  int width;
+  int height;
+  /** meme rectangle en coordonnees normalisees: uv_atlas = offset + uv*scale */
+  float offset[2];
+  float scale[2];
+};
+
+/** Petites textures regroupees dans les couches d'une texture tableau.
+ *
+ *  Les textures sont placees par skyline_packer dans des couches de meme taille; chacune est
+ *  entouree d'une bordure ou ses texels de bord sont repetes, pour que le filtrage bilineaire
+ *  et les premiers niveaux de mipmaps ne melangent pas deux textures voisines. Les positions
+ *  sont alignees sur la bordure et la chaine de mipmaps s'arrete au niveau ou la bordure fait
+ *  un texel. Une texture qui se repete (coordonnees hors de [0,1]) doit rester a part.
+ */
+struct texture_atlas
+{
+  int width;
+  int height;
+  /** une texture RGBA8 par couche, avec ses nb_level niveaux */
+  std::vector<texture_data> layers;
+  int nb_level;
+  /** une entree par image, dans l'ordre donne */
+  std::vector<atlas_entry> entries;
+
+  texture_atlas();
+};
+
+/** Place les images dans des couches layer_size x layer_size, bordure de padding texels
+ *  (puissance de 2). Exception std::string si une image ne tient pas dans une couche. */
+texture_atlas build_texture_atlas(const std::vector<const Image*>& images,int layer_size,int padding);
+
+/** Lit exactement les fichiers demandes (pack compris, sans substitution de format source) et relit
+ *  l'atlas depuis son cache s'il existe. Sinon decode les images en parallele sur le pool, construit
+ *  l'atlas, le compresse en BC1 (BC3 si une couche a de la transparence) quand la compression des
+ *  textures est active, et l'ecrit dans le cache (voir texture_atlas_cache_filename). Pas de cache si
+ *  une image vient du pack ou si les fichiers cache sont desactives. Exception std::string si un
+ *  fichier est illisible. */
+texture_atlas load_texture_atlas(const std::vector<std::string>& filenames,int layer_size,int padding);
+/** Prefixe des fichiers cache de l'atlas, dans le repertoire de la premiere image: <prefixe>.txt
+ *  (couches et entrees) et <prefixe>.<couche>.ktx. Le hachage couvre le contenu des images, layer_size,
+ *  padding et les options de compression. Vide si un fichier est introuvable. */
+std::string texture_atlas_cache_filename(const std::vector<std::string>& filenames,int layer_size,int padding);
+
+/** Memoire de toutes les couches et de leurs niveaux */
+size_t texture_memory(const texture_atlas& atlas);
+
+#endif
@@ -0,0 +1,393 @@
+
+#include "texture_cache.hpp"
+
+#include "dds.hpp"
+#include "hash.hpp"
+#include "image.hpp"
+#include "ktx.hpp"
+#include "thread_pool.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <mutex>
+
+namespace
+{
+  /** version des textures produites, a incrementer quand la preparation change */
+  const unsigned int texture_cache_version=1;
+
+  std::atomic<bool> compression_enabled(true);
+  std::atomic<int> compression_quality(compress_normal);
+  std::atomic<bool> cache_enabled(true);
+
+  /** formats sources interchangeables d'une meme image */
+  const char* const source_extensions[]={".tga",".jpg",".png"};
+
+  /** choix de calibrate_texture_sources, par nom de fichier demande */
+  std::mutex source_mutex;
+  std::map<std::string,std::vector<texture_source_cost> > source_costs;
+  std::map<std::string,std::string> source_choices;
+
+  std::string strip_extension(const std::string& filename)
+  {
+    const size_t dot=filename.find_last_of('.');
+    const size_t slash=filename.find_last_of("/\\");
+    return dot!=std::string::npos && (slash==std::string::npos || dot>slash) ? filename.substr(0,dot) : filename;
+  }
+
+  /** Variantes presentes de filename (meme nom, autre format source), filename en tete;
+   *  vide si filename est introuvable */
+  std::vector<std::shared_ptr<texture_source> > read_texture_variants(const std::string& filename)
+  {
+    std::vector<std::shared_ptr<texture_source> > variants;
+    std::shared_ptr<texture_source> requested=read_texture_bytes(filename);
+    if(!requested)
+      return variants;
+    variants.push_back(requested);
+    const std::string stem=strip_extension(filename);
+    for(unsigned int e=0;e<sizeof(source_extensions)/sizeof(source_extensions[0]);++e)
+    {
+      const std::string name=stem+source_extensions[e];
+      std::shared_ptr<texture_source> variant=name!=filename ? read_texture_bytes(name) : nullptr;
+      if(variant)
+        variants.push_back(variant);
+    }
+    return variants;
+  }
+
+  /** Fichier du choix enregistre, a cote du fichier demande: le hachage couvre le nom et le contenu
+   *  de chaque variante et les options de chargement, un choix perime n'est donc jamais relu */
+  std::string variants_choice_filename(const std::vector<std::shared_ptr<texture_source> >& variants)
+  {
+    unsigned long long h=0;
+    for(unsigned int v=0;v<variants.size();++v)
+    {
+      h=hash_combine(h,hash_bytes(variants[v]->filename.data(),variants[v]->filename.size()));
+      h=hash_combine(h,variants[v]->content_hash);
+    }
+    char hex[17];
+    std::snprintf(hex,sizeof(hex),"%016llx",texture_options_hash(h));
+    return variants[0]->filename+"."+hex+".source";
+  }
+
+  /** Relit un choix enregistre: une ligne par variante (nom, duree, texels identiques, retenue) */
+  bool read_texture_choice(const std::string& choice_filename,const std::vector<std::shared_ptr<texture_source> >& variants,
+                           std::vector<texture_source_cost>* costs)
+  {
+    std::ifstream fid(choice_filename.c_str());
+    std::vector<texture_source_cost> c;
+    texture_source_cost cost;
+    int nb_chosen=0;
+    while(fid>>cost.filename>>cost.milliseconds>>cost.identical>>cost.chosen)
+    {
+      if(c.size()>=variants.size() || cost.filename!=variants[c.size()]->filename || (cost.chosen && !cost.identical))
+        return false;
+      nb_chosen+=cost.chosen;
+      c.push_back(cost);
+    }
+    if(c.size()!=variants.size() || nb_chosen!=1)
+      return false;
+    *costs=c;
+    return true;
+  }
+
+  void save_texture_choice(const std::string& choice_filename,const std::vector<texture_source_cost>& costs)
+  {
+    const std::string temporary=choice_filename+".tmp";
+    {
+      std::ofstream fid(temporary.c_str());
+      for(unsigned int v=0;v<costs.size();++v)
+        fid<<costs[v].filename<<" "<<costs[v].milliseconds<<" "<<costs[v].identical<<" "<<costs[v].chosen<<std::endl;
+      if(!fid)
+      {
+        //repertoire en lecture seule: la mesure sera refaite au prochain lancement
+        fid.close();
+        std::remove(temporary.c_str());
+        return;
+      }
+    }
+    std::remove(choice_filename.c_str());
+    if(std::rename(temporary.c_str(),choice_filename.c_str())!=0)
+      std::remove(temporary.c_str());
+  }
+
+  /** Texels RGBA8 de l'image source (niveau 0), faux si ce n'est pas une image decodable */
+  bool decode_texels(const texture_source& source,texture_level* texels)
+  {
+    std::unique_ptr<Image> image(image_load_memory(source.bytes,source.size));
+    if(!image)
+      return false;
+    texels->width=image->width;
+    texels->height=image->height;
+    texels->data=image_rgba8(*image);
+    return true;
+  }
+
+  void prepare_texture_source(texture_source* source,bool use_cache);
+
+  /** Duree (ms) d'un chargement a froid: lecture, hachage, decodage et preparation, sans relire ni
+   *  ecrire le cache; negative si le fichier est illisible */
+  double source_cost(const std::string& filename)
+  {
+    try
+    {
+      const std::chrono::high_resolution_clock::time_point start=std::chrono::high_resolution_clock::now();
+      std::shared_ptr<texture_source> source=read_texture_bytes(filename);
+      if(!source)
+        return -1.0;
+      prepare_texture_source(source.get(),false);
+      return std::chrono::duration<double,std::milli>(std::chrono::high_resolution_clock::now()-start).count();
+    }
+    catch(const std::string&)
+    {
+      return -1.0;
+    }
+  }
+
+  /** Mesure les variantes d'une image et retient la moins chere parmi celles qui donnent exactement
+   *  les texels du fichier demande; les autres (jpg avec pertes...) ne sont pas mesurees */
+  std::vector<texture_source_cost> measure_texture_variants(const std::vector<std::shared_ptr<texture_source> >& variants)
+  {
+    std::vector<texture_source_cost> costs(variants.size());
+    texture_level reference;
+    const bool decoded=decode_texels(*variants[0],&reference);
+    unsigned int nb_identical=0;
+    for(unsigned int v=0;v<variants.size();++v)
+    {
+      texture_level texels;
+      costs[v].filename=variants[v]->filename;
+      costs[v].milliseconds=-1.0;
+      costs[v].identical=v==0 || (decoded && decode_texels(*variants[v],&texels) && texels.width==reference.width &&
+                                  texels.height==reference.height && texels.data==reference.data);
+      costs[v].chosen=false;
+      nb_identical+=costs[v].identical;
+    }
+
+    unsigned int best=0;
+    for(unsigned int v=0;v<variants.size() && nb_identical>1;++v)
+    {
+      if(!costs[v].identical)
+        continue;
+      costs[v].milliseconds=source_cost(costs[v].filename);
+      if(costs[v].milliseconds>=0.0 && (costs[best].milliseconds<0.0 || costs[v].milliseconds<costs[best].milliseconds))
+        best=v;
+    }
+    costs[best].chosen=true;
+    return costs;
+  }
+
+  void prepare_texture_source(texture_source* source,bool use_cache)
+  {
+    //textures deja prechargees par la chaine d'assets: rien a decoder
+    if(parse_texture_container(source->bytes,source->size,&source->view))
+      return;
+    //sans compression, une tga brute est envoyee depuis le fichier projete et ses mipmaps calculees par le GPU
+    if(!compression_enabled.load() && image_view_tga(source->bytes,source->size,&source->view))
+      return;
+
+    const std::string cache_filename=use_cache ? texture_cache_filename(source->filename,source->content_hash) : "";
+    if(use_cache && source->cache.open(cache_filename))
+    {
+      if(parse_ktx_view(reinterpret_cast<const unsigned char*>(source->cache.data()),source->cache.size(),&source->view))
+        return;
+      source->cache.close();
+    }
+
+    std::unique_ptr<Image> image(image_load_memory(source->bytes,source->size));
+    if(!image)
+      throw std::string("Impossible de decoder l'image "+source->filename);
+    source->data=texture_from_image(*image,true);
+
+    if(compression_enabled.load())
+    {
+      const texture_level& base=source->data.levels[0];
+      const block_format format=choose_block_format(&base.data[0],static_cast<size_t>(base.width)*base.height);
+      source->data=compress_texture(source->data,format,static_cast<compress_quality>(compression_quality.load()));
+    }
+    source->view=view_of(source->data);
+
+    if(use_cache)
+      save_texture_cache(cache_filename,source->data);
+  }
+}
+
+unsigned long long texture_options_hash(unsigned long long content_hash)
+{
+  unsigned long long h=hash_combine(content_hash,texture_cache_version);
+  h=hash_combine(h,compression_enabled.load());
+  if(compression_enabled.load())
+    h=hash_combine(h,compression_quality.load());
+  return h;
+}
+
+/** Ecriture dans un fichier temporaire puis renommage, comme pour les maillages */
+void save_texture_cache(const std::string& cache_filename,const texture_data& texture)
+{
+  const std::string temporary=cache_filename+".tmp";
+  try
+  {
+    save_ktx(temporary,texture);
+  }
+  catch(const std::string&)
+  {
+    //repertoire en lecture seule: la texture reste utilisable sans cache
+    std::remove(temporary.c_str());
+    return;
+  }
+  std::remove(cache_filename.c_str());
+  if(std::rename(temporary.c_str(),cache_filename.c_str())!=0)
+    std::remove(temporary.c_str());
+}
+
+std::shared_ptr<texture_source> read_texture_bytes(const std::string& filename)
+{
+  std::shared_ptr<texture_source> source(new texture_source());
+  source->filename=filename;
+  if(asset_pack().read(filename,&source->pack))
+  {
+    source->bytes=source->pack.span.data;
+    source->size=source->pack.span.size;
+    source->from_pack=true;
+  }
+  else
+  {
+    if(!source->file.open(filename))
+      return nullptr;
+    source->bytes=reinterpret_cast<const unsigned char*>(source->file.data());
+    source->size=source->file.size();
+  }
+  source->content_hash=hash_bytes(source->bytes,source->size);
+  return source;
+}
+
+std::string texture_cache_filename(const std::string& source_filename,unsigned long long content_hash)
+{
+  char hex[17];
+  std::snprintf(hex,sizeof(hex),"%016llx",texture_options_hash(content_hash));
+  return source_filename+"."+hex+".ktx";
+}
+
+texture_source::texture_source()
+  :filename(),bytes(nullptr),size(0),content_hash(0),from_pack(false)
+{}
+
+bool parse_texture_container(const unsigned char* data,size_t size,texture_view* texture)
+{
+  return parse_ktx_view(data,size,texture) || parse_ktx2_view(data,size,texture) || parse_dds_view(data,size,texture);
+}
+
+std::shared_ptr<texture_source> read_texture_file(const std::string& filename)
+{
+  return read_texture_bytes(texture_source_choice(filename));
+}
+
+void prepare_texture(texture_source* source)
+{
+  prepare_texture_source(source,cache_enabled.load() && !source->from_pack);
+}
+
+std::shared_ptr<texture_source> open_texture_file(const std::string& filename)
+{
+  std::shared_ptr<texture_source> source=read_texture_file(filename);
+  if(!source)
+    throw std::string("Fichier introuvable: "+filename);
+  prepare_texture(source.get());
+  return source;
+}
+
+void set_texture_compression_enabled(bool enabled)
+{
+  compression_enabled=enabled;
+}
+
+bool texture_compression_enabled()
+{
+  return compression_enabled.load();
+}
+
+void set_texture_compression_quality(compress_quality quality)
+{
+  compression_quality=quality;
+}
+
+compress_quality texture_compression_quality()
+{
+  return static_cast<compress_quality>(compression_quality.load());
+}
+
+void set_texture_cache_enabled(bool enabled)
+{
+  cache_enabled=enabled;
+}
+
+bool texture_cache_enabled()
+{
+  return cache_enabled.load();
+}
+
+std::vector<texture_source_cost> calibrate_texture_sources(const std::vector<std::string>& filenames)
+{
+  std::vector<std::vector<texture_source_cost> > costs(filenames.size());
+  task_group group(default_thread_pool());
+  for(unsigned int k=0;k<filenames.size();++k)
+    group.run([&filenames,&costs,k]() {
+      const std::vector<std::shared_ptr<texture_source> > variants=read_texture_variants(filenames[k]);
+      if(variants.empty())
+        return;
+      //choix deja mesure pour ces contenus et ces options
+      const bool use_cache=cache_enabled.load() && !variants[0]->from_pack;
+      const std::string choice_filename=use_cache ? variants_choice_filename(variants) : "";
+      if(use_cache && read_texture_choice(choice_filename,variants,&costs[k]))
+        return;
+      //les variantes d'une image sont mesurees l'une apres l'autre sur la meme tache
+      costs[k]=measure_texture_variants(variants);
+      if(use_cache)
+        save_texture_choice(choice_filename,costs[k]);
+    });
+  group.wait();
+
+  std::vector<texture_source_cost> all;
+  std::lock_guard<std::mutex> lock(source_mutex);
+  for(unsigned int k=0;k<filenames.size();++k)
+  {
+    const std::vector<texture_source_cost>& c=costs[k];
+    if(c.empty())
+      continue;
+    source_costs[filenames[k]]=c;
+    for(unsigned int v=0;v<c.size();++v)
+      if(c[v].chosen)
+        source_choices[filenames[k]]=c[v].filename;
+    all.insert(all.end(),c.begin(),c.end());
+  }
+  return all;
+}
+
+std::string texture_source_choice_filename(const std::string& filename)
+{
+  const std::vector<std::shared_ptr<texture_source> > variants=read_texture_variants(filename);
+  return variants.empty() ? "" : variants_choice_filename(variants);
+}
+
+std::string texture_source_choice(const std::string& filename)
+{
+  std::lock_guard<std::mutex> lock(source_mutex);
+  std::map<std::string,std::string>::const_iterator it=source_choices.find(filename);
+  return it!=source_choices.end() ? it->second : filename;
+}
+
+void print_texture_sources()
+{
+  std::lock_guard<std::mutex> lock(source_mutex);
+  for(std::map<std::string,std::vector<texture_source_cost> >::const_iterator it=source_costs.begin();it!=source_costs.end();++it)
+    for(unsigned int v=0;v<it->second.size();++v)
+    {
+      const texture_source_cost& c=it->second[v];
+      if(c.milliseconds>=0.0)
+        std::printf("%-32s %8.2f ms%s\n",c.filename.c_str(),c.milliseconds,c.chosen ? "  <-" : "");
+      else
+        std::printf("%-32s %11s%s\n",c.filename.c_str(),c.identical ? "-" : "texels differents",c.chosen ? "  <-" : "");
+    }
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#ifndef TEXTURE_CACHE_HPP
+#define TEXTURE_CACHE_HPP
+
+#include "mapped_file.hpp"
+#include "pack_file.hpp"
+#include "texture_compress.hpp"
+#include "texture_data.hpp"
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+/** Texture prete a envoyer sur le GPU.
+ *
+ *  Les niveaux de view pointent sur place dans le fichier projete (conteneur dds, ktx ou ktx2,
+ *  cache ktx) ou dans l'entree du pack, sans decodage ni copie; ils ne pointent dans data que
+ *  lorsqu'ils ont ete calcules a partir d'une image. La structure garde ces zones ouvertes
+ *  jusqu'a sa destruction, elle peut donc etre preparee sur un thread et envoyee sur un autre.
+ */
+struct texture_source
+{
+  std::string filename;
+  /** contenu du fichier source (pack ou projection) et son hachage */
+  const unsigned char* bytes;
+  size_t size;
+  unsigned long long content_hash;
+  bool from_pack;
+
+  pack_data pack;
+  mapped_file file;
+  mapped_file cache;
+  texture_data data;
+  texture_view view;
+
+  texture_source();
+};
+
+/** Lit sur place un conteneur dds, ktx ou ktx2 (reconnu a son identifiant) */
+bool parse_texture_container(const unsigned char* data,size_t size,texture_view* texture);
+
+/** Ouvre exactement filename depuis asset_pack() ou projete en memoire et calcule le hachage de son
+ *  contenu, sans le decoder. Renvoie nullptr si le fichier est introuvable. */
+std::shared_ptr<texture_source> read_texture_bytes(const std::string& filename);
+/** read_texture_bytes sur la variante retenue par calibrate_texture_sources pour ce nom (memes texels,
+ *  voir texture_source_choice), filename lui-meme sinon */
+std::shared_ptr<texture_source> read_texture_file(const std::string& filename);
+/** Remplit source->view:
+ *  - conteneur dds/ktx/ktx2: niveaux lus sur place;
+ *  - image (tga, jpg, png): RGBA8 et chaine de mipmaps, puis compression par blocs (BC1, ou BC3 si
+ *    l'image a de la transparence) quand elle est activee. Le resultat est relu sur place depuis le
+ *    cache source.<hachage>.ktx s'il existe et y est ecrit sinon; le hachage couvre le contenu du
+ *    source et les options, un cache perime n'est donc jamais relu. Pas de cache pour une entree de pack.
+ *  Exception std::string si l'image est illisible. */
+void prepare_texture(texture_source* source);
+/** read_texture_file puis prepare_texture, exception std::string si le fichier est illisible */
+std::shared_ptr<texture_source> open_texture_file(const std::string& filename);
+
+/** Cout mesure d'un format source */
+struct texture_source_cost
+{
+  std::string filename;
+  /** chargement a froid (lecture, hachage, decodage et preparation sans cache), en millisecondes;
+   *  negatif si la variante n'a pas ete mesuree */
+  double milliseconds;
+  /** decode exactement les memes texels que le fichier demande */
+  bool identical;
+  /** variante la moins chere parmi les identiques, retenue pour les chargements suivants */
+  bool chosen;
+};
+
+/** Choisit, pour chaque fichier demande present sous plusieurs formats (meme nom en .tga, .jpg, .png),
+ *  la variante la moins chere a charger a froid sur cette machine et avec les options courantes.
+ *  Seules les variantes qui decodent exactement les memes texels que le fichier demande peuvent le
+ *  remplacer: un jpg avec pertes ne remplace jamais une tga. Le cout mesure est celui d'un chargement
+ *  sans cache (decodage et compression compris), sans ecrire de fichier cache. Le choix est enregistre
+ *  a cote du fichier demande (<fichier>.<hachage>.source, hachage des contenus et des options) et
+ *  relu aux lancements suivants sans nouvelle mesure. Les images sont traitees en parallele sur le
+ *  pool, leurs variantes l'une apres l'autre. */
+std::vector<texture_source_cost> calibrate_texture_sources(const std::vector<std::string>& filenames);
+/** Variante retenue pour le fichier demande filename, filename s'il n'a pas ete calibre */
+std::string texture_source_choice(const std::string& filename);
+/** Fichier ou calibrate_texture_sources enregistre le choix pour filename avec les contenus et les
+ *  options courants, vide si filename est introuvable */
+std::string texture_source_choice_filename(const std::string& filename);
+/** Affiche les couts mesures et les variantes retenues */
+void print_texture_sources();
+
+/** Nom du fichier cache associe a un fichier source et au hachage de son contenu et des options */
+std::string texture_cache_filename(const std::string& source_filename,unsigned long long content_hash);
+/** Hachage d'un contenu combine a la version du cache et aux options de compression courantes */
+unsigned long long texture_options_hash(unsigned long long content_hash);
+/** Ecrit une texture cache (fichier temporaire puis renommage); sans effet si l'ecriture echoue */
+void save_texture_cache(const std::string& cache_filename,const texture_data& texture);
+
+/** Active ou desactive la compression des textures au chargement (active par defaut) */
+void set_texture_compression_enabled(bool enabled);
+bool texture_compression_enabled();
+/** Qualite de l'encodeur au chargement (compress_normal par defaut) */
+void set_texture_compression_quality(compress_quality quality);
+compress_quality texture_compression_quality();
+
+/** Active ou desactive les fichiers cache des textures (active par defaut) */
+void set_texture_cache_enabled(bool enabled);
+bool texture_cache_enabled();
+
+#endif
@@ -0,0 +1,761 @@
+
+#include "texture_compress.hpp"
+
+#include "thread_pool.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+  /** Bloc 4x4 lu dans l'image, texels hors image remplaces par le dernier texel de la ligne / colonne */
+  void fetch_block(const unsigned char* rgba,int width,int height,int bx,int by,unsigned char block[64])
+  {
+    for(int y=0;y<4;++y)
+    {
+      const int sy=std::min(4*by+y,height-1);
+      for(int x=0;x<4;++x)
+      {
+        const int sx=std::min(4*bx+x,width-1);
+        std::memcpy(block+4*(4*y+x),rgba+4*(static_cast<size_t>(sy)*width+sx),4);
+      }
+    }
+  }
+
+  void store_block(unsigned char* rgba,int width,int height,int bx,int by,const unsigned char block[64])
+  {
+    for(int y=0;y<4 && 4*by+y<height;++y)
+      for(int x=0;x<4 && 4*bx+x<width;++x)
+        std::memcpy(rgba+4*(static_cast<size_t>(4*by+y)*width+4*bx+x),block+4*(4*y+x),4);
+  }
+
+  //------------------------------------------------------------------------
+  // Couleurs (BC1 et partie couleur de BC3)
+  //------------------------------------------------------------------------
+
+  int clamp_byte(float v)
+  {
+    return std::max(0,std::min(255,static_cast<int>(v+0.5f)));
+  }
+
+  unsigned short pack_565(const float c[3])
+  {
+    const int r=(clamp_byte(c[0])*31+127)/255;
+    const int g=(clamp_byte(c[1])*63+127)/255;
+    const int b=(clamp_byte(c[2])*31+127)/255;
+    return static_cast<unsigned short>((r<<11)|(g<<5)|b);
+  }
+
+  void unpack_565(unsigned short p,int c[3])
+  {
+    const int r=(p>>11)&31,g=(p>>5)&63,b=p&31;
+    c[0]=(r<<3)|(r>>2);
+    c[1]=(g<<2)|(g>>4);
+    c[2]=(b<<3)|(b>>2);
+  }
+
+  /** Palette de 4 couleurs d'un bloc; c0<=c1 donne le mode 3 couleurs + noir */
+  void color_palette(unsigned short c0,unsigned short c1,int palette[4][3])
+  {
+    unpack_565(c0,palette[0]);
+    unpack_565(c1,palette[1]);
+    for(int k=0;k<3;++k)
+    {
+      if(c0>c1)
+      {
+        palette[2][k]=(2*palette[0][k]+palette[1][k])/3;
+        palette[3][k]=(palette[0][k]+2*palette[1][k])/3;
+      }
+      else
+      {
+        palette[2][k]=(palette[0][k]+palette[1][k])/2;
+        palette[3][k]=0;
+      }
+    }
+  }
+
+#if defined(__SSE2__)
+  /** Somme des 4 entiers d'un registre */
+  int horizontal_sum(__m128i v)
+  {
+    v=_mm_add_epi32(v,_mm_shuffle_epi32(v,_MM_SHUFFLE(1,0,3,2)));
+    v=_mm_add_epi32(v,_mm_shuffle_epi32(v,_MM_SHUFFLE(2,3,0,1)));
+    return _mm_cvtsi128_si32(v);
+  }
+
+  /** Garde dans (best_error,best) l'erreur e et l'indice index la ou e est strictement plus petite */
+  void keep_smaller(__m128i e,__m128i index,__m128i* best_error,__m128i* best)
+  {
+    const __m128i smaller=_mm_cmplt_epi32(e,*best_error);
+    *best_error=_mm_or_si128(_mm_and_si128(smaller,e),_mm_andnot_si128(smaller,*best_error));
+    *best=_mm_or_si128(_mm_and_si128(smaller,index),_mm_andnot_si128(smaller,*best));
+  }
+#endif
+
+  /** Couleur de la palette la plus proche de chaque texel (la premiere en cas d'egalite), renvoie l'erreur quadratique */
+  int select_color_indices(const int pixels[16][3],const int palette[4][3],int nb_color,int indices[16])
+  {
+#if defined(__SSE2__)
+    //4 texels par registre; r et g dans les deux moities 16 bits de chaque mot: _mm_madd_epi16 donne dr*dr+dg*dg
+    __m128i rg[4],b[4],best_error[4],best[4];
+    for(int q=0;q<4;++q)
+    {
+      const int (*p)[3]=pixels+4*q;
+      rg[q]=_mm_setr_epi32(p[0][0]|(p[0][1]<<16),p[1][0]|(p[1][1]<<16),p[2][0]|(p[2][1]<<16),p[3][0]|(p[3][1]<<16));
+      b[q]=_mm_setr_epi32(p[0][2],p[1][2],p[2][2],p[3][2]);
+      best_error[q]=_mm_set1_epi32(std::numeric_limits<int>::max());
+      best[q]=_mm_setzero_si128();
+    }
+    for(int k=0;k<nb_color;++k)
+    {
+      const __m128i palette_rg=_mm_set1_epi32(palette[k][0]|(palette[k][1]<<16));
+      const __m128i palette_b=_mm_set1_epi32(palette[k][2]);
+      const __m128i index=_mm_set1_epi32(k);
+      for(int q=0;q<4;++q)
+      {
+        const __m128i drg=_mm_sub_epi16(rg[q],palette_rg);
+        const __m128i db=_mm_sub_epi16(b[q],palette_b);
+        keep_smaller(_mm_add_epi32(_mm_madd_epi16(drg,drg),_mm_madd_epi16(db,db)),index,&best_error[q],&best[q]);
+      }
+    }
+    for(int q=0;q<4;++q)
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(indices+4*q),best[q]);
+    return horizontal_sum(_mm_add_epi32(_mm_add_epi32(best_error[0],best_error[1]),_mm_add_epi32(best_error[2],best_error[3])));
+#else
+    int error=0;
+    for(int i=0;i<16;++i)
+    {
+      int best=0,best_error=std::numeric_limits<int>::max();
+      for(int k=0;k<nb_color;++k)
+      {
+        const int dr=pixels[i][0]-palette[k][0];
+        const int dg=pixels[i][1]-palette[k][1];
+        const int db=pixels[i][2]-palette[k][2];
+        const int e=dr*dr+dg*dg+db*db;
+        if(e<best_error)
+        {
+          best_error=e;
+          best=k;
+        }
+      }
+      indices[i]=best;
+      error+=best_error;
+    }
+    return error;
+#endif
+  }
+
+  /** Encode le bloc avec les extremites donnees (mode 4 couleurs), renvoie l'erreur quadratique */
+  int encode_color_endpoints(const int pixels[16][3],const float e0[3],const float e1[3],unsigned char out[8],int indices[16])
+  {
+    unsigned short c0=pack_565(e0);
+    unsigned short c1=pack_565(e1);
+    if(c0<c1)
+      std::swap(c0,c1);
+
+    int palette[4][3];
+    color_palette(c0,c1,palette);
+    //extremites egales: une seule couleur, tous les indices a 0
+    const int nb_color=c0==c1 ? 1 : 4;
+
+    const int error=select_color_indices(pixels,palette,nb_color,indices);
+    unsigned int bits=0;
+    for(int i=0;i<16;++i)
+      bits|=static_cast<unsigned int>(indices[i])<<(2*i);
+
+    out[0]=static_cast<unsigned char>(c0&0xFF);
+    out[1]=static_cast<unsigned char>(c0>>8);
+    out[2]=static_cast<unsigned char>(c1&0xFF);
+    out[3]=static_cast<unsigned char>(c1>>8);
+    for(int k=0;k<4;++k)
+      out[4+k]=static_cast<unsigned char>((bits>>(8*k))&0xFF);
+    return error;
+  }
+
+  /** Extremites aux coins de la boite englobante, rentrees de 1/16 de son etendue */
+  void color_endpoints_box(const unsigned char block[64],float e0[3],float e1[3])
+  {
+    int mn[3],mx[3];
+#if defined(__SSE2__)
+    //minimum et maximum par octet sur les 4 quarts du bloc, puis entre les 4 texels restants
+    const __m128i* quarter=reinterpret_cast<const __m128i*>(block);
+    __m128i v_min=_mm_loadu_si128(quarter);
+    __m128i v_max=v_min;
+    for(int q=1;q<4;++q)
+    {
+      const __m128i v=_mm_loadu_si128(quarter+q);
+      v_min=_mm_min_epu8(v_min,v);
+      v_max=_mm_max_epu8(v_max,v);
+    }
+    v_min=_mm_min_epu8(v_min,_mm_shuffle_epi32(v_min,_MM_SHUFFLE(1,0,3,2)));
+    v_max=_mm_max_epu8(v_max,_mm_shuffle_epi32(v_max,_MM_SHUFFLE(1,0,3,2)));
+    v_min=_mm_min_epu8(v_min,_mm_shuffle_epi32(v_min,_MM_SHUFFLE(2,3,0,1)));
+    v_max=_mm_max_epu8(v_max,_mm_shuffle_epi32(v_max,_MM_SHUFFLE(2,3,0,1)));
+    const unsigned int packed_min=static_cast<unsigned int>(_mm_cvtsi128_si32(v_min));
+    const unsigned int packed_max=static_cast<unsigned int>(_mm_cvtsi128_si32(v_max));
+    for(int k=0;k<3;++k)
+    {
+      mn[k]=(packed_min>>(8*k))&0xFF;
+      mx[k]=(packed_max>>(8*k))&0xFF;
+    }
+#else
+    for(int k=0;k<3;++k)
+    {
+      mn[k]=255;
+      mx[k]=0;
+      for(int i=0;i<16;++i)
+      {
+        mn[k]=std::min(mn[k],static_cast<int>(block[4*i+k]));
+        mx[k]=std::max(mx[k],static_cast<int>(block[4*i+k]));
+      }
+    }
+#endif
+    for(int k=0;k<3;++k)
+    {
+      const float inset=(mx[k]-mn[k])/16.0f;
+      e0[k]=mx[k]-inset;
+      e1[k]=mn[k]+inset;
+    }
+  }
+
+#if defined(__SSE2__)
+  float horizontal_sum(__m128 v)
+  {
+    v=_mm_add_ps(v,_mm_shuffle_ps(v,v,_MM_SHUFFLE(1,0,3,2)));
+    v=_mm_add_ps(v,_mm_shuffle_ps(v,v,_MM_SHUFFLE(2,3,0,1)));
+    return _mm_cvtss_f32(v);
+  }
+#endif
+
+  /** Moyenne et covariance (xx xy xz yy yz zz) des couleurs du bloc */
+  void color_statistics(const unsigned char block[64],float mean[3],float cov[6])
+  {
+#if defined(__SSE2__)
+    //canaux separes en flottants, 4 texels par registre
+    const __m128i mask=_mm_set1_epi32(0xFF);
+    __m128 c[3][4];
+    __m128 sum[3]={_mm_setzero_ps(),_mm_setzero_ps(),_mm_setzero_ps()};
+    for(int q=0;q<4;++q)
+    {
+      const __m128i v=_mm_loadu_si128(reinterpret_cast<const __m128i*>(block)+q);
+      for(int k=0;k<3;++k)
+      {
+        c[k][q]=_mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(v,8*k),mask));
+        sum[k]=_mm_add_ps(sum[k],c[k][q]);
+      }
+    }
+    __m128 m[3];
+    for(int k=0;k<3;++k)
+    {
+      mean[k]=horizontal_sum(sum[k])/16.0f;
+      m[k]=_mm_set1_ps(mean[k]);
+    }
+    __m128 acc[6];
+    for(int j=0;j<6;++j)
+      acc[j]=_mm_setzero_ps();
+    for(int q=0;q<4;++q)
+    {
+      const __m128 dx=_mm_sub_ps(c[0][q],m[0]);
+      const __m128 dy=_mm_sub_ps(c[1][q],m[1]);
+      const __m128 dz=_mm_sub_ps(c[2][q],m[2]);
+      acc[0]=_mm_add_ps(acc[0],_mm_mul_ps(dx,dx)); acc[1]=_mm_add_ps(acc[1],_mm_mul_ps(dx,dy)); acc[2]=_mm_add_ps(acc[2],_mm_mul_ps(dx,dz));
+      acc[3]=_mm_add_ps(acc[3],_mm_mul_ps(dy,dy)); acc[4]=_mm_add_ps(acc[4],_mm_mul_ps(dy,dz)); acc[5]=_mm_add_ps(acc[5],_mm_mul_ps(dz,dz));
+    }
+    for(int j=0;j<6;++j)
+      cov[j]=horizontal_sum(acc[j]);
+#else
+    for(int k=0;k<3;++k)
+      mean[k]=0.0f;
+    for(int i=0;i<16;++i)
+      for(int k=0;k<3;++k)
+        mean[k]+=block[4*i+k];
+    for(int k=0;k<3;++k)
+      mean[k]/=16.0f;
+
+    for(int j=0;j<6;++j)
+      cov[j]=0.0f;
+    for(int i=0;i<16;++i)
+    {
+      const float d[3]={block[4*i]-mean[0],block[4*i+1]-mean[1],block[4*i+2]-mean[2]};
+      cov[0]+=d[0]*d[0]; cov[1]+=d[0]*d[1]; cov[2]+=d[0]*d[2];
+      cov[3]+=d[1]*d[1]; cov[4]+=d[1]*d[2]; cov[5]+=d[2]*d[2];
+    }
+#endif
+  }
+
+  /** Extremites aux projections extremes sur l'axe principal (iterations de la puissance sur la covariance) */
+  void color_endpoints_axis(const unsigned char block[64],float e0[3],float e1[3])
+  {
+    float mean[3];
+    float cov[6]; //xx xy xz yy yz zz
+    color_statistics(block,mean,cov);
+
+    float axis[3]={1.0f,1.0f,1.0f};
+    for(int it=0;it<8;++it)
+    {
+      const float a[3]={cov[0]*axis[0]+cov[1]*axis[1]+cov[2]*axis[2],
+                        cov[1]*axis[0]+cov[3]*axis[1]+cov[4]*axis[2],
+                        cov[2]*axis[0]+cov[4]*axis[1]+cov[5]*axis[2]};
+      const float n=std::max(std::fabs(a[0]),std::max(std::fabs(a[1]),std::fabs(a[2])));
+      if(n<1e-6f)
+      {
+        //bloc uniforme
+        for(int k=0;k<3;++k)
+          e0[k]=e1[k]=mean[k];
+        return;
+      }
+      for(int k=0;k<3;++k)
+        axis[k]=a[k]/n;
+    }
+
+    float t_min=std::numeric_limits<float>::max(),t_max=-std::numeric_limits<float>::max();
+    for(int i=0;i<16;++i)
+    {
+      const float t=(block[4*i]-mean[0])*axis[0]+(block[4*i+1]-mean[1])*axis[1]+(block[4*i+2]-mean[2])*axis[2];
+      t_min=std::min(t_min,t);
+      t_max=std::max(t_max,t);
+    }
+    const float norm2=axis[0]*axis[0]+axis[1]*axis[1]+axis[2]*axis[2];
+    const float inset=(t_max-t_min)/16.0f;
+    for(int k=0;k<3;++k)
+    {
+      e0[k]=mean[k]+(t_max-inset)*axis[k]/norm2;
+      e1[k]=mean[k]+(t_min+inset)*axis[k]/norm2;
+    }
+  }
+
+  /** Extremites optimales au sens des moindres carres pour les indices donnes (mode 4 couleurs) */
+  bool color_endpoints_fit(const int pixels[16][3],const int indices[16],float e0[3],float e1[3])
+  {
+    static const float weight[4]={1.0f,0.0f,2.0f/3.0f,1.0f/3.0f};
+    float aa=0.0f,bb=0.0f,ab=0.0f;
+    float ap[3]={0.0f,0.0f,0.0f},bp[3]={0.0f,0.0f,0.0f};
+    for(int i=0;i<16;++i)
+    {
+      const float w=weight[indices[i]];
+      aa+=w*w;
+      bb+=(1.0f-w)*(1.0f-w);
+      ab+=w*(1.0f-w);
+      for(int k=0;k<3;++k)
+      {
+        ap[k]+=w*pixels[i][k];
+        bp[k]+=(1.0f-w)*pixels[i][k];
+      }
+    }
+    const float det=aa*bb-ab*ab;
+    if(std::fabs(det)<1e-6f)
+      return false;
+    for(int k=0;k<3;++k)
+    {
+      e0[k]=(ap[k]*bb-bp[k]*ab)/det;
+      e1[k]=(bp[k]*aa-ap[k]*ab)/det;
+    }
+    return true;
+  }
+
+  void encode_color_block(const unsigned char block[64],compress_quality quality,unsigned char out[8])
+  {
+    int pixels[16][3];
+    for(int i=0;i<16;++i)
+      for(int k=0;k<3;++k)
+        pixels[i][k]=block[4*i+k];
+
+    float e0[3],e1[3];
+    if(quality==compress_fast) color_endpoints_box(block,e0,e1);
+    else                       color_endpoints_axis(block,e0,e1);
+
+    int indices[16];
+    int error=encode_color_endpoints(pixels,e0,e1,out,indices);
+    if(quality!=compress_high)
+      return;
+
+    for(int it=0;it<2 && error>0;++it)
+    {
+      if(!color_endpoints_fit(pixels,indices,e0,e1))
+        break;
+      unsigned char candidate[8];
+      int candidate_indices[16];
+      const int candidate_error=encode_color_endpoints(pixels,e0,e1,candidate,candidate_indices);
+      if(candidate_error>=error)
+        break;
+      error=candidate_error;
+      std::memcpy(out,candidate,8);
+      std::memcpy(indices,candidate_indices,sizeof(indices));
+    }
+  }
+
+  void decode_color_block(const unsigned char in[8],unsigned char block[64])
+  {
+    const unsigned short c0=static_cast<unsigned short>(in[0]|(in[1]<<8));
+    const unsigned short c1=static_cast<unsigned short>(in[2]|(in[3]<<8));
+    int palette[4][3];
+    color_palette(c0,c1,palette);
+    const unsigned int bits=in[4]|(in[5]<<8)|(in[6]<<16)|(static_cast<unsigned int>(in[7])<<24);
+    for(int i=0;i<16;++i)
+    {
+      const int k=(bits>>(2*i))&3;
+      block[4*i+0]=static_cast<unsigned char>(palette[k][0]);
+      block[4*i+1]=static_cast<unsigned char>(palette[k][1]);
+      block[4*i+2]=static_cast<unsigned char>(palette[k][2]);
+      block[4*i+3]=static_cast<unsigned char>(c0<=c1 && k==3 ? 0 : 255);
+    }
+  }
+
+  //------------------------------------------------------------------------
+  // Canal seul (BC4, canaux de BC5 et alpha de BC3)
+  //------------------------------------------------------------------------
+
+  /** Palette de 8 valeurs: a0>a1 interpole 8 valeurs, sinon 6 valeurs plus 0 et 255 */
+  void channel_palette(int a0,int a1,int palette[8])
+  {
+    palette[0]=a0;
+    palette[1]=a1;
+    if(a0>a1)
+    {
+      for(int i=2;i<8;++i)
+        palette[i]=((8-i)*a0+(i-1)*a1)/7;
+    }
+    else
+    {
+      for(int i=2;i<6;++i)
+        palette[i]=((6-i)*a0+(i-1)*a1)/5;
+      palette[6]=0;
+      palette[7]=255;
+    }
+  }
+
+  /** Valeur de la palette la plus proche de chaque texel (la premiere en cas d'egalite), renvoie l'erreur quadratique */
+  int select_channel_indices(const int values[16],const int palette[8],int indices[16])
+  {
+#if defined(__SSE2__)
+    //valeurs dans la moitie basse 16 bits de chaque mot, la moitie haute reste nulle apres soustraction
+    __m128i v[4],best_error[4],best[4];
+    for(int q=0;q<4;++q)
+    {
+      v[q]=_mm_loadu_si128(reinterpret_cast<const __m128i*>(values+4*q));
+      best_error[q]=_mm_set1_epi32(std::numeric_limits<int>::max());
+      best[q]=_mm_setzero_si128();
+    }
+    for(int k=0;k<8;++k)
+    {
+      const __m128i p=_mm_set1_epi32(palette[k]);
+      const __m128i index=_mm_set1_epi32(k);
+      for(int q=0;q<4;++q)
+      {
+        const __m128i d=_mm_sub_epi16(v[q],p);
+        keep_smaller(_mm_madd_epi16(d,d),index,&best_error[q],&best[q]);
+      }
+    }
+    for(int q=0;q<4;++q)
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(indices+4*q),best[q]);
+    return horizontal_sum(_mm_add_epi32(_mm_add_epi32(best_error[0],best_error[1]),_mm_add_epi32(best_error[2],best_error[3])));
+#else
+    int error=0;
+    for(int i=0;i<16;++i)
+    {
+      int best=0,best_error=std::numeric_limits<int>::max();
+      for(int k=0;k<8;++k)
+      {
+        const int d=values[i]-palette[k];
+        if(d*d<best_error)
+        {
+          best_error=d*d;
+          best=k;
+        }
+      }
+      indices[i]=best;
+      error+=best_error;
+    }
+    return error;
+#endif
+  }
+
+  int encode_channel_endpoints(const int values[16],int a0,int a1,unsigned char out[8],int indices[16])
+  {
+    int palette[8];
+    channel_palette(a0,a1,palette);
+
+    const int error=select_channel_indices(values,palette,indices);
+    unsigned long long bits=0;
+    for(int i=0;i<16;++i)
+      bits|=static_cast<unsigned long long>(indices[i])<<(3*i);
+
+    out[0]=static_cast<unsigned char>(a0);
+    out[1]=static_cast<unsigned char>(a1);
+    for(int k=0;k<6;++k)
+      out[2+k]=static_cast<unsigned char>((bits>>(8*k))&0xFF);
+    return error;
+  }
+
+  /** Extremites optimales au sens des moindres carres pour les indices donnes (mode 8 valeurs) */
+  bool channel_endpoints_fit(const int values[16],const int indices[16],int* a0,int* a1)
+  {
+    float aa=0.0f,bb=0.0f,ab=0.0f,ap=0.0f,bp=0.0f;
+    for(int i=0;i<16;++i)
+    {
+      const int k=indices[i];
+      const float w=k==0 ? 1.0f : k==1 ? 0.0f : (8-k)/7.0f;
+      aa+=w*w;
+      bb+=(1.0f-w)*(1.0f-w);
+      ab+=w*(1.0f-w);
+      ap+=w*values[i];
+      bp+=(1.0f-w)*values[i];
+    }
+    const float det=aa*bb-ab*ab;
+    if(std::fabs(det)<1e-6f)
+      return false;
+    *a0=clamp_byte((ap*bb-bp*ab)/det);
+    *a1=clamp_byte((bp*aa-ap*ab)/det);
+    return *a0>*a1;
+  }
+
+  void encode_channel_block(const unsigned char block[64],int channel,compress_quality quality,unsigned char out[8])
+  {
+    int values[16];
+    int mn=255,mx=0;
+    int inner_min=255,inner_max=0;
+    bool extremes=false;
+    for(int i=0;i<16;++i)
+    {
+      values[i]=block[4*i+channel];
+      mn=std::min(mn,values[i]);
+      mx=std::max(mx,values[i]);
+      if(values[i]==0 || values[i]==255)
+        extremes=true;
+      else
+      {
+        inner_min=std::min(inner_min,values[i]);
+        inner_max=std::max(inner_max,values[i]);
+      }
+    }
+
+    int indices[16];
+    int error=encode_channel_endpoints(values,mx,mn,out,indices);
+    if(quality==compress_fast || error==0)
+      return;
+
+    //0 et 255 exacts en mode 6 valeurs, le reste interpole entre les valeurs intermediaires
+    if(extremes && inner_min<=inner_max)
+    {
+      unsigned char candidate[8];
+      int candidate_indices[16];
+      const int candidate_error=encode_channel_endpoints(values,inner_min,inner_max,candidate,candidate_indices);
+      if(candidate_error<error)
+      {
+        error=candidate_error;
+        std::memcpy(out,candidate,8);
+        std::memcpy(indices,candidate_indices,sizeof(indices));
+      }
+    }
+    if(quality!=compress_high || out[0]<=out[1])
+      return;
+
+    for(int it=0;it<2 && error>0;++it)
+    {
+      int a0,a1;
+      if(!channel_endpoints_fit(values,indices,&a0,&a1))
+        break;
+      unsigned char candidate[8];
+      int candidate_indices[16];
+      const int candidate_error=encode_channel_endpoints(values,a0,a1,candidate,candidate_indices);
+      if(candidate_error>=error)
+        break;
+      error=candidate_error;
+      std::memcpy(out,candidate,8);
+      std::memcpy(indices,candidate_indices,sizeof(indices));
+    }
+  }
+
+  void decode_channel_block(const unsigned char in[8],int channel,unsigned char block[64])
+  {
+    int palette[8];
+    channel_palette(in[0],in[1],palette);
+    unsigned long long bits=0;
+    for(int k=0;k<6;++k)
+      bits|=static_cast<unsigned long long>(in[2+k])<<(8*k);
+    for(int i=0;i<16;++i)
+      block[4*i+channel]=static_cast<unsigned char>(palette[(bits>>(3*i))&7]);
+  }
+
+  void encode_block(const unsigned char block[64],block_format format,compress_quality quality,unsigned char* out)
+  {
+    switch(format)
+    {
+    case block_bc1: encode_color_block(block,quality,out); break;
+    case block_bc3: encode_channel_block(block,3,quality,out); encode_color_block(block,quality,out+8); break;
+    case block_bc4: encode_channel_block(block,0,quality,out); break;
+    case block_bc5: encode_channel_block(block,0,quality,out); encode_channel_block(block,1,quality,out+8); break;
+    }
+  }
+
+  void decode_block(const unsigned char* in,block_format format,unsigned char block[64])
+  {
+    for(int i=0;i<16;++i)
+    {
+      block[4*i+0]=block[4*i+1]=block[4*i+2]=0;
+      block[4*i+3]=255;
+    }
+    switch(format)
+    {
+    case block_bc1: decode_color_block(in,block); break;
+    case block_bc3: decode_color_block(in+8,block); decode_channel_block(in,3,block); break;
+    case block_bc4: decode_channel_block(in,0,block); break;
+    case block_bc5: decode_channel_block(in,0,block); decode_channel_block(in+8,1,block); break;
+    }
+  }
+}
+
+size_t block_size(block_format format)
+{
+  return format==block_bc1 || format==block_bc4 ? 8 : 16;
+}
+
+unsigned int block_gl_internal_format(block_format format)
+{
+  switch(format)
+  {
+  case block_bc1: return texture_gl_compressed_bc1;
+  case block_bc3: return texture_gl_compressed_bc3;
+  case block_bc4: return texture_gl_compressed_bc4;
+  case block_bc5: return texture_gl_compressed_bc5;
+  }
+  return 0;
+}
+
+bool block_format_of(unsigned int gl_internal_format,block_format* format)
+{
+  switch(gl_internal_format)
+  {
+  case texture_gl_compressed_bc1: *format=block_bc1; return true;
+  case texture_gl_compressed_bc3: *format=block_bc3; return true;
+  case texture_gl_compressed_bc4: *format=block_bc4; return true;
+  case texture_gl_compressed_bc5: *format=block_bc5; return true;
+  }
+  return false;
+}
+
+block_format choose_block_format(const unsigned char* rgba,size_t nb_pixel)
+{
+  for(size_t k=0;k<nb_pixel;++k)
+    if(rgba[4*k+3]!=255)
+      return block_bc3;
+  return block_bc1;
+}
+
+std::vector<unsigned char> compress_blocks(const unsigned char* rgba,int width,int height,block_format format,compress_quality quality)
+{
+  const int nb_block_x=(width+3)/4;
+  const int nb_block_y=(height+3)/4;
+  const size_t size=block_size(format);
+  std::vector<unsigned char> blocks(size*nb_block_x*nb_block_y);
+  if(blocks.empty())
+    return blocks;
+
+  parallel_for(0,nb_block_y,4,[&](int y_begin,int y_end) {
+    unsigned char block[64];
+    for(int by=y_begin;by<y_end;++by)
+      for(int bx=0;bx<nb_block_x;++bx)
+      {
+        fetch_block(rgba,width,height,bx,by,block);
+        encode_block(block,format,quality,&blocks[size*(static_cast<size_t>(by)*nb_block_x+bx)]);
+      }
+  });
+  return blocks;
+}
+
+std::vector<unsigned char> decompress_blocks(const unsigned char* blocks,int width,int height,block_format format)
+{
+  const int nb_block_x=(width+3)/4;
+  const int nb_block_y=(height+3)/4;
+  const size_t size=block_size(format);
+  std::vector<unsigned char> rgba(4*static_cast<size_t>(width)*height);
+  if(rgba.empty())
+    return rgba;
+
+  parallel_for(0,nb_block_y,16,[&](int y_begin,int y_end) {
+    unsigned char block[64];
+    for(int by=y_begin;by<y_end;++by)
+      for(int bx=0;bx<nb_block_x;++bx)
+      {
+        decode_block(blocks+size*(static_cast<size_t>(by)*nb_block_x+bx),format,block);
+        store_block(&rgba[0],width,height,bx,by,block);
+      }
+  });
+  return rgba;
+}
+
+texture_data compress_texture(const texture_data& rgba,block_format format,compress_quality quality)
+{
+  texture_data t;
+  t.gl_internal_format=block_gl_internal_format(format);
+  t.gl_format=0;
+  t.gl_type=0;
+  t.levels.resize(rgba.levels.size());
+  for(unsigned int k=0;k<rgba.levels.size();++k)
+  {
+    const texture_level& src=rgba.levels[k];
+    t.levels[k].width=src.width;
+    t.levels[k].height=src.height;
+    if(!src.data.empty())
+      t.levels[k].data=compress_blocks(&src.data[0],src.width,src.height,format,quality);
+  }
+  return t;
+}
+
+texture_data decompress_texture(const texture_data& compressed)
+{
+  block_format format;
+  if(!compressed.compressed() || !block_format_of(compressed.gl_internal_format,&format))
+    return compressed;
+
+  texture_data t;
+  t.levels.resize(compressed.levels.size());
+  for(unsigned int k=0;k<compressed.levels.size();++k)
+  {
+    const texture_level& src=compressed.levels[k];
+    t.levels[k].width=src.width;
+    t.levels[k].height=src.height;
+    if(!src.data.empty())
+      t.levels[k].data=decompress_blocks(&src.data[0],src.width,src.height,format);
+  }
+  return t;
+}
+
+double block_psnr(const unsigned char* rgba,const unsigned char* decoded,size_t nb_pixel,block_format format)
+{
+  const bool channels[4][4]={{true,true,true,false},{true,true,true,true},{true,false,false,false},{true,true,false,false}};
+  const bool* used=channels[format];
+
+  double sum=0.0;
+  size_t count=0;
+  for(size_t k=0;k<nb_pixel;++k)
+    for(int c=0;c<4;++c)
+      if(used[c])
+      {
+        const double d=static_cast<double>(rgba[4*k+c])-decoded[4*k+c];
+        sum+=d*d;
+        ++count;
+      }
+  if(count==0 || sum==0.0)
+    return std::numeric_limits<double>::infinity();
+  return 10.0*std::log10(255.0*255.0/(sum/count));
+}
+
+double texture_psnr(const texture_data& rgba,const texture_data& compressed)
+{
+  block_format format;
+  if(rgba.levels.empty() || compressed.levels.empty() || !block_format_of(compressed.gl_internal_format,&format))
+    return 0.0;
+  const texture_level& src=rgba.levels[0];
+  const texture_level& dst=compressed.levels[0];
+  if(src.data.empty() || dst.data.empty())
+    return 0.0;
+  const std::vector<unsigned char> decoded=decompress_blocks(&dst.data[0],dst.width,dst.height,format);
+  return block_psnr(&src.data[0],&decoded[0],static_cast<size_t>(src.width)*src.height,format);
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#ifndef TEXTURE_COMPRESS_HPP
+#define TEXTURE_COMPRESS_HPP
+
+#include "texture_data.hpp"
+
+#include <cstddef>
+#include <vector>
+
+/** Formats compresses par blocs de 4x4 texels (S3TC / RGTC) */
+enum block_format
+{
+  /** RGB opaque, 8 octets par bloc (DXT1) */
+  block_bc1,
+  /** RGBA, alpha interpole sur 8 niveaux, 16 octets par bloc (DXT5) */
+  block_bc3,
+  /** canal rouge seul, 8 octets par bloc */
+  block_bc4,
+  /** canaux rouge et vert (cartes de normales), 16 octets par bloc */
+  block_bc5
+};
+
+/** Compromis vitesse / qualite de l'encodeur */
+enum compress_quality
+{
+  /** extremites prises sur la boite englobante des couleurs du bloc */
+  compress_fast,
+  /** extremites sur l'axe principal des couleurs du bloc */
+  compress_normal,
+  /** axe principal puis extremites affinees par moindres carres */
+  compress_high
+};
+
+const unsigned int texture_gl_compressed_bc1=0x83F0; //GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+const unsigned int texture_gl_compressed_bc3=0x83F3; //GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+const unsigned int texture_gl_compressed_bc4=0x8DBB; //GL_COMPRESSED_RED_RGTC1
+const unsigned int texture_gl_compressed_bc5=0x8DBD; //GL_COMPRESSED_RG_RGTC2
+
+/** Taille d'un bloc en octets */
+size_t block_size(block_format format);
+/** Format interne OpenGL du format de blocs */
+unsigned int block_gl_internal_format(block_format format);
+/** Format de blocs d'un format interne OpenGL, false s'il n'est pas gere */
+bool block_format_of(unsigned int gl_internal_format,block_format* format);
+/** BC1 si tous les texels sont opaques, BC3 sinon */
+block_format choose_block_format(const unsigned char* rgba,size_t nb_pixel);
+
+/** Compresse une image RGBA8 (blocs en bord d'image completes par le dernier texel).
+ *  Les lignes de blocs sont reparties sur le pool de threads. */
+std::vector<unsigned char> compress_blocks(const unsigned char* rgba,int width,int height,block_format format,compress_quality quality);
+/** Decompresse des blocs en RGBA8, comme le GPU: BC4 donne (r,0,0,255), BC5 (r,g,0,255) */
+std::vector<unsigned char> decompress_blocks(const unsigned char* blocks,int width,int height,block_format format);
+
+/** Compresse tous les niveaux d'une texture RGBA8 */
+texture_data compress_texture(const texture_data& rgba,block_format format,compress_quality quality);
+/** Texture RGBA8 des niveaux d'une texture compressee (si le GPU ne sait pas lire le format) */
+texture_data decompress_texture(const texture_data& compressed);
+
+/** Rapport signal/bruit (dB) entre deux images RGBA8, sur les canaux codes par le format
+ *  (RGB pour BC1, RGBA pour BC3, R pour BC4, RG pour BC5). Infini si les images sont identiques. */
+double block_psnr(const unsigned char* rgba,const unsigned char* decoded,size_t nb_pixel,block_format format);
+/** PSNR du niveau 0 d'une texture compressee par rapport a sa source RGBA8 */
+double texture_psnr(const texture_data& rgba,const texture_data& compressed);
+
+#endif
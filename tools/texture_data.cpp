@@ -0,0 +1,167 @@
+
+#include "texture_data.hpp"
+
+#include "image.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+texture_data::texture_data()
+  :gl_internal_format(texture_gl_rgba8),gl_format(texture_gl_rgba),gl_type(texture_gl_unsigned_byte),levels()
+{}
+
+bool texture_data::compressed() const
+{
+  return gl_format==0;
+}
+
+texture_view::texture_view()
+  :gl_internal_format(texture_gl_rgba8),gl_format(texture_gl_rgba),gl_type(texture_gl_unsigned_byte),levels()
+{}
+
+bool texture_view::compressed() const
+{
+  return gl_format==0;
+}
+
+texture_view view_of(const texture_data& texture)
+{
+  texture_view view;
+  view.gl_internal_format=texture.gl_internal_format;
+  view.gl_format=texture.gl_format;
+  view.gl_type=texture.gl_type;
+  view.levels.resize(texture.levels.size());
+  for(unsigned int k=0;k<texture.levels.size();++k)
+  {
+    const texture_level& l=texture.levels[k];
+    view.levels[k].width=l.width;
+    view.levels[k].height=l.height;
+    view.levels[k].data=l.data.empty() ? nullptr : &l.data[0];
+    view.levels[k].size=l.data.size();
+  }
+  return view;
+}
+
+texture_data copy_of(const texture_view& view)
+{
+  texture_data texture;
+  texture.gl_internal_format=view.gl_internal_format;
+  texture.gl_format=view.gl_format;
+  texture.gl_type=view.gl_type;
+  texture.levels.resize(view.levels.size());
+  for(unsigned int k=0;k<view.levels.size();++k)
+  {
+    const texture_level_view& l=view.levels[k];
+    texture.levels[k].width=l.width;
+    texture.levels[k].height=l.height;
+    texture.levels[k].data.assign(l.data,l.data+l.size);
+  }
+  return texture;
+}
+
+std::vector<texture_level> build_mipmaps_rgba8(const unsigned char* rgba,int width,int height)
+{
+  std::vector<texture_level> levels(1);
+  levels[0].width=width;
+  levels[0].height=height;
+  levels[0].data.assign(rgba,rgba+4*static_cast<size_t>(width)*height);
+
+  while(levels.back().width>1 || levels.back().height>1)
+  {
+    const texture_level& src=levels.back();
+    texture_level dst;
+    dst.width=std::max(1,src.width/2);
+    dst.height=std::max(1,src.height/2);
+    dst.data.resize(4*static_cast<size_t>(dst.width)*dst.height);
+
+    //pour une dimension impaire ou egale a 1, le dernier texel est repris
+    for(int y=0;y<dst.height;++y)
+    {
+      const int y0=std::min(2*y,src.height-1);
+      const int y1=std::min(2*y+1,src.height-1);
+      for(int x=0;x<dst.width;++x)
+      {
+        const int x0=std::min(2*x,src.width-1);
+        const int x1=std::min(2*x+1,src.width-1);
+        const unsigned char* p00=&src.data[4*(static_cast<size_t>(y0)*src.width+x0)];
+        const unsigned char* p01=&src.data[4*(static_cast<size_t>(y0)*src.width+x1)];
+        const unsigned char* p10=&src.data[4*(static_cast<size_t>(y1)*src.width+x0)];
+        const unsigned char* p11=&src.data[4*(static_cast<size_t>(y1)*src.width+x1)];
+        unsigned char* q=&dst.data[4*(static_cast<size_t>(y)*dst.width+x)];
+        for(int c=0;c<4;++c)
+          q[c]=static_cast<unsigned char>((p00[c]+p01[c]+p10[c]+p11[c]+2)/4);
+      }
+    }
+    levels.push_back(dst);
+  }
+  return levels;
+}
+
+texture_data texture_rgba8(const unsigned char* rgba,int width,int height)
+{
+  texture_data t;
+  t.levels=build_mipmaps_rgba8(rgba,width,height);
+  return t;
+}
+
+std::vector<unsigned char> image_rgba8(const Image& image)
+{
+  const size_t nb_pixel=static_cast<size_t>(image.width)*image.height;
+  std::vector<unsigned char> rgba(4*nb_pixel);
+  const unsigned char* p=image.data;
+  unsigned char* q=&rgba[0];
+  switch(image.type)
+  {
+  case IMAGE_TYPE_GRAY:
+    for(size_t k=0;k<nb_pixel;++k,p+=1,q+=4) { q[0]=q[1]=q[2]=p[0]; q[3]=255; }
+    break;
+  case IMAGE_TYPE_GRAYA:
+    for(size_t k=0;k<nb_pixel;++k,p+=2,q+=4) { q[0]=q[1]=q[2]=p[0]; q[3]=p[1]; }
+    break;
+  case IMAGE_TYPE_RGB:
+    for(size_t k=0;k<nb_pixel;++k,p+=3,q+=4) { q[0]=p[0]; q[1]=p[1]; q[2]=p[2]; q[3]=255; }
+    break;
+  case IMAGE_TYPE_RGBA:
+    std::memcpy(q,p,4*nb_pixel);
+    break;
+  }
+  return rgba;
+}
+
+texture_data texture_from_image(const Image& image,bool mipmaps)
+{
+  const std::vector<unsigned char> rgba=image_rgba8(image);
+  if(mipmaps)
+    return texture_rgba8(&rgba[0],image.width,image.height);
+
+  texture_data t;
+  t.levels.resize(1);
+  t.levels[0].width=image.width;
+  t.levels[0].height=image.height;
+  t.levels[0].data=rgba;
+  return t;
+}
+
+int texture_level_count(int width,int height)
+{
+  int n=1;
+  for(int size=std::max(width,height);size>1;size/=2)
+    ++n;
+  return n;
+}
+
+size_t texture_memory(const texture_data& texture)
+{
+  size_t size=0;
+  for(unsigned int k=0;k<texture.levels.size();++k)
+    size+=texture.levels[k].data.size();
+  return size;
+}
+
+size_t texture_memory(const texture_view& texture)
+{
+  size_t size=0;
+  for(unsigned int k=0;k<texture.levels.size();++k)
+    size+=texture.levels[k].size;
+  return size;
+}
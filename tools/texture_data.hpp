@@ -0,0 +1,84 @@
+#pragma once
+
+#ifndef TEXTURE_DATA_HPP
+#define TEXTURE_DATA_HPP
+
+#include <cstddef>
+#include <vector>
+
+struct Image;
+
+/** Un niveau de mipmap (pixels du niveau, lignes jointives) */
+struct texture_level
+{
+  int width;
+  int height;
+  std::vector<unsigned char> data;
+};
+
+/** Une texture 2D et sa chaine de mipmaps, decrite avec les constantes OpenGL
+ *  (les valeurs sont stockees sans inclure d'en-tete OpenGL) */
+struct texture_data
+{
+  /** format interne (GL_RGBA8, GL_COMPRESSED_...) */
+  unsigned int gl_internal_format;
+  /** format et type des pixels (0 pour un format compresse) */
+  unsigned int gl_format;
+  unsigned int gl_type;
+  /** niveaux du plus grand (0) au plus petit (1x1) */
+  std::vector<texture_level> levels;
+
+  texture_data();
+  /** Indique si les niveaux sont des blocs compresses */
+  bool compressed() const;
+};
+
+/** Niveau d'une texture lu sur place (fichier projete, entree de pack), sans copie */
+struct texture_level_view
+{
+  int width;
+  int height;
+  const unsigned char* data;
+  size_t size;
+};
+
+/** Une texture dont les niveaux pointent dans une zone memoire qui doit rester valide jusqu'a l'envoi */
+struct texture_view
+{
+  unsigned int gl_internal_format;
+  unsigned int gl_format;
+  unsigned int gl_type;
+  std::vector<texture_level_view> levels;
+
+  texture_view();
+  /** Indique si les niveaux sont des blocs compresses */
+  bool compressed() const;
+};
+
+/** Vue sur les niveaux d'une texture (valide tant que la texture n'est pas modifiee) */
+texture_view view_of(const texture_data& texture);
+/** Copie des niveaux d'une vue */
+texture_data copy_of(const texture_view& view);
+
+const unsigned int texture_gl_rgba=0x1908;
+const unsigned int texture_gl_bgr=0x80E0;
+const unsigned int texture_gl_bgra=0x80E1;
+const unsigned int texture_gl_rgba8=0x8058;
+const unsigned int texture_gl_unsigned_byte=0x1401;
+
+/** Construit la chaine de mipmaps complete d'une image RGBA8 (filtre boite 2x2) */
+std::vector<texture_level> build_mipmaps_rgba8(const unsigned char* rgba,int width,int height);
+/** Texture RGBA8 non compressee avec tous ses niveaux */
+texture_data texture_rgba8(const unsigned char* rgba,int width,int height);
+
+/** Pixels d'une image (gris, gris+alpha, RGB ou RGBA) convertis en RGBA8 */
+std::vector<unsigned char> image_rgba8(const Image& image);
+/** Texture RGBA8 d'une image, avec tous ses niveaux ou seulement le niveau 0 */
+texture_data texture_from_image(const Image& image,bool mipmaps);
+/** Nombre de niveaux de la chaine complete (jusqu'a 1x1) */
+int texture_level_count(int width,int height);
+/** Taille en octets de tous les niveaux */
+size_t texture_memory(const texture_data& texture);
+size_t texture_memory(const texture_view& texture);
+
+#endif
@@ -0,0 +1,205 @@
+
+#include "texture_stream.hpp"
+
+#include "glhelper.hpp"
+
+#include <cstring>
+
+namespace
+{
+  /** debut de chaque niveau aligne pour GL_UNPACK_ALIGNMENT et les copies vectorisees */
+  const size_t level_alignment=64;
+
+  size_t align(size_t n)
+  {
+    return (n+level_alignment-1)/level_alignment*level_alignment;
+  }
+}
+
+texture_stream_block::texture_stream_block()
+  :id(0),layout()
+{}
+
+texture_stream::texture_stream(size_t capacity)
+  :buffer(0),memory(nullptr),client_memory(),size(align(capacity)),mutex(),regions(),next_id(1)
+{
+  if(GLEW_VERSION_4_4 || GLEW_ARB_buffer_storage)
+  {
+    const GLbitfield flags=GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    glGenBuffers(1,&buffer);                                                              CHECK_GL_ERROR();
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER,buffer);                                          CHECK_GL_ERROR();
+    glBufferStorage(GL_PIXEL_UNPACK_BUFFER,size,nullptr,flags);                           CHECK_GL_ERROR();
+    memory=static_cast<unsigned char*>(glMapBufferRange(GL_PIXEL_UNPACK_BUFFER,0,size,flags)); CHECK_GL_ERROR();
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER,0);                                               CHECK_GL_ERROR();
+    if(memory==nullptr)
+    {
+      glDeleteBuffers(1,&buffer);                                                         CHECK_GL_ERROR();
+      buffer=0;
+    }
+  }
+  if(buffer==0)
+  {
+    client_memory.resize(size);
+    memory=&client_memory[0];
+  }
+}
+
+texture_stream::~texture_stream()
+{
+  for(unsigned int k=0;k<regions.size();++k)
+    if(regions[k].fence!=0)
+    {
+      glClientWaitSync(regions[k].fence,GL_SYNC_FLUSH_COMMANDS_BIT,GL_TIMEOUT_IGNORED);  CHECK_GL_ERROR();
+      glDeleteSync(regions[k].fence);                                                     CHECK_GL_ERROR();
+    }
+  if(buffer!=0)
+  {
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER,buffer);                                          CHECK_GL_ERROR();
+    glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);                                                CHECK_GL_ERROR();
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER,0);                                               CHECK_GL_ERROR();
+    glDeleteBuffers(1,&buffer);                                                           CHECK_GL_ERROR();
+  }
+}
+
+bool texture_stream::reserve(size_t n,size_t* offset,unsigned long long* id)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  size_t position=0;
+  if(!regions.empty())
+  {
+    //zones occupees de begin (la plus ancienne) a end (la plus recente), eventuellement repliees
+    const size_t begin=regions.front().offset;
+    const size_t end=regions.back().offset+regions.back().size;
+    if(regions.back().offset>=begin)
+    {
+      if(size-end>=n)       position=end;
+      else if(begin>=n)     position=0;
+      else                  return false;
+    }
+    else if(begin-end>=n)   position=end;
+    else                    return false;
+  }
+  else if(n>size)
+    return false;
+
+  region r;
+  r.id=next_id++;
+  r.offset=position;
+  r.size=n;
+  r.done=false;
+  r.fence=0;
+  regions.push_back(r);
+  *offset=position;
+  *id=r.id;
+  return true;
+}
+
+texture_stream::region* texture_stream::find(unsigned long long id)
+{
+  for(unsigned int k=0;k<regions.size();++k)
+    if(regions[k].id==id)
+      return &regions[k];
+  return nullptr;
+}
+
+bool texture_stream::write(const texture_view& texture,texture_stream_block* block)
+{
+  if(texture.levels.empty() || !glhelper::texture_format_supported(texture))
+    return false;
+
+  size_t n=0;
+  for(unsigned int k=0;k<texture.levels.size();++k)
+    n+=align(texture.levels[k].size);
+  size_t offset=0;
+  if(!reserve(n,&offset,&block->id))
+    return false;
+
+  //copie hors verrou: la zone n'appartient qu'a ce bloc jusqu'a son envoi
+  block->layout=texture;
+  for(unsigned int k=0;k<texture.levels.size();++k)
+  {
+    texture_level_view& l=block->layout.levels[k];
+    std::memcpy(memory+offset,l.data,l.size);
+    l.data=reinterpret_cast<const unsigned char*>(offset);
+    offset+=align(l.size);
+  }
+  return true;
+}
+
+GLuint texture_stream::upload(const texture_stream_block& block,const std::string& label)
+{
+  retire();
+
+  GLuint texture_id=0;
+  if(buffer!=0)
+  {
+    //positions dans le buffer lie: la copie vers la texture est faite par le GPU
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER,buffer);                                          CHECK_GL_ERROR();
+    texture_id=glhelper::create_texture(block.layout,label);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER,0);                                               CHECK_GL_ERROR();
+  }
+  else
+  {
+    texture_view view=block.layout;
+    for(unsigned int k=0;k<view.levels.size();++k)
+      view.levels[k].data=memory+reinterpret_cast<size_t>(view.levels[k].data);
+    texture_id=glhelper::create_texture(view,label);
+  }
+
+  std::lock_guard<std::mutex> lock(mutex);
+  region* r=find(block.id);
+  if(r!=nullptr)
+  {
+    r->done=true;
+    if(buffer!=0)
+    {
+      r->fence=glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE,0);                              CHECK_GL_ERROR();
+    }
+  }
+  return texture_id;
+}
+
+void texture_stream::discard(const texture_stream_block& block)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  region* r=find(block.id);
+  if(r!=nullptr)
+    r->done=true;
+}
+
+void texture_stream::retire()
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  //la place se libere dans l'ordre de reservation: un bloc en cours d'ecriture retient les suivants
+  while(!regions.empty() && regions.front().done)
+  {
+    region& r=regions.front();
+    if(r.fence!=0)
+    {
+      const GLenum status=glClientWaitSync(r.fence,0,0);                                 CHECK_GL_ERROR();
+      if(status!=GL_ALREADY_SIGNALED && status!=GL_CONDITION_SATISFIED)
+        break;
+      glDeleteSync(r.fence);                                                              CHECK_GL_ERROR();
+    }
+    regions.pop_front();
+  }
+}
+
+bool texture_stream::persistent() const
+{
+  return buffer!=0;
+}
+
+size_t texture_stream::capacity() const
+{
+  return size;
+}
+
+size_t texture_stream::used() const
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  size_t n=0;
+  for(unsigned int k=0;k<regions.size();++k)
+    n+=regions[k].size;
+  return n;
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#ifndef TEXTURE_STREAM_HPP
+#define TEXTURE_STREAM_HPP
+
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#define GLEW_STATIC 1
+#include <GL/glew.h>
+
+#include "texture_data.hpp"
+
+/** Niveaux d'une texture ecrits dans l'anneau, en attente d'envoi */
+struct texture_stream_block
+{
+  /** numero de la zone reservee, 0 si le bloc est vide */
+  unsigned long long id;
+  /** niveaux dont les pointeurs sont des positions depuis le debut de l'anneau */
+  texture_view layout;
+
+  texture_stream_block();
+};
+
+/** Anneau de transfert des textures vers le GPU (Pixel Buffer Object).
+ *
+ *  Un GL_PIXEL_UNPACK_BUFFER est projete une fois pour toutes en memoire (glBufferStorage,
+ *  GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT). Les threads du pool y ecrivent les niveaux
+ *  prets a envoyer; le thread OpenGL n'a plus qu'a lancer glTexSubImage2D depuis le buffer,
+ *  copie faite par le GPU sans bloquer l'image en cours. Une barriere (glFenceSync) posee
+ *  apres chaque envoi rend la place a l'anneau quand le GPU a fini de lire.
+ *
+ *  Sans glBufferStorage (OpenGL < 4.4 et pas d'ARB_buffer_storage), l'anneau est en memoire
+ *  du processus et l'envoi se fait depuis cette memoire, comme create_texture.
+ */
+class texture_stream
+{
+public:
+  /** A creer sur le thread OpenGL, capacity en octets */
+  explicit texture_stream(size_t capacity=64*1024*1024);
+  /** Thread OpenGL: attend la fin des envois puis libere le buffer */
+  ~texture_stream();
+
+  /** Tout thread: copie les niveaux de texture dans l'anneau. Renvoie false si la place manque
+   *  ou si le GPU ne lit pas ses blocs compresses: la texture est alors envoyee directement. */
+  bool write(const texture_view& texture,texture_stream_block* block);
+  /** Thread OpenGL: cree la texture depuis le bloc (voir glhelper::create_texture) et rend sa place
+   *  des que le GPU a fini de la lire */
+  GLuint upload(const texture_stream_block& block,const std::string& label="");
+  /** Thread OpenGL: rend la place d'un bloc ecrit qui ne sera pas envoye */
+  void discard(const texture_stream_block& block);
+  /** Thread OpenGL: recupere la place des envois termines (fait aussi par upload) */
+  void retire();
+
+  /** Vrai si l'anneau est un buffer OpenGL projete de facon persistante */
+  bool persistent() const;
+  size_t capacity() const;
+  /** Octets reserves par des blocs non encore rendus */
+  size_t used() const;
+
+private:
+  texture_stream(const texture_stream&);
+  texture_stream& operator=(const texture_stream&);
+
+  /** Zone de l'anneau, rendue dans l'ordre de reservation */
+  struct region
+  {
+    unsigned long long id;
+    size_t offset;
+    size_t size;
+    bool done;
+    GLsync fence;
+  };
+
+  bool reserve(size_t size,size_t* offset,unsigned long long* id);
+  region* find(unsigned long long id);
+
+  GLuint buffer;
+  unsigned char* memory;
+  std::vector<unsigned char> client_memory;
+  size_t size;
+
+  mutable std::mutex mutex;
+  std::deque<region> regions;
+  unsigned long long next_id;
+};
+
+#endif
@@ -1,509 +1,333 @@
-// use STB for windows compatibility
+// use STB for windows compatibility (jpg, png et tga a palette)
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
 #include "image.hpp"
-#include <fstream>
+#include "mapped_file.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#if defined(__SSSE3__)
+#include <tmmintrin.h>
+#endif
+
+namespace
+{
+  void release_array(unsigned char* p) { delete[] p; }
+  void release_stb(unsigned char* p) { stbi_image_free(p); }
+
+  // en-tete tga (18 octets, petit-boutiste)
+  struct tga_header
+  {
+    int id_length;
+    int color_map_type;
+    int image_type;
+    int color_map_length;
+    int color_map_entry_size;
+    int width;
+    int height;
+    int bits_per_pixel;
+    int descriptor;
+  };
+
+  int read_u16(const unsigned char* p) { return p[0] | (p[1] << 8); }
+
+  // lit l'en-tete et renvoie le debut des pixels, nullptr si le fichier n'est pas une tga geree
+  // (types 2/3 non compresses, 10/11 RLE, en 24/32 bits couleur ou 8 bits gris, sans palette)
+  const unsigned char* parse_header(const unsigned char* data, size_t size, tga_header* h)
+  {
+    if(data == nullptr || size < 18)
+      return nullptr;
+    h->id_length = data[0];
+    h->color_map_type = data[1];
+    h->image_type = data[2];
+    h->color_map_length = read_u16(data + 5);
+    h->color_map_entry_size = data[7];
+    h->width = read_u16(data + 12);
+    h->height = read_u16(data + 14);
+    h->bits_per_pixel = data[16];
+    h->descriptor = data[17];
+
+    const bool color = h->image_type == 2 || h->image_type == 10;
+    const bool gray = h->image_type == 3 || h->image_type == 11;
+    if(h->color_map_type != 0 || (!color && !gray) || h->width == 0 || h->height == 0)
+      return nullptr;
+    if((color && h->bits_per_pixel != 24 && h->bits_per_pixel != 32) || (gray && h->bits_per_pixel != 8))
+      return nullptr;
+
+    const size_t offset = 18 + h->id_length;
+    return offset <= size ? data + offset : nullptr;
+  }
+
+  // BGRA -> RGBA: echange des octets 0 et 2 de chaque mot de 32 bits, 4 pixels par instruction en SSE2
+  void swizzle_bgra(const unsigned char* src, unsigned char* dst, size_t n)
+  {
+    size_t k = 0;
+#if defined(__SSE2__)
+    const __m128i mask_ga = _mm_set1_epi32(static_cast<int>(0xFF00FF00u));
+    const __m128i mask_low = _mm_set1_epi32(0x000000FF);
+    for(; k + 4 <= n; k += 4)
+    {
+      const __m128i p = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 4*k));
+      const __m128i ga = _mm_and_si128(p, mask_ga);
+      const __m128i r = _mm_and_si128(_mm_srli_epi32(p, 16), mask_low);
+      const __m128i b = _mm_slli_epi32(_mm_and_si128(p, mask_low), 16);
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 4*k), _mm_or_si128(ga, _mm_or_si128(r, b)));
+    }
+#endif
+    for(; k < n; ++k)
+    {
+      const unsigned char b = src[4*k], g = src[4*k + 1], r = src[4*k + 2], a = src[4*k + 3];
+      dst[4*k] = r;
+      dst[4*k + 1] = g;
+      dst[4*k + 2] = b;
+      dst[4*k + 3] = a;
+    }
+  }
+
+  // BGR -> RGB, 5 pixels par pshufb quand SSSE3 est disponible
+  void swizzle_bgr(const unsigned char* src, unsigned char* dst, size_t n)
+  {
+    size_t k = 0;
+#if defined(__SSSE3__)
+    const __m128i shuffle = _mm_setr_epi8(2, 1, 0, 5, 4, 3, 8, 7, 6, 11, 10, 9, 14, 13, 12, 15);
+    //16 octets lus et ecrits pour 15 utiles: le dernier pixel est laisse a la boucle scalaire
+    for(; k + 6 <= n; k += 5)
+    {
+      const __m128i p = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 3*k));
+      const __m128i q = _mm_shuffle_epi8(p, shuffle);
+      //l'octet 15 appartient au pixel suivant: il est recopie tel quel puis reecrit au tour suivant
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 3*k), q);
+    }
+#endif
+    for(; k < n; ++k)
+    {
+      const unsigned char b = src[3*k], g = src[3*k + 1], r = src[3*k + 2];
+      dst[3*k] = r;
+      dst[3*k + 1] = g;
+      dst[3*k + 2] = b;
+    }
+  }
+
+  void convert_pixels(const unsigned char* src, unsigned char* dst, size_t n, int channels)
+  {
+    if(channels == 4)      swizzle_bgra(src, dst, n);
+    else if(channels == 3) swizzle_bgr(src, dst, n);
+    else                   std::memcpy(dst, src, n);
+  }
+
+  // decodeur de pixels ecrivant chaque ligne du fichier a sa place dans l'image (premiere ligne en haut)
+  struct tga_rows
+  {
+    unsigned char* pixels;
+    int width;
+    int height;
+    int channels;
+    bool bottom_up;
+
+    unsigned char* row(int r) const
+    {
+      const int y = bottom_up ? height - 1 - r : r;
+      return pixels + static_cast<size_t>(channels)*width*y;
+    }
+  };
+
+  bool decode_raw(const unsigned char* p, const unsigned char* end, const tga_rows& rows)
+  {
+    const size_t row_size = static_cast<size_t>(rows.channels)*rows.width;
+    if(static_cast<size_t>(end - p) < row_size*rows.height)
+      return false;
+    for(int r = 0; r < rows.height; ++r)
+      convert_pixels(p + row_size*r, rows.row(r), rows.width, rows.channels);
+    return true;
+  }
+
+  // paquets RLE: repetition d'un pixel ou suite de pixels bruts, un paquet peut deborder sur la ligne suivante
+  bool decode_rle(const unsigned char* p, const unsigned char* end, const tga_rows& rows)
+  {
+    const int channels = rows.channels;
+    int x = 0, r = 0;
+    unsigned char* row = rows.row(0);
+    while(r < rows.height)
+    {
+      if(p >= end)
+        return false;
+      const int header = *p++;
+      int count = (header & 127) + 1;
+      if(header & 128)
+      {
+        if(end - p < channels)
+          return false;
+        unsigned char pixel[4];
+        convert_pixels(p, pixel, 1, channels);
+        p += channels;
+        while(count > 0 && r < rows.height)
+        {
+          const int n = std::min(count, rows.width - x);
+          for(int k = 0; k < n; ++k)
+            std::memcpy(row + channels*(x + k), pixel, channels);
+          x += n;
+          count -= n;
+          if(x == rows.width && ++r < rows.height)
+          {
+            x = 0;
+            row = rows.row(r);
+          }
+        }
+      }
+      else
+      {
+        if(end - p < static_cast<ptrdiff_t>(count)*channels)
+          return false;
+        while(count > 0 && r < rows.height)
+        {
+          const int n = std::min(count, rows.width - x);
+          convert_pixels(p, row + channels*x, n, channels);
+          p += static_cast<size_t>(n)*channels;
+          x += n;
+          count -= n;
+          if(x == rows.width && ++r < rows.height)
+          {
+            x = 0;
+            row = rows.row(r);
+          }
+        }
+      }
+    }
+    return true;
+  }
+}
+
+Image::Image()
+  :width(0), height(0), type(IMAGE_TYPE_RGB), data(nullptr), release(release_array)
+{}
+
+Image::~Image()
+{
+  if(data != nullptr && release != nullptr)
+    release(data);
+}
+
+int image_channels(ImageType type)
+{
+  switch(type)
+  {
+  case IMAGE_TYPE_GRAY:  return 1;
+  case IMAGE_TYPE_GRAYA: return 2;
+  case IMAGE_TYPE_RGB:   return 3;
+  case IMAGE_TYPE_RGBA:  return 4;
+  }
+  return 0;
+}
 
 Image *image_load_tga(const std::string& filename)
 {
-  std::ifstream file(filename);
-  if(!file.is_open()){return nullptr;} 
+  // une seule ouverture: le fichier projete est decode directement en memoire
+  mapped_file file(filename);
+  if(!file.is_open() || file.size()==0){return nullptr;}
 
-  Image* im=new Image;
-  int type;
-  im->data = stbi_load(filename.c_str(), &im->width, &im->height, &type, 3);
-  im->type = IMAGE_TYPE_RGB;
+  return image_load_memory(reinterpret_cast<const unsigned char*>(file.data()), file.size());
+}
+
+Image *image_decode_tga(const unsigned char* data, size_t size)
+{
+  tga_header h;
+  const unsigned char* p = parse_header(data, size, &h);
+  if(p == nullptr)
+    return nullptr;
+  const unsigned char* end = data + size;
+
+  const int channels = h.bits_per_pixel/8;
+  unsigned char* pixels = new unsigned char[static_cast<size_t>(channels)*h.width*h.height];
+  const tga_rows rows = {pixels, h.width, h.height, channels, (h.descriptor & 0x20) == 0};
+  const bool ok = h.image_type >= 9 ? decode_rle(p, end, rows) : decode_raw(p, end, rows);
+  if(!ok)
+  {
+    delete[] pixels;
+    return nullptr;
+  }
+
+  // origine a droite (rare): lignes retournees horizontalement
+  if(h.descriptor & 0x10)
+    for(int y = 0; y < h.height; ++y)
+    {
+      unsigned char* row = pixels + static_cast<size_t>(channels)*h.width*y;
+      for(int x0 = 0, x1 = h.width - 1; x0 < x1; ++x0, --x1)
+        std::swap_ranges(row + channels*x0, row + channels*(x0 + 1), row + channels*x1);
+    }
+
+  // 32 bits sans bits d'alpha declares: le quatrieme octet n'est pas une transparence
+  if(channels == 4 && (h.descriptor & 0x0F) == 0)
+    for(size_t k = 0; k < static_cast<size_t>(h.width)*h.height; ++k)
+      pixels[4*k + 3] = 255;
+
+  Image* im = new Image;
+  im->width = h.width;
+  im->height = h.height;
+  im->data = pixels;
+  im->type = channels == 4 ? IMAGE_TYPE_RGBA : channels == 3 ? IMAGE_TYPE_RGB : IMAGE_TYPE_GRAY;
   return im;
 }
 
+bool image_view_tga(const unsigned char* data, size_t size, texture_view* view)
+{
+  tga_header h;
+  const unsigned char* p = parse_header(data, size, &h);
+  if(p == nullptr || h.image_type != 2 || (h.descriptor & 0x30) != 0x20)
+    return false;
+  // 32 bits sans bits d'alpha: le decodeur force l'alpha a 255, les octets du fichier ne conviennent pas
+  if(h.bits_per_pixel == 32 && (h.descriptor & 0x0F) == 0)
+    return false;
+  const size_t nb_byte = static_cast<size_t>(h.bits_per_pixel/8)*h.width*h.height;
+  if(static_cast<size_t>(data + size - p) < nb_byte)
+    return false;
+
+  view->gl_internal_format = texture_gl_rgba8;
+  view->gl_format = h.bits_per_pixel == 32 ? texture_gl_bgra : texture_gl_bgr;
+  view->gl_type = texture_gl_unsigned_byte;
+  view->levels.resize(1);
+  view->levels[0].width = h.width;
+  view->levels[0].height = h.height;
+  view->levels[0].data = p;
+  view->levels[0].size = nb_byte;
+  return true;
+}
+
+Image *image_load_memory(const unsigned char* data, size_t size)
+{
+  if(data==nullptr || size==0){return nullptr;}
 
-///* tga.c */
-//
-//#include <stdlib.h>
-//#include <stdio.h>
-//#include <errno.h>
-//#include <string.h>
-//
-//#include "image.hpp"
-//
-///* Round up a division to the nearest integer. */
-//#define ROUNDUP_DIVIDE(n,d) (((n) + (d - 1)) / (d))
-//
-///* TRUEVISION-XFILE magic signature string */
-//static unsigned char magic[18] =
-//{
-//  0x54, 0x52, 0x55, 0x45, 0x56, 0x49, 0x53, 0x49, 0x4f,
-//  0x4e, 0x2d, 0x58, 0x46, 0x49, 0x4c, 0x45, 0x2e, 0x0
-//};
-//
-//typedef struct tga_info_struct
-//{
-//  unsigned char idLength;
-//  unsigned char colorMapType;
-//
-//  unsigned char imageType;
-//  /* Known image types. */
-//#define TGA_TYPE_MAPPED      1
-//#define TGA_TYPE_COLOR       2
-//#define TGA_TYPE_GRAY        3
-//
-//  unsigned char imageCompression;
-//  /* Only known compression is RLE */
-//#define TGA_COMP_NONE        0
-//#define TGA_COMP_RLE         1
-//
-//  /* Color Map Specification. */
-//  /* We need to separately specify high and low bytes to avoid endianness
-//     and alignment problems. */
-//
-//  unsigned short colorMapIndex;
-//  unsigned short colorMapLength;
-//  unsigned char  colorMapSize;
-//
-//  /* Image Specification. */
-//  unsigned short xOrigin;
-//  unsigned short yOrigin;
-//
-//  unsigned short width;
-//  unsigned short height;
-//
-//  unsigned char bpp;
-//  unsigned char bytes;
-//
-//  unsigned char alphaBits;
-//  unsigned char flipHoriz;
-//  unsigned char flipVert;
-//
-//  /* Extensions (version 2) */
-//
-//  /* Not all the structures described in the standard are transcribed here
-//     only those which seem applicable to Gimp */
-//
-//  char         authorName[41];
-//  char         comment[324];
-//  unsigned int month, day, year, hour, minute, second;
-//  char         jobName[41];
-//  char         softwareID[41];
-//  unsigned int pixelWidth, pixelHeight;  /* write dpi? */
-//  double       gamma;
-//} tga_info;
-//
-//
-///* Declare some local functions.
-//*/
-//static Image *ReadImage (FILE       *fp,
-//    tga_info   *info);
-//
-//
-//  Image *
-//image_load_tga (const std::string &filename)
-//{
-//  FILE          *fp;
-//  tga_info       info;
-//  unsigned char  header[18];
-//  unsigned char  footer[26];
-//  unsigned char  extension[495];
-//  long           offset;
-//  Image         *image;
-//
-//  fp = fopen (filename.c_str (), "r");
-//  if (!fp)
-//  {
-//    printf ("Could not open '%s' for reading: %s\n", filename.c_str (), strerror (errno));
-//    return NULL;
-//  }
-//
-//  if (!fseek (fp, -26L, SEEK_END)) { /* Is file big enough for a footer? */
-//    if (fread (footer, sizeof (footer), 1, fp) != 1)
-//    {
-//      printf ("Cannot read footer from '%s'\n", filename.c_str ());
-//      return NULL;
-//    }
-//    else if (memcmp (footer + 8, magic, sizeof (magic)) == 0)
-//    {
-//      /* Check the signature. */
-//
-//      offset= footer[0] + (footer[1] * 256) + (footer[2] * 65536)
-//        + (footer[3] * 16777216);
-//
-//      if (offset != 0)
-//      {
-//        if (fseek (fp, offset, SEEK_SET) ||
-//            fread (extension, sizeof (extension), 1, fp) != 1)
-//        {
-//          printf ("Cannot read extension from '%s'\n", filename.c_str ());
-//          return NULL;
-//        }
-//        /* Eventually actually handle version 2 TGA here */
-//      }
-//    }
-//  }
-//
-//  if (fseek (fp, 0, SEEK_SET) ||
-//      fread (header, sizeof (header), 1, fp) != 1)
-//  {
-//    printf ("Cannot read header from '%s'\n", filename.c_str ());
-//    return NULL;
-//  }
-//
-//  switch (header[2])
-//  {
-//    case 1:
-//      info.imageType = TGA_TYPE_MAPPED;
-//      info.imageCompression = TGA_COMP_NONE;
-//      break;
-//    case 2:
-//      info.imageType = TGA_TYPE_COLOR;
-//      info.imageCompression = TGA_COMP_NONE;
-//      break;
-//    case 3:
-//      info.imageType = TGA_TYPE_GRAY;
-//      info.imageCompression = TGA_COMP_NONE;
-//      break;
-//
-//    case 9:
-//      info.imageType = TGA_TYPE_MAPPED;
-//      info.imageCompression = TGA_COMP_RLE;
-//      break;
-//    case 10:
-//      info.imageType = TGA_TYPE_COLOR;
-//      info.imageCompression = TGA_COMP_RLE;
-//      break;
-//    case 11:
-//      info.imageType = TGA_TYPE_GRAY;
-//      info.imageCompression = TGA_COMP_RLE;
-//      break;
-//
-//    default:
-//      info.imageType = 0;
-//  }
-//
-//  info.idLength     = header[0];
-//  info.colorMapType = header[1];
-//
-//  info.colorMapIndex  = header[3] + header[4] * 256;
-//  info.colorMapLength = header[5] + header[6] * 256;
-//  info.colorMapSize   = header[7];
-//
-//  info.xOrigin = header[8] + header[9] * 256;
-//  info.yOrigin = header[10] + header[11] * 256;
-//  info.width   = header[12] + header[13] * 256;
-//  info.height  = header[14] + header[15] * 256;
-//
-//  info.bpp       = header[16];
-//  info.bytes     = (info.bpp + 7) / 8;
-//  info.alphaBits = header[17] & 0x0f; /* Just the low 4 bits */
-//  info.flipHoriz = (header[17] & 0x10) ? 1 : 0;
-//  info.flipVert  = (header[17] & 0x20) ? 0 : 1;
-//
-//  /* hack to handle some existing files with incorrect headers, see bug #306675 */
-//  if (info.alphaBits == info.bpp)
-//    info.alphaBits = 0;
-//
-//  switch (info.imageType)
-//  {
-//    case TGA_TYPE_MAPPED:
-//      if (info.bpp != 8)
-//      {
-//        printf ("Unhandled sub-format in '%s'\n", filename.c_str ());
-//        return NULL;
-//      }
-//      break;
-//    case TGA_TYPE_COLOR:
-//      if (info.bpp != 15 && info.bpp != 16 && info.bpp != 24
-//          && info.bpp != 32)
-//      {
-//        printf ("Unhandled sub-format in '%s'\n", filename.c_str ());
-//        return NULL;
-//      }
-//      break;
-//    case TGA_TYPE_GRAY:
-//      if (info.bpp != 8 && (info.alphaBits != 8 || (info.bpp != 16 && info.bpp != 15)))
-//      {
-//        printf ("Unhandled sub-format in '%s'\n", filename.c_str ());
-//        return NULL;
-//      }
-//      break;
-//
-//    default:
-//      printf ("Unknown image type for '%s'\n", filename.c_str ());
-//      return NULL;
-//  }
-//
-//  /* Plausible but unhandled formats */
-//  if (info.bytes * 8 != info.bpp && !(info.bytes == 2 && info.bpp == 15))
-//  {
-//    puts ("No support yet for TGA with these parameters");
-//    return NULL;
-//  }
-//
-//  /* Check that we have a color map only when we need it. */
-//  if (info.imageType == TGA_TYPE_MAPPED && info.colorMapType != 1)
-//  {
-//    printf ("Indexed image has invalid color map type %d\n", info.colorMapType);
-//    return NULL;
-//  }
-//  else if (info.imageType != TGA_TYPE_MAPPED && info.colorMapType != 0)
-//  {
-//    printf ("Non-indexed image has invalid color map type %d\n", info.colorMapType);
-//    return NULL;
-//  }
-//
-//  /* Skip the image ID field. */
-//  if (info.idLength && fseek (fp, info.idLength, SEEK_CUR))
-//  {
-//    printf ("File '%s' is truncated or corrupted\n", filename.c_str ());
-//    return NULL;
-//  }
-//
-//  image = ReadImage (fp, &info);
-//  fclose (fp);
-//  return image;
-//}
-//
-//  static int
-//rle_read (FILE          *fp,
-//    unsigned char *buffer,
-//    tga_info      *info)
-//{
-//  static int           repeat = 0;
-//  static int           direct = 0;
-//  static unsigned char sample[4];
-//  int head;
-//  int x, k;
-//
-//  for (x = 0; x < info->width; x++)
-//  {
-//    if (repeat == 0 && direct == 0)
-//    {
-//      head = getc (fp);
-//
-//      if (head == EOF)
-//      {
-//        return EOF;
-//      }
-//      else if (head >= 128)
-//      {
-//        repeat = head - 127;
-//
-//        if (fread (sample, info->bytes, 1, fp) < 1)
-//          return EOF;
-//      }
-//      else
-//      {
-//        direct = head + 1;
-//      }
-//    }
-//
-//    if (repeat > 0)
-//    {
-//      for (k = 0; k < info->bytes; ++k)
-//      {
-//        buffer[k] = sample[k];
-//      }
-//
-//      repeat--;
-//    }
-//    else /* direct > 0 */
-//    {
-//      if (fread (buffer, info->bytes, 1, fp) < 1)
-//        return EOF;
-//
-//      direct--;
-//    }
-//
-//    buffer += info->bytes;
-//  }
-//
-//  return 0;
-//}
-//
-//  static void
-//flip_line (unsigned char *buffer,
-//    tga_info      *info)
-//{
-//  unsigned char  temp;
-//  unsigned char *alt;
-//  int            x, s;
-//
-//  alt = buffer + (info->bytes * (info->width - 1));
-//
-//  for (x = 0; x * 2 <= info->width; x++)
-//  {
-//    for (s = 0; s < info->bytes; ++s)
-//    {
-//      temp = buffer[s];
-//      buffer[s] = alt[s];
-//      alt[s] = temp;
-//    }
-//
-//    buffer += info->bytes;
-//    alt -= info->bytes;
-//  }
-//}
-//
-///* Some people write 16-bit RGB TGA files. The spec would probably
-//   allow 27-bit RGB too, for what it's worth, but I won't fix that
-//   unless someone actually provides an existence proof */
-//
-//  static void
-//upsample (unsigned char *dest,
-//    unsigned char *src,
-//    unsigned int   width,
-//    unsigned int   bytes,
-//    unsigned char  alphaBits)
-//{
-//  unsigned int x;
-//
-//  for (x = 0; x < width; x++)
-//  {
-//    dest[0] =  ((src[1] << 1) & 0xf8);
-//    dest[0] += (dest[0] >> 5);
-//
-//    dest[1] =  ((src[0] & 0xe0) >> 2) + ((src[1] & 0x03) << 6);
-//    dest[1] += (dest[1] >> 5);
-//
-//    dest[2] =  ((src[0] << 3) & 0xf8);
-//    dest[2] += (dest[2] >> 5);
-//
-//    switch (alphaBits)
-//    {
-//      case 1:
-//        dest[3] = (src[1] & 0x80)? 0: 255;
-//        dest += 4;
-//        break;
-//      default:
-//        dest += 3;
-//    }
-//
-//    src += bytes;
-//  }
-//}
-//
-//  static void
-//bgr2rgb (unsigned char *dest,
-//    unsigned char *src,
-//    unsigned int   width,
-//    unsigned int   bytes,
-//    unsigned int   alpha)
-//{
-//  unsigned int x;
-//
-//
-//  if (alpha)
-//  {
-//    for (x = 0; x < width; x++)
-//    {
-//      *(dest++) = src[2];
-//      *(dest++) = src[1];
-//      *(dest++) = src[0];
-//      *(dest++) = src[3];
-//
-//      src += bytes;
-//    }
-//  }
-//  else
-//  {
-//    for (x = 0; x < width; x++)
-//    {
-//      *(dest++) = src[2];
-//      *(dest++) = src[1];
-//      *(dest++) = src[0];
-//
-//      src += bytes;
-//    }
-//  }
-//}
-//
-//  static void
-//read_line (FILE          *fp,
-//    unsigned char *row,
-//    unsigned char *buffer,
-//    tga_info      *info)
-//{
-//  if (info->imageCompression == TGA_COMP_RLE)
-//  {
-//    rle_read (fp, buffer, info);
-//  }
-//  else
-//  {
-//    if(fread (buffer, info->bytes, info->width, fp)<1)
-//      perror("Incorrect read");
-//  }
-//
-//  if (info->flipHoriz)
-//  {
-//    flip_line (buffer, info);
-//  }
-//
-//  if (info->imageType == TGA_TYPE_COLOR)
-//  {
-//    if (info->bpp == 16 || info->bpp == 15)
-//    {
-//      upsample (row, buffer, info->width, info->bytes, info->alphaBits);
-//    }
-//    else
-//    {
-//      bgr2rgb (row, buffer,info->width,info->bytes, info->alphaBits);
-//    }
-//  }
-//  else
-//  {
-//    memcpy (row, buffer, info->width * info->bytes);
-//  }
-//}
-//
-//  static Image *
-//ReadImage (FILE       *fp,
-//    tga_info   *info)
-//{
-//  Image *image;
-//
-//  unsigned char *buffer, *row;
-//  int            y;
-//
-//  image = new Image;
-//
-//  switch (info->imageType)
-//  {
-//    case TGA_TYPE_GRAY:
-//      if (info->alphaBits)
-//        image->type = IMAGE_TYPE_GRAYA;
-//      else
-//        image->type = IMAGE_TYPE_GRAY;
-//      break;
-//
-//    case TGA_TYPE_COLOR:
-//      if (info->alphaBits)
-//        image->type = IMAGE_TYPE_RGBA;
-//      else
-//        image->type = IMAGE_TYPE_RGB;
-//      break;
-//  }
-//
-//  image->width  = info->width;
-//  image->height = info->height;
-//  image->data = new unsigned char [info->width * info->height * info->bytes];
-//  buffer      = new unsigned char [info->width * info->bytes];
-//
-//  if (info->flipVert)
-//  {
-//    for (y = 1; y <= info->height; ++y)
-//    {
-//      row = image->data + (info->width * info->bytes * (info->height - y));
-//      read_line (fp, row, buffer, info);
-//    }
-//  }
-//  else
-//  {
-//    for (y = 0; y < info->height; ++y)
-//    {
-//      row = image->data + (info->width * info->bytes * y);
-//      read_line (fp, row, buffer, info);
-//    }
-//  }
-//
-//  delete[] buffer;
-//
-//  return image;
-//}
+  // jpg et png se reconnaissent a leur signature, la tga n'en a pas
+  const bool jpg = size >= 2 && data[0] == 0xFF && data[1] == 0xD8;
+  const bool png = size >= 4 && std::memcmp(data, "\x89PNG", 4) == 0;
+  if(!jpg && !png)
+  {
+    Image* im = image_decode_tga(data, size);
+    if(im != nullptr)
+      return im;
+  }
+  // grande jpg a intervalles de redemarrage: bandes decodees en parallele
+  if(jpg)
+  {
+    Image* im = image_decode_jpeg_strips(data, size);
+    if(im != nullptr)
+      return im;
+  }
+
+  // canaux du fichier conserves (gris, gris + alpha, RGB, RGBA)
+  int width, height, channels;
+  unsigned char* pixels = stbi_load_from_memory(data, static_cast<int>(size), &width, &height, &channels, 0);
+  if(pixels==nullptr){return nullptr;}
+
+  static const ImageType types[] = {IMAGE_TYPE_GRAY, IMAGE_TYPE_GRAYA, IMAGE_TYPE_RGB, IMAGE_TYPE_RGBA};
+  Image* im=new Image;
+  im->width = width;
+  im->height = height;
+  im->data = pixels;
+  im->type = types[channels - 1];
+  im->release = release_stb;
+  return im;
+}
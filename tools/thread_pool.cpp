@@ -0,0 +1,182 @@
+
+#include "thread_pool.hpp"
+
+#include <algorithm>
+
+
+thread_pool::thread_pool(unsigned int nb_thread)
+  :stop(false)
+{
+  if(nb_thread==0)
+  {
+    const unsigned int nb_core=std::thread::hardware_concurrency();
+    nb_thread=nb_core>1 ? nb_core-1 : 1;
+  }
+  for(unsigned int k=0;k<nb_thread;++k)
+    threads.push_back(std::thread(&thread_pool::worker,this));
+}
+
+thread_pool::~thread_pool()
+{
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    stop=true;
+  }
+  condition.notify_all();
+  for(unsigned int k=0;k<threads.size();++k)
+    threads[k].join();
+}
+
+void thread_pool::push(const std::function<void()>& task)
+{
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    tasks.push_back(task);
+  }
+  condition.notify_one();
+}
+
+bool thread_pool::run_pending_task()
+{
+  std::function<void()> task;
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    if(tasks.empty())
+      return false;
+    task=tasks.front();
+    tasks.pop_front();
+  }
+  task();
+  return true;
+}
+
+unsigned int thread_pool::size() const
+{
+  return threads.size();
+}
+
+void thread_pool::worker()
+{
+  while(true)
+  {
+    std::function<void()> task;
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      while(!stop && tasks.empty())
+        condition.wait(lock);
+      if(tasks.empty())
+        return;
+      task=tasks.front();
+      tasks.pop_front();
+    }
+    task();
+  }
+}
+
+
+task_group::task_group(thread_pool& pool_param)
+  :pool(pool_param),pending(0)
+{}
+
+task_group::~task_group()
+{
+  //pas d'exception depuis un destructeur: elle est perdue si wait() n'a pas ete appele
+  wait_all();
+}
+
+void task_group::run(const std::function<void()>& task)
+{
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    ++pending;
+  }
+  task_group* group=this;
+  pool.push([task,group]() {
+    //une exception ne doit ni sortir du thread du pool (std::terminate) ni sauter la fin de la tache
+    std::exception_ptr error;
+    try
+    {
+      task();
+    }
+    catch(...)
+    {
+      error=std::current_exception();
+    }
+    group->finish(error);
+  });
+}
+
+void task_group::finish(std::exception_ptr error)
+{
+  //reveil sous le verrou: le groupe ne peut pas etre detruit avant la fin de notify_all
+  std::unique_lock<std::mutex> lock(mutex);
+  if(error && !first_error)
+    first_error=error;
+  --pending;
+  if(pending==0)
+    condition.notify_all();
+}
+
+void task_group::wait()
+{
+  wait_all();
+  std::exception_ptr error;
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    std::swap(error,first_error);
+  }
+  if(error)
+    std::rethrow_exception(error);
+}
+
+void task_group::wait_all()
+{
+  while(true)
+  {
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      if(pending==0)
+        return;
+    }
+    //les taches du groupe encore en file sont executees ici; quand la file est vide,
+    //celles qui restent tournent deja sur d'autres threads: on dort jusqu'a leur fin
+    if(!pool.run_pending_task())
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      condition.wait(lock,[this]() { return pending==0; });
+      return;
+    }
+  }
+}
+
+
+thread_pool& default_thread_pool()
+{
+  static thread_pool pool;
+  return pool;
+}
+
+void parallel_for(int begin,int end,int grain,const std::function<void(int,int)>& f)
+{
+  const int N=end-begin;
+  if(N<=0)
+    return;
+
+  thread_pool& pool=default_thread_pool();
+  const int nb_chunk_max=4*(pool.size()+1);
+  const int chunk=std::max(std::max(grain,1),(N+nb_chunk_max-1)/nb_chunk_max);
+  if(chunk>=N)
+  {
+    f(begin,end);
+    return;
+  }
+
+  task_group group(pool);
+  for(int k=begin+chunk;k<end;k+=chunk)
+  {
+    const int k_end=std::min(k+chunk,end);
+    group.run([&f,k,k_end]() { f(k,k_end); });
+  }
+  f(begin,std::min(begin+chunk,end));
+  group.wait();
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#ifndef THREAD_POOL_HPP
+#define THREAD_POOL_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/** Un ensemble de threads executant des taches dans l'ordre de soumission */
+class thread_pool
+{
+public:
+  /** Cree nb_thread threads (0: nombre de coeurs moins un, au minimum 1) */
+  explicit thread_pool(unsigned int nb_thread=0);
+  /** Termine les taches en cours et arrete les threads */
+  ~thread_pool();
+
+  /** Ajoute une tache a executer */
+  void push(const std::function<void()>& task);
+  /** Execute une tache en attente sur le thread appelant, renvoie false si la file est vide */
+  bool run_pending_task();
+  /** Nombre de threads du pool */
+  unsigned int size() const;
+
+private:
+  thread_pool(const thread_pool&);
+  thread_pool& operator=(const thread_pool&);
+
+  void worker();
+
+  std::vector<std::thread> threads;
+  std::deque<std::function<void()> > tasks;
+  std::mutex mutex;
+  std::condition_variable condition;
+  bool stop;
+};
+
+/** Un groupe de taches dont on peut attendre la fin.
+ *  Le thread qui attend execute lui-meme les taches en attente, ce qui permet
+ *  d'imbriquer des groupes depuis une tache du pool sans interblocage.
+ *  Une exception levee par une tache est gardee (la premiere seulement) et relancee par wait(). */
+class task_group
+{
+public:
+  explicit task_group(thread_pool& pool);
+  ~task_group();
+
+  /** Soumet une tache au pool */
+  void run(const std::function<void()>& task);
+  /** Attend la fin de toutes les taches soumises, puis relance la premiere exception levee par l'une d'elles */
+  void wait();
+
+private:
+  task_group(const task_group&);
+  task_group& operator=(const task_group&);
+
+  /** Attend la fin des taches sans relancer d'exception (utilise par le destructeur) */
+  void wait_all();
+  /** Fin d'une tache: garde son exception eventuelle et reveille le thread qui attend */
+  void finish(std::exception_ptr error);
+
+  thread_pool& pool;
+  int pending;
+  std::exception_ptr first_error;
+  std::mutex mutex;
+  std::condition_variable condition;
+};
+
+/** Pool partage par les chargeurs et les structures acceleratrices */
+thread_pool& default_thread_pool();
+
+/** Decoupe [begin,end[ en intervalles d'au moins grain elements et appelle f(debut,fin) en parallele */
+void parallel_for(int begin,int end,int grain,const std::function<void(int,int)>& f);
+
+#endif